@@ -50,6 +50,12 @@ static cll::opt<unsigned long long>
     src_node("startNode", // not uint64_t due to a bug in llvm cl
              cll::desc("ID of the source node"), cll::init(0));
 
+static cll::opt<bool>
+    pipelineSync("pipelineSync",
+                 cll::desc("Overlap the sync of each round with its "
+                           "computation: Default false"),
+                 cll::init(false));
+
 /******************************************************************************/
 /* Graph structure declarations + other initialization */
 /******************************************************************************/
@@ -127,6 +133,9 @@ struct BFS {
     do {
       _graph.set_num_round(_num_iterations);
       dga.reset();
+#ifndef __GALOIS_HET_ASYNC__
+      bool synced = false;
+#endif
 #ifdef __GALOIS_HET_CUDA__
       if (personality == GPU_CUDA) {
         std::string impl_str("BFS_" + (_graph.get_run_identifier()));
@@ -139,17 +148,30 @@ struct BFS {
       } else if (personality == CPU)
 #endif
       {
-        galois::do_all(
-            galois::iterate(nodesWithEdges), BFS(&_graph, dga),
-            galois::no_stats(), galois::steal(),
-            galois::loopname(_graph.get_run_identifier("BFS").c_str()));
+#ifndef __GALOIS_HET_ASYNC__
+        if (pipelineSync) {
+          _graph.sync_pipelined<writeSource, readDestination,
+                                Reduce_min_dist_current,
+                                Broadcast_dist_current, Bitset_dist_current>(
+              nodesWithEdges, BFS(&_graph, dga), "BFS");
+          synced = true;
+        } else
+#endif
+        {
+          galois::do_all(
+              galois::iterate(nodesWithEdges), BFS(&_graph, dga),
+              galois::no_stats(), galois::steal(),
+              galois::loopname(_graph.get_run_identifier("BFS").c_str()));
+        }
       }
 #ifdef __GALOIS_HET_ASYNC__
       _graph.sync<writeSource, readDestination, Reduce_min_dist_current,
                   Broadcast_dist_current, Bitset_dist_current, true>("BFS");
 #else
-      _graph.sync<writeSource, readDestination, Reduce_min_dist_current,
-                  Broadcast_dist_current, Bitset_dist_current>("BFS");
+      if (!synced) {
+        _graph.sync<writeSource, readDestination, Reduce_min_dist_current,
+                    Broadcast_dist_current, Bitset_dist_current>("BFS");
+      }
 #endif
 
       galois::runtime::reportStat_Tsum(
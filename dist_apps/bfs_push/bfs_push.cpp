@@ -58,6 +58,13 @@ static cll::opt<uint32_t>
              cll::desc("Shift value for the delta step (default value 0)"),
              cll::init(0));
 
+static cll::opt<unsigned int>
+    rebalanceEvery("rebalanceEvery",
+                   cll::desc("Move masters of active nodes between hosts "
+                             "every this many rounds (default value 0: "
+                             "never); needs an edge cut such as goec"),
+                   cll::init(0));
+
 /******************************************************************************/
 /* Graph structure declarations + other initialization */
 /******************************************************************************/
@@ -195,17 +202,24 @@ struct BFS {
 
     unsigned _num_iterations = 1;
 
-    const auto& nodesWithEdges = _graph.allNodesWithEdgesRange();
-
     uint32_t priority;
     if (delta == 0) priority = std::numeric_limits<uint32_t>::max();
     else priority = 0;
     galois::GAccumulator<uint32_t> work_items;
+#ifndef __GALOIS_HET_ASYNC__
+    galois::DGReduceHandle<unsigned int> numActive;
+#endif
 
     do {
 
       if (work_items.reduce() == 0) priority += delta;
 
+#if !defined(__GALOIS_HET_CUDA__) && !defined(__GALOIS_HET_ASYNC__)
+      if (rebalanceEvery && (_num_iterations % rebalanceEvery) == 0) {
+        rebalance(_graph);
+      }
+#endif
+
       _graph.set_num_round(_num_iterations);
       dga.reset();
       work_items.reset();
@@ -224,7 +238,8 @@ struct BFS {
 #endif
       {
         galois::do_all(
-            galois::iterate(nodesWithEdges), BFS(priority, &_graph, dga, work_items), galois::steal(),
+            galois::iterate(_graph.allNodesWithEdgesRange()),
+            BFS(priority, &_graph, dga, work_items), galois::steal(),
             galois::no_stats(),
             galois::loopname(_graph.get_run_identifier("BFS").c_str()));
       }
@@ -232,6 +247,8 @@ struct BFS {
       _graph.sync<writeDestination, readSource, Reduce_min_dist_current,
                   Broadcast_dist_current, Bitset_dist_current, true>("BFS");
 #else
+      // the number of active nodes is final now: reduce it while syncing
+      numActive = dga.reduce_async(_graph.get_run_identifier());
       _graph.sync<writeDestination, readSource, Reduce_min_dist_current,
                   Broadcast_dist_current, Bitset_dist_current>("BFS");
 #endif
@@ -243,15 +260,34 @@ struct BFS {
       ++_num_iterations;
     } while (
 #ifndef __GALOIS_HET_ASYNC__
-             (_num_iterations < maxIterations) &&
+             (_num_iterations < maxIterations) && numActive.wait()
+#else
+             dga.reduce(_graph.get_run_identifier())
 #endif
-             dga.reduce(_graph.get_run_identifier()));
+             );
 
     galois::runtime::reportStat_Tmax(
         regionname, "NumIterations_" + std::to_string(_graph.get_run_num()),
         (unsigned long)_num_iterations);
   }
 
+  /**
+   * Moves masters from hosts with many active nodes to hosts with few; the
+   * work of an active node is its number of edges.
+   */
+  void static rebalance(Graph& _graph) {
+    bool moved = _graph.rebalance_masters([&](uint32_t src) -> uint64_t {
+      NodeData& snode = _graph.getData(src);
+      if (snode.dist_old <= snode.dist_current)
+        return 0;
+      return 1 + std::distance(_graph.edge_begin(src), _graph.edge_end(src));
+    });
+    if (moved) {
+      bitset_dist_current.resize(_graph.size());
+      bitset_dist_current.reset();
+    }
+  }
+
   void operator()(GNode src) const {
     NodeData& snode = graph->getData(src);
 
@@ -315,8 +351,10 @@ struct BFSSanityCheck {
                      galois::no_stats(), galois::loopname("BFSSanityCheck"));
     }
 
-    uint64_t num_visited  = dgas.reduce();
-    uint32_t max_distance = dgm.reduce();
+    galois::DGReduceFused reduceAll;
+    reduceAll.add(dgas).add(dgm).reduce();
+    uint64_t num_visited  = dgas.read();
+    uint32_t max_distance = dgm.read();
 
     // Only host 0 will print the info
     if (galois::runtime::getSystemNetworkInterface().ID == 0) {
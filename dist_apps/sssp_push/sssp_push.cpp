@@ -199,6 +199,9 @@ struct SSSP {
     if (delta == 0) priority = std::numeric_limits<uint32_t>::max();
     else priority = 0;
     galois::GAccumulator<uint32_t> work_items;
+#ifndef __GALOIS_HET_ASYNC__
+    galois::DGReduceHandle<unsigned int> numActive;
+#endif
 
     do {
 
@@ -232,6 +235,8 @@ struct SSSP {
       _graph.sync<writeDestination, readSource, Reduce_min_dist_current,
                   Broadcast_dist_current, Bitset_dist_current, true>("SSSP");
 #else
+      // the number of active nodes is final now: reduce it while syncing
+      numActive = dga.reduce_async(_graph.get_run_identifier());
       _graph.sync<writeDestination, readSource, Reduce_min_dist_current,
                   Broadcast_dist_current, Bitset_dist_current>("SSSP");
 #endif
@@ -242,9 +247,11 @@ struct SSSP {
       ++_num_iterations;
     } while (
 #ifndef __GALOIS_HET_ASYNC__
-             (_num_iterations < maxIterations) &&
+             (_num_iterations < maxIterations) && numActive.wait()
+#else
+             dga.reduce(_graph.get_run_identifier())
 #endif
-             dga.reduce(_graph.get_run_identifier()));
+             );
 
     galois::runtime::reportStat_Tmax(
         "SSSP", "NumIterations_" + std::to_string(_graph.get_run_num()),
@@ -318,10 +325,12 @@ struct SSSPSanityCheck {
                      galois::no_stats(), galois::loopname("SSSPSanityCheck"));
     }
 
-    uint64_t num_visited  = dgas.reduce();
-    uint32_t max_distance = dgm.reduce();
+    galois::DGReduceFused reduceAll;
+    reduceAll.add(dgas).add(dgm).add(dgag).reduce();
+    uint64_t num_visited  = dgas.read();
+    uint32_t max_distance = dgm.read();
 
-    float visit_average = ((float)dgag.reduce()) / num_visited;
+    float visit_average = ((float)dgag.read()) / num_visited;
 
     // Only host 0 will print the info
     if (galois::runtime::getSystemNetworkInterface().ID == 0) {
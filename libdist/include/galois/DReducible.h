@@ -26,15 +26,323 @@
 #ifndef GALOIS_DISTACCUMULATOR_H
 #define GALOIS_DISTACCUMULATOR_H
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
 #include "galois/Galois.h"
 #include "galois/Reduction.h"
 #include "galois/AtomicHelpers.h"
 #include "galois/runtime/LWCI.h"
 #include "galois/runtime/DistStats.h"
+#include "galois/runtime/Network.h"
 
 namespace galois {
 
+namespace runtime {
+namespace internal {
+
+//! False if the network IO layer runs without MPI (e.g. over TCP)
+inline bool reduceWithMPI() {
+  int initialized;
+  MPI_Initialized(&initialized);
+  return initialized;
+}
+
+/**
+ * All-reduce over the network interface for when MPI is not available: every
+ * host sends its value to every other host and combines what it receives.
+ */
+template <typename Ty, typename Op>
+Ty reduceWithMessages(Ty value, Op op) {
+  auto& net = getSystemNetworkInterface();
+  for (unsigned h = 0; h < net.Num; ++h) {
+    if (h == net.ID)
+      continue;
+    SendBuffer b;
+    gSerialize(b, value);
+    net.sendTagged(h, evilPhase, b);
+  }
+  net.flush();
+
+  for (unsigned received = 1; received < net.Num; ++received) {
+    decltype(net.recieveTagged(evilPhase, nullptr)) p;
+    do {
+      net.handleReceives();
+      p = net.recieveTagged(evilPhase, nullptr);
+    } while (!p);
+    Ty other;
+    gDeserialize(p->second, other);
+    value = op(value, other);
+  }
+
+  ++evilPhase;
+  if (evilPhase >= std::numeric_limits<int16_t>::max()) // limit defined by MPI
+    evilPhase = 1;
+  return value;
+}
+
+#ifndef GALOIS_USE_LWCI
+//! MPI datatype of the types supported by the distributed reducers
+template <typename Ty>
+MPI_Datatype mpiType() {
+  static_assert(std::is_same<Ty, int32_t>::value ||
+                    std::is_same<Ty, int64_t>::value ||
+                    std::is_same<Ty, uint32_t>::value ||
+                    std::is_same<Ty, uint64_t>::value ||
+                    std::is_same<Ty, float>::value ||
+                    std::is_same<Ty, double>::value ||
+                    std::is_same<Ty, long double>::value,
+                "Type not supported for MPI reduction");
+  if (std::is_same<Ty, int32_t>::value)
+    return MPI_INT;
+  if (std::is_same<Ty, int64_t>::value)
+    return MPI_LONG;
+  if (std::is_same<Ty, uint32_t>::value)
+    return MPI_UNSIGNED;
+  if (std::is_same<Ty, uint64_t>::value)
+    return MPI_UNSIGNED_LONG;
+  if (std::is_same<Ty, float>::value)
+    return MPI_FLOAT;
+  if (std::is_same<Ty, double>::value)
+    return MPI_DOUBLE;
+  return MPI_LONG_DOUBLE;
+}
+#endif
+
+//! Operations a fused reduction can apply to a value
+enum FusedReduceOp : uint32_t { fusedSum, fusedMax, fusedMin };
+
+/**
+ * One value of a fused reduction. The operation and type travel with the
+ * value so that a single reduction operator can combine all of them.
+ */
+struct FusedSlot {
+  uint64_t value; //!< bits of the value
+  uint32_t op;    //!< FusedReduceOp to apply
+  uint32_t type;  //!< FusedType of the value
+};
+
+//! Code of the types a fused reduction supports
+template <typename Ty>
+struct FusedType;
+template <>
+struct FusedType<int32_t> : std::integral_constant<uint32_t, 0> {};
+template <>
+struct FusedType<int64_t> : std::integral_constant<uint32_t, 1> {};
+template <>
+struct FusedType<uint32_t> : std::integral_constant<uint32_t, 2> {};
+template <>
+struct FusedType<uint64_t> : std::integral_constant<uint32_t, 3> {};
+template <>
+struct FusedType<float> : std::integral_constant<uint32_t, 4> {};
+template <>
+struct FusedType<double> : std::integral_constant<uint32_t, 5> {};
+
+//! Combines the value bits in into inout as a Ty
+template <typename Ty>
+void combineFusedValue(uint32_t op, uint64_t in, uint64_t& inout) {
+  Ty a, b;
+  std::memcpy(&a, &in, sizeof(Ty));
+  std::memcpy(&b, &inout, sizeof(Ty));
+  if (op == fusedSum)
+    b = a + b;
+  else if (op == fusedMax)
+    b = std::max(a, b);
+  else
+    b = std::min(a, b);
+  std::memcpy(&inout, &b, sizeof(Ty));
+}
+
+//! Combines n slots of in into the matching slots of inout
+inline void combineFusedSlots(const FusedSlot* in, FusedSlot* inout,
+                              size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    uint32_t op = inout[i].op;
+    switch (inout[i].type) {
+    case FusedType<int32_t>::value:
+      combineFusedValue<int32_t>(op, in[i].value, inout[i].value);
+      break;
+    case FusedType<int64_t>::value:
+      combineFusedValue<int64_t>(op, in[i].value, inout[i].value);
+      break;
+    case FusedType<uint32_t>::value:
+      combineFusedValue<uint32_t>(op, in[i].value, inout[i].value);
+      break;
+    case FusedType<uint64_t>::value:
+      combineFusedValue<uint64_t>(op, in[i].value, inout[i].value);
+      break;
+    case FusedType<float>::value:
+      combineFusedValue<float>(op, in[i].value, inout[i].value);
+      break;
+    default:
+      combineFusedValue<double>(op, in[i].value, inout[i].value);
+      break;
+    }
+  }
+}
+
+#ifdef GALOIS_USE_LWCI
+//! lc_alreduce operator for fused slots; count is in bytes
+inline void lwciFusedOp(void* dst, void* src, size_t count) {
+  combineFusedSlots(static_cast<FusedSlot*>(src), static_cast<FusedSlot*>(dst),
+                    count / sizeof(FusedSlot));
+}
+#else
+//! MPI operator for fused slots
+inline void mpiFusedOp(void* in, void* inout, int* len, MPI_Datatype*) {
+  combineFusedSlots(static_cast<FusedSlot*>(in),
+                    static_cast<FusedSlot*>(inout), *len);
+}
+
+//! MPI datatype of a fused slot; created on first use
+inline MPI_Datatype mpiFusedSlotType() {
+  static MPI_Datatype type = [] {
+    MPI_Datatype t;
+    MPI_Type_contiguous(sizeof(FusedSlot), MPI_BYTE, &t);
+    MPI_Type_commit(&t);
+    return t;
+  }();
+  return type;
+}
+
+//! MPI operator that combines fused slots; created on first use
+inline MPI_Op mpiFusedReduceOp() {
+  static MPI_Op op = [] {
+    MPI_Op o;
+    MPI_Op_create(&mpiFusedOp, 1, &o);
+    return o;
+  }();
+  return op;
+}
+#endif
+
+} // namespace internal
+} // namespace runtime
+
+class DGReduceFused;
+
+/**
+ * Handle to a reduction started with reduce_async. Reduced values may only be
+ * read after wait (or a successful test); the reducer that started the
+ * reduction must stay alive and must not be updated until then. Destroying
+ * or overwriting a handle waits for its reduction.
+ */
+class DGReduceRequest {
+  template <typename>
+  friend class DGAccumulator;
+  template <typename>
+  friend class DGReduceMax;
+  template <typename>
+  friend class DGReduceMin;
+  friend class DGReduceFused;
+
+#ifndef GALOIS_USE_LWCI
+  MPI_Request request = MPI_REQUEST_NULL;
+#endif
+  //! Called when the reduction finishes, e.g. to unpack fused values
+  std::function<void()> onComplete;
+  std::string timerName;
+  bool pending = false;
+
+#ifndef GALOIS_USE_LWCI
+  //! Marks the reduction as started; returns the request to pass to MPI
+  MPI_Request* start() {
+    pending = true;
+    return &request;
+  }
+#endif
+
+  void complete() {
+    pending = false;
+    if (onComplete)
+      onComplete();
+  }
+
+public:
+  DGReduceRequest() = default;
+  explicit DGReduceRequest(std::string _timerName)
+      : timerName(std::move(_timerName)) {}
+  DGReduceRequest(const DGReduceRequest&) = delete;
+  DGReduceRequest& operator=(const DGReduceRequest&) = delete;
+  DGReduceRequest(DGReduceRequest&& o) { *this = std::move(o); }
+  DGReduceRequest& operator=(DGReduceRequest&& o) {
+    if (this != &o) {
+      wait();
+#ifndef GALOIS_USE_LWCI
+      request = o.request;
+#endif
+      onComplete = std::move(o.onComplete);
+      timerName  = std::move(o.timerName);
+      pending    = o.pending;
+      o.pending  = false;
+    }
+    return *this;
+  }
+  ~DGReduceRequest() { wait(); }
+
+  /**
+   * Checks without blocking if the reduction has finished.
+   *
+   * @returns true if the reduction has finished
+   */
+  bool test() {
+#ifndef GALOIS_USE_LWCI
+    if (pending) {
+      int done;
+      MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+      if (done)
+        complete();
+    }
+#endif
+    return !pending;
+  }
+
+  /**
+   * Blocks until the reduction has finished.
+   */
+  void wait() {
+    if (!pending)
+      return;
+    galois::CondStatTimer<MORE_COMM_STATS> waitTimer(timerName.c_str(),
+                                                     "DGReducible");
+    waitTimer.start();
+#ifndef GALOIS_USE_LWCI
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+#endif
+    complete();
+    waitTimer.stop();
+  }
+};
+
+/**
+ * Handle to a reduction of a single reducer started with reduce_async.
+ *
+ * @tparam Ty type of the reduced value
+ */
+template <typename Ty>
+class DGReduceHandle : public DGReduceRequest {
+  const Ty* result = nullptr;
+
+public:
+  DGReduceHandle() = default;
+  DGReduceHandle(const Ty* _result, std::string timerName)
+      : DGReduceRequest(std::move(timerName)), result(_result) {}
+
+  /**
+   * Blocks until the reduction has finished.
+   *
+   * @returns the reduced value
+   */
+  Ty wait() {
+    DGReduceRequest::wait();
+    return *result;
+  }
+};
+
 /**
  * Distributed sum-reducer for getting the sum of some value across multiple
  * hosts.
@@ -49,6 +357,8 @@ class DGAccumulator {
   galois::GAccumulator<Ty> mdata;
   Ty local_mdata, global_mdata;
 
+  friend class DGReduceFused;
+
 #ifdef GALOIS_USE_LWCI
   /**
    * Sum reduction using LWCI
@@ -179,13 +489,45 @@ public:
 #ifdef GALOIS_USE_LWCI
     reduce_lwci();
 #else
-    reduce_mpi();
+    if (galois::runtime::internal::reduceWithMPI())
+      reduce_mpi();
+    else
+      global_mdata = galois::runtime::internal::reduceWithMessages(
+          local_mdata, [](Ty a, Ty b) { return a + b; });
 #endif
 
     reduceTimer.stop();
 
     return global_mdata;
   }
+
+  /**
+   * Starts reducing data across all hosts without waiting for it; the
+   * reduced value is returned by the wait call of the returned handle (or by
+   * read after it). Every host has to start the reduction.
+   *
+   * @param runID optional argument used to create a statistics timer
+   * for the time spent waiting for the reduction
+   *
+   * @returns handle to wait for the reduction with
+   */
+  DGReduceHandle<Ty> reduce_async(std::string runID = std::string()) {
+    DGReduceHandle<Ty> handle(&global_mdata, "ReduceDGAccumWait_" + runID);
+    if (local_mdata == 0)
+      local_mdata = mdata.reduce();
+
+#ifndef GALOIS_USE_LWCI
+    if (galois::runtime::internal::reduceWithMPI()) {
+      MPI_Iallreduce(&local_mdata, &global_mdata, 1,
+                     galois::runtime::internal::mpiType<Ty>(), MPI_SUM,
+                     MPI_COMM_WORLD, handle.start());
+      return handle;
+    }
+#endif
+    // no non-blocking reduction available: reduce right away
+    reduce(runID);
+    return handle;
+  }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -204,6 +546,8 @@ class DGReduceMax {
   galois::GReduceMax<Ty> mdata; // local max reducer
   Ty local_mdata, global_mdata;
 
+  friend class DGReduceFused;
+
 #ifdef GALOIS_USE_LWCI
   /**
    * Use LWCI to reduce max across hosts
@@ -315,12 +659,44 @@ public:
 #ifdef GALOIS_USE_LWCI
     reduce_lwci();
 #else
-    reduce_mpi();
+    if (galois::runtime::internal::reduceWithMPI())
+      reduce_mpi();
+    else
+      global_mdata = galois::runtime::internal::reduceWithMessages(
+          local_mdata, [](Ty a, Ty b) { return std::max(a, b); });
 #endif
     reduceTimer.stop();
 
     return global_mdata;
   }
+
+  /**
+   * Starts reducing data across all hosts without waiting for it; the
+   * reduced value is returned by the wait call of the returned handle (or by
+   * read after it). Every host has to start the reduction.
+   *
+   * @param runID optional argument used to create a statistics timer
+   * for the time spent waiting for the reduction
+   *
+   * @returns handle to wait for the reduction with
+   */
+  DGReduceHandle<Ty> reduce_async(std::string runID = std::string()) {
+    DGReduceHandle<Ty> handle(&global_mdata, "ReduceDGReduceMaxWait_" + runID);
+    if (local_mdata == 0)
+      local_mdata = mdata.reduce();
+
+#ifndef GALOIS_USE_LWCI
+    if (galois::runtime::internal::reduceWithMPI()) {
+      MPI_Iallreduce(&local_mdata, &global_mdata, 1,
+                     galois::runtime::internal::mpiType<Ty>(), MPI_MAX,
+                     MPI_COMM_WORLD, handle.start());
+      return handle;
+    }
+#endif
+    // no non-blocking reduction available: reduce right away
+    reduce(runID);
+    return handle;
+  }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -339,6 +715,8 @@ class DGReduceMin {
   galois::GReduceMin<Ty> mdata; // local min reducer
   Ty local_mdata, global_mdata;
 
+  friend class DGReduceFused;
+
 #ifdef GALOIS_USE_LWCI
   /**
    * Use LWCI to reduce min across hosts
@@ -451,12 +829,203 @@ public:
 #ifdef GALOIS_USE_LWCI
     reduce_lwci();
 #else
-    reduce_mpi();
+    if (galois::runtime::internal::reduceWithMPI())
+      reduce_mpi();
+    else
+      global_mdata = galois::runtime::internal::reduceWithMessages(
+          local_mdata, [](Ty a, Ty b) { return std::min(a, b); });
 #endif
     reduceTimer.stop();
 
     return global_mdata;
   }
+
+  /**
+   * Starts reducing data across all hosts without waiting for it; the
+   * reduced value is returned by the wait call of the returned handle (or by
+   * read after it). Every host has to start the reduction.
+   *
+   * @param runID optional argument used to create a statistics timer
+   * for the time spent waiting for the reduction
+   *
+   * @returns handle to wait for the reduction with
+   */
+  DGReduceHandle<Ty> reduce_async(std::string runID = std::string()) {
+    DGReduceHandle<Ty> handle(&global_mdata, "ReduceDGReduceMinWait_" + runID);
+    if (local_mdata == std::numeric_limits<Ty>::max())
+      local_mdata = mdata.reduce();
+
+#ifndef GALOIS_USE_LWCI
+    if (galois::runtime::internal::reduceWithMPI()) {
+      MPI_Iallreduce(&local_mdata, &global_mdata, 1,
+                     galois::runtime::internal::mpiType<Ty>(), MPI_MIN,
+                     MPI_COMM_WORLD, handle.start());
+      return handle;
+    }
+#endif
+    // no non-blocking reduction available: reduce right away
+    reduce(runID);
+    return handle;
+  }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Reduces several distributed reducers with a single collective instead of
+ * one per reducer, e.g. the accumulator whose sum decides termination
+ * together with the statistics gathered in the same round. Reducers are
+ * registered once with add; every reduce or reduce_async call then reduces
+ * all of them, after which their read calls return the reduced values as if
+ * each had been reduced on its own. Registered reducers must outlive this
+ * object.
+ *
+ * Supports reducers of int32_t, int64_t, uint32_t, uint64_t, float and double.
+ */
+class DGReduceFused {
+  using FusedSlot = galois::runtime::internal::FusedSlot;
+
+  //! Local values of the registered reducers, in registration order
+  std::vector<FusedSlot> local;
+  //! Reduced values of the registered reducers
+  std::vector<FusedSlot> global;
+  //! Read the local value of a reducer into its slot
+  std::vector<std::function<void(FusedSlot&)>> readLocal;
+  //! Store the reduced value of a slot in its reducer
+  std::vector<std::function<void(const FusedSlot&)>> writeGlobal;
+
+  template <typename Ty, typename ReadFn, typename WriteFn>
+  DGReduceFused& addSlot(uint32_t op, ReadFn readFn, WriteFn writeFn) {
+    static_assert(sizeof(Ty) <= sizeof(uint64_t),
+                  "Type of reducer not supported for fused reduction");
+    FusedSlot slot;
+    slot.value = 0;
+    slot.op    = op;
+    slot.type  = galois::runtime::internal::FusedType<Ty>::value;
+    local.push_back(slot);
+    global.push_back(slot);
+    readLocal.emplace_back([readFn](FusedSlot& s) {
+      Ty value = readFn();
+      std::memcpy(&s.value, &value, sizeof(Ty));
+    });
+    writeGlobal.emplace_back([writeFn](const FusedSlot& s) {
+      Ty value;
+      std::memcpy(&value, &s.value, sizeof(Ty));
+      writeFn(value);
+    });
+    return *this;
+  }
+
+  void gatherLocal() {
+    for (size_t i = 0; i < local.size(); ++i)
+      readLocal[i](local[i]);
+  }
+
+  void scatterGlobal() {
+    for (size_t i = 0; i < global.size(); ++i)
+      writeGlobal[i](global[i]);
+  }
+
+  //! Reduces with messages (or LWCI) when there is no MPI
+  void reduceBlocking() {
+#ifdef GALOIS_USE_LWCI
+    lc_alreduce(local.data(), global.data(), local.size() * sizeof(FusedSlot),
+                &galois::runtime::internal::lwciFusedOp, mv);
+#else
+    global = galois::runtime::internal::reduceWithMessages(
+        local, [](std::vector<FusedSlot> a, const std::vector<FusedSlot>& b) {
+          galois::runtime::internal::combineFusedSlots(b.data(), a.data(),
+                                                       a.size());
+          return a;
+        });
+#endif
+    scatterGlobal();
+  }
+
+public:
+  //! Registers a sum-reducer
+  template <typename Ty>
+  DGReduceFused& add(DGAccumulator<Ty>& reducer) {
+    return addSlot<Ty>(
+        galois::runtime::internal::fusedSum,
+        [&reducer]() { return reducer.read_local(); },
+        [&reducer](Ty value) { reducer.global_mdata = value; });
+  }
+
+  //! Registers a max-reducer
+  template <typename Ty>
+  DGReduceFused& add(DGReduceMax<Ty>& reducer) {
+    return addSlot<Ty>(
+        galois::runtime::internal::fusedMax,
+        [&reducer]() { return reducer.read_local(); },
+        [&reducer](Ty value) { reducer.global_mdata = value; });
+  }
+
+  //! Registers a min-reducer
+  template <typename Ty>
+  DGReduceFused& add(DGReduceMin<Ty>& reducer) {
+    return addSlot<Ty>(
+        galois::runtime::internal::fusedMin,
+        [&reducer]() { return reducer.read_local(); },
+        [&reducer](Ty value) { reducer.global_mdata = value; });
+  }
+
+  /**
+   * Reduces all registered reducers across all hosts with one collective.
+   *
+   * @param runID optional argument used to create a statistics timer
+   * for later reporting
+   */
+  void reduce(std::string runID = std::string()) {
+    std::string timer_str("ReduceDGFused_" + runID);
+    galois::CondStatTimer<MORE_COMM_STATS> reduceTimer(timer_str.c_str(),
+                                                       "DGReducible");
+    reduceTimer.start();
+    gatherLocal();
+
+#ifndef GALOIS_USE_LWCI
+    if (galois::runtime::internal::reduceWithMPI()) {
+      MPI_Allreduce(local.data(), global.data(), local.size(),
+                    galois::runtime::internal::mpiFusedSlotType(),
+                    galois::runtime::internal::mpiFusedReduceOp(),
+                    MPI_COMM_WORLD);
+      scatterGlobal();
+    } else
+#endif
+      reduceBlocking();
+
+    reduceTimer.stop();
+  }
+
+  /**
+   * Starts reducing all registered reducers across all hosts with one
+   * non-blocking collective. Their reduced values can be read after the
+   * returned request has been waited for.
+   *
+   * @param runID optional argument used to create a statistics timer
+   * for the time spent waiting for the reduction
+   *
+   * @returns request to wait for the reduction with
+   */
+  DGReduceRequest reduce_async(std::string runID = std::string()) {
+    DGReduceRequest request("ReduceDGFusedWait_" + runID);
+    gatherLocal();
+
+#ifndef GALOIS_USE_LWCI
+    if (galois::runtime::internal::reduceWithMPI()) {
+      request.onComplete = [this]() { scatterGlobal(); };
+      MPI_Iallreduce(local.data(), global.data(), local.size(),
+                     galois::runtime::internal::mpiFusedSlotType(),
+                     galois::runtime::internal::mpiFusedReduceOp(),
+                     MPI_COMM_WORLD, request.start());
+      return request;
+    }
+#endif
+    // no non-blocking reduction available: reduce right away
+    reduceBlocking();
+    return request;
+  }
 };
 
 } // namespace galois
@@ -140,6 +140,11 @@ public:
     lc_alreduce(&snapshot, &global_snapshot, sizeof(Ty),
                 &galois::runtime::internal::ompi_op_max<Ty>);
 #else
+    int initialized;
+    MPI_Initialized(&initialized);
+    if (!initialized)
+      GALOIS_DIE("asynchronous termination detection needs MPI; "
+                 "GALOIS_NETWORK_IO=tcp only supports synchronous runs");
     MPI_Iallreduce(&snapshot, &global_snapshot, 1, MPI::UNSIGNED_LONG, MPI_MAX,
                   MPI_COMM_WORLD, &snapshot_request);
 #endif
@@ -29,14 +29,21 @@
 
 #include <unordered_map>
 #include <fstream>
+#include <sstream>
+#include <chrono>
+#include <functional>
+#include <numeric>
+#include <unistd.h>
 
 #include "galois/runtime/GlobalObj.h"
 #include "galois/graphs/BufferedGraph.h"
 #include "galois/graphs/B_LC_CSR_Graph.h"
 #include "galois/runtime/DistStats.h"
 #include "galois/graphs/OfflineGraph.h"
+#include "galois/graphs/PartitionImage.h"
 #include "galois/runtime/SyncStructures.h"
 #include "galois/runtime/DataCommMode.h"
+#include "galois/runtime/SyncCompression.h"
 #include "galois/DynamicBitset.h"
 
 #ifdef __GALOIS_HET_CUDA__
@@ -91,6 +98,10 @@ extern cll::opt<uint32_t> nodeAlphaRanges;
 extern cll::opt<unsigned> numFileThreads;
 //! Specifies the size of the buffer used for
 extern cll::opt<unsigned> edgePartitionSendBufSize;
+//! Syncs go through one leader host per machine
+extern cll::opt<bool> hierarchicalSync;
+//! Hosts per machine assumed by hierarchical syncs (0: use host names)
+extern cll::opt<unsigned> syncGroupSize;
 
 //! Enumeration for specifiying write location for sync calls
 enum WriteLocation {
@@ -137,6 +148,9 @@ private:
   bool round;
 
 protected:
+  //! Mapped partition image the topology of the graph points into, if the
+  //! graph was read from one; declared before graph so that it outlives it
+  PartitionImage localImage;
   //! The internal graph used by DistGraph to represent the graph
   GraphTy graph;
   //! Synchronization type
@@ -220,6 +234,81 @@ private:
 
   galois::DynamicBitSet syncBitset;
   galois::PODResizeableArray<unsigned int> syncOffsets;
+  //! Coded offsets of the varintOffsetsData and runLengthBitsetData modes
+  galois::PODResizeableArray<uint8_t> syncCodedOffsets;
+
+  //! Positions in mirrorNodes/masterNodes of each host sorted by local id;
+  //! used to find the shared nodes of a block in pipelined syncs
+  std::vector<std::vector<uint32_t>> mirrorPositionsByLID;
+  std::vector<std::vector<uint32_t>> masterPositionsByLID;
+
+  //! State of the outstanding pipelined sync (see sync_pipelined_start)
+  struct PipelinedSyncState {
+    bool active = false;
+    std::string loopName;
+    //! parts still expected from each host (~0 until the first arrives)
+    std::vector<uint32_t> partsLeft;
+    //! number of hosts that parts are still expected from
+    unsigned hostsLeft = 0;
+    //! applies a received part
+    std::function<void(uint32_t, galois::runtime::RecvBuffer&)> apply;
+    //! second phase of the sync, if any
+    std::function<void()> finish;
+    std::chrono::high_resolution_clock::time_point firstBlockDone;
+    std::chrono::high_resolution_clock::time_point lastBlockDone;
+  };
+  PipelinedSyncState pipelined;
+
+  //! Overlap totals of pipelined syncs for each run identifier
+  struct PipelinedSyncTotals {
+    uint64_t overlapped        = 0;
+    uint64_t exposed           = 0;
+    int64_t reportedEfficiency = 0;
+  };
+  std::unordered_map<std::string, PipelinedSyncTotals> pipelinedTotals;
+
+  //! Machines of the hosts for hierarchical syncs
+  struct HierarchicalSyncState {
+    bool ready = false;
+    //! leader host of the machine of every host
+    std::vector<unsigned> leaderOf;
+    //! leader hosts of all machines
+    std::vector<unsigned> leaders;
+    //! other hosts of the machine of this host if it is a leader
+    std::vector<unsigned> followers;
+  };
+  HierarchicalSyncState hierarchical;
+
+  //! Updates of proxies on other hosts, routed through the leaders of
+  //! machines in hierarchical syncs
+  template <typename ValTy>
+  struct RoutedUpdates {
+    std::vector<uint32_t> hosts; //!< host that has the proxy to update
+    std::vector<uint64_t> gids;  //!< global id of the node
+    std::vector<ValTy> values;
+
+    size_t size() const { return gids.size(); }
+
+    void resize(size_t n) {
+      hosts.resize(n);
+      gids.resize(n);
+      values.resize(n);
+    }
+
+    //! Adds the i-th update of other
+    void push_back(const RoutedUpdates& other, size_t i) {
+      hosts.push_back(other.hosts[i]);
+      gids.push_back(other.gids[i]);
+      values.push_back(other.values[i]);
+    }
+
+    //! Adds all updates of other
+    void append(const RoutedUpdates& other) {
+      hosts.insert(hosts.end(), other.hosts.begin(), other.hosts.end());
+      gids.insert(gids.end(), other.gids.begin(), other.gids.end());
+      values.insert(values.end(), other.values.begin(), other.values.end());
+    }
+  };
 
 protected:
   //! Prints graph statistics.
@@ -275,11 +364,52 @@ public:
   //! Deserialize a graph
   virtual void boostDeSerializeLocalGraph(boost::archive::binary_iarchive& ar,
                                           const unsigned int version = 0){};
+  //! Adds the partitioning scheme specific data of this graph to a partition
+  //! image; by default its Boost serialization
+  virtual void imageSerializeLocalGraph(PartitionImageWriter& image) const {
+    std::ostringstream stream;
+    {
+      boost::archive::binary_oarchive ar(stream, boost::archive::no_header);
+      boostSerializeLocalGraph(ar);
+    }
+    image.addCopy(PartitionImageSection::Partition, stream.str());
+  }
+  //! Reads the data added by imageSerializeLocalGraph from a mapped image
+  virtual void imageDeSerializeLocalGraph(const PartitionImage& image) {
+    internal::MemoryStreamBuf buffer(
+        image.section(PartitionImageSection::Partition),
+        image.sectionSize(PartitionImageSection::Partition));
+    std::istream stream(&buffer);
+    boost::archive::binary_iarchive ar(stream, boost::archive::no_header);
+    boostDeSerializeLocalGraph(ar);
+  }
   //! Gets the mirror node ranges on this graph
   //! @returns Range of mirror nodes on this graph
   virtual std::vector<std::pair<uint32_t, uint32_t>>
   getMirrorRanges() const = 0;
 
+  /**
+   * Moves masters (with their edges and node data) from hosts with more work
+   * to hosts with less work. Only partitioning schemes that can change the
+   * owners of nodes after construction implement this.
+   *
+   * Must be called by all hosts between rounds, after the node data has been
+   * synchronized. Local ids and the size of the graph change, so bitsets and
+   * ranges obtained from the graph must be resized or fetched again.
+   *
+   * @param work work of a master (given by its local id) in the next round
+   * @param imbalanceThreshold masters are moved only while the most loaded
+   * host has more than imbalanceThreshold times the average work
+   * @param blockSize number of consecutive global ids that are moved together
+   * @returns true if any masters were moved
+   */
+  virtual bool rebalance_masters(const std::function<uint64_t(uint32_t)>& work,
+                                 double imbalanceThreshold = 1.2,
+                                 uint32_t blockSize        = 4096) {
+    GALOIS_DIE("moving masters is not supported by this partitioning policy");
+    return false;
+  }
+
   // Requirement: For all X and Y,
   // On X, nothingToSend(Y) <=> On Y, nothingToRecv(X)
   // Note: templates may not be virtual, so passing types as arguments
@@ -728,6 +858,62 @@ protected:
     net.resetMemUsage();
   }
 
+  /**
+   * Sets up thread ranges and communication again after the local graph was
+   * rebuilt with a different set of masters and mirrors, and copies the node
+   * data of every master to its (new) mirrors.
+   *
+   * Expects masters to be the first numOwned local nodes and the only ones
+   * with edges, and mirrorNodes to hold the global ids of the mirrors.
+   */
+  void reset_proxies() {
+    for (auto& masters : masterNodes) {
+      masters.clear();
+    }
+    mirrorPositionsByLID.clear();
+    masterPositionsByLID.clear();
+
+    allNodesRanges.clear();
+    masterRanges.clear();
+    withEdgeRanges.clear();
+    specificRanges.clear();
+    determineThreadRanges();
+    determineThreadRangesMaster();
+    determineThreadRangesWithEdges();
+    initializeSpecificRanges();
+
+    setup_communication();
+
+    // mirrors are new nodes: give them the data of their masters
+    auto& net = galois::runtime::getSystemNetworkInterface();
+    for (unsigned x = 0; x < numHosts; ++x) {
+      if (x == id)
+        continue;
+
+      galois::runtime::SendBuffer b;
+      for (auto lid : masterNodes[x]) {
+        b.insert(reinterpret_cast<const uint8_t*>(&graph.getData(lid)),
+                 sizeof(NodeTy));
+      }
+      net.sendTagged(x, galois::runtime::evilPhase, b);
+    }
+    for (unsigned x = 0; x < numHosts; ++x) {
+      if (x == id)
+        continue;
+
+      decltype(net.recieveTagged(galois::runtime::evilPhase, nullptr)) p;
+      do {
+        p = net.recieveTagged(galois::runtime::evilPhase, nullptr);
+      } while (!p);
+
+      for (auto lid : mirrorNodes[p->first]) {
+        p->second.extract(reinterpret_cast<uint8_t*>(&graph.getData(lid)),
+                          sizeof(NodeTy));
+      }
+    }
+    increment_evilPhase();
+  }
+
 public:
   /**
    * Do an in-memory transpose while keeping the original graph intact.
@@ -1397,8 +1583,24 @@ private:
                                         bit_set_count);
     }
 
-    data_mode =
-        get_data_mode<typename FnTy::ValTy>(bit_set_count, indices.size());
+    // sizes of the offsets under the compressed modes; GPUs only know the
+    // uncompressed modes, so heterogeneous builds never pick them
+    size_t varint_offsets_size = 0;
+    size_t run_length_size     = 0;
+#ifndef __GALOIS_HET_CUDA__
+    if ((enforce_data_mode == noData || enforce_data_mode == neverOnlyData) &&
+        bit_set_count > 0 && bit_set_count < indices.size()) {
+      varint_offsets_size =
+          galois::runtime::encodedOffsetsSize<
+              galois::runtime::internal::DeltaVarintCoder>(offsets,
+                                                           bit_set_count);
+      run_length_size = galois::runtime::encodedOffsetsSize<
+          galois::runtime::internal::RunLengthCoder>(offsets, bit_set_count);
+    }
+#endif
+
+    data_mode = get_data_mode<typename FnTy::ValTy>(
+        bit_set_count, indices.size(), varint_offsets_size, run_length_size);
   }
 
   /**
@@ -2408,6 +2610,21 @@ private:
       Tserialize.start();
       gSerialize(b, data_mode, bit_set_count, bit_set_comm, val_vec);
       Tserialize.stop();
+    } else if (data_mode == varintOffsetsData ||
+               data_mode == runLengthBitsetData) {
+      val_vec.resize(bit_set_count);
+      Tserialize.start();
+      if (data_mode == varintOffsetsData) {
+        galois::runtime::encodeOffsets<
+            galois::runtime::internal::DeltaVarintCoder>(offsets, bit_set_count,
+                                                         syncCodedOffsets);
+      } else {
+        galois::runtime::encodeOffsets<
+            galois::runtime::internal::RunLengthCoder>(offsets, bit_set_count,
+                                                       syncCodedOffsets);
+      }
+      gSerialize(b, data_mode, bit_set_count, syncCodedOffsets, val_vec);
+      Tserialize.stop();
     } else { // onlyData
       Tserialize.start();
       gSerialize(b, data_mode, val_vec);
@@ -2944,6 +3161,16 @@ private:
       } else if (data_mode == bitsetData) {
         bit_set_comm.resize(num);
         galois::runtime::gDeserialize(buf, bit_set_comm);
+      } else if (data_mode == varintOffsetsData) {
+        galois::runtime::gDeserialize(buf, syncCodedOffsets);
+        galois::runtime::decodeOffsets<
+            galois::runtime::internal::DeltaVarintCoder>(
+            syncCodedOffsets, bit_set_count, offsets);
+      } else if (data_mode == runLengthBitsetData) {
+        galois::runtime::gDeserialize(buf, syncCodedOffsets);
+        galois::runtime::decodeOffsets<
+            galois::runtime::internal::RunLengthCoder>(
+            syncCodedOffsets, bit_set_count, offsets);
       } else if (data_mode == dataSplit) {
         galois::runtime::gDeserialize(buf, buf_start);
       } else if (data_mode == dataSplitFirst) {
@@ -3044,7 +3271,7 @@ private:
             set_subset<decltype(offsets), SyncFnTy, syncType, true, true>(
                 loopName, offsets, bit_set_count, offsets, val_vec,
                 bit_set_compute);
-          } else { // bitsetData or offsetsData
+          } else { // bitsetData, offsetsData or compressed offsets
             set_subset<decltype(sharedNodes[from_id]), SyncFnTy, syncType,
                        false, true>(loopName, sharedNodes[from_id],
                                     bit_set_count, offsets, val_vec,
@@ -3143,7 +3370,7 @@ private:
             set_subset<decltype(offsets), SyncFnTy, syncType, true, true, true>(
                 loopName, offsets, bit_set_count, offsets, val_vec,
                 bit_set_compute, i);
-          } else { // bitsetData or offsetsData
+          } else { // bitsetData, offsetsData or compressed offsets
             set_subset<decltype(sharedNodes[from_id]), SyncFnTy, syncType,
                        false, true, true>(loopName, sharedNodes[from_id],
                                           bit_set_count, offsets, val_vec,
@@ -3458,6 +3685,348 @@ private:
   }
 #endif
 
+  /**
+   * Finds the machine of every host for hierarchical syncs: hosts with the
+   * same host name (or, if syncGroupSize is set, in the same group of
+   * consecutive host ids) share a machine, and the lowest host id of a
+   * machine is its leader.
+   */
+  void setup_hierarchical_sync() {
+    auto& net = galois::runtime::getSystemNetworkInterface();
+    std::vector<std::string> machineNames(numHosts);
+
+    if (syncGroupSize > 0) {
+      for (unsigned h = 0; h < numHosts; ++h) {
+        machineNames[h] = std::to_string(h / syncGroupSize);
+      }
+    } else {
+      char name[256] = {0};
+      gethostname(name, sizeof(name) - 1);
+      machineNames[id] = name;
+
+      for (unsigned x = 0; x < numHosts; ++x) {
+        if (x == id)
+          continue;
+        galois::runtime::SendBuffer b;
+        gSerialize(b, machineNames[id]);
+        net.sendTagged(x, galois::runtime::evilPhase, b);
+      }
+      for (unsigned x = 0; x < numHosts; ++x) {
+        if (x == id)
+          continue;
+        decltype(net.recieveTagged(galois::runtime::evilPhase, nullptr)) p;
+        do {
+          p = net.recieveTagged(galois::runtime::evilPhase, nullptr);
+        } while (!p);
+        galois::runtime::gDeserialize(p->second, machineNames[p->first]);
+      }
+      increment_evilPhase();
+    }
+
+    hierarchical.leaderOf.resize(numHosts);
+    hierarchical.leaders.clear();
+    hierarchical.followers.clear();
+    for (unsigned h = 0; h < numHosts; ++h) {
+      unsigned leader = 0;
+      while (machineNames[leader] != machineNames[h]) {
+        ++leader;
+      }
+      hierarchical.leaderOf[h] = leader;
+      if (leader == h) {
+        hierarchical.leaders.push_back(h);
+      } else if (leader == id) {
+        hierarchical.followers.push_back(h);
+      }
+    }
+    hierarchical.ready = true;
+
+    if (id == 0) {
+      galois::gPrint("Hierarchical sync: ", hierarchical.leaders.size(),
+                     " machines for ", numHosts, " hosts\n");
+    }
+  }
+
+  /**
+   * Appends an update for every node this host shares with another host
+   * (its mirrors on reduce, its masters on broadcast) to updates.
+   *
+   * @tparam syncType either reduce or broadcast
+   * @tparam SyncFnTy synchronization structure with info needed to synchronize
+   * @tparam BitsetFnTy struct that has info on how to access the bitset; only
+   * nodes set in it are extracted if it is valid
+   */
+  template <SyncType syncType, typename SyncFnTy, typename BitsetFnTy>
+  void
+  extract_routed_updates(const std::string& loopName,
+                         RoutedUpdates<typename SyncFnTy::ValTy>& updates) {
+    auto& sharedNodes = (syncType == syncReduce) ? mirrorNodes : masterNodes;
+    galois::DynamicBitSet& bit_set_comm               = syncBitset;
+    galois::PODResizeableArray<unsigned int>& offsets = syncOffsets;
+
+    for (unsigned x = 0; x < numHosts; ++x) {
+      if (x == id || sharedNodes[x].empty())
+        continue;
+      const std::vector<size_t>& indices = sharedNodes[x];
+
+      size_t count = indices.size();
+      if (BitsetFnTy::is_valid()) {
+        const galois::DynamicBitSet& bit_set_compute = BitsetFnTy::get();
+        bit_set_comm.resize(indices.size());
+        bit_set_comm.reset();
+        galois::do_all(galois::iterate(0ul, indices.size()),
+                       [&](unsigned int n) {
+                         if (bit_set_compute.test(indices[n])) {
+                           bit_set_comm.set(n);
+                         }
+                       },
+                       galois::no_stats());
+        get_offsets_from_bitset<syncType>(loopName, bit_set_comm, offsets,
+                                          count);
+      }
+
+      size_t start = updates.size();
+      updates.resize(start + count);
+      galois::do_all(galois::iterate((size_t)0, count),
+                     [&](size_t n) {
+                       size_t lid = indices[BitsetFnTy::is_valid() ? offsets[n]
+                                                                   : n];
+                       updates.hosts[start + n] = x;
+                       updates.gids[start + n]  = getGID(lid);
+                       updates.values[start + n] =
+                           extract_wrapper<SyncFnTy, syncType>(lid);
+                     },
+                     galois::no_stats());
+    }
+  }
+
+  /**
+   * Reduces or sets the given updates on the local proxies of their nodes.
+   * Updates of the same node are applied one after another.
+   *
+   * @param updates updates to apply
+   * @param selected positions in updates of the updates to apply
+   */
+  template <SyncType syncType, typename SyncFnTy, typename BitsetFnTy>
+  void apply_routed_updates(
+      const RoutedUpdates<typename SyncFnTy::ValTy>& updates,
+      std::vector<size_t>& selected) {
+    std::sort(selected.begin(), selected.end(), [&](size_t a, size_t b) {
+      return updates.gids[a] < updates.gids[b];
+    });
+    std::vector<size_t> groups;
+    for (size_t i = 0; i < selected.size(); ++i) {
+      if (i == 0 || updates.gids[selected[i]] != updates.gids[selected[i - 1]])
+        groups.push_back(i);
+    }
+    groups.push_back(selected.size());
+
+    galois::DynamicBitSet& bit_set_compute = BitsetFnTy::get();
+    galois::do_all(galois::iterate((size_t)0, groups.size() - 1),
+                   [&](size_t g) {
+                     size_t lid = G2L(updates.gids[selected[groups[g]]]);
+                     for (size_t i = groups[g]; i < groups[g + 1]; ++i) {
+                       set_wrapper<SyncFnTy, syncType>(
+                           lid, updates.values[selected[i]], bit_set_compute);
+                     }
+                   },
+                   galois::steal(), galois::no_stats());
+  }
+
+  /**
+   * Reduces the updates for nodes that this host mirrors as well into its
+   * mirrors and removes them from updates; they leave the machine with the
+   * mirrors of this host.
+   */
+  template <SyncType syncType, typename SyncFnTy, typename BitsetFnTy,
+            typename std::enable_if<syncType == syncReduce>::type* = nullptr>
+  void fold_routed_updates(RoutedUpdates<typename SyncFnTy::ValTy>& updates) {
+    RoutedUpdates<typename SyncFnTy::ValTy> kept;
+    std::vector<size_t> folded;
+    for (size_t i = 0; i < updates.size(); ++i) {
+      if (updates.hosts[i] != id && isLocal(updates.gids[i])) {
+        folded.push_back(i);
+      } else {
+        kept.push_back(updates, i);
+      }
+    }
+    apply_routed_updates<syncReduce, SyncFnTy, BitsetFnTy>(updates, folded);
+    updates = std::move(kept);
+  }
+
+  //! Broadcast values are not folded
+  template <SyncType syncType, typename SyncFnTy, typename BitsetFnTy,
+            typename std::enable_if<syncType == syncBroadcast>::type* = nullptr>
+  void fold_routed_updates(RoutedUpdates<typename SyncFnTy::ValTy>&) {}
+
+  //! Sends updates to a host with the current phase
+  template <typename ValTy>
+  void send_routed_updates(unsigned x, const RoutedUpdates<ValTy>& updates,
+                           size_t& numMessages) {
+    galois::runtime::SendBuffer b;
+    gSerialize(b, updates.hosts, updates.gids, updates.values);
+    galois::runtime::getSystemNetworkInterface().sendTagged(
+        x, galois::runtime::evilPhase, b);
+    ++numMessages;
+  }
+
+  //! Receives updates sent with the current phase from some host
+  template <typename ValTy>
+  void recv_routed_updates(RoutedUpdates<ValTy>& updates) {
+    auto& net = galois::runtime::getSystemNetworkInterface();
+    decltype(net.recieveTagged(galois::runtime::evilPhase, nullptr)) p;
+    do {
+      p = net.recieveTagged(galois::runtime::evilPhase, nullptr);
+    } while (!p);
+    RoutedUpdates<ValTy> received;
+    galois::runtime::gDeserialize(p->second, received.hosts, received.gids,
+                                  received.values);
+    updates.append(received);
+  }
+
+  /**
+   * Hierarchical sync: instead of every pair of hosts exchanging messages,
+   * the hosts of a machine hand their updates to the leader of the machine,
+   * the leaders exchange them, and every leader hands the updates for the
+   * hosts of its machine to them. Updates travel as (host, global id, value)
+   * so that leaders can merge them; on reduce, a leader also folds the
+   * updates of its hosts into its own mirrors of the same nodes, so that
+   * only one value per node leaves the machine for those.
+   *
+   * Used when -hierarchicalSync is given, for non-vector bitsets and
+   * synchronous syncs.
+   *
+   * @tparam SendBitsetFnTy bitset used to pick the nodes to send
+   * @tparam BitsetFnTy bitset updated on the receiving side
+   * @returns false if the sync has to be done the regular way
+   */
+  template <SyncType syncType, typename SyncFnTy, typename SendBitsetFnTy,
+            typename BitsetFnTy, bool async,
+            typename std::enable_if<!BitsetFnTy::is_vector_bitset()>::type* =
+                nullptr>
+  bool sync_hierarchical(std::string loopName) {
+    if (!hierarchicalSync || async) {
+      return false;
+    }
+    if (!hierarchical.ready) {
+      setup_hierarchical_sync();
+    }
+
+    using ValTy = typename SyncFnTy::ValTy;
+    std::string syncTypeStr = (syncType == syncReduce) ? "Reduce" : "Broadcast";
+    galois::CondStatTimer<MORE_COMM_STATS> TSendTime(
+        (syncTypeStr + "Send_" + get_run_identifier(loopName)).c_str(), GRNAME);
+    galois::CondStatTimer<MORE_COMM_STATS> TRecvTime(
+        (syncTypeStr + "Recv_" + get_run_identifier(loopName)).c_str(), GRNAME);
+    size_t numMessages = 0;
+
+    const unsigned leader = hierarchical.leaderOf[id];
+    RoutedUpdates<ValTy> updates;
+    std::vector<size_t> selected;
+
+    // 1. hosts hand their updates to the leader of their machine
+    if (leader != id) {
+      TSendTime.start();
+      extract_routed_updates<syncType, SyncFnTy, SendBitsetFnTy>(loopName,
+                                                                 updates);
+      if (SendBitsetFnTy::is_valid()) {
+        reset_bitset(syncType, &SendBitsetFnTy::reset_range);
+      }
+      send_routed_updates(leader, updates, numMessages);
+      TSendTime.stop();
+      increment_evilPhase();
+      increment_evilPhase();
+    } else {
+      TRecvTime.start();
+      for (size_t f = 0; f < hierarchical.followers.size(); ++f) {
+        recv_routed_updates(updates);
+      }
+      increment_evilPhase();
+
+      fold_routed_updates<syncType, SyncFnTy, SendBitsetFnTy>(updates);
+      TRecvTime.stop();
+
+      TSendTime.start();
+      extract_routed_updates<syncType, SyncFnTy, SendBitsetFnTy>(loopName,
+                                                                 updates);
+      if (SendBitsetFnTy::is_valid()) {
+        reset_bitset(syncType, &SendBitsetFnTy::reset_range);
+      }
+
+      // 2. leaders exchange the updates for each other's machines
+      std::vector<RoutedUpdates<ValTy>> outgoing(numHosts);
+      RoutedUpdates<ValTy> arrived;
+      for (size_t i = 0; i < updates.size(); ++i) {
+        unsigned destination = hierarchical.leaderOf[updates.hosts[i]];
+        if (destination == id) {
+          arrived.push_back(updates, i);
+        } else {
+          outgoing[destination].push_back(updates, i);
+        }
+      }
+      for (unsigned l : hierarchical.leaders) {
+        if (l != id) {
+          send_routed_updates(l, outgoing[l], numMessages);
+        }
+      }
+      TSendTime.stop();
+      TRecvTime.start();
+      for (size_t l = 1; l < hierarchical.leaders.size(); ++l) {
+        recv_routed_updates(arrived);
+      }
+      TRecvTime.stop();
+      increment_evilPhase();
+
+      // 3. leaders hand the updates for their hosts to them
+      TSendTime.start();
+      for (unsigned f : hierarchical.followers) {
+        outgoing[f] = RoutedUpdates<ValTy>();
+      }
+      for (size_t i = 0; i < arrived.size(); ++i) {
+        if (arrived.hosts[i] == id) {
+          selected.push_back(i);
+        } else {
+          outgoing[arrived.hosts[i]].push_back(arrived, i);
+        }
+      }
+      for (unsigned f : hierarchical.followers) {
+        send_routed_updates(f, outgoing[f], numMessages);
+      }
+      TSendTime.stop();
+      updates = std::move(arrived);
+    }
+
+    if (leader != id) {
+      TRecvTime.start();
+      updates = RoutedUpdates<ValTy>();
+      recv_routed_updates(updates);
+      selected.resize(updates.size());
+      std::iota(selected.begin(), selected.end(), 0);
+      TRecvTime.stop();
+    }
+    TRecvTime.start();
+    apply_routed_updates<syncType, SyncFnTy, BitsetFnTy>(updates, selected);
+    TRecvTime.stop();
+    increment_evilPhase();
+
+    galois::runtime::reportStat_Tsum(
+        GRNAME, syncTypeStr + "NumMessages_" + get_run_identifier(loopName),
+        numMessages);
+    return true;
+  }
+
+  /**
+   * Vector bitsets are always synchronized the regular way.
+   *
+   * @returns false
+   */
+  template <SyncType syncType, typename SyncFnTy, typename SendBitsetFnTy,
+            typename BitsetFnTy, bool async,
+            typename std::enable_if<BitsetFnTy::is_vector_bitset()>::type* =
+                nullptr>
+  bool sync_hierarchical(std::string) {
+    return false;
+  }
+
   /**
    * Does a reduction of data from mirror nodes to master nodes.
    *
@@ -3476,6 +4045,12 @@ private:
                                                        GRNAME);
     TsyncReduce.start();
 
+    if (sync_hierarchical<syncReduce, ReduceFnTy, BitsetFnTy, BitsetFnTy,
+                          async>(loopName)) {
+      TsyncReduce.stop();
+      return;
+    }
+
 #ifdef __GALOIS_BARE_MPI_COMMUNICATION__
     switch (bare_mpi) {
     case noBareMPI:
@@ -3544,6 +4119,18 @@ private:
       }
     }
 
+    bool synced =
+        use_bitset
+            ? sync_hierarchical<syncBroadcast, BroadcastFnTy, BitsetFnTy,
+                                BitsetFnTy, async>(loopName)
+            : sync_hierarchical<syncBroadcast, BroadcastFnTy,
+                                galois::InvalidBitsetFnTy, BitsetFnTy, async>(
+                  loopName);
+    if (synced) {
+      TsyncBroadcast.stop();
+      return;
+    }
+
 #ifdef __GALOIS_BARE_MPI_COMMUNICATION__
     switch (bare_mpi) {
     case noBareMPI:
@@ -3774,6 +4361,293 @@ private:
     broadcast<writeAny, readAny, BroadcastFnTy, BitsetFnTy, async>(loopName);
   }
 
+  /**
+   * Determines which of the reduce and broadcast phases a sync with the
+   * given write and read locations does on this partition; matches the
+   * sync_*_to_* functions.
+   *
+   * @param writeLocation Location data is written (src or dst)
+   * @param readLocation Location data is read (src or dst)
+   * @param needReduce OUTPUT: true if the sync reduces to masters
+   * @param needBroadcast OUTPUT: true if the sync broadcasts to mirrors
+   */
+  void get_sync_phases(WriteLocation writeLocation, ReadLocation readLocation,
+                       bool& needReduce, bool& needBroadcast) const {
+    bool srcCut = transposed || is_vertex_cut();
+    bool dstCut = !transposed || is_vertex_cut();
+
+    if (partitionAgnostic) {
+      needReduce    = true;
+      needBroadcast = true;
+    } else if (writeLocation == writeSource) {
+      needReduce = srcCut;
+      if (readLocation == readSource) {
+        needBroadcast = srcCut;
+      } else if (readLocation == readDestination) {
+        needBroadcast = dstCut;
+      } else { // readAny
+        needBroadcast = true;
+      }
+    } else if (writeLocation == writeDestination) {
+      needReduce = dstCut;
+      if (readLocation == readSource) {
+        needBroadcast = srcCut;
+      } else if (readLocation == readDestination) {
+        needBroadcast = dstCut;
+      } else { // readAny
+        needBroadcast = true;
+      }
+    } else { // writeAny
+      needReduce = true;
+      if (readLocation == readSource) {
+        needBroadcast = srcCut;
+      } else if (readLocation == readDestination) {
+        needBroadcast = dstCut;
+      } else { // readAny
+        needBroadcast = true;
+      }
+    }
+  }
+
+  /**
+   * Returns, for each host, the positions in the list of nodes shared with
+   * it sorted by the local ids of the nodes; built on first use.
+   *
+   * @param syncType either reduce (mirror nodes) or broadcast (master nodes)
+   */
+  const std::vector<std::vector<uint32_t>>&
+  get_positions_by_lid(SyncType syncType) {
+    auto& sharedNodes = (syncType == syncReduce) ? mirrorNodes : masterNodes;
+    auto& positions =
+        (syncType == syncReduce) ? mirrorPositionsByLID : masterPositionsByLID;
+
+    if (positions.empty()) {
+      positions.resize(numHosts);
+      galois::do_all(galois::iterate(0u, numHosts),
+                     [&](unsigned h) {
+                       auto& indices = sharedNodes[h];
+                       positions[h].resize(indices.size());
+                       std::iota(positions[h].begin(), positions[h].end(), 0);
+                       std::sort(positions[h].begin(), positions[h].end(),
+                                 [&](uint32_t a, uint32_t b) {
+                                   return indices[a] < indices[b];
+                                 });
+                     },
+                     galois::no_stats());
+    }
+    return positions;
+  }
+
+  /**
+   * Serializes the part of a pipelined sync message to host x that covers
+   * the shared nodes with local ids in the given intervals. Runs on a single
+   * thread.
+   *
+   * A part is a regular sync message (see syncRecvApply) whose offsets
+   * index the full list of nodes shared with x, preceded by the number of
+   * parts the receiver has to expect from this host.
+   *
+   * @tparam syncType either reduce or broadcast
+   * @tparam SyncFnTy synchronization structure with info needed to synchronize
+   * @tparam BitsetFnTy struct that has info on how to access the bitset
+   *
+   * @param x host the part is for
+   * @param intervals local id intervals [begin, end) covered by the part
+   * @param numParts number of parts every host sends to x
+   * @param offsets scratch space for the offsets
+   * @param val_vec scratch space for the extracted values
+   * @param coded scratch space for the coded offsets
+   * @param b OUTPUT: buffer to serialize the part into
+   */
+  template <SyncType syncType, typename SyncFnTy, typename BitsetFnTy>
+  void extract_pipelined_part(
+      unsigned x, const std::vector<std::pair<size_t, size_t>>& intervals,
+      uint32_t numParts, galois::PODResizeableArray<unsigned int>& offsets,
+      galois::PODResizeableArray<typename SyncFnTy::ValTy>& val_vec,
+      galois::PODResizeableArray<uint8_t>& coded,
+      galois::runtime::SendBuffer& b) {
+    auto& indices = (syncType == syncReduce) ? mirrorNodes[x] : masterNodes[x];
+    auto& positions = (syncType == syncReduce) ? mirrorPositionsByLID[x]
+                                               : masterPositionsByLID[x];
+    const galois::DynamicBitSet& bit_set_compute = BitsetFnTy::get();
+
+    offsets.resize(0);
+    for (auto& interval : intervals) {
+      auto ii = std::lower_bound(positions.begin(), positions.end(),
+                                 interval.first,
+                                 [&](uint32_t pos, size_t lid) {
+                                   return indices[pos] < lid;
+                                 });
+      for (; ii != positions.end() && indices[*ii] < interval.second; ++ii) {
+        if (!BitsetFnTy::is_valid() || bit_set_compute.test(indices[*ii])) {
+          offsets.push_back(*ii);
+        }
+      }
+    }
+    std::sort(offsets.begin(), offsets.end());
+
+    size_t bit_set_count = offsets.size();
+    if (bit_set_count == 0) {
+      gSerialize(b, numParts, noData);
+      return;
+    }
+
+    val_vec.resize(bit_set_count);
+    for (size_t n = 0; n < bit_set_count; ++n) {
+      val_vec[n] = extract_wrapper<SyncFnTy, syncType>(indices[offsets[n]]);
+    }
+
+    // a part only covers some of the shared nodes, so only the offsets
+    // modes apply
+    DataCommMode data_mode = enforce_data_mode;
+    if (data_mode != offsetsData && data_mode != varintOffsetsData &&
+        data_mode != runLengthBitsetData) {
+      size_t offsets_size = bit_set_count * sizeof(unsigned int);
+      size_t varint_size  = galois::runtime::encodedOffsetsSize<
+          galois::runtime::internal::DeltaVarintCoder, false>(offsets,
+                                                              bit_set_count);
+      size_t run_length_size = galois::runtime::encodedOffsetsSize<
+          galois::runtime::internal::RunLengthCoder, false>(offsets,
+                                                            bit_set_count);
+      data_mode = offsetsData;
+      if (varint_size < std::min(offsets_size, run_length_size)) {
+        data_mode = varintOffsetsData;
+      } else if (run_length_size < offsets_size) {
+        data_mode = runLengthBitsetData;
+      }
+    }
+
+    if (data_mode == offsetsData) {
+      gSerialize(b, numParts, data_mode, bit_set_count, offsets, val_vec);
+    } else {
+      if (data_mode == varintOffsetsData) {
+        galois::runtime::encodeOffsets<
+            galois::runtime::internal::DeltaVarintCoder, false>(
+            offsets, bit_set_count, coded);
+      } else {
+        galois::runtime::encodeOffsets<
+            galois::runtime::internal::RunLengthCoder, false>(
+            offsets, bit_set_count, coded);
+      }
+      gSerialize(b, numParts, data_mode, bit_set_count, coded, val_vec);
+    }
+  }
+
+  /**
+   * Runs fn over range with every thread sending the updates to the shared
+   * nodes of its block of the range as soon as the block is done, i.e.
+   * while other threads are still computing. Threads do not steal work
+   * from each other so that a finished block stays finished.
+   *
+   * @tparam syncType either reduce or broadcast
+   * @tparam SyncFnTy synchronization structure with info needed to synchronize
+   * @tparam BitsetFnTy struct that has info on how to access the bitset
+   *
+   * @param range range to run fn over
+   * @param fn operator to run on every node of the range
+   * @param writeLocation Location data is written (src or dst)
+   * @param readLocation Location data is read (src or dst)
+   */
+  template <SyncType syncType, typename SyncFnTy, typename BitsetFnTy,
+            typename FunctionTy>
+  void sync_pipelined_send(const NodeRangeType& range, const FunctionTy& fn,
+                           WriteLocation writeLocation,
+                           ReadLocation readLocation) {
+    using Clock = std::chrono::high_resolution_clock;
+    auto& net   = galois::runtime::getSystemNetworkInterface();
+
+    get_positions_by_lid(syncType);
+
+    std::vector<unsigned> sendTo;
+    for (unsigned h = 1; h < numHosts; ++h) {
+      unsigned x = (id + h) % numHosts;
+      if (!nothingToSend(x, syncType, writeLocation, readLocation))
+        sendTo.push_back(x);
+    }
+
+    uint32_t numParts = galois::getActiveThreads();
+    std::vector<Clock::time_point> blockDone(numParts);
+    size_t globalBegin = *range.begin();
+    size_t globalEnd   = *range.end();
+
+    galois::on_each([&](unsigned tid, unsigned nthreads) {
+      auto block = range.block_pair();
+      for (auto ii = block.first; ii != block.second; ++ii) {
+        fn(*ii);
+      }
+      blockDone[tid] = Clock::now();
+
+      // lids outside of the range may have been updated by earlier loops
+      std::vector<std::pair<size_t, size_t>> intervals;
+      if (*block.first < *block.second)
+        intervals.emplace_back(*block.first, *block.second);
+      if (tid == 0 && globalBegin > 0)
+        intervals.emplace_back(0, globalBegin);
+      if (tid == nthreads - 1 && globalEnd < size())
+        intervals.emplace_back(globalEnd, size());
+
+      galois::PODResizeableArray<unsigned int> offsets;
+      galois::PODResizeableArray<typename SyncFnTy::ValTy> val_vec;
+      galois::PODResizeableArray<uint8_t> coded;
+      for (unsigned x : sendTo) {
+        galois::runtime::SendBuffer b;
+        extract_pipelined_part<syncType, SyncFnTy, BitsetFnTy>(
+            x, intervals, numParts, offsets, val_vec, coded, b);
+        net.sendTagged(x, galois::runtime::evilPhase, b);
+      }
+      net.flush();
+    });
+
+    if (BitsetFnTy::is_valid()) {
+      reset_bitset(syncType, &BitsetFnTy::reset_range);
+    }
+
+    pipelined.firstBlockDone =
+        *std::min_element(blockDone.begin(), blockDone.end());
+    pipelined.lastBlockDone =
+        *std::max_element(blockDone.begin(), blockDone.end());
+  }
+
+  /**
+   * Reports how much of the pipelined sync that just completed was
+   * overlapped with computation: the time between the first and the last
+   * thread finishing its block, against the time from the last thread
+   * finishing its block until the sync completed.
+   */
+  void report_pipelined_stats() {
+    using namespace std::chrono;
+    auto done = high_resolution_clock::now();
+    uint64_t overlapped =
+        duration_cast<microseconds>(pipelined.lastBlockDone -
+                                    pipelined.firstBlockDone)
+            .count();
+    uint64_t exposed =
+        duration_cast<microseconds>(done - pipelined.lastBlockDone).count();
+
+    std::string run_id = get_run_identifier(pipelined.loopName);
+    auto& totals       = pipelinedTotals[run_id];
+    totals.overlapped += overlapped;
+    totals.exposed += exposed;
+    int64_t efficiency = 0;
+    if (totals.overlapped + totals.exposed > 0) {
+      efficiency =
+          (100 * totals.overlapped) / (totals.overlapped + totals.exposed);
+    }
+
+    using galois::runtime::StatTotal;
+    galois::runtime::reportDistStat(GRNAME, "SyncOverlapUsec_" + run_id,
+                                    overlapped, StatTotal::TSUM,
+                                    StatTotal::TAVG);
+    galois::runtime::reportDistStat(GRNAME, "SyncExposedUsec_" + run_id,
+                                    exposed, StatTotal::TSUM, StatTotal::TAVG);
+    // reported values add up, so report the change of the efficiency of
+    // the run
+    galois::runtime::reportDistStat(GRNAME, "SyncOverlapEfficiency_" + run_id,
+                                    efficiency - totals.reportedEfficiency,
+                                    StatTotal::TSUM, StatTotal::TAVG);
+    totals.reportedEfficiency = efficiency;
+  }
+
 public:
   /**
    * Main sync call exposed to the user that calls the correct sync function
@@ -3830,6 +4704,171 @@ public:
     Tsync.stop();
   }
 
+  /**
+   * Runs fn over range and starts the sync of the field it writes, sending
+   * the updates of each thread's block of the range while the other blocks
+   * are still being computed. The received updates are applied by
+   * sync_pipelined_progress or sync_pipelined_wait, so the caller can do
+   * other work (that does not touch the synchronized field) in between. No
+   * other sync may be started before sync_pipelined_wait returns.
+   *
+   * Only a field written at the source of the range (writeSource) is final
+   * once a block is done, so for other write locations this runs fn and
+   * does a regular sync. Of a sync with a reduce and a broadcast phase, only
+   * the first phase is pipelined; the second one runs in
+   * sync_pipelined_wait.
+   *
+   * @tparam writeLocation Location data is written (src or dst)
+   * @tparam readLocation Location data is read (src or dst)
+   * @tparam ReduceFnTy specify how to do reductions
+   * @tparam BroadcastFnTy specify how to do broadcasts
+   * @tparam BitsetFnTy struct that has info on how to access the bitset
+   *
+   * @param range one of the node ranges of this graph (e.g.
+   * allNodesWithEdgesRange)
+   * @param fn operator to run on every node of the range
+   * @param loopName used to name timers for statistics
+   */
+  template <WriteLocation writeLocation, ReadLocation readLocation,
+            typename ReduceFnTy, typename BroadcastFnTy,
+            typename BitsetFnTy = galois::InvalidBitsetFnTy,
+            typename FunctionTy>
+  void sync_pipelined_start(const NodeRangeType& range, const FunctionTy& fn,
+                            std::string loopName) {
+    static_assert(!BitsetFnTy::is_vector_bitset(),
+                  "pipelined sync does not support vector bitsets");
+    assert(!pipelined.active);
+
+    bool needReduce, needBroadcast;
+    get_sync_phases(writeLocation, readLocation, needReduce, needBroadcast);
+
+    if (writeLocation != writeSource || !(needReduce || needBroadcast)) {
+      galois::do_all(galois::iterate(range), fn, galois::no_stats(),
+                     galois::loopname(get_run_identifier(loopName).c_str()));
+      sync<writeLocation, readLocation, ReduceFnTy, BroadcastFnTy,
+           BitsetFnTy>(loopName);
+      return;
+    }
+
+    pipelined.active   = true;
+    pipelined.loopName = loopName;
+    pipelined.partsLeft.assign(numHosts, 0);
+    pipelined.hostsLeft = 0;
+    SyncType syncType   = needReduce ? syncReduce : syncBroadcast;
+    for (unsigned x = 0; x < numHosts; ++x) {
+      if (x != id && !nothingToRecv(x, syncType, writeLocation, readLocation)) {
+        // unknown until the first part arrives
+        pipelined.partsLeft[x] = ~0u;
+        ++pipelined.hostsLeft;
+      }
+    }
+
+    if (needReduce) {
+      sync_pipelined_send<syncReduce, ReduceFnTy, BitsetFnTy>(
+          range, fn, writeLocation, readLocation);
+      pipelined.apply = [this](uint32_t from,
+                               galois::runtime::RecvBuffer& buf) {
+        syncRecvApply<syncReduce, ReduceFnTy, BitsetFnTy>(from, buf,
+                                                          pipelined.loopName);
+      };
+      if (needBroadcast) {
+        pipelined.finish = [this]() {
+          broadcast<writeLocation, readLocation, BroadcastFnTy, BitsetFnTy,
+                    false>(pipelined.loopName);
+        };
+      }
+    } else {
+      sync_pipelined_send<syncBroadcast, BroadcastFnTy, BitsetFnTy>(
+          range, fn, writeLocation, readLocation);
+      pipelined.apply = [this](uint32_t from,
+                               galois::runtime::RecvBuffer& buf) {
+        syncRecvApply<syncBroadcast, BroadcastFnTy, BitsetFnTy>(
+            from, buf, pipelined.loopName);
+      };
+    }
+  }
+
+  /**
+   * Applies the updates of the outstanding pipelined sync that have arrived
+   * so far without waiting for more. Once all of them are applied, runs the
+   * rest of the sync and reports the overlap statistics.
+   *
+   * @returns true if there is no outstanding pipelined sync anymore
+   */
+  bool sync_pipelined_progress() {
+    if (!pipelined.active)
+      return true;
+
+    auto& net = galois::runtime::getSystemNetworkInterface();
+    decltype(net.recieveTagged(galois::runtime::evilPhase, nullptr)) p;
+    while (pipelined.hostsLeft > 0 &&
+           (p = net.recieveTagged(galois::runtime::evilPhase, nullptr))) {
+      uint32_t numParts;
+      galois::runtime::gDeserialize(p->second, numParts);
+      uint32_t& partsLeft = pipelined.partsLeft[p->first];
+      if (partsLeft == ~0u)
+        partsLeft = numParts;
+      pipelined.apply(p->first, p->second);
+      if (--partsLeft == 0)
+        --pipelined.hostsLeft;
+    }
+    if (pipelined.hostsLeft > 0)
+      return false;
+
+    increment_evilPhase();
+    if (pipelined.finish)
+      pipelined.finish();
+
+    report_pipelined_stats();
+
+    pipelined.active = false;
+    pipelined.apply  = nullptr;
+    pipelined.finish = nullptr;
+    return true;
+  }
+
+  /**
+   * Applies the updates of the outstanding pipelined sync and runs the rest
+   * of it; returns once the sync is complete.
+   */
+  void sync_pipelined_wait() {
+    if (!pipelined.active)
+      return;
+
+    std::string timer_str("Sync_" + pipelined.loopName + "_" +
+                          get_run_identifier());
+    galois::StatTimer Tsync(timer_str.c_str(), GRNAME);
+    Tsync.start();
+    while (!sync_pipelined_progress())
+      ;
+    Tsync.stop();
+  }
+
+  /**
+   * Runs fn over range and syncs the field it writes, overlapping the
+   * communication with the computation; see sync_pipelined_start.
+   *
+   * @tparam writeLocation Location data is written (src or dst)
+   * @tparam readLocation Location data is read (src or dst)
+   * @tparam ReduceFnTy specify how to do reductions
+   * @tparam BroadcastFnTy specify how to do broadcasts
+   * @tparam BitsetFnTy struct that has info on how to access the bitset
+   *
+   * @param range one of the node ranges of this graph
+   * @param fn operator to run on every node of the range
+   * @param loopName used to name timers for statistics
+   */
+  template <WriteLocation writeLocation, ReadLocation readLocation,
+            typename ReduceFnTy, typename BroadcastFnTy,
+            typename BitsetFnTy = galois::InvalidBitsetFnTy,
+            typename FunctionTy>
+  void sync_pipelined(const NodeRangeType& range, const FunctionTy& fn,
+                      std::string loopName) {
+    sync_pipelined_start<writeLocation, readLocation, ReduceFnTy,
+                         BroadcastFnTy, BitsetFnTy>(range, fn, loopName);
+    sync_pipelined_wait();
+  }
+
 private:
   /**
    * Generic Sync on demand handler. Should NEVER get to this (hence
@@ -4354,14 +5393,37 @@ public:
 #endif
   }
 
+  //! Flattens per host proxy lists into their sizes followed by their entries
+  std::vector<uint64_t>
+  flattenProxies(const std::vector<std::vector<size_t>>& proxies) const {
+    std::vector<uint64_t> flat(numHosts);
+    for (uint32_t h = 0; h < numHosts; ++h) {
+      flat[h] = proxies[h].size();
+    }
+    for (uint32_t h = 0; h < numHosts; ++h) {
+      flat.insert(flat.end(), proxies[h].begin(), proxies[h].end());
+    }
+    return flat;
+  }
+
+  //! Inverse of flattenProxies
+  void unflattenProxies(const uint64_t* flat,
+                        std::vector<std::vector<size_t>>& proxies) const {
+    const uint64_t* entries = flat + numHosts;
+    for (uint32_t h = 0; h < numHosts; ++h) {
+      proxies[h].assign(entries, entries + flat[h]);
+      entries += flat[h];
+    }
+  }
+
   /**
-   * Write the local LC_CSR graph to the file on a disk.
+   * Write the local LC_CSR graph to the file on a disk as a partition image
+   * (see PartitionImage.h).
    *
    * @param localGraphFileName file name to write local graph to.
    */
   void
   save_local_graph_to_file(std::string localGraphFileName = "local_graph") {
-    using namespace boost::archive;
     galois::StatTimer dGraphTimerSaveLocalGraph("TimerSaveLocalGraph", GRNAME);
     dGraphTimerSaveLocalGraph.start();
 
@@ -4369,44 +5431,106 @@ public:
 
     galois::gDebug("[", id, "] inside save_local_graph_to_file \n");
 
-    std::ofstream outputStream(fileName, std::ios::binary);
-    if (!outputStream.is_open()) {
-      std::cerr << "ERROR: Could not open " << fileName
-                << " to save local graph!!!\n";
-    }
-
-    boost::archive::binary_oarchive ar(outputStream, boost::archive::no_header);
+    const uint64_t edgeDataSize = LargeArray<EdgeTy>::size_of::value;
+    PartitionImageWriter image(id, numHosts, edgeDataSize);
+
+    // scalars
+    PartitionImageScalars scalars;
+    scalars.numGlobalNodes    = numGlobalNodes;
+    scalars.numGlobalEdges    = numGlobalEdges;
+    scalars.numNodes          = graph.size();
+    scalars.numEdges          = graph.sizeEdges();
+    scalars.numOwned          = numOwned;
+    scalars.beginMaster       = beginMaster;
+    scalars.numNodesWithEdges = numNodesWithEdges;
+    scalars.transposed        = transposed;
+    image.add(PartitionImageSection::Scalars, &scalars, sizeof(scalars));
 
     // graph topology
-    ar << graph;
-    ar << numGlobalNodes;
-    ar << numGlobalEdges;
-
-    // bool
-    ar << transposed;
+    image.add(PartitionImageSection::EdgeIndices, graph.edgeIndexArray(),
+              scalars.numNodes * sizeof(uint64_t));
+    image.add(PartitionImageSection::EdgeDests, graph.edgeDstArray(),
+              scalars.numEdges * sizeof(uint32_t));
+    image.add(PartitionImageSection::EdgeData, graph.edgeDataArray(),
+              scalars.numEdges * edgeDataSize);
 
     // Proxy information
-    // TODO: Find better way to serialize vector of vectors in boost
-    // serialization
-    for (uint32_t i = 0; i < numHosts; ++i) {
-      ar << masterNodes[i];
-      ar << mirrorNodes[i];
+    std::vector<uint64_t> masters = flattenProxies(masterNodes);
+    std::vector<uint64_t> mirrors = flattenProxies(mirrorNodes);
+    image.add(PartitionImageSection::MasterNodes, masters.data(),
+              masters.size() * sizeof(uint64_t));
+    image.add(PartitionImageSection::MirrorNodes, mirrors.data(),
+              mirrors.size() * sizeof(uint64_t));
+    image.add(PartitionImageSection::GID2Host, gid2host.data(),
+              gid2host.size() * sizeof(gid2host[0]));
+
+    // partitioning scheme specific data
+    imageSerializeLocalGraph(image);
+
+    image.write(fileName);
+    dGraphTimerSaveLocalGraph.stop();
+  }
+
+  /**
+   * Sets up the graph from a mapped partition image. The topology and edge
+   * data are used in place; the image is kept mapped for as long as the graph
+   * uses it.
+   *
+   * @param image mapped partition image
+   * @param fileName file the image was mapped from (for error messages)
+   */
+  void read_local_graph_from_image(PartitionImage& image,
+                                   const std::string& fileName) {
+    const PartitionImageHeader& header = image.header();
+    if (header.hostID != id || header.numHosts != numHosts) {
+      GALOIS_DIE(fileName, " holds the partition of host ", header.hostID,
+                 " of ", header.numHosts, " but this is host ", id, " of ",
+                 numHosts);
+    }
+    if (header.edgeDataSize != LargeArray<EdgeTy>::size_of::value) {
+      GALOIS_DIE(fileName, " has edge data of size ", header.edgeDataSize,
+                 " but the graph expects ",
+                 LargeArray<EdgeTy>::size_of::value);
     }
 
-    ar << numOwned;
-    ar << beginMaster;
-    ar << numNodesWithEdges;
-    ar << gid2host;
+    // scalars
+    const PartitionImageScalars& scalars =
+        *image.section<PartitionImageScalars>(PartitionImageSection::Scalars);
+    numGlobalNodes    = scalars.numGlobalNodes;
+    numGlobalEdges    = scalars.numGlobalEdges;
+    numOwned          = scalars.numOwned;
+    beginMaster       = scalars.beginMaster;
+    numNodesWithEdges = scalars.numNodesWithEdges;
+    transposed        = scalars.transposed;
 
-    // Serialize partitioning scheme specific data structures.
-    boostSerializeLocalGraph(ar);
+    // Graph topology
+    graph.wrapTopology(
+        scalars.numNodes, scalars.numEdges,
+        image.section<uint64_t>(PartitionImageSection::EdgeIndices),
+        image.section<uint32_t>(PartitionImageSection::EdgeDests),
+        image.section(PartitionImageSection::EdgeData));
 
-    outputStream.close();
-    dGraphTimerSaveLocalGraph.stop();
+    // Proxy information
+    unflattenProxies(
+        image.section<uint64_t>(PartitionImageSection::MasterNodes),
+        masterNodes);
+    unflattenProxies(
+        image.section<uint64_t>(PartitionImageSection::MirrorNodes),
+        mirrorNodes);
+    auto ranges = image.section<std::pair<uint64_t, uint64_t>>(
+        PartitionImageSection::GID2Host);
+    gid2host.assign(ranges, ranges + numHosts);
+
+    // partitioning scheme specific data
+    imageDeSerializeLocalGraph(image);
+
+    localImage = std::move(image);
   }
 
   /**
-   * Read the local LC_CSR graph from the file on a disk.
+   * Read the local LC_CSR graph from the file on a disk. Partition images are
+   * mapped and used in place; files in the older Boost archive format are
+   * deserialized.
    *
    * @param localGraphFileName file name to read local graph from.
    */
@@ -4418,39 +5542,47 @@ public:
 
     std::string fileName = localGraphFileName + "_" + std::to_string(id);
 
-    std::ifstream inputStream(fileName, std::ios::binary);
-    if (!inputStream.is_open()) {
-      std::cerr << "ERROR: Could not open " << fileName
-                << " to read local graph!!!\n";
-    }
-
     galois::gPrint("[", id, "] inside read_local_graph_from_file \n");
 
-    boost::archive::binary_iarchive ar(inputStream, boost::archive::no_header);
+    PartitionImage image;
+    if (image.open(fileName)) {
+      read_local_graph_from_image(image, fileName);
+    } else {
+      std::ifstream inputStream(fileName, std::ios::binary);
+      if (!inputStream.is_open()) {
+        std::cerr << "ERROR: Could not open " << fileName
+                  << " to read local graph!!!\n";
+      }
 
-    // Graph topology
-    ar >> graph;
-    ar >> numGlobalNodes;
-    ar >> numGlobalEdges;
+      boost::archive::binary_iarchive ar(inputStream,
+                                         boost::archive::no_header);
 
-    // bool
-    ar >> transposed;
+      // Graph topology
+      ar >> graph;
+      ar >> numGlobalNodes;
+      ar >> numGlobalEdges;
 
-    // Proxy information
-    // TODO: Find better way to Deserialize vector of vectors in boost
-    // serialization
-    for (uint32_t i = 0; i < numHosts; ++i) {
-      ar >> masterNodes[i];
-      ar >> mirrorNodes[i];
-    }
+      // bool
+      ar >> transposed;
 
-    ar >> numOwned;
-    ar >> beginMaster;
-    ar >> numNodesWithEdges;
-    ar >> gid2host;
+      // Proxy information
+      // TODO: Find better way to Deserialize vector of vectors in boost
+      // serialization
+      for (uint32_t i = 0; i < numHosts; ++i) {
+        ar >> masterNodes[i];
+        ar >> mirrorNodes[i];
+      }
 
-    // Serialize partitioning scheme specific data structures.
-    boostDeSerializeLocalGraph(ar);
+      ar >> numOwned;
+      ar >> beginMaster;
+      ar >> numNodesWithEdges;
+      ar >> gid2host;
+
+      // Serialize partitioning scheme specific data structures.
+      boostDeSerializeLocalGraph(ar);
+
+      inputStream.close();
+    }
 
     allNodesRanges.clear();
     masterRanges.clear();
@@ -4466,7 +5598,6 @@ public:
     // Exchange information among hosts
     // send_info_to_host();
 
-    inputStream.close();
     dGraphTimerReadLocalGraph.stop();
   }
 
@@ -60,7 +60,11 @@ enum PARTITIONING_SCHEME {
   CEC,                    //!< custom edge cut
   GCVC,                    //!< generic cvc
   GHIVC,                    //!< generic hivc
-  GOEC                    //!< generic oec
+  GOEC,                   //!< generic oec
+  GHDRF,                  //!< streaming hdrf vertex cut
+  GGINGER,                //!< streaming ginger hybrid vertex cut
+  GFENNEL,                //!< streaming fennel edge cut
+  GLDG                    //!< streaming ldg edge cut
 };
 
 /**
@@ -103,6 +107,14 @@ inline const char* EnumToString(PARTITIONING_SCHEME e) {
     return "ghivc";
   case GOEC:
     return "goec";
+  case GHDRF:
+    return "hdrf";
+  case GGINGER:
+    return "ginger";
+  case GFENNEL:
+    return "fennel";
+  case GLDG:
+    return "ldg";
   default:
     GALOIS_DIE("Unsupported partition");
   }
@@ -279,6 +291,10 @@ constructSymmetricGraph(std::vector<unsigned>& scaleFactor) {
   using GenericCVC = DistGraphGeneric<NodeData, EdgeData, GenericCVC>;
   using GenericHVC = DistGraphGeneric<NodeData, EdgeData, GenericHVC>;
   using GenericEC = DistGraphGeneric<NodeData, EdgeData, NoCommunication>;
+  using GenericHDRF = DistGraphGeneric<NodeData, EdgeData, GenericHDRF>;
+  using GenericGinger = DistGraphGeneric<NodeData, EdgeData, GenericGinger>;
+  using GenericFennel = DistGraphGeneric<NodeData, EdgeData, GenericFennel>;
+  using GenericLDG = DistGraphGeneric<NodeData, EdgeData, GenericLDG>;
 
   auto& net = galois::runtime::getSystemNetworkInterface();
 
@@ -329,6 +345,19 @@ constructSymmetricGraph(std::vector<unsigned>& scaleFactor) {
   case GOEC:
     return new GenericEC(inputFile, net.ID, net.Num, false);
 
+  case GHDRF:
+    return new GenericHDRF(inputFile, net.ID, net.Num, false, readFromFile,
+                           localGraphFileName);
+  case GGINGER:
+    return new GenericGinger(inputFile, net.ID, net.Num, false, readFromFile,
+                             localGraphFileName);
+  case GFENNEL:
+    return new GenericFennel(inputFile, net.ID, net.Num, false, readFromFile,
+                             localGraphFileName);
+  case GLDG:
+    return new GenericLDG(inputFile, net.ID, net.Num, false, readFromFile,
+                          localGraphFileName);
+
   default:
     GALOIS_DIE("Error: partition scheme specified is invalid");
     return nullptr;
@@ -372,6 +401,10 @@ constructGraph(std::vector<unsigned>& scaleFactor) {
   using GenericCVC = DistGraphGeneric<NodeData, EdgeData, GenericCVC>;
   using GenericHVC = DistGraphGeneric<NodeData, EdgeData, GenericHVC>;
   using GenericEC = DistGraphGeneric<NodeData, EdgeData, NoCommunication>;
+  using GenericHDRF = DistGraphGeneric<NodeData, EdgeData, GenericHDRF>;
+  using GenericGinger = DistGraphGeneric<NodeData, EdgeData, GenericGinger>;
+  using GenericFennel = DistGraphGeneric<NodeData, EdgeData, GenericFennel>;
+  using GenericLDG = DistGraphGeneric<NodeData, EdgeData, GenericLDG>;
 
   auto& net = galois::runtime::getSystemNetworkInterface();
 
@@ -456,6 +489,24 @@ constructGraph(std::vector<unsigned>& scaleFactor) {
   case GOEC:
     return new GenericEC(inputFile, net.ID, net.Num, false);
 
+  case GHDRF:
+    return new GenericHDRF(inputFile, net.ID, net.Num, false, readFromFile,
+                           localGraphFileName);
+  case GGINGER:
+    if (inputFileTranspose.size()) {
+      return new GenericGinger(inputFileTranspose, net.ID, net.Num, true,
+                               readFromFile, localGraphFileName);
+    } else {
+      GALOIS_DIE("Error: attempting ginger cut without transpose graph");
+      break;
+    }
+  case GFENNEL:
+    return new GenericFennel(inputFile, net.ID, net.Num, false, readFromFile,
+                             localGraphFileName);
+  case GLDG:
+    return new GenericLDG(inputFile, net.ID, net.Num, false, readFromFile,
+                          localGraphFileName);
+
 
   default:
     GALOIS_DIE("Error: partition scheme specified is invalid");
@@ -504,6 +555,10 @@ constructGraph(std::vector<unsigned>& scaleFactor) {
   using GenericCVC = DistGraphGeneric<NodeData, EdgeData, GenericCVCColumnFlip>;
   using GenericHVC = DistGraphGeneric<NodeData, EdgeData, GenericHVC>;
   using GenericEC = DistGraphGeneric<NodeData, EdgeData, NoCommunication>;
+  using GenericHDRF = DistGraphGeneric<NodeData, EdgeData, GenericHDRF>;
+  using GenericGinger = DistGraphGeneric<NodeData, EdgeData, GenericGinger>;
+  using GenericFennel = DistGraphGeneric<NodeData, EdgeData, GenericFennel>;
+  using GenericLDG = DistGraphGeneric<NodeData, EdgeData, GenericLDG>;
 
   auto& net = galois::runtime::getSystemNetworkInterface();
 
@@ -642,6 +697,24 @@ constructGraph(std::vector<unsigned>& scaleFactor) {
   case GOEC:
     return new GenericEC(inputFile, net.ID, net.Num, true);
 
+  case GHDRF:
+    return new GenericHDRF(inputFile, net.ID, net.Num, true, readFromFile,
+                           localGraphFileName);
+  case GGINGER:
+    if (inputFileTranspose.size()) {
+      return new GenericGinger(inputFileTranspose, net.ID, net.Num, false,
+                               readFromFile, localGraphFileName);
+    } else {
+      GALOIS_DIE("Error: attempting ginger cut without transpose graph");
+      break;
+    }
+  case GFENNEL:
+    return new GenericFennel(inputFile, net.ID, net.Num, true, readFromFile,
+                             localGraphFileName);
+  case GLDG:
+    return new GenericLDG(inputFile, net.ID, net.Num, true, readFromFile,
+                          localGraphFileName);
+
 
   default:
     GALOIS_DIE("Error: partition scheme specified is invalid");
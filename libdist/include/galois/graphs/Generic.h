@@ -27,7 +27,10 @@
 #define _GALOIS_DIST_GENERIC_H
 
 #include "galois/graphs/DistributedGraph.h"
+#include <algorithm>
+#include <cstring>
 #include <sstream>
+#include <tuple>
 
 namespace galois {
 namespace graphs {
@@ -60,6 +63,12 @@ class DistGraphGeneric : public DistGraph<NodeTy, EdgeTy> {
   uint64_t numEdges;
   uint32_t nodesToReceive;
 
+  //! Block size (in global ids) of the masters moved by rebalance_masters
+  uint32_t migrationBlockSize = 0;
+  //! Current owner of the masters of a moved block that the partitioner
+  //! assigned to some host; key is block * numHosts + assigned host
+  std::unordered_map<uint64_t, uint32_t> migratedBlocks;
+
   /**
    * Free memory of a vector by swapping an empty vector with it
    */
@@ -71,12 +80,20 @@ class DistGraphGeneric : public DistGraph<NodeTy, EdgeTy> {
 
   unsigned getHostID(uint64_t gid) const {
     assert(gid < base_DistGraph::numGlobalNodes);
-    return graphPartitioner->getMaster(gid);
+    unsigned host = graphPartitioner->getMaster(gid);
+    if (!migratedBlocks.empty()) {
+      auto moved = migratedBlocks.find(
+          gid / migrationBlockSize * base_DistGraph::numHosts + host);
+      if (moved != migratedBlocks.end()) {
+        host = moved->second;
+      }
+    }
+    return host;
   }
 
   bool isOwned(uint64_t gid) const {
     assert(gid < base_DistGraph::numGlobalNodes);
-    return (graphPartitioner->getMaster(gid) == base_DistGraph::id);
+    return (getHostID(gid) == base_DistGraph::id);
   }
 
   virtual bool isLocal(uint64_t gid) const {
@@ -219,6 +236,15 @@ class DistGraphGeneric : public DistGraph<NodeTy, EdgeTy> {
                               *edgeEnd, base_DistGraph::numGlobalNodes,
                               base_DistGraph::numGlobalEdges);
     graphReadTimer.stop();
+
+    // streaming partitioners decide on masters and edge owners here
+    if (!graphPartitioner->noCommunication()) {
+      galois::StatTimer streamTimer("StreamPartitioning", GRNAME);
+      streamTimer.start();
+      graphPartitioner->streamPartition(bufGraph,
+                                        base_DistGraph::numGlobalEdges);
+      streamTimer.stop();
+    }
     bufGraph.resetReadCounters();
 
     galois::gstl::Vector<uint64_t> prefixSumOfEdges;
@@ -651,7 +677,8 @@ class DistGraphGeneric : public DistGraph<NodeTy, EdgeTy> {
           for (; ee != ee_end; ee++) {
             uint32_t dst = bufGraph.edgeDestination(*ee);
             uint32_t hostBelongs = -1;
-            hostBelongs = graphPartitioner->getEdgeOwner(src, dst, numEdgesL);
+            hostBelongs =
+                graphPartitioner->getEdgeOwner(src, dst, numEdgesL, *ee);
 
             numOutgoingEdges[hostBelongs][src - globalOffset] += 1;
             hostHasOutgoing.set(hostBelongs);
@@ -1294,7 +1321,7 @@ class DistGraphGeneric : public DistGraph<NodeTy, EdgeTy> {
           auto gdata    = bufGraph.edgeData(*ee);
 
           uint32_t hostBelongs =
-            graphPartitioner->getEdgeOwner(src, gdst, numEdgesL);
+            graphPartitioner->getEdgeOwner(src, gdst, numEdgesL, *ee);
           if (hostBelongs == id) {
             // edge belongs here, construct on self
             assert(this->isLocal(src));
@@ -1429,7 +1456,7 @@ class DistGraphGeneric : public DistGraph<NodeTy, EdgeTy> {
         for (; ee != ee_end; ++ee) {
           uint32_t gdst = bufGraph.edgeDestination(*ee);
           uint32_t hostBelongs =
-            graphPartitioner->getEdgeOwner(src, gdst, numEdges);
+            graphPartitioner->getEdgeOwner(src, gdst, numEdges, *ee);
 
           if (hostBelongs == id) {
             // edge belongs here, construct on self
@@ -1594,6 +1621,26 @@ class DistGraphGeneric : public DistGraph<NodeTy, EdgeTy> {
     }
   }
 
+  //! Creates an edge of a moved master from the raw bytes of its data
+  template <typename GraphTy,
+            typename std::enable_if<!std::is_void<
+                typename GraphTy::edge_data_type>::value>::type* = nullptr>
+  static void constructMovedEdge(GraphTy& graph, uint64_t e, uint32_t dst,
+                                 const uint8_t* data) {
+    typename GraphTy::edge_data_type value;
+    std::memcpy(&value, data, sizeof(value));
+    graph.constructEdge(e, dst, value);
+  }
+
+  //! Creates an edge of a moved master (void edge data)
+  template <typename GraphTy,
+            typename std::enable_if<std::is_void<
+                typename GraphTy::edge_data_type>::value>::type* = nullptr>
+  static void constructMovedEdge(GraphTy& graph, uint64_t e, uint32_t dst,
+                                 const uint8_t*) {
+    graph.constructEdge(e, dst);
+  }
+
  public:
   /**
    * Reset bitset
@@ -1639,6 +1686,333 @@ class DistGraphGeneric : public DistGraph<NodeTy, EdgeTy> {
     return graphPartitioner->isVertexCut();
   }
 
+  /**
+   * Moves blocks of masters from the host with the most work to the host
+   * with the least work until the work is within the threshold of the
+   * average (or no block can be moved without making things worse).
+   *
+   * Every host reports the work of its masters per block of global ids; all
+   * hosts then compute the same plan, so only the moved masters themselves
+   * have to be sent. A moved master takes its node data and out-edges along;
+   * mirrors are rebuilt from the edges of the new masters. Node and edge
+   * data are copied as raw bytes.
+   *
+   * Only edge cuts that keep the edges with the masters of their source are
+   * supported. The moved blocks are not saved with the local graph.
+   */
+  virtual bool rebalance_masters(const std::function<uint64_t(uint32_t)>& work,
+                                 double imbalanceThreshold = 1.2,
+                                 uint32_t blockSize        = 4096) {
+    static_assert(std::is_trivially_destructible<NodeTy>::value,
+                  "node data is moved between hosts as raw bytes");
+    if (graphPartitioner->isVertexCut() || base_DistGraph::transposed ||
+        (numNodes > base_DistGraph::numOwned &&
+         *base_DistGraph::graph.edge_begin(base_DistGraph::numOwned) !=
+             numEdges)) {
+      GALOIS_DIE("masters can only be moved in edge cuts that keep all edges "
+                 "on the masters");
+    }
+    if (!migratedBlocks.empty() && blockSize != migrationBlockSize) {
+      GALOIS_DIE("masters were already moved with a block size of ",
+                 migrationBlockSize);
+    }
+    migrationBlockSize = blockSize;
+
+    galois::StatTimer rebalanceTimer("MasterRebalancing", GRNAME);
+    rebalanceTimer.start();
+
+    auto& net               = galois::runtime::getSystemNetworkInterface();
+    const unsigned id       = base_DistGraph::id;
+    const unsigned nHosts   = base_DistGraph::numHosts;
+    const uint32_t numOwned = base_DistGraph::numOwned;
+    auto& graph             = base_DistGraph::graph;
+
+    // work of the local masters in each block
+    std::vector<uint64_t> nodeWork(numOwned);
+    galois::do_all(galois::iterate((uint32_t)0, numOwned),
+                   [&](uint32_t lid) { nodeWork[lid] = work(lid); },
+                   galois::no_stats());
+    std::unordered_map<uint64_t, uint64_t> localBlockWork;
+    for (uint32_t lid = 0; lid < numOwned; ++lid) {
+      if (nodeWork[lid]) {
+        localBlockWork[localToGlobalVector[lid] / blockSize] += nodeWork[lid];
+      }
+    }
+
+    // every host gets the work of all blocks
+    std::vector<std::vector<std::pair<uint64_t, uint64_t>>> blockWork(nHosts);
+    blockWork[id].assign(localBlockWork.begin(), localBlockWork.end());
+    std::sort(blockWork[id].begin(), blockWork[id].end());
+    for (unsigned h = 0; h < nHosts; ++h) {
+      if (h == id)
+        continue;
+      galois::runtime::SendBuffer b;
+      galois::runtime::gSerialize(b, blockWork[id]);
+      net.sendTagged(h, galois::runtime::evilPhase, b);
+    }
+    for (unsigned h = 0; h < nHosts; ++h) {
+      if (h == id)
+        continue;
+      decltype(net.recieveTagged(galois::runtime::evilPhase, nullptr)) p;
+      do {
+        p = net.recieveTagged(galois::runtime::evilPhase, nullptr);
+      } while (!p);
+      galois::runtime::gDeserialize(p->second, blockWork[p->first]);
+    }
+    base_DistGraph::increment_evilPhase();
+
+    // the plan: (block, from, to) moves computed identically on all hosts
+    std::vector<uint64_t> load(nHosts, 0);
+    for (unsigned h = 0; h < nHosts; ++h) {
+      for (auto& block : blockWork[h]) {
+        load[h] += block.second;
+      }
+    }
+    uint64_t totalWork = std::accumulate(load.begin(), load.end(), uint64_t{0});
+    double averageWork = (double)totalWork / nHosts;
+    uint64_t maxWorkBefore = *std::max_element(load.begin(), load.end());
+
+    std::vector<std::tuple<uint64_t, unsigned, unsigned>> moves;
+    while (totalWork) {
+      unsigned from = std::max_element(load.begin(), load.end()) - load.begin();
+      unsigned to   = std::min_element(load.begin(), load.end()) - load.begin();
+      if (load[from] <= imbalanceThreshold * averageWork) {
+        break;
+      }
+      // heaviest block that still leaves the sender above the receiver, so
+      // that every move lowers the spread of the load
+      uint64_t gap = load[from] - load[to];
+      size_t best  = blockWork[from].size();
+      for (size_t i = 0; i < blockWork[from].size(); ++i) {
+        uint64_t w = blockWork[from][i].second;
+        if (w < gap && (best == blockWork[from].size() ||
+                        w > blockWork[from][best].second)) {
+          best = i;
+        }
+      }
+      if (best == blockWork[from].size()) {
+        break;
+      }
+
+      auto block = blockWork[from][best];
+      blockWork[from].erase(blockWork[from].begin() + best);
+      auto merged = std::find_if(
+          blockWork[to].begin(), blockWork[to].end(),
+          [&](const std::pair<uint64_t, uint64_t>& b) {
+            return b.first == block.first;
+          });
+      if (merged != blockWork[to].end()) {
+        merged->second += block.second;
+      } else {
+        blockWork[to].push_back(block);
+      }
+      load[from] -= block.second;
+      load[to] += block.second;
+      moves.emplace_back(block.first, from, to);
+    }
+    uint64_t maxWorkAfter = *std::max_element(load.begin(), load.end());
+
+    if (id == 0) {
+      galois::gPrint("Rebalancing masters: ", moves.size(),
+                     " blocks moved, maximum host work ", maxWorkBefore,
+                     " -> ", maxWorkAfter, " (average ", averageWork, ")\n");
+    }
+    if (moves.empty()) {
+      rebalanceTimer.stop();
+      return false;
+    }
+
+    // new owners; all masters of a block that are on the sender move
+    for (auto& move : moves) {
+      uint64_t block = std::get<0>(move);
+      unsigned from  = std::get<1>(move);
+      unsigned to    = std::get<2>(move);
+      for (unsigned assigned = 0; assigned < nHosts; ++assigned) {
+        uint64_t key = block * nHosts + assigned;
+        auto owner   = migratedBlocks.find(key);
+        unsigned current =
+            (owner != migratedBlocks.end()) ? owner->second : assigned;
+        if (current != from) {
+          continue;
+        }
+        if (to == assigned) {
+          migratedBlocks.erase(key);
+        } else {
+          migratedBlocks[key] = to;
+        }
+      }
+    }
+
+    // send the masters that left along with their data and edges
+    const size_t edgeSize = LargeArray<EdgeTy>::size_of::value;
+    const uint8_t* oldEdgeData =
+        static_cast<const uint8_t*>(graph.edgeDataArray());
+    std::vector<uint32_t> keptMasters;
+    std::vector<std::vector<uint32_t>> leaving(nHosts);
+    for (uint32_t lid = 0; lid < numOwned; ++lid) {
+      unsigned owner = getHostID(localToGlobalVector[lid]);
+      if (owner == id) {
+        keptMasters.push_back(lid);
+      } else {
+        leaving[owner].push_back(lid);
+      }
+    }
+
+    uint64_t movedMasters = 0;
+    uint64_t movedEdges   = 0;
+    for (unsigned h = 0; h < nHosts; ++h) {
+      if (h == id)
+        continue;
+      std::vector<uint64_t> gids, edgeEnds, dsts;
+      std::vector<uint8_t> nodeBytes, edgeBytes;
+      for (uint32_t lid : leaving[h]) {
+        gids.push_back(localToGlobalVector[lid]);
+        auto data = reinterpret_cast<const uint8_t*>(&graph.getData(lid));
+        nodeBytes.insert(nodeBytes.end(), data, data + sizeof(NodeTy));
+        for (auto e : graph.edges(lid)) {
+          dsts.push_back(localToGlobalVector[graph.getEdgeDst(e)]);
+          edgeBytes.insert(edgeBytes.end(), oldEdgeData + *e * edgeSize,
+                           oldEdgeData + (*e + 1) * edgeSize);
+        }
+        edgeEnds.push_back(dsts.size());
+      }
+      movedMasters += gids.size();
+      movedEdges += dsts.size();
+
+      galois::runtime::SendBuffer b;
+      galois::runtime::gSerialize(b, gids, nodeBytes, edgeEnds, dsts,
+                                  edgeBytes);
+      net.sendTagged(h, galois::runtime::evilPhase, b);
+    }
+
+    struct ArrivedMasters {
+      std::vector<uint64_t> gids, edgeEnds, dsts;
+      std::vector<uint8_t> nodeBytes, edgeBytes;
+    };
+    std::vector<ArrivedMasters> arrived(nHosts);
+    for (unsigned h = 0; h < nHosts; ++h) {
+      if (h == id)
+        continue;
+      decltype(net.recieveTagged(galois::runtime::evilPhase, nullptr)) p;
+      do {
+        p = net.recieveTagged(galois::runtime::evilPhase, nullptr);
+      } while (!p);
+      auto& a = arrived[p->first];
+      galois::runtime::gDeserialize(p->second, a.gids, a.nodeBytes,
+                                    a.edgeEnds, a.dsts, a.edgeBytes);
+    }
+    base_DistGraph::increment_evilPhase();
+
+    // new local ids: kept masters, arrived masters (by sender), mirrors
+    std::vector<uint64_t> newL2G;
+    std::vector<uint64_t> edgePrefix;
+    std::vector<uint64_t> mirrors;
+    uint64_t newNumEdges = 0;
+    for (uint32_t lid : keptMasters) {
+      newL2G.push_back(localToGlobalVector[lid]);
+      for (auto e : graph.edges(lid)) {
+        uint64_t dst = localToGlobalVector[graph.getEdgeDst(e)];
+        if (!isOwned(dst)) {
+          mirrors.push_back(dst);
+        }
+      }
+      newNumEdges += std::distance(graph.edge_begin(lid), graph.edge_end(lid));
+      edgePrefix.push_back(newNumEdges);
+    }
+    for (auto& a : arrived) {
+      newL2G.insert(newL2G.end(), a.gids.begin(), a.gids.end());
+      for (uint64_t dst : a.dsts) {
+        if (!isOwned(dst)) {
+          mirrors.push_back(dst);
+        }
+      }
+      for (uint64_t end : a.edgeEnds) {
+        edgePrefix.push_back(newNumEdges + end);
+      }
+      newNumEdges += a.dsts.size();
+    }
+    uint32_t newNumOwned = newL2G.size();
+    std::sort(mirrors.begin(), mirrors.end());
+    mirrors.erase(std::unique(mirrors.begin(), mirrors.end()), mirrors.end());
+    newL2G.insert(newL2G.end(), mirrors.begin(), mirrors.end());
+    uint32_t newNumNodes = newL2G.size();
+    edgePrefix.resize(newNumNodes, newNumEdges);
+
+    std::unordered_map<uint64_t, uint32_t> newG2L;
+    newG2L.reserve(newNumNodes);
+    for (uint32_t lid = 0; lid < newNumNodes; ++lid) {
+      newG2L[newL2G[lid]] = lid;
+    }
+
+    // build the new local graph
+    decltype(base_DistGraph::graph) newGraph;
+    newGraph.allocateFrom(newNumNodes, newNumEdges);
+    newGraph.constructNodes();
+    galois::do_all(
+        galois::iterate((uint32_t)0, newNumNodes),
+        [&](uint32_t n) { newGraph.fixEndEdge(n, edgePrefix[n]); },
+        galois::no_stats());
+
+    galois::do_all(
+        galois::iterate((size_t)0, keptMasters.size()),
+        [&](size_t n) {
+          uint32_t oldLID = keptMasters[n];
+          std::memcpy(&newGraph.getData(n), &graph.getData(oldLID),
+                      sizeof(NodeTy));
+          uint64_t cur = *newGraph.edge_begin(n);
+          for (auto e : graph.edges(oldLID)) {
+            constructMovedEdge(
+                newGraph, cur++,
+                newG2L.at(localToGlobalVector[graph.getEdgeDst(e)]),
+                oldEdgeData + *e * edgeSize);
+          }
+        },
+        galois::no_stats());
+
+    uint32_t firstArrived = keptMasters.size();
+    for (auto& a : arrived) {
+      galois::do_all(
+          galois::iterate((size_t)0, a.gids.size()),
+          [&](size_t i) {
+            uint32_t n = firstArrived + i;
+            std::memcpy(&newGraph.getData(n),
+                        a.nodeBytes.data() + i * sizeof(NodeTy),
+                        sizeof(NodeTy));
+            uint64_t cur = *newGraph.edge_begin(n);
+            for (uint64_t k = (i ? a.edgeEnds[i - 1] : 0); k < a.edgeEnds[i];
+                 ++k) {
+              constructMovedEdge(newGraph, cur++, newG2L.at(a.dsts[k]),
+                                 a.edgeBytes.data() + k * edgeSize);
+            }
+          },
+          galois::no_stats());
+      firstArrived += a.gids.size();
+    }
+
+    graph.swapGraph(newGraph);
+    numNodes            = newNumNodes;
+    numEdges            = newNumEdges;
+    localToGlobalVector = std::move(newL2G);
+    globalToLocalMap    = std::move(newG2L);
+    base_DistGraph::numOwned          = newNumOwned;
+    base_DistGraph::beginMaster       = 0;
+    base_DistGraph::numNodesWithEdges = newNumOwned;
+
+    for (auto& hostMirrors : base_DistGraph::mirrorNodes) {
+      hostMirrors.clear();
+    }
+    for (uint32_t lid = newNumOwned; lid < numNodes; ++lid) {
+      base_DistGraph::mirrorNodes[getHostID(localToGlobalVector[lid])]
+          .push_back(localToGlobalVector[lid]);
+    }
+    base_DistGraph::reset_proxies();
+
+    rebalanceTimer.stop();
+    galois::runtime::reportStat_Tsum(GRNAME, "MastersMoved", movedMasters);
+    galois::runtime::reportStat_Tsum(GRNAME, "EdgesMoved", movedEdges);
+    return true;
+  }
+
   virtual void boostSerializeLocalGraph(boost::archive::binary_oarchive& ar,
                                         const unsigned int version = 0) const {
     // unsigned ints
@@ -1667,6 +2041,41 @@ class DistGraphGeneric : public DistGraph<NodeTy, EdgeTy> {
     ar >> localToGlobalVector;
     ar >> globalToLocalMap;
   }
+
+  //! The global ids of the local nodes go into a section of their own; the
+  //! map from global to local ids is rebuilt from them when reading
+  virtual void imageSerializeLocalGraph(PartitionImageWriter& image) const {
+    std::ostringstream stream;
+    {
+      boost::archive::binary_oarchive ar(stream, boost::archive::no_header);
+      ar << numNodes;
+      graphPartitioner->serializePartition(ar);
+    }
+    image.addCopy(PartitionImageSection::Partition, stream.str());
+    image.add(PartitionImageSection::LocalToGlobal, localToGlobalVector.data(),
+              localToGlobalVector.size() * sizeof(uint64_t));
+  }
+
+  virtual void imageDeSerializeLocalGraph(const PartitionImage& image) {
+    graphPartitioner = new Partitioner(base_DistGraph::id, base_DistGraph::numHosts);
+    graphPartitioner->saveGIDToHost(base_DistGraph::gid2host);
+
+    galois::graphs::internal::MemoryStreamBuf buffer(
+        image.section(PartitionImageSection::Partition),
+        image.sectionSize(PartitionImageSection::Partition));
+    std::istream stream(&buffer);
+    boost::archive::binary_iarchive ar(stream, boost::archive::no_header);
+    ar >> numNodes;
+    graphPartitioner->deserializePartition(ar);
+
+    const uint64_t* gids =
+        image.section<uint64_t>(PartitionImageSection::LocalToGlobal);
+    localToGlobalVector.assign(gids, gids + numNodes);
+    globalToLocalMap.reserve(numNodes);
+    for (uint32_t i = 0; i < numNodes; ++i) {
+      globalToLocalMap[gids[i]] = i;
+    }
+  }
 };
 
 // make GRNAME visible to public
@@ -3,6 +3,9 @@
 
 #include "DistributedGraph.h"
 #include <utility>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 
 class NoCommunication {
   std::vector<std::pair<uint64_t, uint64_t>> _gid2host;
@@ -17,6 +20,9 @@ class NoCommunication {
     _gid2host = gid2host;
   }
 
+  template <typename GraphTy>
+  void streamPartition(GraphTy&, uint64_t) {}
+
   uint32_t getMaster(uint32_t gid) const {
     for (auto h = 0U; h < _numHosts; ++h) {
       uint64_t start, end;
@@ -29,7 +35,7 @@ class NoCommunication {
     return _numHosts;
   }
 
-  uint32_t getEdgeOwner(uint32_t src, uint32_t, uint64_t) const {
+  uint32_t getEdgeOwner(uint32_t src, uint32_t, uint64_t, uint64_t) const {
     return getMaster(src);
   }
 
@@ -116,6 +122,9 @@ class GenericCVC {
     _gid2host = gid2host;
   }
 
+  template <typename GraphTy>
+  void streamPartition(GraphTy&, uint64_t) {}
+
   uint32_t getMaster(uint32_t gid) const {
     for (auto h = 0U; h < _numHosts; ++h) {
       uint64_t start, end;
@@ -128,7 +137,8 @@ class GenericCVC {
     return _numHosts;
   }
 
-  uint32_t getEdgeOwner(uint32_t src, uint32_t dst, uint64_t numEdges) const {
+  uint32_t getEdgeOwner(uint32_t src, uint32_t dst, uint64_t numEdges,
+                        uint64_t) const {
     int i         = getColumnOfNode(dst);
     return _h_offset + i;
   }
@@ -284,6 +294,9 @@ class GenericCVCColumnFlip {
     _gid2host = gid2host;
   }
 
+  template <typename GraphTy>
+  void streamPartition(GraphTy&, uint64_t) {}
+
   uint32_t getMaster(uint32_t gid) const {
     for (auto h = 0U; h < _numHosts; ++h) {
       uint64_t start, end;
@@ -296,7 +309,8 @@ class GenericCVCColumnFlip {
     return _numHosts;
   }
 
-  uint32_t getEdgeOwner(uint32_t src, uint32_t dst, uint64_t numEdges) const {
+  uint32_t getEdgeOwner(uint32_t src, uint32_t dst, uint64_t numEdges,
+                        uint64_t) const {
     int i         = getColumnOfNode(dst);
     return _h_offset + i;
   }
@@ -410,6 +424,9 @@ class GenericHVC {
     _gid2host = gid2host;
   }
 
+  template <typename GraphTy>
+  void streamPartition(GraphTy&, uint64_t) {}
+
   uint32_t getMaster(uint32_t gid) const {
     for (auto h = 0U; h < _numHosts; ++h) {
       uint64_t start, end;
@@ -422,7 +439,8 @@ class GenericHVC {
     return _numHosts;
   }
 
-  uint32_t getEdgeOwner(uint32_t src, uint32_t dst, uint64_t numEdges) const {
+  uint32_t getEdgeOwner(uint32_t src, uint32_t dst, uint64_t numEdges,
+                        uint64_t) const {
     if (numEdges > _vCutThreshold) {
       return getMaster(dst);
     } else {
@@ -459,4 +477,488 @@ class GenericHVC {
     return false;
   }
 };
+/**
+ * Common parts of the streaming partitioners below. Every host streams the
+ * nodes it read (and their edges) in a fixed number of rounds. Threads work
+ * on a round in parallel and score against the partition loads of the last
+ * synchronization plus what they added themselves since then; at the end of
+ * a round, the loads added by all threads of all hosts are combined (along
+ * with whatever else a partitioner shares), so that all hosts start the next
+ * round with the same loads.
+ */
+class StreamingPartitioner {
+ protected:
+  std::vector<std::pair<uint64_t, uint64_t>> _gid2host;
+  uint32_t _hostID;
+  uint32_t _numHosts;
+  //! loads of the partitions as of the last synchronization
+  std::vector<uint64_t> _loads;
+  //! loads each thread added since the last synchronization
+  galois::substrate::PerThreadStorage<std::vector<uint64_t>> _addedLoads;
+
+  //! number of rounds (and synchronizations) the stream is split into
+  constexpr static uint32_t numRounds = 32;
+
+  StreamingPartitioner(uint32_t hostID, uint32_t numHosts) {
+    _hostID   = hostID;
+    _numHosts = numHosts;
+    _loads.assign(numHosts, 0);
+  }
+
+  //! Returns the load of partition h as seen by the calling thread
+  uint64_t load(uint32_t h) const {
+    return _loads[h] + (*_addedLoads.getLocal())[h];
+  }
+
+  //! Adds to the load of partition h
+  void addLoad(uint32_t h, uint64_t amount) {
+    (*_addedLoads.getLocal())[h] += amount;
+  }
+
+  /**
+   * Streams the nodes this host read in numRounds rounds.
+   *
+   * @param nodeFn called on every node read by this host, in parallel
+   * @param sendFn called with a send buffer and the node range [begin, end)
+   * of a round to add what the other hosts need to know about it
+   * @param recvFn called with the sending host and the buffer of every
+   * message received in a round, positioned after the loads
+   */
+  template <typename NodeFnTy, typename SendFnTy, typename RecvFnTy>
+  void streamRounds(NodeFnTy nodeFn, SendFnTy sendFn, RecvFnTy recvFn) {
+    auto& net          = galois::runtime::getSystemNetworkInterface();
+    uint64_t begin     = _gid2host[_hostID].first;
+    uint64_t end       = _gid2host[_hostID].second;
+    uint64_t roundSize = (end - begin + numRounds - 1) / numRounds;
+
+    galois::on_each([&](unsigned, unsigned) {
+      _addedLoads.getLocal()->assign(_numHosts, 0);
+    });
+
+    for (uint32_t r = 0; r < numRounds; ++r) {
+      uint64_t roundBegin = std::min(begin + r * roundSize, end);
+      uint64_t roundEnd   = std::min(roundBegin + roundSize, end);
+      galois::do_all(galois::iterate(roundBegin, roundEnd), nodeFn,
+                     galois::steal(), galois::no_stats());
+
+      // combine the loads added by the threads
+      std::vector<uint64_t> added(_numHosts, 0);
+      for (unsigned t = 0; t < galois::getActiveThreads(); ++t) {
+        auto& threadAdded = *_addedLoads.getRemote(t);
+        for (uint32_t h = 0; h < _numHosts; ++h) {
+          added[h] += threadAdded[h];
+          threadAdded[h] = 0;
+        }
+      }
+
+      for (uint32_t h = 0; h < _numHosts; ++h) {
+        if (h == _hostID)
+          continue;
+        galois::runtime::SendBuffer b;
+        galois::runtime::gSerialize(b, added);
+        sendFn(b, roundBegin, roundEnd);
+        net.sendTagged(h, galois::runtime::evilPhase, b);
+      }
+      for (uint32_t h = 0; h < _numHosts; ++h) {
+        _loads[h] += added[h];
+      }
+
+      for (uint32_t h = 0; h < _numHosts - 1; ++h) {
+        decltype(net.recieveTagged(galois::runtime::evilPhase, nullptr)) p;
+        do {
+          p = net.recieveTagged(galois::runtime::evilPhase, nullptr);
+        } while (!p);
+        galois::runtime::gDeserialize(p->second, added);
+        for (uint32_t i = 0; i < _numHosts; ++i) {
+          _loads[i] += added[i];
+        }
+        recvFn(p->first, p->second);
+      }
+      ++galois::runtime::evilPhase;
+      if (galois::runtime::evilPhase >=
+          std::numeric_limits<int16_t>::max()) { // limit defined by MPI or LCI
+        galois::runtime::evilPhase = 1;
+      }
+    }
+  }
+};
+
+/**
+ * Streaming partitioners that place every node on the partition maximizing a
+ * score of how many of its out-neighbors are already there and how loaded
+ * the partition is. The load of a partition is the number of nodes plus the
+ * number of edges it holds (what computeMasters balances as well). Masters
+ * assigned by other hosts become known at the end of every round; at the end
+ * of the stream all hosts have the same masters.
+ */
+class StreamingMasterPartitioner : public StreamingPartitioner {
+ protected:
+  //! master of every node; _numHosts if not assigned (yet)
+  std::vector<uint32_t> _masters;
+  //! number of neighbors on each partition of the node being placed
+  galois::substrate::PerThreadStorage<std::vector<uint64_t>> _neighbors;
+
+  StreamingMasterPartitioner(uint32_t hostID, uint32_t numHosts)
+      : StreamingPartitioner(hostID, numHosts) {}
+
+  /**
+   * Assigns the masters of all nodes.
+   *
+   * @param bufGraph nodes (and edges) read by this host
+   * @param scoreFn returns the score of placing a node with the given number
+   * of neighbors and the given load of its own on a partition with the given
+   * load
+   * @param highDegreeThreshold the edges of nodes with more edges than this
+   * are placed with the masters of their destinations rather than with the
+   * master of their source
+   */
+  template <typename GraphTy, typename ScoreFnTy>
+  void streamMasters(GraphTy& bufGraph, ScoreFnTy scoreFn,
+                     uint64_t highDegreeThreshold) {
+    _masters.assign(_gid2host.back().second, _numHosts);
+    galois::on_each([&](unsigned, unsigned) {
+      _neighbors.getLocal()->assign(_numHosts, 0);
+    });
+
+    streamRounds(
+        [&](uint64_t src) {
+          auto ee            = bufGraph.edgeBegin(src);
+          auto ee_end        = bufGraph.edgeEnd(src);
+          uint64_t numEdgesL = std::distance(ee, ee_end);
+          auto& neighbors    = *_neighbors.getLocal();
+
+          std::fill(neighbors.begin(), neighbors.end(), 0);
+          for (; ee != ee_end; ++ee) {
+            uint32_t master = _masters[bufGraph.edgeDestination(*ee)];
+            if (master != _numHosts) {
+              neighbors[master] += 1;
+            }
+          }
+
+          // ties go to this host (whose view of its own load is the most
+          // current), then to the least loaded partition
+          uint64_t nodeLoad = 1 + numEdgesL;
+          uint32_t best     = _hostID;
+          double bestScore  = scoreFn(neighbors[best], nodeLoad, load(best));
+          for (uint32_t h = 0; h < _numHosts; ++h) {
+            if (h == _hostID)
+              continue;
+            double score = scoreFn(neighbors[h], nodeLoad, load(h));
+            if ((score > bestScore) ||
+                (score == bestScore && best != _hostID &&
+                 load(h) < load(best))) {
+              best      = h;
+              bestScore = score;
+            }
+          }
+          _masters[src] = best;
+
+          if (numEdgesL <= highDegreeThreshold) {
+            addLoad(best, nodeLoad);
+          } else {
+            addLoad(best, 1);
+            for (ee = bufGraph.edgeBegin(src); ee != ee_end; ++ee) {
+              uint32_t master = _masters[bufGraph.edgeDestination(*ee)];
+              addLoad((master != _numHosts) ? master : best, 1);
+            }
+          }
+        },
+        [&](galois::runtime::SendBuffer& b, uint64_t begin, uint64_t end) {
+          std::vector<uint32_t> assigned(_masters.begin() + begin,
+                                         _masters.begin() + end);
+          galois::runtime::gSerialize(b, begin, assigned);
+        },
+        [&](uint32_t, galois::runtime::RecvBuffer& b) {
+          uint64_t begin;
+          std::vector<uint32_t> assigned;
+          galois::runtime::gDeserialize(b, begin, assigned);
+          std::copy(assigned.begin(), assigned.end(),
+                    _masters.begin() + begin);
+        });
+  }
+
+  /**
+   * Assigns the masters of all nodes with the Fennel score: the number of
+   * neighbors on a partition minus the cost of adding the node's load to it,
+   * at the marginal cost alpha * gamma * load^(gamma - 1) of a unit of load.
+   */
+  template <typename GraphTy>
+  void streamFennel(GraphTy& bufGraph, uint64_t numGlobalEdges,
+                    uint64_t highDegreeThreshold) {
+    constexpr double gamma = 1.5;
+    double totalLoad       = _gid2host.back().second + numGlobalEdges;
+    double alpha           = numGlobalEdges *
+                   std::pow(_numHosts, gamma - 1) /
+                   std::pow(std::max(totalLoad, 1.0), gamma);
+
+    streamMasters(bufGraph,
+                  [&](uint64_t neighbors, uint64_t nodeLoad, uint64_t load) {
+                    return neighbors - nodeLoad * alpha * gamma *
+                                           std::pow(load, gamma - 1);
+                  },
+                  highDegreeThreshold);
+  }
+
+ public:
+  void saveGIDToHost(std::vector<std::pair<uint64_t, uint64_t>>& gid2host) {
+    _gid2host = gid2host;
+  }
+
+  uint32_t getMaster(uint32_t gid) const {
+    return _masters[gid];
+  }
+
+  constexpr static bool isCartCut() {
+    return false;
+  }
+
+  // not used by this
+  bool isNotCommunicationPartner(unsigned, unsigned, WriteLocation,
+                                 ReadLocation, bool) {
+    return false;
+  }
+
+  void serializePartition(boost::archive::binary_oarchive& ar) {
+    ar << _masters;
+  }
+
+  void deserializePartition(boost::archive::binary_iarchive& ar) {
+    ar >> _masters;
+  }
+
+  bool noCommunication() {
+    return false;
+  }
+};
+
+/**
+ * Fennel edge cut: nodes are placed by the Fennel score and take all of
+ * their edges with them.
+ */
+class GenericFennel : public StreamingMasterPartitioner {
+ public:
+  GenericFennel(uint32_t hostID, uint32_t numHosts)
+      : StreamingMasterPartitioner(hostID, numHosts) {}
+
+  template <typename GraphTy>
+  void streamPartition(GraphTy& bufGraph, uint64_t numGlobalEdges) {
+    streamFennel(bufGraph, numGlobalEdges,
+                 std::numeric_limits<uint64_t>::max());
+  }
+
+  uint32_t getEdgeOwner(uint32_t src, uint32_t, uint64_t, uint64_t) const {
+    return getMaster(src);
+  }
+
+  bool isVertexCut() const {
+    return false;
+  }
+};
+
+/**
+ * Linear deterministic greedy edge cut: nodes are placed on the partition
+ * maximizing the number of neighbors there weighted by how far the partition
+ * is from its capacity, and take all of their edges with them.
+ */
+class GenericLDG : public StreamingMasterPartitioner {
+ public:
+  GenericLDG(uint32_t hostID, uint32_t numHosts)
+      : StreamingMasterPartitioner(hostID, numHosts) {}
+
+  template <typename GraphTy>
+  void streamPartition(GraphTy& bufGraph, uint64_t numGlobalEdges) {
+    // 10% of slack over a perfectly balanced load
+    double capacity =
+        1.1 * (_gid2host.back().second + numGlobalEdges) / _numHosts;
+
+    streamMasters(bufGraph,
+                  [&](uint64_t neighbors, uint64_t nodeLoad, uint64_t load) {
+                    if (load + nodeLoad > capacity) {
+                      return std::numeric_limits<double>::lowest();
+                    }
+                    return neighbors * (1 - load / capacity);
+                  },
+                  std::numeric_limits<uint64_t>::max());
+  }
+
+  uint32_t getEdgeOwner(uint32_t src, uint32_t, uint64_t, uint64_t) const {
+    return getMaster(src);
+  }
+
+  bool isVertexCut() const {
+    return false;
+  }
+};
+
+/**
+ * Ginger hybrid vertex cut: nodes are placed by the Fennel score; like
+ * GenericHVC, the edges of low-degree nodes stay with their source while
+ * those of high-degree nodes go to their destinations.
+ */
+class GenericGinger : public StreamingMasterPartitioner {
+  uint32_t _vCutThreshold;
+
+ public:
+  GenericGinger(uint32_t hostID, uint32_t numHosts)
+      : StreamingMasterPartitioner(hostID, numHosts) {
+    _vCutThreshold = 1000; // same default as GenericHVC
+  }
+
+  template <typename GraphTy>
+  void streamPartition(GraphTy& bufGraph, uint64_t numGlobalEdges) {
+    streamFennel(bufGraph, numGlobalEdges, _vCutThreshold);
+  }
+
+  uint32_t getEdgeOwner(uint32_t src, uint32_t dst, uint64_t numEdges,
+                        uint64_t) const {
+    if (numEdges > _vCutThreshold) {
+      return getMaster(dst);
+    } else {
+      return getMaster(src);
+    }
+  }
+
+  bool isVertexCut() const {
+    return true;
+  }
+};
+
+/**
+ * HDRF (high-degree replicated first) vertex cut: masters are blocked as
+ * read, and every edge goes to the partition that already has replicas of its
+ * endpoints (preferring the endpoint with the lower degree seen so far) and
+ * is least loaded. The load of a partition is its number of edges.
+ *
+ * Replicas are known from the masters and from the edges this host
+ * assigned; replicas created by other hosts are not shared.
+ */
+class GenericHDRF : public StreamingPartitioner {
+  //! owner of every edge this host read, by edge id relative to _firstEdge
+  std::vector<uint32_t> _edgeOwners;
+  uint64_t _firstEdge;
+
+  //! weight of the balance term relative to the replication term
+  constexpr static double lambda = 1.0;
+  constexpr static double epsilon = 1.0;
+
+ public:
+  GenericHDRF(uint32_t hostID, uint32_t numHosts)
+      : StreamingPartitioner(hostID, numHosts) {
+    _firstEdge = 0;
+  }
+
+  void saveGIDToHost(std::vector<std::pair<uint64_t, uint64_t>>& gid2host) {
+    _gid2host = gid2host;
+  }
+
+  uint32_t getMaster(uint32_t gid) const {
+    for (auto h = 0U; h < _numHosts; ++h) {
+      uint64_t start, end;
+      std::tie(start, end) = _gid2host[h];
+      if (gid >= start && gid < end) {
+        return h;
+      }
+    }
+    assert(false);
+    return _numHosts;
+  }
+
+  template <typename GraphTy>
+  void streamPartition(GraphTy& bufGraph, uint64_t) {
+    uint64_t numGlobalNodes = _gid2host.back().second;
+    uint64_t begin          = _gid2host[_hostID].first;
+    uint64_t end            = _gid2host[_hostID].second;
+    if (begin < end) {
+      _firstEdge = *bufGraph.edgeBegin(begin);
+      _edgeOwners.resize(*bufGraph.edgeEnd(end - 1) - _firstEdge);
+    }
+
+    // partitions known to have a replica of a node; masters always do
+    std::vector<galois::DynamicBitSet> replicas(_numHosts);
+    for (uint32_t h = 0; h < _numHosts; ++h) {
+      replicas[h].resize(numGlobalNodes);
+      galois::do_all(
+          galois::iterate(_gid2host[h].first, _gid2host[h].second),
+          [&](uint64_t n) { replicas[h].set(n); }, galois::no_stats());
+    }
+    // degrees seen so far in the stream of this host
+    std::vector<galois::CopyableAtomic<uint32_t>> degrees(numGlobalNodes);
+
+    streamRounds(
+        [&](uint64_t src) {
+          auto ee     = bufGraph.edgeBegin(src);
+          auto ee_end = bufGraph.edgeEnd(src);
+          for (; ee != ee_end; ++ee) {
+            uint32_t dst        = bufGraph.edgeDestination(*ee);
+            double srcDegree    = ++degrees[src];
+            double dstDegree    = ++degrees[dst];
+            double srcTheta     = srcDegree / (srcDegree + dstDegree);
+            uint64_t minLoad    = std::numeric_limits<uint64_t>::max();
+            uint64_t maxLoad    = 0;
+            for (uint32_t h = 0; h < _numHosts; ++h) {
+              minLoad = std::min(minLoad, load(h));
+              maxLoad = std::max(maxLoad, load(h));
+            }
+
+            // ties go to this host
+            uint32_t best    = _hostID;
+            double bestScore = std::numeric_limits<double>::lowest();
+            for (uint32_t i = 0; i < _numHosts; ++i) {
+              uint32_t h   = (_hostID + i) % _numHosts;
+              double score = lambda * (maxLoad - load(h)) /
+                             (epsilon + maxLoad - minLoad);
+              if (replicas[h].test(src)) {
+                score += 2 - srcTheta;
+              }
+              if (replicas[h].test(dst)) {
+                score += 1 + srcTheta;
+              }
+              if (score > bestScore) {
+                best      = h;
+                bestScore = score;
+              }
+            }
+
+            _edgeOwners[*ee - _firstEdge] = best;
+            replicas[best].set(src);
+            replicas[best].set(dst);
+            addLoad(best, 1);
+          }
+        },
+        [&](galois::runtime::SendBuffer&, uint64_t, uint64_t) {},
+        [&](uint32_t, galois::runtime::RecvBuffer&) {});
+  }
+
+  uint32_t getEdgeOwner(uint32_t, uint32_t, uint64_t,
+                        uint64_t edgeID) const {
+    return _edgeOwners[edgeID - _firstEdge];
+  }
+
+  bool isVertexCut() const {
+    return true;
+  }
+
+  constexpr static bool isCartCut() {
+    return false;
+  }
+
+  // not used by this
+  bool isNotCommunicationPartner(unsigned, unsigned, WriteLocation,
+                                 ReadLocation, bool) {
+    return false;
+  }
+
+  void serializePartition(boost::archive::binary_oarchive&) {
+    return;
+  }
+
+  void deserializePartition(boost::archive::binary_iarchive&) {
+    return;
+  }
+
+  bool noCommunication() {
+    return false;
+  }
+};
+
 #endif
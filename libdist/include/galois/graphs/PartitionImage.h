@@ -0,0 +1,297 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+/**
+ * @file PartitionImage.h
+ *
+ * On-disk image of a local partition of a distributed graph. The image starts
+ * with a header that holds a table of sections; every section starts on a
+ * page boundary so that the large arrays in it (e.g. the CSR topology) can be
+ * used in place after the file is memory-mapped.
+ */
+
+#ifndef _GALOIS_DIST_PARTITIONIMAGE_H_
+#define _GALOIS_DIST_PARTITIONIMAGE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "galois/gIO.h"
+
+namespace galois {
+namespace graphs {
+
+//! Sections of a partition image
+enum class PartitionImageSection : uint32_t {
+  Scalars,       //!< PartitionImageScalars of the DistGraph
+  EdgeIndices,   //!< end of the edges of every local node (uint64_t)
+  EdgeDests,     //!< destination of every local edge (uint32_t)
+  EdgeData,      //!< data of every local edge
+  MasterNodes,   //!< per host count, then master lists of all hosts
+  MirrorNodes,   //!< per host count, then mirror lists of all hosts
+  GID2Host,      //!< read range of every host (pairs of uint64_t)
+  LocalToGlobal, //!< global id of every local node (uint64_t)
+  Partition,     //!< Boost archive of partitioning scheme specific data
+  NumSections
+};
+
+//! Scalars of a DistGraph stored in a partition image
+struct PartitionImageScalars {
+  uint64_t numGlobalNodes;
+  uint64_t numGlobalEdges;
+  uint64_t numNodes;
+  uint64_t numEdges;
+  uint32_t numOwned;
+  uint32_t beginMaster;
+  uint32_t numNodesWithEdges;
+  uint32_t transposed;
+};
+
+//! Header at the beginning of a partition image
+struct PartitionImageHeader {
+  //! Identifies a file as a partition image
+  static constexpr uint64_t magicValue = 0x474d49545241504cULL; // "LPARTIMG"
+  //! Bumped whenever the layout of the image changes
+  static constexpr uint32_t currentVersion = 1;
+
+  uint64_t magic;
+  uint32_t version;
+  uint32_t numSections;
+  uint32_t hostID;
+  uint32_t numHosts;
+  uint64_t edgeDataSize; //!< sizeof the edge data type (0 if void)
+  struct {
+    uint64_t offset;
+    uint64_t size;
+  } sections[static_cast<uint32_t>(PartitionImageSection::NumSections)];
+};
+
+//! Alignment of the sections of a partition image
+constexpr uint64_t partitionImageAlignment = 4096;
+
+/**
+ * Collects the sections of a partition image and writes them to a file.
+ *
+ * Sections added with add are only referenced and have to stay alive until
+ * write is called; sections added with addCopy are copied.
+ */
+class PartitionImageWriter {
+  PartitionImageHeader header;
+  std::vector<const char*> sectionData;
+  std::vector<std::string> copies;
+
+public:
+  PartitionImageWriter(uint32_t hostID, uint32_t numHosts,
+                       uint64_t edgeDataSize)
+      : sectionData(static_cast<uint32_t>(PartitionImageSection::NumSections),
+                    nullptr) {
+    std::memset(&header, 0, sizeof(header));
+    header.magic        = PartitionImageHeader::magicValue;
+    header.version      = PartitionImageHeader::currentVersion;
+    header.numSections  = sectionData.size();
+    header.hostID       = hostID;
+    header.numHosts     = numHosts;
+    header.edgeDataSize = edgeDataSize;
+  }
+
+  //! Adds a section that is written from data when write is called
+  void add(PartitionImageSection section, const void* data, size_t size) {
+    uint32_t s              = static_cast<uint32_t>(section);
+    sectionData[s]          = static_cast<const char*>(data);
+    header.sections[s].size = size;
+  }
+
+  //! Adds a copy of the given bytes as a section
+  void addCopy(PartitionImageSection section, std::string bytes) {
+    copies.emplace_back(std::move(bytes));
+    add(section, copies.back().data(), copies.back().size());
+  }
+
+  /**
+   * Writes the header and all sections to the given file.
+   *
+   * @param fileName file to write the image to
+   */
+  void write(const std::string& fileName) {
+    uint64_t offset = partitionImageAlignment;
+    for (uint32_t s = 0; s < header.numSections; ++s) {
+      header.sections[s].offset = offset;
+      offset += (header.sections[s].size + partitionImageAlignment - 1) /
+                partitionImageAlignment * partitionImageAlignment;
+    }
+
+    std::ofstream outputStream(fileName, std::ios::binary);
+    if (!outputStream.is_open()) {
+      GALOIS_DIE("could not open ", fileName, " to save local graph");
+    }
+
+    std::vector<char> padding(partitionImageAlignment, 0);
+    outputStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outputStream.write(padding.data(),
+                       partitionImageAlignment - sizeof(header));
+    for (uint32_t s = 0; s < header.numSections; ++s) {
+      uint64_t size = header.sections[s].size;
+      if (size) {
+        outputStream.write(sectionData[s], size);
+      }
+      uint64_t tail = size % partitionImageAlignment;
+      if (tail) {
+        outputStream.write(padding.data(), partitionImageAlignment - tail);
+      }
+    }
+
+    if (!outputStream) {
+      GALOIS_DIE("failed to write local graph to ", fileName);
+    }
+  }
+};
+
+/**
+ * A partition image mapped into memory.
+ *
+ * The file is mapped privately and writable, so arrays used in place can be
+ * modified without changing the file (pages are copied on first write).
+ * Pages are only read from the file when they are first touched.
+ */
+class PartitionImage {
+  char* base    = nullptr;
+  size_t length = 0;
+
+  void unmap() {
+    if (base) {
+      munmap(base, length);
+      base   = nullptr;
+      length = 0;
+    }
+  }
+
+public:
+  PartitionImage() = default;
+  PartitionImage(const PartitionImage&) = delete;
+  PartitionImage& operator=(const PartitionImage&) = delete;
+  PartitionImage(PartitionImage&& o) : base(o.base), length(o.length) {
+    o.base   = nullptr;
+    o.length = 0;
+  }
+  PartitionImage& operator=(PartitionImage&& o) {
+    if (this != &o) {
+      unmap();
+      std::swap(base, o.base);
+      std::swap(length, o.length);
+    }
+    return *this;
+  }
+  ~PartitionImage() { unmap(); }
+
+  /**
+   * Maps the given file if it is a partition image.
+   *
+   * @param fileName file to map
+   * @returns false if the file does not start with a partition image header
+   * (e.g. it was written in the older Boost archive format); the file is
+   * not mapped in that case
+   */
+  bool open(const std::string& fileName) {
+    unmap();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+      GALOIS_SYS_DIE("could not open ", fileName, " to read local graph");
+    }
+
+    PartitionImageHeader header;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        header.magic != PartitionImageHeader::magicValue) {
+      close(fd);
+      return false;
+    }
+    if (header.version != PartitionImageHeader::currentVersion) {
+      GALOIS_DIE("partition image ", fileName, " has version ", header.version,
+                 " but version ", PartitionImageHeader::currentVersion,
+                 " is expected");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      GALOIS_SYS_DIE("could not stat ", fileName);
+    }
+    length = st.st_size;
+
+    void* mapped =
+        mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      length = 0;
+      GALOIS_SYS_DIE("could not map ", fileName);
+    }
+    base = static_cast<char*>(mapped);
+
+    for (uint32_t s = 0; s < header.numSections; ++s) {
+      if (header.sections[s].offset + header.sections[s].size > length) {
+        GALOIS_DIE("partition image ", fileName, " is truncated");
+      }
+    }
+    return true;
+  }
+
+  //! True if an image is mapped
+  bool isOpen() const { return base != nullptr; }
+
+  //! Header of the mapped image
+  const PartitionImageHeader& header() const {
+    return *reinterpret_cast<const PartitionImageHeader*>(base);
+  }
+
+  //! Start of the given section in the mapped image
+  template <typename T = char>
+  T* section(PartitionImageSection s) const {
+    return reinterpret_cast<T*>(
+        base + header().sections[static_cast<uint32_t>(s)].offset);
+  }
+
+  //! Size in bytes of the given section
+  size_t sectionSize(PartitionImageSection s) const {
+    return header().sections[static_cast<uint32_t>(s)].size;
+  }
+};
+
+namespace internal {
+
+//! Read-only stream buffer over bytes in memory, e.g. a mapped section
+class MemoryStreamBuf : public std::streambuf {
+public:
+  MemoryStreamBuf(char* data, size_t size) { setg(data, data, data + size); }
+};
+
+} // namespace internal
+
+} // namespace graphs
+} // namespace galois
+
+#endif
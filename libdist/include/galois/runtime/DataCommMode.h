@@ -28,6 +28,8 @@
  */
 #pragma once
 
+#include <algorithm>
+
 //! Enumeration of data communication modes that can be used in sychronization
 //! @todo document the enums in doxygen
 enum DataCommMode {
@@ -38,12 +40,44 @@ enum DataCommMode {
   onlyData,
   dataSplitFirst,
   dataSplit,
-  neverOnlyData
+  neverOnlyData,
+  varintOffsetsData,  //!< delta + varint coded offsets followed by data
+  runLengthBitsetData //!< run-length coded bitset followed by data
 };
 
 //! If this is set, then always used the data mode it is set to
 extern DataCommMode enforce_data_mode;
 
+/**
+ * Switches data_mode to one of the compressed offsets modes if its message
+ * would be smaller than best_size, the size of the message in data_mode.
+ *
+ * @tparam DataType type of the data to be synchronized
+ *
+ * @param num_selected number of elements to send out
+ * @param varint_offsets_size size of the delta + varint coded offsets (0 if
+ * not available)
+ * @param run_length_size size of the run-length coded offsets (0 if not
+ * available)
+ * @param best_size size of the message in the currently chosen data mode
+ * @param data_mode IN/OUTPUT: chosen data mode
+ */
+template <typename DataType>
+void pick_compressed_mode(size_t num_selected, size_t varint_offsets_size,
+                          size_t run_length_size, size_t best_size,
+                          DataCommMode& data_mode) {
+  size_t fixed_size = (num_selected * sizeof(DataType)) + sizeof(size_t) +
+                       sizeof(size_t) + sizeof(num_selected);
+  if (varint_offsets_size &&
+      (fixed_size + varint_offsets_size) < best_size) {
+    best_size = fixed_size + varint_offsets_size;
+    data_mode = varintOffsetsData;
+  }
+  if (run_length_size && (fixed_size + run_length_size) < best_size) {
+    data_mode = runLengthBitsetData;
+  }
+}
+
 /**
  * Given a size of a subset of elements to send and the total number of
  * elements, determine an appropriate data mode to use for sending out the data
@@ -53,11 +87,17 @@ extern DataCommMode enforce_data_mode;
  *
  * @param num_selected number of elements to send out (subset of num_total)
  * @param num_total total number of elements that exist
+ * @param varint_offsets_size size of the selected offsets when delta + varint
+ * coded; 0 if they were not coded, which rules out varintOffsetsData
+ * @param run_length_size size of the selected offsets when run-length coded;
+ * 0 if they were not coded, which rules out runLengthBitsetData
  *
  * @returns an appropriate DataCommMode to use for synchronization
  */
 template <typename DataType>
-DataCommMode get_data_mode(size_t num_selected, size_t num_total) {
+DataCommMode get_data_mode(size_t num_selected, size_t num_total,
+                           size_t varint_offsets_size = 0,
+                           size_t run_length_size     = 0) {
   DataCommMode data_mode = noData;
   // TODO clean up neverOnlyData path (integrate with main path in some way)
   if (enforce_data_mode == neverOnlyData) {
@@ -77,6 +117,10 @@ DataCommMode get_data_mode(size_t num_selected, size_t num_total) {
       } else {
         data_mode = offsetsData;
       }
+      pick_compressed_mode<DataType>(num_selected, varint_offsets_size,
+                                     run_length_size,
+                                     std::min(bitsetDataSize, offsetsDataSize),
+                                     data_mode);
     }
   } else if (enforce_data_mode != noData) {
     data_mode = enforce_data_mode;
@@ -107,6 +151,9 @@ DataCommMode get_data_mode(size_t num_selected, size_t num_total) {
           data_mode = onlyData;
         }
       }
+      pick_compressed_mode<DataType>(
+          num_selected, varint_offsets_size, run_length_size,
+          std::min({onlyDataSize, bitsetDataSize, offsetsDataSize}), data_mode);
     }
   }
   return data_mode;
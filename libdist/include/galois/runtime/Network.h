@@ -207,6 +207,23 @@ NetworkInterface& getSystemNetworkInterface();
 namespace internal {
   //! Deletes the system network interface (if it exists).
   void destroySystemNetworkInterface();
+
+  //! Fixed function of the binary that message handlers are located from
+  void handlerAnchor();
+
+  //! Message handlers travel as offsets from handlerAnchor: every host runs
+  //! the same binary, but a position-independent one may be loaded at a
+  //! different address on each host.
+  template <typename F>
+  uintptr_t handlerToWire(F* fp) {
+    return (uintptr_t)fp - (uintptr_t)&handlerAnchor;
+  }
+
+  //! Inverse of handlerToWire
+  template <typename F>
+  F* handlerFromWire(uintptr_t offset) {
+    return (F*)(offset + (uintptr_t)&handlerAnchor);
+  }
 }
 
 //! Gets this host's ID
@@ -231,9 +248,10 @@ namespace { // anon
 template <typename... Args>
 
 static void genericLandingPad(uint32_t src, RecvBuffer& buf) {
-  void (*fp)(uint32_t, Args...);
+  uintptr_t offset;
   std::tuple<Args...> args;
-  gDeserialize(buf, fp, args);
+  gDeserialize(buf, offset, args);
+  auto fp = internal::handlerFromWire<void(uint32_t, Args...)>(offset);
 /* Test for GCC >= 5.2.0 */
 #if __GNUC__ > 5 || (__GNUC__ == 5 && __GNUC_MINOR__ > 1)
   std::experimental::apply([fp, src](Args... params) { fp(src, params...); },
@@ -250,8 +268,8 @@ void NetworkInterface::sendSimple(uint32_t dest,
                                   void (*recv)(uint32_t, Args...),
                                   Args... param) {
   SendBuffer buf;
-  gSerialize(buf, (uintptr_t)recv, param...,
-             (uintptr_t)genericLandingPad<Args...>);
+  gSerialize(buf, internal::handlerToWire(recv), param...,
+             internal::handlerToWire(genericLandingPad<Args...>));
   sendTagged(dest, 0, buf);
 }
 
@@ -259,7 +277,7 @@ template <typename... Args>
 void NetworkInterface::broadcastSimple(void (*recv)(uint32_t, Args...),
                                        Args... param) {
   SendBuffer buf;
-  gSerialize(buf, (uintptr_t)recv, param...);
+  gSerialize(buf, internal::handlerToWire(recv), param...);
   broadcast(genericLandingPad<Args...>, buf, false);
 }
 
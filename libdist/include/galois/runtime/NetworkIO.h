@@ -21,8 +21,8 @@
  * @file NetworkIO.h
  *
  * Contains NetworkIO, a base class that is inherited by classes that want to
- * implement the communication layer of Galois. (e.g. NetworkIOMPI and
- * NetworkIOLWCI)
+ * implement the communication layer of Galois. (e.g. NetworkIOMPI,
+ * NetworkIOSHM, NetworkIOTCP, and NetworkIOLWCI)
  */
 
 #ifndef GALOIS_RUNTIME_NETWORKTHREAD_H
@@ -110,6 +110,11 @@ public:
   virtual message dequeue() = 0;
   //! Make progress. Other functions don't have to make progress.
   virtual void progress() = 0;
+  //! Named counters specific to this IO layer (e.g. bytes sent per path)
+  virtual std::vector<std::pair<std::string, unsigned long>>
+  reportStats() const {
+    return {};
+  }
 };
 
 /**
@@ -120,6 +125,24 @@ public:
  */
 std::tuple<std::unique_ptr<NetworkIO>, uint32_t, uint32_t>
 makeNetworkIOMPI(galois::runtime::MemUsageTracker& tracker, std::atomic<size_t>& sends, std::atomic<size_t>& recvs);
+/**
+ * Creates/returns a network IO layer that uses POSIX shared memory between
+ * hosts on the same machine and MPI between machines.
+ *
+ * @returns tuple with pointer to the shared-memory IO layer, this host's ID,
+ * and the total number of hosts in the system
+ */
+std::tuple<std::unique_ptr<NetworkIO>, uint32_t, uint32_t>
+makeNetworkIOSHM(galois::runtime::MemUsageTracker& tracker, std::atomic<size_t>& sends, std::atomic<size_t>& recvs);
+/**
+ * Creates/returns a network IO layer that uses TCP sockets and does not need
+ * MPI. Hosts are listed in GALOIS_TCP_HOSTS or GALOIS_TCP_HOSTFILE.
+ *
+ * @returns tuple with pointer to the TCP IO layer, this host's ID, and the
+ * total number of hosts in the system
+ */
+std::tuple<std::unique_ptr<NetworkIO>, uint32_t, uint32_t>
+makeNetworkIOTCP(galois::runtime::MemUsageTracker& tracker, std::atomic<size_t>& sends, std::atomic<size_t>& recvs);
 #ifdef GALOIS_USE_LWCI
 /**
  * Creates/returns a network IO layer that uses LWCI to do communication.
@@ -0,0 +1,277 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+/**
+ * @file SyncCompression.h
+ *
+ * Compact encodings of the sorted offsets that say which shared nodes a sync
+ * message carries values for.
+ *
+ * Offsets are coded in independent chunks of a fixed number of entries, so
+ * that encoding and decoding can both run in parallel. An encoded buffer
+ * starts with the end position (relative to the end of the table) of every
+ * chunk as a uint32_t, followed by the chunks themselves.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include "galois/Galois.h"
+#include "galois/Reduction.h"
+#include "galois/PODResizeableArray.h"
+
+namespace galois {
+namespace runtime {
+
+namespace internal {
+
+//! Number of offsets in each independently coded chunk
+constexpr size_t syncCodeChunkSize = 1024;
+
+//! Bytes needed to store v as a LEB128 varint
+inline size_t varintSize(uint32_t v) {
+  size_t size = 1;
+  while (v >= 0x80) {
+    v >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+//! Writes v as a LEB128 varint; returns the position after it
+inline uint8_t* putVarint(uint8_t* out, uint32_t v) {
+  while (v >= 0x80) {
+    *out++ = static_cast<uint8_t>(v | 0x80);
+    v >>= 7;
+  }
+  *out++ = static_cast<uint8_t>(v);
+  return out;
+}
+
+//! Reads a LEB128 varint into v; returns the position after it
+inline const uint8_t* getVarint(const uint8_t* in, uint32_t& v) {
+  uint32_t shift = 0;
+  v              = 0;
+  while (*in & 0x80) {
+    v |= static_cast<uint32_t>(*in++ & 0x7f) << shift;
+    shift += 7;
+  }
+  v |= static_cast<uint32_t>(*in++) << shift;
+  return in;
+}
+
+/**
+ * Delta coding: the first offset of a chunk as is, then the gap to the
+ * previous offset minus one, each as a varint.
+ */
+struct DeltaVarintCoder {
+  static size_t size(const unsigned int* offsets, size_t n) {
+    size_t size = varintSize(offsets[0]);
+    for (size_t i = 1; i < n; ++i)
+      size += varintSize(offsets[i] - offsets[i - 1] - 1);
+    return size;
+  }
+
+  static void encode(const unsigned int* offsets, size_t n, uint8_t* out) {
+    out = putVarint(out, offsets[0]);
+    for (size_t i = 1; i < n; ++i)
+      out = putVarint(out, offsets[i] - offsets[i - 1] - 1);
+  }
+
+  static void decode(const uint8_t* in, size_t n, unsigned int* offsets) {
+    uint32_t v;
+    in         = getVarint(in, v);
+    offsets[0] = v;
+    for (size_t i = 1; i < n; ++i) {
+      in         = getVarint(in, v);
+      offsets[i] = offsets[i - 1] + v + 1;
+    }
+  }
+};
+
+/**
+ * Run-length coding of the bitset the offsets came from: every run of
+ * consecutive offsets is stored as the gap since the end of the previous run
+ * (the absolute start for the first run of a chunk) and the run length minus
+ * one, each as a varint.
+ */
+struct RunLengthCoder {
+  template <typename RunFn>
+  static void forEachRun(const unsigned int* offsets, size_t n, RunFn fn) {
+    size_t i = 0;
+    while (i < n) {
+      size_t j = i + 1;
+      while (j < n && offsets[j] == offsets[j - 1] + 1)
+        ++j;
+      fn(offsets[i], static_cast<uint32_t>(j - i));
+      i = j;
+    }
+  }
+
+  static size_t size(const unsigned int* offsets, size_t n) {
+    size_t size     = 0;
+    uint32_t runEnd = 0;
+    forEachRun(offsets, n, [&](uint32_t start, uint32_t length) {
+      size += varintSize(start - runEnd) + varintSize(length - 1);
+      runEnd = start + length;
+    });
+    return size;
+  }
+
+  static void encode(const unsigned int* offsets, size_t n, uint8_t* out) {
+    uint32_t runEnd = 0;
+    forEachRun(offsets, n, [&](uint32_t start, uint32_t length) {
+      out    = putVarint(out, start - runEnd);
+      out    = putVarint(out, length - 1);
+      runEnd = start + length;
+    });
+  }
+
+  static void decode(const uint8_t* in, size_t n, unsigned int* offsets) {
+    uint32_t runEnd = 0;
+    size_t i        = 0;
+    while (i < n) {
+      uint32_t gap, extra;
+      in = getVarint(in, gap);
+      in = getVarint(in, extra);
+      uint32_t start = runEnd + gap;
+      for (uint32_t k = 0; k <= extra; ++k)
+        offsets[i++] = start + k;
+      runEnd = start + extra + 1;
+    }
+  }
+};
+
+//! Number of chunks used to code count offsets
+inline size_t syncCodeNumChunks(size_t count) {
+  return (count + syncCodeChunkSize - 1) / syncCodeChunkSize;
+}
+
+//! Number of offsets in chunk c of count offsets
+inline size_t syncCodeChunkLength(size_t c, size_t count) {
+  return std::min(syncCodeChunkSize, count - c * syncCodeChunkSize);
+}
+
+/**
+ * Calls fn on every chunk index, in parallel if parallelize is set.
+ */
+template <bool parallelize, typename FnTy>
+void forEachChunk(size_t numChunks, FnTy fn) {
+  if (parallelize) {
+    galois::do_all(galois::iterate(size_t{0}, numChunks), fn,
+                   galois::no_stats());
+  } else {
+    for (size_t c = 0; c < numChunks; ++c)
+      fn(c);
+  }
+}
+
+} // namespace internal
+
+/**
+ * Returns the number of bytes encodeOffsets would produce for the given
+ * offsets with the given coder.
+ *
+ * @tparam Coder internal::DeltaVarintCoder or internal::RunLengthCoder
+ * @tparam parallelize Determines if the chunks are sized in parallel or not
+ * @param offsets sorted offsets to encode
+ * @param count number of offsets to use from the offsets array
+ */
+template <typename Coder, bool parallelize = true>
+size_t
+encodedOffsetsSize(const galois::PODResizeableArray<unsigned int>& offsets,
+                   size_t count) {
+  size_t numChunks = internal::syncCodeNumChunks(count);
+  galois::GAccumulator<size_t> size;
+  internal::forEachChunk<parallelize>(numChunks, [&](size_t c) {
+    size += Coder::size(offsets.data() + c * internal::syncCodeChunkSize,
+                        internal::syncCodeChunkLength(c, count));
+  });
+  return numChunks * sizeof(uint32_t) + size.reduce();
+}
+
+/**
+ * Encodes the first count (sorted) offsets into out.
+ *
+ * @tparam Coder internal::DeltaVarintCoder or internal::RunLengthCoder
+ * @tparam parallelize Determines if the chunks are coded in parallel or not
+ * @param offsets sorted offsets to encode
+ * @param count number of offsets to encode
+ * @param out OUTPUT: encoded offsets
+ */
+template <typename Coder, bool parallelize = true>
+void encodeOffsets(const galois::PODResizeableArray<unsigned int>& offsets,
+                   size_t count, galois::PODResizeableArray<uint8_t>& out) {
+  size_t numChunks = internal::syncCodeNumChunks(count);
+  size_t tableSize = numChunks * sizeof(uint32_t);
+  std::vector<uint32_t> ends(numChunks);
+
+  internal::forEachChunk<parallelize>(numChunks, [&](size_t c) {
+    ends[c] = Coder::size(offsets.data() + c * internal::syncCodeChunkSize,
+                          internal::syncCodeChunkLength(c, count));
+  });
+  for (size_t c = 1; c < numChunks; ++c)
+    ends[c] += ends[c - 1];
+
+  out.resize(tableSize + (numChunks ? ends[numChunks - 1] : 0));
+  if (numChunks)
+    std::memcpy(out.data(), ends.data(), tableSize);
+
+  uint8_t* data = out.data() + tableSize;
+  internal::forEachChunk<parallelize>(numChunks, [&](size_t c) {
+    Coder::encode(offsets.data() + c * internal::syncCodeChunkSize,
+                  internal::syncCodeChunkLength(c, count),
+                  data + (c ? ends[c - 1] : 0));
+  });
+}
+
+/**
+ * Decodes count offsets produced by encodeOffsets in parallel.
+ *
+ * @tparam Coder the coder the offsets were encoded with
+ * @param in encoded offsets
+ * @param count number of offsets that were encoded
+ * @param offsets OUTPUT: decoded offsets; resized to count
+ */
+template <typename Coder>
+void decodeOffsets(const galois::PODResizeableArray<uint8_t>& in, size_t count,
+                   galois::PODResizeableArray<unsigned int>& offsets) {
+  size_t numChunks = internal::syncCodeNumChunks(count);
+  const uint8_t* data = in.data() + numChunks * sizeof(uint32_t);
+  offsets.resize(count);
+
+  galois::do_all(galois::iterate(size_t{0}, numChunks),
+                 [&](size_t c) {
+                   uint32_t begin = 0;
+                   if (c)
+                     std::memcpy(&begin, in.data() + (c - 1) * sizeof(uint32_t),
+                                 sizeof(uint32_t));
+                   Coder::decode(
+                       data + begin, internal::syncCodeChunkLength(c, count),
+                       offsets.data() + c * internal::syncCodeChunkSize);
+                 },
+                 galois::no_stats());
+}
+
+} // namespace runtime
+} // namespace galois
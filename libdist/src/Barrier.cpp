@@ -92,7 +92,14 @@ public:
 #ifdef GALOIS_USE_LWCI
     lc_barrier(mv);
 #else
-    MPI_Barrier(MPI_COMM_WORLD); // assumes MPI_THREAD_MULTIPLE
+    int initialized;
+    MPI_Initialized(&initialized);
+    if (initialized) {
+      MPI_Barrier(MPI_COMM_WORLD); // assumes MPI_THREAD_MULTIPLE
+    } else {
+      // TCP network IO: no MPI, so a fence serves as the barrier
+      galois::runtime::getHostFence().wait();
+    }
 #endif
   }
 };
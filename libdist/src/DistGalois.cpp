@@ -31,10 +31,14 @@
 galois::DistMemSys::DistMemSys(void)
     : galois::runtime::SharedMemRuntime<galois::runtime::DistStatManager>() {}
 
-//! DistMemSys destructor which reports memory usage from the network
+//! DistMemSys destructor which reports memory usage and counters from the
+//! network
 galois::DistMemSys::~DistMemSys(void) {
   if (MORE_DIST_STATS) {
     auto& net = galois::runtime::getSystemNetworkInterface();
     net.reportMemUsage();
+    for (auto& stat : net.reportExtraNamed())
+      galois::runtime::reportStat_Tsum("dGraph", "Net" + stat.first,
+                                       stat.second);
   }
 }
@@ -51,6 +51,10 @@ cll::opt<DataCommMode> enforce_metadata(
                 clEnumValN(offsetsData, "offsets",
                            "Use offsets metadata always"),
                 clEnumValN(gidsData, "gids", "Use global IDs metadata always"),
+                clEnumValN(varintOffsetsData, "varint",
+                           "Use delta + varint coded offsets metadata always"),
+                clEnumValN(runLengthBitsetData, "runlength",
+                           "Use run-length coded bitset metadata always"),
                 clEnumValN(onlyData, "none",
                            "Do not use any metadata (sends "
                            "non-updated values)"),
@@ -114,6 +118,21 @@ cll::opt<BareMPI> bare_mpi(
     cll::init(noBareMPI), cll::Hidden);
 #endif
 
+//! Command line definition for hierarchicalSync
+cll::opt<bool>
+    hierarchicalSync("hierarchicalSync",
+                     cll::desc("Exchange sync messages between machines only "
+                               "through one leader host per machine"),
+                     cll::init(false));
+
+//! Command line definition for syncGroupSize
+cll::opt<unsigned>
+    syncGroupSize("syncGroupSize",
+                  cll::desc("Number of consecutive hosts treated as one "
+                            "machine by hierarchical syncs (default: group "
+                            "hosts by host name)"),
+                  cll::init(0), cll::Hidden);
+
 //! Command line definition for edgePartitionSendBufSize
 cll::opt<unsigned>
     edgePartitionSendBufSize("edgeBufferSize",
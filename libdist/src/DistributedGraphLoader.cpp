@@ -64,6 +64,11 @@ cll::opt<PARTITIONING_SCHEME> partitionScheme(
         clEnumValN(GCVC, "gcvc", "CVC (oec) using generic interface"),
         clEnumValN(GHIVC, "ghivc", "HIVC using generic interface"),
         clEnumValN(GOEC, "goec", "oec generic interface"),
+        clEnumValN(GHDRF, "hdrf", "Streaming HDRF Vertex-Cut"),
+        clEnumValN(GGINGER, "ginger",
+                   "Streaming Ginger Hybrid Vertex-Cut (needs transpose)"),
+        clEnumValN(GFENNEL, "fennel", "Streaming Fennel Edge-Cut"),
+        clEnumValN(GLDG, "ldg", "Streaming LDG Edge-Cut"),
         clEnumValEnd),
     cll::init(OEC));
 cll::opt<unsigned int>
@@ -72,9 +72,9 @@ void NetworkInterface::reportMemUsage() const {
 static void bcastLandingPad(uint32_t src, ::RecvBuffer& buf);
 
 static void bcastLandingPad(uint32_t src, RecvBuffer& buf) {
-  uintptr_t fp;
-  gDeserialize(buf, fp);
-  auto recv = (void (*)(uint32_t, RecvBuffer&))fp;
+  uintptr_t offset;
+  gDeserialize(buf, offset);
+  auto recv = internal::handlerFromWire<void(uint32_t, RecvBuffer&)>(offset);
   trace("NetworkInterface::bcastLandingPad", (void*)recv);
   recv(src, buf);
 }
@@ -82,18 +82,18 @@ static void bcastLandingPad(uint32_t src, RecvBuffer& buf) {
 void NetworkInterface::sendMsg(uint32_t dest,
                                void (*recv)(uint32_t, RecvBuffer&),
                                SendBuffer& buf) {
-  gSerialize(buf, recv);
+  gSerialize(buf, internal::handlerToWire(recv));
   sendTagged(dest, 0, buf);
 }
 
 void NetworkInterface::broadcast(void (*recv)(uint32_t, RecvBuffer&),
                                  SendBuffer& buf, bool self) {
   trace("NetworkInterface::broadcast", (void*)recv);
-  auto fp = (uintptr_t)recv;
+  auto fp = internal::handlerToWire(recv);
   for (unsigned x = 0; x < Num; ++x) {
     if (x != ID) {
       SendBuffer b;
-      gSerialize(b, fp, buf, (uintptr_t)&bcastLandingPad);
+      gSerialize(b, fp, buf, internal::handlerToWire(&bcastLandingPad));
       sendTagged(x, 0, b);
     } else if (self) {
       RecvBuffer rb(buf.begin(), buf.end());
@@ -112,12 +112,14 @@ void NetworkInterface::handleReceives() {
     gDeserializeRaw(buf.r_linearData() + buf.r_size() - sizeof(uintptr_t), fp);
     buf.pop_back(sizeof(uintptr_t));
     assert(fp);
-    auto f = (void (*)(uint32_t, RecvBuffer&))fp;
+    auto f = internal::handlerFromWire<void(uint32_t, RecvBuffer&)>(fp);
     f(src, buf);
     opt = recieveTagged(0, &lg);
   }
 }
 
+void galois::runtime::internal::handlerAnchor() {}
+
 NetworkInterface& galois::runtime::getSystemNetworkInterface() {
   return makeNetworkBuffered();
 }
@@ -29,6 +29,7 @@
 #include "galois/runtime/Network.h"
 #include "galois/runtime/NetworkIO.h"
 #include "galois/runtime/Tracer.h"
+#include "galois/substrate/EnvCheck.h"
 
 #ifdef GALOIS_USE_LWCI
 #define NO_AGG
@@ -377,27 +378,48 @@ class NetworkInterfaceBuffered : public NetworkInterface {
     if (ID == 0)
       fprintf(stderr, "**Using LWCI Communication layer**\n");
 #else
-    initializeMPI();
-    int rank;
-    int hostSize;
+    // every host has to pick the same layer: export the variable to all
+    std::string layer = "mpi";
+    EnvCheck("GALOIS_NETWORK_IO", layer);
+    usingMPI = layer != "tcp";
+    if (!usingMPI) {
+      std::tie(netio, ID, Num) =
+          makeNetworkIOTCP(memUsageTracker, inflightSends, inflightRecvs);
+      if (ID == 0)
+        fprintf(stderr, "**Using TCP Communication layer**\n");
+    } else {
+      initializeMPI();
+      int rank;
+      int hostSize;
+
+      int rankSuccess = MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+      if (rankSuccess != MPI_SUCCESS) {
+        MPI_Abort(MPI_COMM_WORLD, rankSuccess);
+      }
 
-    int rankSuccess = MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    if (rankSuccess != MPI_SUCCESS) {
-      MPI_Abort(MPI_COMM_WORLD, rankSuccess);
-    }
+      int sizeSuccess = MPI_Comm_size(MPI_COMM_WORLD, &hostSize);
+      if (sizeSuccess != MPI_SUCCESS) {
+        MPI_Abort(MPI_COMM_WORLD, sizeSuccess);
+      }
 
-    int sizeSuccess = MPI_Comm_size(MPI_COMM_WORLD, &hostSize);
-    if (sizeSuccess != MPI_SUCCESS) {
-      MPI_Abort(MPI_COMM_WORLD, sizeSuccess);
-    }
+      galois::gDebug("[", NetworkInterface::ID, "] MPI initialized");
+      if (layer == "shm") {
+        std::tie(netio, ID, Num) =
+            makeNetworkIOSHM(memUsageTracker, inflightSends, inflightRecvs);
+        if (ID == 0)
+          fprintf(stderr, "**Using shared-memory Communication layer**\n");
+      } else {
+        if (layer != "mpi")
+          GALOIS_DIE("unknown GALOIS_NETWORK_IO layer ", layer);
+        std::tie(netio, ID, Num) =
+            makeNetworkIOMPI(memUsageTracker, inflightSends, inflightRecvs);
+      }
 
-    galois::gDebug("[", NetworkInterface::ID, "] MPI initialized");
-    std::tie(netio, ID, Num) = makeNetworkIOMPI(memUsageTracker, inflightSends, inflightRecvs);
+      assert(ID == (unsigned)rank);
+      assert(Num == (unsigned)hostSize);
+    }
 #endif
 
-    assert(ID == (unsigned)rank);
-    assert(Num == (unsigned)hostSize);
-
     ready = 1;
     while (ready < 2) { /*fprintf(stderr, "[WaitOnReady-2]");*/
     };
@@ -432,6 +454,8 @@ class NetworkInterfaceBuffered : public NetworkInterface {
 
   std::thread worker;
   std::atomic<int> ready;
+  //! false if the IO layer runs without MPI
+  bool usingMPI;
 
 public:
   using NetworkInterface::ID;
@@ -455,15 +479,17 @@ public:
     ready = 3;
     worker.join();
 
-// disable MPI if LWCI wasn't used
+// disable MPI if LWCI or TCP wasn't used
 #ifndef GALOIS_USE_LWCI
-    int finalizeSuccess = MPI_Finalize();
+    if (usingMPI) {
+      int finalizeSuccess = MPI_Finalize();
 
-    if (finalizeSuccess != MPI_SUCCESS) {
-      MPI_Abort(MPI_COMM_WORLD, finalizeSuccess);
-    }
+      if (finalizeSuccess != MPI_SUCCESS) {
+        MPI_Abort(MPI_COMM_WORLD, finalizeSuccess);
+      }
 
-    galois::gDebug("[", NetworkInterface::ID, "] MPI finalized");
+      galois::gDebug("[", NetworkInterface::ID, "] MPI finalized");
+    }
 #endif
   }
 
@@ -561,6 +587,8 @@ public:
     }
     retval[3] = statSendEnqueued;
     retval[4] = statRecvDequeued;
+    for (auto& stat : netio->reportStats())
+      retval.push_back(stat.second);
     return retval;
   }
 
@@ -579,6 +607,8 @@ public:
     }
     retval[3].second = statSendEnqueued;
     retval[4].second = statRecvDequeued;
+    auto ioStats = netio->reportStats();
+    retval.insert(retval.end(), ioStats.begin(), ioStats.end());
     return retval;
   }
 };
@@ -0,0 +1,426 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+/**
+ * @file NetworkIOSHM.cpp
+ *
+ * Contains an implementation of network IO that moves messages between hosts
+ * on the same machine through POSIX shared memory and uses MPI for the rest.
+ */
+
+#include "galois/runtime/NetworkIO.h"
+#include "galois/runtime/Tracer.h"
+#include "galois/substrate/EnvCheck.h"
+#include "galois/gIO.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * Shared-memory implementation of network IO. ASSUMES THAT MPI IS INITIALIZED
+ * UPON CREATION OF THIS OBJECT.
+ *
+ * Every host owns one shared segment holding a single-producer
+ * single-consumer ring per host on the same machine; host i sends to a
+ * co-located host j by writing into ring i of j's segment. Messages larger
+ * than the segment threshold do not go through the ring: the sender places
+ * them in a shared segment of their own and only passes its name, so one
+ * large buffer never blocks the ring. Messages to other machines are handed
+ * to an MPI network IO layer.
+ */
+class NetworkIOSHM : public galois::runtime::NetworkIO {
+private:
+  static constexpr size_t CACHE_LINE = 64;
+
+  //! Header of a ring; producer and consumer positions on separate lines
+  struct ringHeader {
+    alignas(CACHE_LINE) std::atomic<uint64_t> head; //!< consumer position
+    alignas(CACHE_LINE) std::atomic<uint64_t> tail; //!< producer position
+  };
+
+  //! Record preceding every message in a ring
+  struct record {
+    enum : uint32_t { INLINE, PAD, SEGMENT };
+    uint32_t tag;
+    uint32_t kind;
+    uint64_t len; //!< bytes of message data
+  };
+  static_assert(sizeof(record) == 16, "record must keep 16 byte alignment");
+
+  //! One direction of a ring as seen from one side
+  struct ring {
+    ringHeader* hdr = nullptr;
+    uint8_t* buf    = nullptr;
+    uint64_t mask   = 0;
+
+    void attach(uint8_t* base, uint64_t capacity) {
+      hdr  = reinterpret_cast<ringHeader*>(base);
+      buf  = base + sizeof(ringHeader);
+      mask = capacity - 1;
+    }
+
+    static uint64_t footprint(uint64_t len) {
+      return sizeof(record) + ((len + 15) & ~uint64_t{15});
+    }
+
+    //! Whether a record with this much payload fits right now
+    bool room(uint64_t payloadLen) const {
+      uint64_t tail  = hdr->tail.load(std::memory_order_relaxed);
+      uint64_t head  = hdr->head.load(std::memory_order_acquire);
+      uint64_t need  = footprint(payloadLen);
+      uint64_t toEnd = mask + 1 - (tail & mask);
+      return mask + 1 - (tail - head) >= (toEnd < need ? toEnd : 0) + need;
+    }
+
+    /**
+     * Writes a record with the given payload; room() must hold. Only the
+     * producer moves the tail, so room cannot shrink in between.
+     */
+    void write(uint32_t tag, uint32_t kind, uint64_t len, const void* payload,
+               uint64_t payloadLen) {
+      uint64_t tail  = hdr->tail.load(std::memory_order_relaxed);
+      uint64_t need  = footprint(payloadLen);
+      uint64_t toEnd = mask + 1 - (tail & mask);
+      if (toEnd < need) {
+        record* r = reinterpret_cast<record*>(buf + (tail & mask));
+        r->kind   = record::PAD;
+        tail += toEnd;
+      }
+      record* r = reinterpret_cast<record*>(buf + (tail & mask));
+      r->tag    = tag;
+      r->kind   = kind;
+      r->len    = len;
+      std::memcpy(r + 1, payload, payloadLen);
+      hdr->tail.store(tail + need, std::memory_order_release);
+    }
+
+    //! Returns the next record or nullptr if the ring is empty
+    const record* peek() {
+      uint64_t head = hdr->head.load(std::memory_order_relaxed);
+      if (head == hdr->tail.load(std::memory_order_acquire))
+        return nullptr;
+      const record* r = reinterpret_cast<const record*>(buf + (head & mask));
+      if (r->kind == record::PAD) {
+        head += mask + 1 - (head & mask);
+        hdr->head.store(head, std::memory_order_release);
+        if (head == hdr->tail.load(std::memory_order_acquire))
+          return nullptr;
+        r = reinterpret_cast<const record*>(buf + (head & mask));
+      }
+      return r;
+    }
+
+    //! Releases the record returned by peek
+    void pop(uint64_t payloadLen) {
+      uint64_t head = hdr->head.load(std::memory_order_relaxed);
+      hdr->head.store(head + footprint(payloadLen),
+                      std::memory_order_release);
+    }
+  };
+
+  std::unique_ptr<galois::runtime::NetworkIO> remote;
+
+  uint32_t ID;
+  //! co-located index of each host; ~0 for hosts on other machines
+  std::vector<uint32_t> localIndex;
+  //! host id of each co-located index
+  std::vector<uint32_t> localHosts;
+  uint32_t myIndex;
+
+  std::string prefix;
+  uint64_t ringCapacity;
+  uint64_t segmentThreshold;
+  size_t mappedBytes;
+
+  //! mapped segments of co-located hosts (own segment at myIndex)
+  std::vector<uint8_t*> segments;
+  //! rings to send to each co-located host
+  std::vector<ring> outRings;
+  //! rings to receive from each co-located host
+  std::vector<ring> inRings;
+  //! messages waiting for room in the ring of each co-located host
+  std::vector<std::deque<message>> pending;
+  std::vector<uint64_t> segmentSeq;
+  std::deque<message> done;
+  bool preferRemote;
+
+  unsigned long statInlineBytes;
+  unsigned long statInlineMsgs;
+  unsigned long statSegmentBytes;
+  unsigned long statSegmentMsgs;
+  unsigned long statRemoteBytes;
+  unsigned long statRemoteMsgs;
+  unsigned long statRingFull;
+
+  std::string ringName(uint32_t index) const {
+    return prefix + "r" + std::to_string(index);
+  }
+
+  std::string segmentName(uint32_t src, uint32_t dst, uint64_t seq) const {
+    return prefix + "m" + std::to_string(src) + "-" + std::to_string(dst) +
+           "-" + std::to_string(seq);
+  }
+
+  static uint8_t* mapSegment(const std::string& name, size_t bytes,
+                             bool create) {
+    int fd = shm_open(name.c_str(), create ? O_CREAT | O_EXCL | O_RDWR : O_RDWR,
+                      S_IRUSR | S_IWUSR);
+    if (fd < 0)
+      GALOIS_SYS_DIE("shm_open of ", name, " failed");
+    if (create && ftruncate(fd, bytes) != 0)
+      GALOIS_SYS_DIE("ftruncate of ", name, " failed");
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+      GALOIS_SYS_DIE("mmap of ", name, " failed");
+    return static_cast<uint8_t*>(p);
+  }
+
+  size_t ringBytes() const { return sizeof(ringHeader) + ringCapacity; }
+
+  /**
+   * Finds the hosts on this machine and maps the rings between them. The
+   * segments are unlinked as soon as every host has mapped them, so nothing
+   * is left behind in /dev/shm if the job dies.
+   */
+  void setupRings(int numHosts) {
+    MPI_Comm nodeComm;
+    handleError(MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, ID,
+                                    MPI_INFO_NULL, &nodeComm));
+    int localRank, localSize;
+    handleError(MPI_Comm_rank(nodeComm, &localRank));
+    handleError(MPI_Comm_size(nodeComm, &localSize));
+    myIndex = localRank;
+
+    localHosts.resize(localSize);
+    handleError(MPI_Allgather(&ID, 1, MPI_UINT32_T, localHosts.data(), 1,
+                              MPI_UINT32_T, nodeComm));
+    localIndex.assign(numHosts, ~0U);
+    for (int i = 0; i < localSize; ++i)
+      localIndex[localHosts[i]] = i;
+
+    // names must be unique to this job on this machine
+    int32_t leader = getpid();
+    handleError(MPI_Bcast(&leader, 1, MPI_INT32_T, 0, nodeComm));
+    prefix = "/galois-" + std::to_string(leader) + "-";
+
+    mappedBytes = ringBytes() * localSize;
+    segments.resize(localSize);
+    segments[myIndex] = mapSegment(ringName(myIndex), mappedBytes, true);
+    handleError(MPI_Barrier(nodeComm));
+    for (int i = 0; i < localSize; ++i)
+      if ((uint32_t)i != myIndex)
+        segments[i] = mapSegment(ringName(i), mappedBytes, false);
+    handleError(MPI_Barrier(nodeComm));
+    shm_unlink(ringName(myIndex).c_str());
+    handleError(MPI_Comm_free(&nodeComm));
+
+    outRings.resize(localSize);
+    inRings.resize(localSize);
+    for (int i = 0; i < localSize; ++i) {
+      outRings[i].attach(segments[i] + ringBytes() * myIndex, ringCapacity);
+      inRings[i].attach(segments[myIndex] + ringBytes() * i, ringCapacity);
+    }
+    pending    = decltype(pending)(localSize);
+    segmentSeq.assign(localSize, 0);
+  }
+
+  //! Hands a message to a co-located host; false if its ring is full
+  bool trySend(uint32_t dst, message& m) {
+    ring& r = outRings[dst];
+    if (m.data.size() <= segmentThreshold) {
+      if (!r.room(m.data.size()))
+        return false;
+      r.write(m.tag, record::INLINE, m.data.size(), m.data.data(),
+              m.data.size());
+      statInlineBytes += m.data.size();
+      ++statInlineMsgs;
+    } else {
+      uint64_t seq = segmentSeq[dst];
+      if (!r.room(sizeof(seq)))
+        return false;
+      ++segmentSeq[dst];
+      // the segment is complete before its record becomes visible
+      std::string name = segmentName(myIndex, dst, seq);
+      uint8_t* p       = mapSegment(name, m.data.size(), true);
+      std::memcpy(p, m.data.data(), m.data.size());
+      munmap(p, m.data.size());
+      r.write(m.tag, record::SEGMENT, m.data.size(), &seq, sizeof(seq));
+      statSegmentBytes += m.data.size();
+      ++statSegmentMsgs;
+    }
+    galois::runtime::trace("SHM SEND", m.host, m.tag, m.data.size());
+    memUsageTracker.decrementMemUsage(m.data.size());
+    --inflightSends;
+    return true;
+  }
+
+  void drainPending() {
+    for (uint32_t i = 0; i < pending.size(); ++i) {
+      auto& q = pending[i];
+      while (!q.empty() && trySend(i, q.front()))
+        q.pop_front();
+    }
+  }
+
+  //! Takes at most one message out of every incoming ring
+  void poll() {
+    for (uint32_t i = 0; i < inRings.size(); ++i) {
+      ring& r         = inRings[i];
+      const record* h = r.peek();
+      if (!h)
+        continue;
+      if (h->kind == record::SEGMENT) {
+        uint64_t seq;
+        std::memcpy(&seq, h + 1, sizeof(seq));
+        std::string name = segmentName(i, myIndex, seq);
+        int fd           = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+          GALOIS_SYS_DIE("shm_open of ", name, " failed");
+        vTy data(h->len);
+        void* p = mmap(nullptr, h->len, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED)
+          GALOIS_SYS_DIE("mmap of ", name, " failed");
+        std::memcpy(data.data(), p, h->len);
+        munmap(p, h->len);
+        shm_unlink(name.c_str());
+        receive(localHosts[i], h->tag, std::move(data));
+        r.pop(sizeof(seq));
+      } else {
+        const uint8_t* payload = reinterpret_cast<const uint8_t*>(h + 1);
+        vTy data(payload, payload + h->len);
+        uint64_t len = h->len;
+        receive(localHosts[i], h->tag, std::move(data));
+        r.pop(len);
+      }
+    }
+  }
+
+  void receive(uint32_t host, uint32_t tag, vTy&& data) {
+    ++inflightRecvs;
+    memUsageTracker.incrementMemUsage(data.size());
+    galois::runtime::trace("SHM RECV", host, tag, data.size());
+    done.emplace_back(host, tag, std::move(data));
+  }
+
+public:
+  /**
+   * Constructor.
+   *
+   * @param tracker memory usage tracker
+   * @param [out] ID this machine's host id
+   * @param [out] NUM total number of hosts in the system
+   */
+  NetworkIOSHM(galois::runtime::MemUsageTracker& tracker,
+               std::atomic<size_t>& sends, std::atomic<size_t>& recvs,
+               uint32_t& _ID, uint32_t& NUM)
+      : NetworkIO(tracker, sends, recvs), preferRemote(false),
+        statInlineBytes(0), statInlineMsgs(0), statSegmentBytes(0),
+        statSegmentMsgs(0), statRemoteBytes(0), statRemoteMsgs(0),
+        statRingFull(0) {
+    std::tie(remote, ID, NUM) =
+        galois::runtime::makeNetworkIOMPI(tracker, sends, recvs);
+    _ID = ID;
+
+    int capacity = 4 << 20;
+    galois::substrate::EnvCheck("GALOIS_SHM_RING_BYTES", capacity);
+    ringCapacity = 4096;
+    while (ringCapacity < (uint64_t)capacity)
+      ringCapacity <<= 1;
+    int threshold = 64 << 10;
+    galois::substrate::EnvCheck("GALOIS_SHM_SEGMENT_THRESHOLD", threshold);
+    segmentThreshold = std::min<uint64_t>(threshold, ringCapacity / 4);
+
+    setupRings(NUM);
+  }
+
+  virtual ~NetworkIOSHM() {
+    for (auto* s : segments)
+      munmap(s, mappedBytes);
+  }
+
+  /**
+   * Writes a message to a co-located host, keeping it in order behind any
+   * messages still waiting for room, or passes it on to MPI.
+   */
+  virtual void enqueue(message m) {
+    uint32_t dst = localIndex[m.host];
+    if (dst == ~0U) {
+      statRemoteBytes += m.data.size();
+      ++statRemoteMsgs;
+      remote->enqueue(std::move(m));
+      return;
+    }
+    memUsageTracker.incrementMemUsage(m.data.size());
+    auto& q = pending[dst];
+    if (q.empty() && trySend(dst, m))
+      return;
+    ++statRingFull;
+    q.emplace_back(std::move(m));
+  }
+
+  /**
+   * Attempts to get a message, alternating between co-located hosts and
+   * MPI so neither starves the other.
+   */
+  virtual message dequeue() {
+    preferRemote = !preferRemote;
+    if (preferRemote || done.empty()) {
+      message m = remote->dequeue();
+      if (m.valid() || done.empty())
+        return m;
+    }
+    message m = std::move(done.front());
+    done.pop_front();
+    return m;
+  }
+
+  /**
+   * Push progress forward in the system.
+   */
+  virtual void progress() {
+    drainPending();
+    poll();
+    remote->progress();
+  }
+
+  virtual std::vector<std::pair<std::string, unsigned long>>
+  reportStats() const {
+    return {{"ShmInlineBytes", statInlineBytes},
+            {"ShmInlineMsgs", statInlineMsgs},
+            {"ShmSegmentBytes", statSegmentBytes},
+            {"ShmSegmentMsgs", statSegmentMsgs},
+            {"ShmRingFull", statRingFull},
+            {"RemoteBytes", statRemoteBytes},
+            {"RemoteMsgs", statRemoteMsgs}};
+  }
+}; // end NetworkIOSHM class
+
+std::tuple<std::unique_ptr<galois::runtime::NetworkIO>, uint32_t, uint32_t>
+galois::runtime::makeNetworkIOSHM(galois::runtime::MemUsageTracker& tracker,
+                                  std::atomic<size_t>& sends,
+                                  std::atomic<size_t>& recvs) {
+  uint32_t ID, NUM;
+  std::unique_ptr<galois::runtime::NetworkIO> n{
+      new NetworkIOSHM(tracker, sends, recvs, ID, NUM)};
+  return std::make_tuple(std::move(n), ID, NUM);
+}
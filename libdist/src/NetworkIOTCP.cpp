@@ -0,0 +1,558 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+/**
+ * @file NetworkIOTCP.cpp
+ *
+ * Contains an implementation of network IO that uses plain TCP sockets.
+ */
+
+#include "galois/runtime/NetworkIO.h"
+#include "galois/runtime/Tracer.h"
+#include "galois/substrate/EnvCheck.h"
+#include "galois/gIO.h"
+
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+/**
+ * TCP implementation of network IO. Does not need MPI: hosts find each other
+ * through a host list given in the environment.
+ *
+ * Every pair of hosts shares one connection; host i connects to every host
+ * below it and accepts connections from every host above it. Sockets are
+ * non-blocking and driven by epoll from progress(). Messages queued for a host
+ * between two progress calls are gathered into a single sendmsg, so many small
+ * messages share one system call (and, with TCP_NODELAY, are not held back by
+ * Nagle's algorithm).
+ */
+class NetworkIOTCP : public galois::runtime::NetworkIO {
+private:
+  //! Sent in front of every message on a connection
+  struct frameHeader {
+    uint32_t tag;
+    uint32_t pad;
+    uint64_t len;
+  };
+
+  struct outMessage {
+    frameHeader hdr;
+    message m;
+    outMessage(message&& _m) : m(std::move(_m)) {
+      hdr.tag = m.tag;
+      hdr.pad = 0;
+      hdr.len = m.data.size();
+    }
+  };
+
+  static constexpr size_t READ_BUFFER = 64 << 10;
+  static constexpr int MAX_IOV        = 64;
+
+  //! Connection to one host
+  struct peer {
+    int fd = -1;
+    std::deque<outMessage> sendQ;
+    //! bytes of the front message (header included) already written
+    size_t sendOffset = 0;
+    //! waiting for EPOLLOUT because the socket buffer was full
+    bool blocked = false;
+
+    std::vector<uint8_t> rbuf;
+    size_t rbufPos = 0;
+    size_t rbufEnd = 0;
+    frameHeader hdr;
+    size_t hdrGot = 0;
+    bool inBody   = false;
+    vTy body;
+    size_t bodyGot = 0;
+    bool closed    = false;
+  };
+
+  uint32_t ID;
+  uint32_t Num;
+  int epfd;
+  std::vector<peer> peers;
+  std::deque<message> done;
+
+  unsigned long statSendBytes;
+  unsigned long statSendMsgs;
+  unsigned long statWrites;
+  unsigned long statBlocked;
+  unsigned long statRecvBytes;
+  unsigned long statReads;
+
+  struct hostAddress {
+    std::string host;
+    std::string port;
+  };
+
+  /**
+   * Reads the host list from GALOIS_TCP_HOSTS (comma separated) or from the
+   * file named by GALOIS_TCP_HOSTFILE (one host per line). A host is
+   * "name[:port]"; hosts without a port listen on GALOIS_TCP_PORT plus their
+   * position in the list, so several hosts can share a machine.
+   */
+  static std::vector<hostAddress> readHostList() {
+    std::string list, file;
+    std::vector<std::string> entries;
+    if (galois::substrate::EnvCheck("GALOIS_TCP_HOSTS", list)) {
+      std::stringstream ss(list);
+      std::string entry;
+      while (std::getline(ss, entry, ','))
+        entries.push_back(entry);
+    } else if (galois::substrate::EnvCheck("GALOIS_TCP_HOSTFILE", file)) {
+      std::ifstream in(file);
+      if (!in.is_open())
+        GALOIS_DIE("could not open TCP host file ", file);
+      std::string line;
+      while (std::getline(in, line)) {
+        std::stringstream ss(line);
+        std::string entry;
+        if (ss >> entry && entry[0] != '#')
+          entries.push_back(entry);
+      }
+    } else {
+      GALOIS_DIE("TCP network needs GALOIS_TCP_HOSTS or GALOIS_TCP_HOSTFILE");
+    }
+
+    int basePort = 41000;
+    galois::substrate::EnvCheck("GALOIS_TCP_PORT", basePort);
+    std::vector<hostAddress> hosts;
+    for (auto& e : entries) {
+      if (e.empty())
+        continue;
+      auto colon = e.rfind(':');
+      if (colon == std::string::npos)
+        hosts.push_back({e, std::to_string(basePort + hosts.size())});
+      else
+        hosts.push_back({e.substr(0, colon), e.substr(colon + 1)});
+    }
+    if (hosts.empty())
+      GALOIS_DIE("TCP host list is empty");
+    return hosts;
+  }
+
+  //! This host's position in the host list; taken from GALOIS_TCP_RANK or
+  //! from the rank variables of common launchers
+  static uint32_t readRank(size_t numHosts) {
+    int rank = -1;
+    for (const char* var : {"GALOIS_TCP_RANK", "OMPI_COMM_WORLD_RANK",
+                            "PMI_RANK", "SLURM_PROCID"})
+      if (galois::substrate::EnvCheck(var, rank))
+        break;
+    if (rank < 0 || (size_t)rank >= numHosts)
+      GALOIS_DIE("TCP network needs GALOIS_TCP_RANK in [0, ", numHosts, ")");
+    return rank;
+  }
+
+  static void setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+      GALOIS_SYS_DIE("could not make socket non-blocking");
+  }
+
+  static void tuneSocket(int fd) {
+    int one = 1;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)))
+      GALOIS_SYS_DIE("setsockopt TCP_NODELAY failed");
+    int bufSize = 4 << 20;
+    galois::substrate::EnvCheck("GALOIS_TCP_SOCKET_BUFFER", bufSize);
+    if (bufSize > 0) {
+      setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize));
+      setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+    }
+  }
+
+  static void writeAll(int fd, const void* buf, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(buf);
+    while (len) {
+      ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        GALOIS_SYS_DIE("TCP handshake write failed");
+      p += n;
+      len -= n;
+    }
+  }
+
+  static void readAll(int fd, void* buf, size_t len) {
+    uint8_t* p = static_cast<uint8_t*>(buf);
+    while (len) {
+      ssize_t n = read(fd, p, len);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        GALOIS_SYS_DIE("TCP handshake read failed");
+      p += n;
+      len -= n;
+    }
+  }
+
+  //! Connects to a host, retrying until it is listening or time runs out
+  static int connectTo(const hostAddress& addr) {
+    int timeout = 60;
+    galois::substrate::EnvCheck("GALOIS_TCP_CONNECT_TIMEOUT", timeout);
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(timeout);
+
+    addrinfo hints = {};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res;
+    int rc = getaddrinfo(addr.host.c_str(), addr.port.c_str(), &hints, &res);
+    if (rc)
+      GALOIS_DIE("could not resolve ", addr.host, ": ", gai_strerror(rc));
+
+    while (true) {
+      for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+          continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+          freeaddrinfo(res);
+          return fd;
+        }
+        close(fd);
+      }
+      if (std::chrono::steady_clock::now() > deadline)
+        GALOIS_SYS_DIE("could not connect to ", addr.host, ":", addr.port);
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+
+  static int listenOn(const hostAddress& addr) {
+    addrinfo hints = {};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = AI_PASSIVE;
+    addrinfo* res;
+    int rc = getaddrinfo(nullptr, addr.port.c_str(), &hints, &res);
+    if (rc)
+      GALOIS_DIE("could not resolve port ", addr.port, ": ", gai_strerror(rc));
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    int one = 1;
+    if (fd < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) ||
+        bind(fd, res->ai_addr, res->ai_addrlen) || listen(fd, SOMAXCONN))
+      GALOIS_SYS_DIE("could not listen on port ", addr.port);
+    freeaddrinfo(res);
+    return fd;
+  }
+
+  //! Opens a connection to every other host
+  void connectAll(const std::vector<hostAddress>& hosts) {
+    int lfd = Num > 1 ? listenOn(hosts[ID]) : -1;
+
+    for (uint32_t h = 0; h < ID; ++h) {
+      int fd = connectTo(hosts[h]);
+      writeAll(fd, &ID, sizeof(ID));
+      peers[h].fd = fd;
+    }
+    for (uint32_t i = ID + 1; i < Num; ++i) {
+      int fd = accept(lfd, nullptr, nullptr);
+      if (fd < 0)
+        GALOIS_SYS_DIE("accept failed");
+      uint32_t h;
+      readAll(fd, &h, sizeof(h));
+      if (h <= ID || h >= Num || peers[h].fd != -1)
+        GALOIS_DIE("unexpected TCP connection from host ", h);
+      peers[h].fd = fd;
+    }
+    if (lfd >= 0)
+      close(lfd);
+
+    epfd = epoll_create1(0);
+    if (epfd < 0)
+      GALOIS_SYS_DIE("epoll_create1 failed");
+    for (uint32_t h = 0; h < Num; ++h) {
+      peer& p = peers[h];
+      if (h == ID)
+        continue;
+      tuneSocket(p.fd);
+      setNonBlocking(p.fd);
+      p.rbuf.resize(READ_BUFFER);
+      epoll_event ev = {};
+      ev.events      = EPOLLIN;
+      ev.data.u32    = h;
+      if (epoll_ctl(epfd, EPOLL_CTL_ADD, p.fd, &ev))
+        GALOIS_SYS_DIE("epoll_ctl failed");
+    }
+  }
+
+  void watchWritable(uint32_t h, bool on) {
+    peer& p = peers[h];
+    if (p.blocked == on)
+      return;
+    p.blocked      = on;
+    epoll_event ev = {};
+    ev.events      = on ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    ev.data.u32    = h;
+    if (epoll_ctl(epfd, EPOLL_CTL_MOD, p.fd, &ev))
+      GALOIS_SYS_DIE("epoll_ctl failed");
+  }
+
+  //! Writes as much of the send queue of a host as the socket takes
+  void flush(uint32_t h) {
+    peer& p = peers[h];
+    while (!p.sendQ.empty()) {
+      iovec iov[MAX_IOV];
+      int n         = 0;
+      size_t offset = p.sendOffset;
+      for (auto ii = p.sendQ.begin(), ei = p.sendQ.end();
+           ii != ei && n + 2 <= MAX_IOV; ++ii) {
+        if (offset < sizeof(frameHeader)) {
+          iov[n].iov_base = reinterpret_cast<uint8_t*>(&ii->hdr) + offset;
+          iov[n].iov_len  = sizeof(frameHeader) - offset;
+          ++n;
+          offset = 0;
+        } else {
+          offset -= sizeof(frameHeader);
+        }
+        if (ii->m.data.size() > offset) {
+          iov[n].iov_base = ii->m.data.data() + offset;
+          iov[n].iov_len  = ii->m.data.size() - offset;
+          ++n;
+        }
+        offset = 0;
+      }
+
+      msghdr msg  = {};
+      msg.msg_iov = iov;
+      msg.msg_iovlen = n;
+      // a host that went away must not raise SIGPIPE
+      ssize_t written = sendmsg(p.fd, &msg, MSG_NOSIGNAL);
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          ++statBlocked;
+          watchWritable(h, true);
+          return;
+        }
+        GALOIS_SYS_DIE("send to host ", h, " failed");
+      }
+      ++statWrites;
+      statSendBytes += written;
+
+      size_t left = written;
+      while (left) {
+        outMessage& f = p.sendQ.front();
+        size_t frame  = sizeof(frameHeader) + f.m.data.size();
+        size_t step   = std::min(left, frame - p.sendOffset);
+        p.sendOffset += step;
+        left -= step;
+        if (p.sendOffset == frame) {
+          memUsageTracker.decrementMemUsage(f.m.data.size());
+          --inflightSends;
+          p.sendQ.pop_front();
+          p.sendOffset = 0;
+        }
+      }
+    }
+    watchWritable(h, false);
+  }
+
+  void receive(uint32_t host, uint32_t tag, vTy&& data) {
+    galois::runtime::trace("TCP RECV", host, tag, data.size());
+    done.emplace_back(host, tag, std::move(data));
+  }
+
+  //! Reads and splits into messages whatever a host has sent
+  void readFrom(uint32_t h) {
+    peer& p = peers[h];
+    while (!p.closed) {
+      size_t bodyLeft = p.inBody ? p.hdr.len - p.bodyGot : 0;
+      if (p.rbufPos == p.rbufEnd) {
+        // large bodies skip the read buffer
+        bool direct = bodyLeft >= READ_BUFFER;
+        ssize_t n   = direct ? read(p.fd, p.body.data() + p.bodyGot, bodyLeft)
+                             : read(p.fd, p.rbuf.data(), READ_BUFFER);
+        if (n < 0) {
+          if (errno == EINTR)
+            continue;
+          if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return;
+          GALOIS_SYS_DIE("receive from host ", h, " failed");
+        }
+        if (n == 0) {
+          // hosts close their connections once they shut down
+          p.closed = true;
+          epoll_ctl(epfd, EPOLL_CTL_DEL, p.fd, nullptr);
+          return;
+        }
+        ++statReads;
+        statRecvBytes += n;
+        if (direct) {
+          p.bodyGot += n;
+        } else {
+          p.rbufPos = 0;
+          p.rbufEnd = n;
+        }
+      } else if (!p.inBody) {
+        size_t step = std::min(sizeof(frameHeader) - p.hdrGot,
+                               p.rbufEnd - p.rbufPos);
+        std::memcpy(reinterpret_cast<uint8_t*>(&p.hdr) + p.hdrGot,
+                    p.rbuf.data() + p.rbufPos, step);
+        p.hdrGot += step;
+        p.rbufPos += step;
+        if (p.hdrGot == sizeof(frameHeader)) {
+          p.inBody  = true;
+          p.bodyGot = 0;
+          p.body.resize(p.hdr.len);
+          ++inflightRecvs;
+          memUsageTracker.incrementMemUsage(p.hdr.len);
+        }
+      } else {
+        size_t step = std::min(bodyLeft, p.rbufEnd - p.rbufPos);
+        std::memcpy(p.body.data() + p.bodyGot, p.rbuf.data() + p.rbufPos,
+                    step);
+        p.bodyGot += step;
+        p.rbufPos += step;
+      }
+
+      if (p.inBody && p.bodyGot == p.hdr.len) {
+        receive(h, p.hdr.tag, std::move(p.body));
+        p.body   = vTy();
+        p.inBody = false;
+        p.hdrGot = 0;
+      }
+    }
+  }
+
+public:
+  /**
+   * Constructor.
+   *
+   * @param tracker memory usage tracker
+   * @param [out] _ID this machine's host id
+   * @param [out] NUM total number of hosts in the system
+   */
+  NetworkIOTCP(galois::runtime::MemUsageTracker& tracker,
+               std::atomic<size_t>& sends, std::atomic<size_t>& recvs,
+               uint32_t& _ID, uint32_t& NUM)
+      : NetworkIO(tracker, sends, recvs), epfd(-1), statSendBytes(0),
+        statSendMsgs(0), statWrites(0), statBlocked(0), statRecvBytes(0),
+        statReads(0) {
+    auto hosts = readHostList();
+    ID         = readRank(hosts.size());
+    Num        = hosts.size();
+    peers      = decltype(peers)(Num);
+    connectAll(hosts);
+    _ID = ID;
+    NUM = Num;
+  }
+
+  //! Sends out what is still queued and closes the connections
+  virtual ~NetworkIOTCP() {
+    for (uint32_t h = 0; h < Num; ++h) {
+      peer& p = peers[h];
+      if (h == ID)
+        continue;
+      while (!p.sendQ.empty()) {
+        flush(h);
+        if (!p.sendQ.empty()) {
+          epoll_event ev;
+          epoll_wait(epfd, &ev, 1, 10);
+        }
+      }
+      close(p.fd);
+    }
+    if (epfd >= 0)
+      close(epfd);
+  }
+
+  /**
+   * Queues a message for its host; messages to self are delivered directly.
+   */
+  virtual void enqueue(message m) {
+    galois::runtime::trace("TCP SEND", m.host, m.tag, m.data.size());
+    ++statSendMsgs;
+    if (m.host == ID) {
+      --inflightSends;
+      ++inflightRecvs;
+      memUsageTracker.incrementMemUsage(m.data.size());
+      receive(m.host, m.tag, std::move(m.data));
+      return;
+    }
+    memUsageTracker.incrementMemUsage(m.data.size());
+    peers[m.host].sendQ.emplace_back(std::move(m));
+  }
+
+  /**
+   * Attempts to get a message from the receive queue.
+   */
+  virtual message dequeue() {
+    if (!done.empty()) {
+      auto msg = std::move(done.front());
+      done.pop_front();
+      return msg;
+    }
+    return message{~0U, 0, vTy()};
+  }
+
+  /**
+   * Writes out queued messages and handles socket events.
+   */
+  virtual void progress() {
+    for (uint32_t h = 0; h < Num; ++h)
+      if (!peers[h].blocked && !peers[h].sendQ.empty())
+        flush(h);
+
+    epoll_event events[16];
+    int n = Num > 1 ? epoll_wait(epfd, events, 16, 0) : 0;
+    if (n < 0 && errno != EINTR)
+      GALOIS_SYS_DIE("epoll_wait failed");
+    for (int i = 0; i < n; ++i) {
+      uint32_t h = events[i].data.u32;
+      if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+        readFrom(h);
+      if (events[i].events & EPOLLOUT)
+        flush(h);
+    }
+  }
+
+  virtual std::vector<std::pair<std::string, unsigned long>>
+  reportStats() const {
+    return {{"TcpSendBytes", statSendBytes}, {"TcpSendMsgs", statSendMsgs},
+            {"TcpWrites", statWrites},       {"TcpSendBlocked", statBlocked},
+            {"TcpRecvBytes", statRecvBytes}, {"TcpReads", statReads}};
+  }
+}; // end NetworkIOTCP class
+
+std::tuple<std::unique_ptr<galois::runtime::NetworkIO>, uint32_t, uint32_t>
+galois::runtime::makeNetworkIOTCP(galois::runtime::MemUsageTracker& tracker,
+                                  std::atomic<size_t>& sends,
+                                  std::atomic<size_t>& recvs) {
+  uint32_t ID, NUM;
+  std::unique_ptr<galois::runtime::NetworkIO> n{
+      new NetworkIOTCP(tracker, sends, recvs, ID, NUM)};
+  return std::make_tuple(std::move(n), ID, NUM);
+}
@@ -203,7 +203,7 @@ struct partition_helper {
 
   partition_helper_state* state;
 
-  void operator()(unsigned, unsigned) {
+  void operator()(unsigned, unsigned) const {
     RP high, low;
     do {
       RP parts  = dual_partition(low.first, low.second, high.first, high.second,
@@ -323,6 +323,62 @@ public:
     ar >> edgeData;
   }
 
+  //! Raw array with the end of the edges of every node
+  const uint64_t* edgeIndexArray() const { return edgeIndData.data(); }
+  //! Raw array with the destination of every edge
+  const uint32_t* edgeDstArray() const { return edgeDst.data(); }
+  //! Raw array with the data of every edge (null if there is no edge data)
+  const void* edgeDataArray() const { return edgeData.data(); }
+
+  /**
+   * Uses existing arrays (e.g. ones in a memory-mapped file) as the topology
+   * and edge data of this graph without copying them; node data is allocated
+   * and constructed as usual. Only for graphs that have not been allocated
+   * yet. The arrays are not freed by the graph and have to outlive it.
+   *
+   * @param nNodes number of nodes
+   * @param nEdges number of edges
+   * @param edgeIndices end of the edges of every node
+   * @param edgeDests destination of every edge
+   * @param edgeValues data of every edge (ignored if there is no edge data)
+   */
+  void wrapTopology(uint32_t nNodes, uint64_t nEdges, uint64_t* edgeIndices,
+                    uint32_t* edgeDests, void* edgeValues) {
+    numNodes = nNodes;
+    numEdges = nEdges;
+
+    EdgeIndData wrappedIndData(edgeIndices, numNodes);
+    EdgeDst wrappedDst(edgeDests, numEdges);
+    EdgeData wrappedData(edgeValues, numEdges);
+    swap(edgeIndData, wrappedIndData);
+    swap(edgeDst, wrappedDst);
+    swap(edgeData, wrappedData);
+
+    if (UseNumaAlloc) {
+      nodeData.allocateBlocked(numNodes);
+      this->outOfLineAllocateBlocked(numNodes);
+    } else {
+      nodeData.allocateInterleaved(numNodes);
+      this->outOfLineAllocateInterleaved(numNodes);
+    }
+    constructNodes();
+  }
+
+  /**
+   * Exchanges the nodes and edges of this graph with those of another graph
+   * (e.g. one that was built as a replacement of this one).
+   */
+  void swapGraph(LC_CSR_Graph& other) {
+    static_assert(!HasOutOfLineLockable,
+                  "out-of-line locks can not be exchanged");
+    std::swap(numNodes, other.numNodes);
+    std::swap(numEdges, other.numEdges);
+    swap(nodeData, other.nodeData);
+    swap(edgeIndData, other.edgeIndData);
+    swap(edgeDst, other.edgeDst);
+    swap(edgeData, other.edgeData);
+  }
+
   /**
    * Accesses the "prefix sum" of this graph; takes advantage of the fact
    * that edge_end(n) is basically prefix_sum[n] (if a prefix sum existed +
@@ -43,6 +43,7 @@
 #include <boost/iterator/transform_iterator.hpp>
 #include <boost/iterator/counting_iterator.hpp>
 
+#include <cmath>
 #include <type_traits>
 #include <deque>
 #include <queue>
@@ -452,7 +453,7 @@ struct FIFO {
   bool empty() const { return m_size == 0; }
 };
 
-template <typename T, typename FunctionTy, typename ArgsTy>
+template <typename T, typename FunctionTy, typename ArgsTy, bool Adaptive>
 struct OptionsCommon {
   typedef T value_type;
   typedef FunctionTy function2_type;
@@ -478,10 +479,15 @@ struct OptionsCommon {
       exists_by_supertype<fixed_neighborhood_tag, ArgsTy>::value;
   static const bool hasIntentToRead =
       exists_by_supertype<intent_to_read_tag, ArgsTy>::value;
+  //! Size rounds from the commit ratio of the previous round and assign
+  //! ids so that each socket works on a contiguous part of the input
+  static const bool adaptiveWindow = Adaptive;
 
   static const int ChunkSize             = 32;
   static const unsigned InitialNumRounds = 100;
   static const size_t MinDelta           = ChunkSize * 40;
+  //! Number of id stripes dealt out to threads in adaptive mode
+  static const size_t NumStripes = MinDelta;
 
   static_assert(
       !hasFixedNeighborhood || (hasFixedNeighborhood && hasId),
@@ -493,9 +499,10 @@ struct OptionsCommon {
   OptionsCommon(const FunctionTy& f, ArgsTy a) : fn2(f), args(a) {}
 };
 
-template <typename T, typename FunctionTy, typename ArgsTy, bool Enable>
-struct OptionsBase : public OptionsCommon<T, FunctionTy, ArgsTy> {
-  typedef OptionsCommon<T, FunctionTy, ArgsTy> SuperTy;
+template <typename T, typename FunctionTy, typename ArgsTy, bool Adaptive,
+          bool Enable>
+struct OptionsBase : public OptionsCommon<T, FunctionTy, ArgsTy, Adaptive> {
+  typedef OptionsCommon<T, FunctionTy, ArgsTy, Adaptive> SuperTy;
   typedef FunctionTy function1_type;
 
   function1_type fn1;
@@ -503,10 +510,10 @@ struct OptionsBase : public OptionsCommon<T, FunctionTy, ArgsTy> {
   OptionsBase(const FunctionTy& f, ArgsTy a) : SuperTy(f, a), fn1(f) {}
 };
 
-template <typename T, typename FunctionTy, typename ArgsTy>
-struct OptionsBase<T, FunctionTy, ArgsTy, true>
-    : public OptionsCommon<T, FunctionTy, ArgsTy> {
-  typedef OptionsCommon<T, FunctionTy, ArgsTy> SuperTy;
+template <typename T, typename FunctionTy, typename ArgsTy, bool Adaptive>
+struct OptionsBase<T, FunctionTy, ArgsTy, Adaptive, true>
+    : public OptionsCommon<T, FunctionTy, ArgsTy, Adaptive> {
+  typedef OptionsCommon<T, FunctionTy, ArgsTy, Adaptive> SuperTy;
   typedef typename get_type_by_supertype<neighborhood_visitor_tag,
                                          ArgsTy>::type::type function1_type;
 
@@ -517,9 +524,10 @@ struct OptionsBase<T, FunctionTy, ArgsTy, true>
         fn1(get_by_supertype<neighborhood_visitor_tag>(a).value) {}
 };
 
-template <typename T, typename FunctionTy, typename ArgsTy>
+template <typename T, typename FunctionTy, typename ArgsTy,
+          bool Adaptive = false>
 using Options =
-    OptionsBase<T, FunctionTy, ArgsTy,
+    OptionsBase<T, FunctionTy, ArgsTy, Adaptive,
                 exists_by_supertype<neighborhood_visitor_tag, ArgsTy>::value>;
 
 template <typename OptionsTy, bool Enable>
@@ -820,8 +828,13 @@ public:
     size_t delta;
     size_t committed;
     size_t iterations;
+    //! Round size learned by the adaptive schedule; 0 if none yet
+    size_t learned;
 
   public:
+    ThreadLocalData()
+        : window(0), delta(0), committed(0), iterations(0), learned(0) {}
+
     size_t nextWindow(bool first = false) {
       if (first)
         window = delta;
@@ -836,20 +849,56 @@ public:
   };
 
 private:
+  //! Number of buckets of the per round commit ratio histogram
+  static const unsigned NumRatioBuckets = 5;
+
   substrate::PerThreadStorage<ThreadLocalData> data;
+  size_t ratioHistogram[NumRatioBuckets];
   unsigned numActive;
 
+  //! Accumulate all threads' info
+  void globalCounts(size_t& allcommitted, size_t& alliterations) {
+    allcommitted  = 0;
+    alliterations = 0;
+    for (unsigned i = 0; i < numActive; ++i) {
+      ThreadLocalData& r = *data.getRemote(i);
+      allcommitted += r.committed;
+      alliterations += r.iterations;
+    }
+  }
+
+  /**
+   * Models the commit ratio of a round of s iterations as exp(-c s),
+   * estimates c from the last round and returns the factor by which to
+   * scale the round so that the ratio meets the target.
+   */
+  static double adaptiveScale(size_t allcommitted, size_t alliterations) {
+    const double target   = 0.8;
+    const double minScale = 0.125;
+    const double maxScale = 2.0;
+
+    if (allcommitted >= alliterations)
+      return maxScale;
+    double ratio = allcommitted / (double)alliterations;
+    double scale = std::log(target) / std::log(ratio);
+    return std::min(std::max(scale, minScale), maxScale);
+  }
+
 public:
-  WindowManagerBase() { numActive = getActiveThreads(); }
+  WindowManagerBase() : ratioHistogram() { numActive = getActiveThreads(); }
 
   ThreadLocalData& getLocalWindowManager() { return *data.getLocal(); }
 
   size_t nextWindow(size_t dist, size_t atleast, size_t base = 0) {
-    if (false) {
-      // This, which tries to continue delta with new work, seems to result in
-      // more conflicts (although less total rounds) and more time
-      ThreadLocalData& local = *data.getLocal();
-      return local.nextWindow(true);
+    ThreadLocalData& local = *data.getLocal();
+    if (OptionsTy::adaptiveWindow && !OptionsTy::hasId && local.learned) {
+      // Continue with the round size learned so far rather than restarting
+      // from a fixed fraction of the new work. Ids of items with a user
+      // provided id are not dense, so those still start from scratch.
+      local.delta     = std::max(local.learned, atleast);
+      local.window    = local.delta + base;
+      local.committed = local.iterations = 0;
+      return local.window;
     } else {
       return initialWindow(dist, atleast, base);
     }
@@ -859,26 +908,38 @@ public:
     ThreadLocalData& local = *data.getLocal();
     size_t w     = std::max(dist / OptionsTy::InitialNumRounds, atleast) + base;
     local.window = local.delta = w;
+    local.committed = local.iterations = 0;
     return w;
   }
 
   void calculateWindow(bool inner) {
     ThreadLocalData& local = *data.getLocal();
 
-    // Accumulate all threads' info
-    size_t allcommitted  = 0;
-    size_t alliterations = 0;
-    for (unsigned i = 0; i < numActive; ++i) {
-      ThreadLocalData& r = *data.getRemote(i);
-      allcommitted += r.committed;
-      alliterations += r.iterations;
-    }
+    size_t allcommitted;
+    size_t alliterations;
+    globalCounts(allcommitted, alliterations);
 
     float commitRatio =
         alliterations > 0 ? allcommitted / (float)alliterations : 0.0;
     const float target = 0.95;
 
-    if (commitRatio >= target)
+    if (OptionsTy::adaptiveWindow && OptionsTy::hasId) {
+      local.delta = adaptiveScale(allcommitted, alliterations) * local.delta;
+    } else if (OptionsTy::adaptiveWindow) {
+      assert((allcommitted > 0 || alliterations == 0) &&
+             "someone should have committed");
+      // Ids are dense, so aim the next round at the estimated size: the
+      // aborted iterations are retried and the rest is filled with new ids.
+      // Small rounds say little about conflicts; fall back to what was
+      // learned from earlier rounds.
+      size_t size = adaptiveScale(allcommitted, alliterations) * alliterations;
+      if (alliterations >= OptionsTy::MinDelta)
+        local.learned = size;
+      else
+        size = std::max(size, local.learned);
+      size_t retry = alliterations - allcommitted;
+      local.delta  = size > retry ? size - retry : 0;
+    } else if (commitRatio >= target)
       local.delta += local.delta;
     else if (allcommitted == 0) {
       assert((alliterations == 0) && "someone should have committed");
@@ -905,6 +966,33 @@ public:
       }
     }
   }
+
+  //! Record the outcome of the round that just finished. Called by thread 0
+  //! after all threads have committed.
+  void recordRound() {
+    size_t allcommitted;
+    size_t alliterations;
+    globalCounts(allcommitted, alliterations);
+    if (alliterations == 0)
+      return;
+
+    // Upper bounds (in percent) of all but the last bucket
+    const size_t bounds[NumRatioBuckets - 1] = {25, 50, 75, 95};
+    size_t percent = 100 * allcommitted / alliterations;
+    unsigned i     = 0;
+    while (i < NumRatioBuckets - 1 && percent >= bounds[i])
+      ++i;
+    ++ratioHistogram[i];
+  }
+
+  void reportRounds(const char* loopname) {
+    const char* names[NumRatioBuckets] = {
+        "RoundsCommitRatio0-25", "RoundsCommitRatio25-50",
+        "RoundsCommitRatio50-75", "RoundsCommitRatio75-95",
+        "RoundsCommitRatio95-100"};
+    for (unsigned i = 0; i < NumRatioBuckets; ++i)
+      reportStat_Single(loopname, names[i], ratioHistogram[i]);
+  }
 };
 
 template <typename OptionsTy>
@@ -933,6 +1021,10 @@ public:
   }
 
   void calculateWindow(bool inner) {}
+
+  void recordRound() {}
+
+  void reportRounds(const char* loopname) {}
 };
 
 template <typename OptionsTy>
@@ -1074,22 +1166,60 @@ class NewWorkManager : public IdManager<OptionsTy> {
   void redistribute(InputIteratorTy ii, InputIteratorTy ei, size_t dist,
                     size_t window, unsigned tid) {
     // ThreadLocalData& local = *data.getLocal();
-    size_t blockSize = window;
+    const size_t numStripes = OptionsTy::NumStripes;
+    size_t blockSize        = window;
+    // The adaptive window no longer follows the amount of work, so spread
+    // items as far apart as the fixed schedule would
+    if (OptionsTy::adaptiveWindow)
+      blockSize = std::max(dist / OptionsTy::InitialNumRounds,
+                           OptionsTy::MinDelta);
     size_t numBlocks = dist / blockSize;
+    size_t perStripe = blockSize / numStripes;
 
     size_t cur = 0;
     safe_advance(ii, tid, cur, dist);
     while (ii != ei) {
       unsigned long id;
-      if (cur < blockSize * numBlocks)
-        id = (cur % numBlocks) * blockSize + (cur / numBlocks);
-      else
+      if (cur < blockSize * numBlocks) {
+        size_t pos = cur / numBlocks;
+        // Within a block, give each stripe of ids a contiguous run of input
+        // so that copyMineStriped hands out neighboring items together
+        if (OptionsTy::adaptiveWindow && pos < perStripe * numStripes)
+          pos = (pos % perStripe) * numStripes + pos / perStripe;
+        id = (cur % numBlocks) * blockSize + pos;
+      } else
         id = cur;
       distributeBuf[id] = *ii;
       safe_advance(ii, numActive, cur, dist);
     }
   }
 
+  /**
+   * Like copyMine, but instead of dealing ids round-robin, each thread takes
+   * a contiguous range of the id stripes (id modulo NumStripes). Threads
+   * of a socket have neighboring ranges, so together with the ordering from
+   * redistribute each socket works on a contiguous part of the input. Every
+   * window spanning NumStripes ids still has work for every thread.
+   */
+  template <typename RandomAccessIteratorTy, typename WL>
+  void copyMineStriped(RandomAccessIteratorTy ii, size_t dist, WL* wl,
+                       size_t window, unsigned tid) {
+    ThreadLocalData& local  = *data.getLocal();
+    const size_t numStripes = OptionsTy::NumStripes;
+    size_t lo               = numStripes * tid / numActive;
+    size_t hi               = numStripes * (tid + 1) / numActive;
+
+    for (size_t base = 0; base < dist; base += numStripes) {
+      size_t end = std::min(base + hi, dist);
+      for (size_t id = base + lo; id < end; ++id) {
+        if (id < window)
+          wl->push(Item(ii[id], id));
+        else
+          local.reserve.push(Item(ii[id], id));
+      }
+    }
+  }
+
   template <typename InputIteratorTy, typename WL>
   void copyMine(InputIteratorTy ii, InputIteratorTy ei, size_t dist, WL* wl,
                 size_t window, unsigned tid) {
@@ -1143,7 +1273,11 @@ class NewWorkManager : public IdManager<OptionsTy> {
     barrier.wait();
     redistribute(ii, ei, dist, window, tid);
     barrier.wait();
-    copyMine(distributeBuf.begin(), distributeBuf.end(), dist, wl, window, tid);
+    if (OptionsTy::adaptiveWindow)
+      copyMineStriped(distributeBuf.begin(), dist, wl, window, tid);
+    else
+      copyMine(distributeBuf.begin(), distributeBuf.end(), dist, wl, window,
+               tid);
   }
 
   template <typename WL>
@@ -1290,6 +1424,11 @@ public:
       size_t window = wm.initialWindow(dist, OptionsTy::MinDelta, local.minId);
       if (OptionsTy::hasFixedNeighborhood) {
         copyMine(b, e, dist, wl, window, substrate::ThreadPool::getTID());
+      } else if (OptionsTy::adaptiveWindow) {
+        copyMineStriped(boost::make_transform_iterator(
+                            mergeBuf.begin(), typename NewItem::GetValue()),
+                        mergeBuf.size(), wl, window,
+                        substrate::ThreadPool::getTID());
       } else {
         copyMine(boost::make_transform_iterator(mergeBuf.begin(),
                                                 typename NewItem::GetValue()),
@@ -1448,6 +1587,9 @@ void Executor<OptionsTy>::go() {
 
       barrier.wait();
 
+      if (OptionsTy::needStats && substrate::ThreadPool::getTID() == 0)
+        this->recordRound();
+
       if (innerDone.get())
         break;
 
@@ -1493,6 +1635,7 @@ void Executor<OptionsTy>::go() {
     if (substrate::ThreadPool::getTID() == 0) {
       reportStat_Single(loopname, "RoundsExecuted", tld.rounds);
       reportStat_Single(loopname, "OuterRoundsExecuted", tld.outerRounds);
+      this->reportRounds(loopname);
     }
   }
 }
@@ -1665,26 +1808,38 @@ namespace worklists {
 
 /**
  * Deterministic execution. Operator should be cautious.
+ *
+ * With Adaptive set, the size of each round follows the commit ratio of the
+ * previous round instead of a fixed growth schedule, and ids are dealt out so
+ * that each socket works on a contiguous part of the input. Output is still
+ * independent of the number of threads, but differs from the non-adaptive
+ * schedule.
  */
-template <typename T = int>
+template <typename T = int, bool Adaptive = false>
 struct Deterministic {
   template <bool _concurrent>
-  using rethread = Deterministic<T>;
+  using rethread = Deterministic<T, Adaptive>;
 
   template <typename _T>
-  using retype = Deterministic<_T>;
+  using retype = Deterministic<_T, Adaptive>;
 
   typedef T value_type;
 };
 
+//! Deterministic execution with adaptive round sizes
+template <typename T = int>
+using DeterministicAdaptive = Deterministic<T, true>;
+
 } // namespace worklists
 
 namespace runtime {
 
-template <class T, class FunctionTy, class ArgsTy>
-struct ForEachExecutor<worklists::Deterministic<T>, FunctionTy, ArgsTy>
-    : public internal::Executor<internal::Options<T, FunctionTy, ArgsTy>> {
-  typedef internal::Options<T, FunctionTy, ArgsTy> OptionsTy;
+template <class T, bool Adaptive, class FunctionTy, class ArgsTy>
+struct ForEachExecutor<worklists::Deterministic<T, Adaptive>, FunctionTy,
+                       ArgsTy>
+    : public internal::Executor<
+          internal::Options<T, FunctionTy, ArgsTy, Adaptive>> {
+  typedef internal::Options<T, FunctionTy, ArgsTy, Adaptive> OptionsTy;
   typedef internal::Executor<OptionsTy> SuperTy;
   ForEachExecutor(const FunctionTy& f, const ArgsTy& args)
       : SuperTy(OptionsTy(f, args)) {}
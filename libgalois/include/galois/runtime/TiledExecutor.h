@@ -27,6 +27,63 @@
 namespace galois {
 namespace runtime {
 
+/**
+ * Socket-affine rotating diagonal schedule over a grid of numX x numY blocks
+ * (DSGD-style stratification).
+ *
+ * Block rows and block columns are split into one contiguous group per active
+ * socket, and socket s owns row group s and column group s. In round r socket
+ * s works on row group s and column group (s + r) mod S, so the S strata of a
+ * round share no block rows or block columns and sockets never contend with
+ * each other. After S rounds every block has been visited once.
+ */
+class SocketDiagonalSchedule {
+  size_t numX;
+  size_t numY;
+  unsigned numSockets;
+
+public:
+  using Range = std::pair<size_t, size_t>;
+
+  //! Block holding element i when n elements are split with
+  //! galois::block_range into num blocks
+  static size_t blockOf(size_t i, size_t n, size_t num) {
+    size_t per = std::max<size_t>((n + num - 1) / num, 1);
+    return std::min<size_t>(i / per, num - 1);
+  }
+
+  SocketDiagonalSchedule(size_t _numX, size_t _numY,
+                         unsigned numThreads = galois::getActiveThreads())
+      : numX(_numX), numY(_numY),
+        numSockets(
+            substrate::getThreadPool().getCumulativeMaxSocket(numThreads - 1) +
+            1) {}
+
+  //! Number of rounds (and sockets) in the schedule
+  unsigned rounds() const { return numSockets; }
+
+  //! Block rows owned by a socket
+  Range xGroup(unsigned socket) const {
+    return galois::block_range(size_t{0}, numX, socket, numSockets);
+  }
+
+  //! Block columns owned by a socket
+  Range yGroup(unsigned socket) const {
+    return galois::block_range(size_t{0}, numY, socket, numSockets);
+  }
+
+  //! Column group a socket works on in a round
+  unsigned column(unsigned socket, unsigned round) const {
+    return (socket + round) % numSockets;
+  }
+
+  //! Socket owning block row x
+  unsigned xOwner(size_t x) const { return blockOf(x, numX, numSockets); }
+
+  //! Socket owning block column y
+  unsigned yOwner(size_t y) const { return blockOf(y, numY, numSockets); }
+};
+
 template <typename Graph, bool UseExp = false>
 class Fixed2DGraphTiledExecutor {
   static constexpr int numDims = 2; // code is specialized to 2
@@ -86,7 +143,9 @@ class Fixed2DGraphTiledExecutor {
   size_t numTasks;
   unsigned maxUpdates;
   bool useLocks;
+  bool numaAware;
   galois::GAccumulator<unsigned> failedProbes;
+  galois::GAccumulator<size_t> crossSocketTiles;
 
   /**
    * Advance point p in the specified dimension by delta and account for
@@ -577,6 +636,128 @@ class Fixed2DGraphTiledExecutor {
     }
   }
 
+  /**
+   * Claim a task for its next update if it has fewer than target updates.
+   * With locks, a claimed task is **returned with the lock**.
+   *
+   * @returns true if the task was claimed
+   */
+  bool tryClaim(Task* t, unsigned target) {
+    if (t->updates.relaxedLoad() >= target)
+      return false;
+
+    if (!useLocks) {
+      unsigned cur = t->updates.relaxedLoad();
+      while (cur < target) {
+        if (t->updates.value.compare_exchange_weak(cur, cur + 1))
+          return true;
+      }
+      return false;
+    }
+
+    if (std::try_lock(locks[0][t->coord[0]], locks[1][t->coord[1]]) < 0) {
+      if (t->updates.relaxedLoad() < target) {
+        t->updates.relaxedAdd(1);
+        return true;
+      }
+      for (int i = 0; i < numDims; ++i)
+        locks[i][t->coord[i]].unlock();
+    }
+    return false;
+  }
+
+  /**
+   * Bring every task in the stratum xr x yr to target updates, starting the
+   * scan at offset. Returns once every task of the stratum has been claimed,
+   * by this thread or by others.
+   *
+   * @returns number of tasks executed by this thread
+   */
+  template <bool UseDense, typename Function>
+  size_t executeStratum(Function& fn, SocketDiagonalSchedule::Range xr,
+                        SocketDiagonalSchedule::Range yr, unsigned target,
+                        size_t offset) {
+    const size_t width = xr.second - xr.first;
+    const size_t n     = width * (yr.second - yr.first);
+    size_t executed    = 0;
+
+    for (bool pending = n > 0; pending;) {
+      pending = false;
+      for (size_t i = 0; i < n; ++i) {
+        size_t k = (offset + i) % n;
+        Task* t  = getTask(Point{{xr.first + k % width, yr.first + k / width}});
+        if (t->updates.relaxedLoad() >= target)
+          continue;
+        pending = true;
+        if (!tryClaim(t, target))
+          continue;
+
+        executeBlock<UseDense>(fn, *t);
+        executed += 1;
+
+        if (useLocks) {
+          for (int d = 0; d < numDims; ++d)
+            locks[d][t->coord[d]].unlock();
+        }
+      }
+    }
+
+    return executed;
+  }
+
+  /**
+   * NUMA-aware execution with a socket-affine rotating diagonal schedule.
+   *
+   * Threads work on the stratum of their socket in each round (see
+   * SocketDiagonalSchedule), so the block rows a socket updates stay on that
+   * socket and no two sockets share a block row or column in a round. A
+   * thread that runs out of local work helps the other strata of the round;
+   * such cross-socket tile moves are counted. Rounds are separated by a
+   * barrier.
+   *
+   * @tparam UseDense dense update (all nodes in block update with all other
+   * nodes) or sparse update (update only if edge exists)
+   * @tparam Type of function specifying how to do update between nodes
+   *
+   * @param fn Function used to update nodes
+   * @param tid Thread id
+   * @param total Total number of threads
+   */
+  template <bool UseDense, typename Function>
+  void executeLoopNuma(Function fn, unsigned tid, unsigned total) {
+    auto& tp = galois::substrate::getThreadPool();
+    SocketDiagonalSchedule schedule(locks[0].size(), locks[1].size(), total);
+    const unsigned socket  = tp.getSocket(tid);
+    const unsigned sockets = schedule.rounds();
+
+    // spread the threads of a socket over its stratum
+    unsigned rank  = 0;
+    unsigned peers = 0;
+    for (unsigned i = 0; i < total; ++i) {
+      if (tp.getSocket(i) == socket) {
+        rank += i < tid;
+        peers += 1;
+      }
+    }
+
+    for (unsigned target = 1; target <= maxUpdates; ++target) {
+      for (unsigned round = 0; round < sockets; ++round) {
+        for (unsigned k = 0; k < sockets; ++k) {
+          unsigned s = (socket + k) % sockets;
+          auto xr    = schedule.xGroup(s);
+          auto yr    = schedule.yGroup(schedule.column(s, round));
+          size_t n   = (xr.second - xr.first) * (yr.second - yr.first);
+          size_t done =
+              executeStratum<UseDense>(fn, xr, yr, target, n * rank / peers);
+          if (k != 0)
+            crossSocketTiles += done;
+        }
+
+        barrier.wait();
+      }
+    }
+  }
+
   /**
    * Wrapper for calling a loop executor function.
    * @tparam UseDense dense update (all nodes in block update with all other
@@ -592,7 +773,10 @@ class Fixed2DGraphTiledExecutor {
     // if (false && UseExp)
     //  executeLoopExp2<UseDense>(fn, tid, total);
     // else
-    executeLoopOrig<UseDense>(fn, tid, total);
+    if (numaAware)
+      executeLoopNuma<UseDense>(fn, tid, total);
+    else
+      executeLoopOrig<UseDense>(fn, tid, total);
   }
 
   /**
@@ -663,11 +847,53 @@ public:
         barrier(galois::runtime::getBarrier(galois::getActiveThreads())) {}
 
   /**
-   * Report the number of probe block failures to statistics.
+   * Report the number of probe block failures and of tiles executed away
+   * from their socket to statistics.
    */
   ~Fixed2DGraphTiledExecutor() {
     galois::runtime::reportStat_Single("TiledExecutor", "ProbeFailures",
                                        failedProbes.reduce());
+    galois::runtime::reportStat_Single("TiledExecutor", "CrossSocketTiles",
+                                       crossSocketTiles.reduce());
+  }
+
+  /**
+   * Sockets owning the X and Y elements of a grid in NUMA-aware mode.
+   */
+  struct SocketPlacement {
+    SocketDiagonalSchedule schedule;
+    size_t numX;
+    size_t numY;
+    size_t numXBlocks;
+    size_t numYBlocks;
+
+    //! Socket owning the element at offset x from firstX
+    unsigned xSocket(size_t x) const {
+      return schedule.xOwner(
+          SocketDiagonalSchedule::blockOf(x, numX, numXBlocks));
+    }
+
+    //! Socket owning the element at offset y from firstY
+    unsigned ySocket(size_t y) const {
+      return schedule.yOwner(
+          SocketDiagonalSchedule::blockOf(y, numY, numYBlocks));
+    }
+  };
+
+  /**
+   * Placement of the elements of a grid in NUMA-aware mode, so callers can
+   * put the data of each block on the socket that will update it. Arguments
+   * are the same as for execute.
+   */
+  static SocketPlacement socketPlacement(iterator firstX, iterator lastX,
+                                         iterator firstY, iterator lastY,
+                                         size_t sizeX, size_t sizeY) {
+    const size_t numX       = std::distance(firstX, lastX);
+    const size_t numY       = std::distance(firstY, lastY);
+    const size_t numXBlocks = (numX + sizeX - 1) / sizeX;
+    const size_t numYBlocks = (numY + sizeY - 1) / sizeY;
+    return SocketPlacement{SocketDiagonalSchedule(numXBlocks, numYBlocks),
+                           numX, numY, numXBlocks, numYBlocks};
   }
 
   /**
@@ -687,15 +913,18 @@ public:
    * @param _useLocks true if locks are desired when updating blocks
    * @param numIterations Max number of iterations to run each block in the
    * tiled executor for
+   * @param _numaAware true to use the socket-affine rotating diagonal
+   * schedule instead of dynamic assignment
    */
   template <typename Function>
   void execute(iterator firstX, iterator lastX, iterator firstY, iterator lastY,
                size_t sizeX, size_t sizeY, Function fn, bool _useLocks,
-               unsigned numIterations = 1) {
+               unsigned numIterations = 1, bool _numaAware = false) {
     initializeTasks(firstX, lastX, firstY, lastY, sizeX, sizeY);
     numTasks   = tasks.size();
     maxUpdates = numIterations;
     useLocks   = _useLocks;
+    numaAware  = _numaAware;
 
     Process<false, Function> p{this, fn};
 
@@ -725,15 +954,19 @@ public:
    * @param _useLocks true if locks are desired when updating blocks
    * @param numIterations Max number of iterations to run each block in the
    * tiled executor for
+   * @param _numaAware true to use the socket-affine rotating diagonal
+   * schedule instead of dynamic assignment
    */
   template <typename Function>
   void executeDense(iterator firstX, iterator lastX, iterator firstY,
                     iterator lastY, size_t sizeX, size_t sizeY, Function fn,
-                    bool _useLocks, int numIterations = 1) {
+                    bool _useLocks, int numIterations = 1,
+                    bool _numaAware = false) {
     initializeTasks(firstX, lastX, firstY, lastY, sizeX, sizeY);
     numTasks   = tasks.size();
     maxUpdates = numIterations;
     useLocks   = _useLocks;
+    numaAware  = _numaAware;
     Process<true, Function> p{this, fn};
     galois::on_each(p);
 
@@ -19,19 +19,25 @@
 
 #include "galois/Galois.h"
 #include "galois/AtomicHelpers.h"
+#include "galois/LargeArray.h"
 #include "galois/Reduction.h"
 #include "galois/PriorityQueue.h"
 #include "galois/Timer.h"
 #include "galois/Timer.h"
 #include "galois/graphs/LCGraph.h"
 #include "galois/graphs/TypeTraits.h"
+#include "galois/substrate/PerThreadStorage.h"
 #include "llvm/Support/CommandLine.h"
 
 #include "Lonestar/BoilerPlate.h"
 #include "astar.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <vector>
 
 namespace cll = llvm::cl;
 
@@ -56,6 +62,19 @@ static cll::opt<unsigned int>
     stepShift("delta",
               cll::desc("Shift value for the deltastep (default value 13)"),
               cll::init(13));
+static cll::opt<std::string> queryFile(
+    "queryFile",
+    cll::desc("Answer the source-target pairs in this file, one per line "
+              "(- for stdin), instead of a single query"),
+    cll::init(""));
+static cll::opt<std::string>
+    queryOutput("queryOutput",
+                cll::desc("File to write query batch distances to"),
+                cll::init(""));
+static cll::opt<bool> bidirectional(
+    "bidirectional",
+    cll::desc("Use bidirectional search for query batches (default false)"),
+    cll::init(false));
 
 enum Algo {
   deltaStep,
@@ -148,8 +167,8 @@ uint64_t dist(Graph& graph, const GNode srcNode, const GNode dstNode) {
     // Use the haversine formula to compute the great-angle radians
     SNode* src = &graph.getData(srcNode);
     SNode* dst = &graph.getData(dstNode);
-    double latS = std::sin(src->lat - dst->lat);
-    double lonS = std::sin(src->lon - dst->lon);
+    double latS = std::sin((src->lat - dst->lat) / 2);
+    double lonS = std::sin((src->lon - dst->lon) / 2);
     double a = latS*latS + lonS*lonS*std::cos(src->lat)*std::cos(dst->lat);
     double c = 2*std::atan2(std::sqrt(a), std::sqrt(1-a));
 
@@ -371,6 +390,288 @@ void dijkstraAlgo(Graph& graph, const GNode& source) {
   galois::runtime::reportStat_Single("SSSP-Dijkstra", "Iterations", iter);
 }
 
+//! Reverse adjacency, used by the backward half of bidirectional queries
+struct ReverseGraph {
+  galois::LargeArray<uint64_t> offsets;
+  galois::LargeArray<uint32_t> sources;
+  galois::LargeArray<uint64_t> weights;
+
+  void build(Graph& graph) {
+    size_t numNodes = graph.size();
+    galois::LargeArray<uint64_t> cursor;
+    cursor.create(numNodes);
+    offsets.create(numNodes + 1);
+    sources.allocateInterleaved(graph.sizeEdges());
+    weights.allocateInterleaved(graph.sizeEdges());
+
+    galois::do_all(galois::iterate(graph), [&](GNode src) {
+      for (auto ii : graph.edges(src, galois::MethodFlag::UNPROTECTED))
+        __sync_fetch_and_add(&cursor[graph.getEdgeDst(ii)], 1);
+    });
+    for (size_t n = 0; n < numNodes; ++n) {
+      offsets[n + 1] = offsets[n] + cursor[n];
+      cursor[n]      = offsets[n];
+    }
+    galois::do_all(galois::iterate(graph), [&](GNode src) {
+      for (auto ii : graph.edges(src, galois::MethodFlag::UNPROTECTED)) {
+        uint64_t pos = __sync_fetch_and_add(&cursor[graph.getEdgeDst(ii)], 1);
+        sources[pos] = src;
+        weights[pos] = graph.getEdgeData(ii);
+      }
+    });
+  }
+};
+
+/**
+ * Per-thread search state for query batches. Labels carry the stamp of the
+ * query that wrote them, so starting a query only bumps the stamp instead of
+ * resetting a distance for every node.
+ */
+struct QueryState {
+  static constexpr uint64_t INF = std::numeric_limits<uint64_t>::max();
+
+  struct Label {
+    uint64_t dist;
+    uint32_t stamp;
+  };
+
+  struct Entry {
+    uint64_t key;
+    uint64_t dist;
+    GNode n;
+    bool operator>(const Entry& rhs) const { return key > rhs.key; }
+  };
+
+  std::vector<Label> labels[2];
+  std::vector<Entry> heaps[2];
+  uint32_t stamp = 0;
+
+  void begin(size_t numNodes) {
+    for (auto& l : labels) {
+      if (l.size() != numNodes) {
+        l.assign(numNodes, Label{INF, 0});
+        stamp = 0;
+      }
+    }
+    if (++stamp == 0) {
+      for (auto& l : labels)
+        std::fill(l.begin(), l.end(), Label{INF, 0});
+      stamp = 1;
+    }
+    for (auto& h : heaps)
+      h.clear();
+  }
+
+  uint64_t get(int side, GNode n) const {
+    const Label& l = labels[side][n];
+    return l.stamp == stamp ? l.dist : INF;
+  }
+
+  void set(int side, GNode n, uint64_t d) { labels[side][n] = Label{d, stamp}; }
+
+  void push(int side, const Entry& e) {
+    heaps[side].push_back(e);
+    std::push_heap(heaps[side].begin(), heaps[side].end(),
+                   std::greater<Entry>());
+  }
+
+  Entry pop(int side) {
+    std::pop_heap(heaps[side].begin(), heaps[side].end(),
+                  std::greater<Entry>());
+    Entry e = heaps[side].back();
+    heaps[side].pop_back();
+    return e;
+  }
+};
+
+/**
+ * Point-to-point A*. Labels may be corrected after a node is expanded, so the
+ * result stays exact when rounding makes the heuristic slightly inconsistent.
+ * Without the heuristic this is Dijkstra's algorithm.
+ */
+template <bool UseHeuristic>
+uint64_t pointToPoint(Graph& graph, QueryState& st, GNode source,
+                      GNode target) {
+  st.begin(graph.size());
+  st.set(0, source, 0);
+  st.push(0, {UseHeuristic ? dist(graph, source, target) : 0, 0, source});
+
+  while (!st.heaps[0].empty()) {
+    QueryState::Entry e = st.pop(0);
+    if (e.dist > st.get(0, e.n))
+      continue;
+    if (e.key >= st.get(0, target))
+      break;
+    for (auto ii : graph.edges(e.n, galois::MethodFlag::UNPROTECTED)) {
+      GNode dst   = graph.getEdgeDst(ii);
+      uint64_t nd = e.dist + graph.getEdgeData(ii);
+      if (nd < st.get(0, dst)) {
+        st.set(0, dst, nd);
+        st.push(0, {nd + (UseHeuristic ? dist(graph, dst, target) : 0), nd,
+                    dst});
+      }
+    }
+  }
+  return st.get(0, target);
+}
+
+/**
+ * Bidirectional A*: the forward search is guided towards the target and the
+ * backward search, over the reverse graph, towards the source. The best
+ * meeting distance is kept as the searches touch each other's labels; once
+ * either queue key reaches it no shorter path remains.
+ */
+uint64_t bidirectionalPointToPoint(Graph& graph, ReverseGraph& reverse,
+                                   QueryState& st, GNode source,
+                                   GNode target) {
+  GNode goal[2] = {target, source};
+  uint64_t best = source == target ? 0 : QueryState::INF;
+
+  st.begin(graph.size());
+  st.set(0, source, 0);
+  st.set(1, target, 0);
+  st.push(0, {dist(graph, source, target), 0, source});
+  st.push(1, {dist(graph, target, source), 0, target});
+
+  auto relax = [&](int side, GNode n, uint64_t nd) {
+    if (nd >= st.get(side, n))
+      return;
+    st.set(side, n, nd);
+    st.push(side, {nd + dist(graph, n, goal[side]), nd, n});
+    uint64_t other = st.get(1 - side, n);
+    if (other != QueryState::INF)
+      best = std::min(best, nd + other);
+  };
+
+  while (!st.heaps[0].empty() && !st.heaps[1].empty()) {
+    // Either queue key bounds every path not yet seen
+    if (st.heaps[0].front().key >= best || st.heaps[1].front().key >= best)
+      break;
+    int side = st.heaps[0].size() <= st.heaps[1].size() ? 0 : 1;
+    QueryState::Entry e = st.pop(side);
+    if (e.dist > st.get(side, e.n))
+      continue;
+    if (side == 0) {
+      for (auto ii : graph.edges(e.n, galois::MethodFlag::UNPROTECTED))
+        relax(0, graph.getEdgeDst(ii), e.dist + graph.getEdgeData(ii));
+    } else {
+      for (uint64_t ii = reverse.offsets[e.n]; ii < reverse.offsets[e.n + 1];
+           ++ii)
+        relax(1, reverse.sources[ii], e.dist + reverse.weights[ii]);
+    }
+  }
+  return best;
+}
+
+std::vector<std::pair<GNode, GNode>> readQueries(Graph& graph) {
+  std::ifstream file;
+  if (queryFile != "-") {
+    file.open(queryFile);
+    if (!file.is_open())
+      GALOIS_DIE("could not open query file ", queryFile);
+  }
+  std::istream& in = queryFile == "-" ? std::cin : file;
+
+  std::vector<std::pair<GNode, GNode>> queries;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream ss(line);
+    uint64_t src, dst;
+    if (line.empty() || line[0] == '#' || !(ss >> src >> dst))
+      continue;
+    if (src >= graph.size() || dst >= graph.size())
+      GALOIS_DIE("query node out of range: ", line);
+    queries.emplace_back(src, dst);
+  }
+  return queries;
+}
+
+/**
+ * Query-batch mode: the graph stays resident and independent source-target
+ * queries are answered concurrently, one per thread at a time.
+ */
+void runQueries(Graph& graph) {
+  using Clock = std::chrono::steady_clock;
+
+  auto queries = readQueries(graph);
+  size_t numQueries = queries.size();
+  std::cout << "Answering " << numQueries << " queries"
+            << (bidirectional ? " with bidirectional search" : "") << "\n";
+
+  ReverseGraph reverse;
+  if (bidirectional)
+    reverse.build(graph);
+
+  galois::substrate::PerThreadStorage<QueryState> states;
+  std::vector<uint64_t> results(numQueries);
+  std::vector<uint64_t> latencies(numQueries);
+  std::atomic<size_t> next(0);
+
+  galois::StatTimer Tmain;
+  Tmain.start();
+  galois::on_each(
+      [&](unsigned, unsigned) {
+        QueryState& st = *states.getLocal();
+        for (size_t q; (q = next++) < numQueries;) {
+          auto start = Clock::now();
+          GNode s    = queries[q].first;
+          GNode t    = queries[q].second;
+          results[q] = bidirectional
+                           ? bidirectionalPointToPoint(graph, reverse, st, s, t)
+                           : pointToPoint<true>(graph, st, s, t);
+          latencies[q] = std::chrono::duration_cast<std::chrono::microseconds>(
+                             Clock::now() - start)
+                             .count();
+        }
+      },
+      galois::loopname("AstarQueries"));
+  Tmain.stop();
+
+  if (numQueries) {
+    std::vector<uint64_t> sorted(latencies);
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](unsigned p) {
+      return sorted[std::min(numQueries - 1, numQueries * p / 100)];
+    };
+    std::cout << "Query latency (us): p50 " << percentile(50) << " p90 "
+              << percentile(90) << " p99 " << percentile(99) << " max "
+              << sorted.back() << "\n";
+    const char* region = "AstarQueries";
+    galois::runtime::reportStat_Single(region, "Queries", numQueries);
+    galois::runtime::reportStat_Single(region, "LatencyP50", percentile(50));
+    galois::runtime::reportStat_Single(region, "LatencyP90", percentile(90));
+    galois::runtime::reportStat_Single(region, "LatencyP99", percentile(99));
+    galois::runtime::reportStat_Single(region, "LatencyMax", sorted.back());
+  }
+
+  if (!queryOutput.empty()) {
+    std::ofstream out(queryOutput);
+    for (size_t q = 0; q < numQueries; ++q) {
+      out << queries[q].first << " " << queries[q].second << " ";
+      if (results[q] == QueryState::INF)
+        out << "unreachable\n";
+      else
+        out << results[q] << "\n";
+    }
+  }
+
+  if (!skipVerify) {
+    galois::GAccumulator<size_t> mismatches;
+    galois::do_all(
+        galois::iterate(size_t{0}, numQueries),
+        [&](size_t q) {
+          QueryState& st = *states.getLocal();
+          if (pointToPoint<false>(graph, st, queries[q].first,
+                                  queries[q].second) != results[q])
+            mismatches += 1;
+        },
+        galois::steal(), galois::loopname("VerifyQueries"));
+    if (mismatches.reduce())
+      GALOIS_DIE(mismatches.reduce(), " queries differ from Dijkstra");
+    std::cout << "Verification successful.\n";
+  }
+}
+
 uint64_t neighDist(Graph& graph, GNode& v, GNode& w) {
 
     for (Graph::edge_iterator
@@ -567,6 +868,12 @@ int main(int argc, char** argv) {
                    approxNodeData / galois::runtime::pagePoolSize());
   galois::reportPageAlloc("MeminfoPre");
 
+  if (!queryFile.empty()) {
+    runQueries(graph);
+    galois::reportPageAlloc("MeminfoPost");
+    return 0;
+  }
+
   if (algo == deltaStep || algo == serDelta) {
     std::cout << "INFO: Using delta-step of " << (1 << stepShift) << "\n";
     std::cout
@@ -21,18 +21,22 @@
 #include "galois/Timer.h"
 #include "galois/Bag.h"
 #include "galois/Reduction.h"
+#include "galois/LargeArray.h"
 #include "Lonestar/BoilerPlate.h"
 #include "galois/runtime/Profile.h"
 
 #include <boost/math/constants/constants.hpp>
 #include <boost/iterator/transform_iterator.hpp>
 
+#include <algorithm>
 #include <array>
 #include <limits>
 #include <iostream>
 #include <fstream>
 #include <random>
 #include <deque>
+#include <memory>
+#include <vector>
 
 #include <strings.h>
 
@@ -54,6 +58,27 @@ static llvm::cl::opt<int> seed("seed",
                                llvm::cl::desc("Random seed (default value 7)"),
                                llvm::cl::init(7));
 
+enum Algo { pointer, morton };
+
+static llvm::cl::opt<Algo> algo(
+    "algo", llvm::cl::desc("Choose an algorithm:"),
+    llvm::cl::values(
+        clEnumValN(Algo::pointer, "pointer", "Pointer-based octree (default)"),
+        clEnumValN(Algo::morton, "morton",
+                   "Morton-sorted linearized octree with grouped walks"),
+        clEnumValEnd),
+    llvm::cl::init(Algo::pointer));
+static llvm::cl::opt<unsigned>
+    leafSize("leafSize",
+             llvm::cl::desc("Maximum number of bodies in a leaf of the "
+                            "morton octree (default value 8)"),
+             llvm::cl::init(8));
+static llvm::cl::opt<unsigned>
+    groupSize("groupSize",
+              llvm::cl::desc("Maximum number of bodies sharing one tree walk "
+                             "in the morton algorithm (default value 64)"),
+              llvm::cl::init(64));
+
 struct Node {
   Point pos;
   double mass;
@@ -470,6 +495,449 @@ double checkAllPairs(Bodies& bodies, int N) {
          N;
 }
 
+/**
+ * Spreads the low 21 bits of v so that there are two zero bits between each
+ * pair of original bits.
+ */
+inline uint64_t spreadBits(uint64_t v) {
+  v &= 0x1fffff;
+  v = (v | v << 32) & 0x1f00000000ffffULL;
+  v = (v | v << 16) & 0x1f0000ff0000ffULL;
+  v = (v | v << 8) & 0x100f00f00f00f00fULL;
+  v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+  v = (v | v << 2) & 0x1249249249249249ULL;
+  return v;
+}
+
+/**
+ * Parallel LSD radix sort of keys together with their values. Each pass
+ * counts one byte of the keys per thread block, turns the counts into
+ * offsets (digit major, then thread order, which keeps the sort stable) and
+ * scatters into the temporaries. Passes in which all keys share the same
+ * byte are skipped.
+ */
+template <typename V>
+void radixSort(galois::LargeArray<uint64_t>& keys, galois::LargeArray<V>& vals,
+               galois::LargeArray<uint64_t>& tmpKeys,
+               galois::LargeArray<V>& tmpVals, size_t n, unsigned bits) {
+  constexpr unsigned Radix = 256;
+  std::vector<std::array<size_t, Radix>> counts(galois::getActiveThreads());
+
+  for (unsigned shift = 0; shift < bits; shift += 8) {
+    galois::on_each([&](unsigned tid, unsigned total) {
+      auto& c = counts[tid];
+      c.fill(0);
+      auto r = galois::block_range(size_t{0}, n, tid, total);
+      for (size_t i = r.first; i < r.second; ++i)
+        ++c[(keys[i] >> shift) & (Radix - 1)];
+    });
+
+    size_t sum   = 0;
+    bool trivial = false;
+    for (unsigned d = 0; d < Radix; ++d) {
+      size_t start = sum;
+      for (auto& c : counts) {
+        size_t num = c[d];
+        c[d]       = sum;
+        sum += num;
+      }
+      trivial |= sum - start == n;
+    }
+    if (trivial)
+      continue;
+
+    galois::on_each([&](unsigned tid, unsigned total) {
+      auto& c = counts[tid];
+      auto r  = galois::block_range(size_t{0}, n, tid, total);
+      for (size_t i = r.first; i < r.second; ++i) {
+        size_t pos    = c[(keys[i] >> shift) & (Radix - 1)]++;
+        tmpKeys[pos] = keys[i];
+        tmpVals[pos] = vals[i];
+      }
+    });
+    std::swap(keys, tmpKeys);
+    std::swap(vals, tmpVals);
+  }
+}
+
+/**
+ * Barnes-Hut over a linearized octree.
+ *
+ * Bodies are sorted by the Morton code of their position, so every octree
+ * cell is a contiguous range of bodies. Nodes are laid out in preorder as
+ * structure-of-arrays, and skip[i] is the index just past the subtree of
+ * node i; a walk is a forward scan that either descends (i + 1) or skips a
+ * subtree, with no pointers or stack. Forces are computed for groups of
+ * Morton-adjacent bodies: one walk against the bounding box of the group
+ * produces an interaction list that is valid for every body of the group,
+ * and the list is evaluated with a branch-free loop over contiguous arrays
+ * that the compiler vectorizes.
+ */
+class MortonTree {
+  static constexpr unsigned MaxDepth = 21; // bits per dimension of a code
+
+  struct Subtree {
+    size_t first;
+    size_t last;
+    unsigned depth;
+    bool top; // expanded serially, otherwise built by one task
+    size_t pos;
+    size_t size;
+  };
+
+  //! Bodies or cells that a group of bodies interacts with
+  struct InteractionList {
+    std::vector<double> x, y, z, mass;
+
+    void clear() {
+      x.clear();
+      y.clear();
+      z.clear();
+      mass.clear();
+    }
+
+    void push(double px, double py, double pz, double m) {
+      x.push_back(px);
+      y.push_back(py);
+      z.push_back(pz);
+      mass.push_back(m);
+    }
+  };
+
+  size_t numBodies = 0;
+  size_t numNodes  = 0;
+
+  galois::LargeArray<uint64_t> codes;
+  galois::LargeArray<uint64_t> tmpCodes;
+  galois::LargeArray<Body*> order;
+  galois::LargeArray<Body*> tmpOrder;
+  // bodies in Morton order
+  galois::LargeArray<double> bodyX, bodyY, bodyZ, bodyMass;
+  // nodes in preorder; a node covers bodies [first, last)
+  galois::LargeArray<double> nodeX, nodeY, nodeZ, nodeMass;
+  galois::LargeArray<uint32_t> skip, first, last;
+  galois::LargeArray<uint8_t> depth;
+
+  std::array<double, MaxDepth + 1> dsqOf;
+  galois::substrate::PerThreadStorage<InteractionList> lists;
+
+  template <typename T>
+  static void reserve(galois::LargeArray<T>& a, size_t n) {
+    if (a.size() < n) {
+      a.deallocate();
+      a.allocateBlocked(n);
+    }
+  }
+
+  static unsigned octant(uint64_t code, unsigned d) {
+    return (code >> (3 * (MaxDepth - 1 - d))) & 7;
+  }
+
+  bool isLeaf(size_t b, size_t e, unsigned d) const {
+    return e - b <= leafSize || d == MaxDepth;
+  }
+
+  //! Calls fn(b, e) for the body range of every non-empty child
+  template <typename Fn>
+  void forChildren(size_t b, size_t e, unsigned d, Fn fn) const {
+    while (b < e) {
+      unsigned o = octant(codes[b], d);
+      size_t c   = std::partition_point(
+                     &codes[b], &codes[0] + e,
+                     [&](uint64_t code) { return octant(code, d) == o; }) -
+                 &codes[0];
+      fn(b, c);
+      b = c;
+    }
+  }
+
+  size_t countNodes(size_t b, size_t e, unsigned d) const {
+    if (isLeaf(b, e, d))
+      return 1;
+    size_t n = 1;
+    forChildren(b, e, d,
+                [&](size_t cb, size_t ce) { n += countNodes(cb, ce, d + 1); });
+    return n;
+  }
+
+  void setNode(size_t pos, size_t b, size_t e, unsigned d) {
+    first[pos] = b;
+    last[pos]  = e;
+    depth[pos] = d;
+  }
+
+  //! Writes the subtree over bodies [b, e) at pos; returns its end
+  size_t fill(size_t b, size_t e, unsigned d, size_t pos) {
+    setNode(pos, b, e, d);
+    size_t next = pos + 1;
+    if (!isLeaf(b, e, d)) {
+      forChildren(b, e, d, [&](size_t cb, size_t ce) {
+        next = fill(cb, ce, d + 1, next);
+      });
+    }
+    skip[pos] = next;
+    return next;
+  }
+
+  void collect(size_t b, size_t e, unsigned d, unsigned splitDepth,
+               std::vector<Subtree>& subtrees) const {
+    bool top = !isLeaf(b, e, d) && d < splitDepth;
+    subtrees.push_back(Subtree{b, e, d, top, 0, 1});
+    if (top) {
+      forChildren(b, e, d, [&](size_t cb, size_t ce) {
+        collect(cb, ce, d + 1, splitDepth, subtrees);
+      });
+    }
+  }
+
+  //! Center of mass of node i, whose children are already summarized
+  void summarize(size_t i) {
+    double m = 0.0, x = 0.0, y = 0.0, z = 0.0;
+    if (skip[i] == i + 1) {
+      for (size_t j = first[i]; j < last[i]; ++j) {
+        m += bodyMass[j];
+        x += bodyX[j] * bodyMass[j];
+        y += bodyY[j] * bodyMass[j];
+        z += bodyZ[j] * bodyMass[j];
+      }
+    } else {
+      for (size_t c = i + 1; c < skip[i]; c = skip[c]) {
+        m += nodeMass[c];
+        x += nodeX[c] * nodeMass[c];
+        y += nodeY[c] * nodeMass[c];
+        z += nodeZ[c] * nodeMass[c];
+      }
+    }
+    nodeMass[i] = m;
+    if (m > 0.0) {
+      nodeX[i] = x / m;
+      nodeY[i] = y / m;
+      nodeZ[i] = z / m;
+    }
+  }
+
+  //! Builds the interaction list shared by the bodies of node g
+  void walk(size_t g, InteractionList& list) const {
+    double lo[3] = {bodyX[first[g]], bodyY[first[g]], bodyZ[first[g]]};
+    double hi[3] = {lo[0], lo[1], lo[2]};
+    for (size_t j = first[g] + 1; j < last[g]; ++j) {
+      double p[3] = {bodyX[j], bodyY[j], bodyZ[j]};
+      for (int k = 0; k < 3; ++k) {
+        lo[k] = std::min(lo[k], p[k]);
+        hi[k] = std::max(hi[k], p[k]);
+      }
+    }
+
+    list.clear();
+    size_t i = 0;
+    while (i < numNodes) {
+      // squared distance from the center of mass to the group's box
+      double p[3] = {nodeX[i], nodeY[i], nodeZ[i]};
+      double psq  = 0.0;
+      for (int k = 0; k < 3; ++k) {
+        double d = std::max(std::max(lo[k] - p[k], p[k] - hi[k]), 0.0);
+        psq += d * d;
+      }
+
+      if (psq >= dsqOf[depth[i]]) {
+        list.push(p[0], p[1], p[2], nodeMass[i]);
+        i = skip[i];
+      } else if (skip[i] == i + 1) {
+        for (size_t j = first[i]; j < last[i]; ++j)
+          list.push(bodyX[j], bodyY[j], bodyZ[j], bodyMass[j]);
+        ++i;
+      } else {
+        ++i;
+      }
+    }
+  }
+
+  /**
+   * Acceleration of a body at (px, py, pz) from every entry of the list.
+   * The body itself may be on the list; its delta is zero, so softening
+   * makes its contribution vanish without a branch.
+   */
+  static Point evaluate(const InteractionList& list, double px, double py,
+                        double pz) {
+    const double* __restrict__ x    = list.x.data();
+    const double* __restrict__ y    = list.y.data();
+    const double* __restrict__ z    = list.z.data();
+    const double* __restrict__ mass = list.mass.data();
+    const size_t num                = list.x.size();
+    const double epssq              = config.epssq;
+
+    double ax = 0.0, ay = 0.0, az = 0.0;
+    for (size_t j = 0; j < num; ++j) {
+      double dx    = px - x[j];
+      double dy    = py - y[j];
+      double dz    = pz - z[j];
+      // single precision square root as in updateForce
+      float psq    = dx * dx + dy * dy + dz * dz + epssq;
+      double idr   = 1.0f / std::sqrt(psq);
+      double scale = mass[j] * idr * idr * idr;
+      ax += dx * scale;
+      ay += dy * scale;
+      az += dz * scale;
+    }
+    return Point(ax, ay, az);
+  }
+
+public:
+  explicit MortonTree(BodyPtrs& pBodies) {
+    numBodies = std::distance(pBodies.begin(), pBodies.end());
+    codes.allocateBlocked(numBodies);
+    tmpCodes.allocateBlocked(numBodies);
+    order.allocateBlocked(numBodies);
+    tmpOrder.allocateBlocked(numBodies);
+    bodyX.allocateBlocked(numBodies);
+    bodyY.allocateBlocked(numBodies);
+    bodyZ.allocateBlocked(numBodies);
+    bodyMass.allocateBlocked(numBodies);
+    std::copy(pBodies.begin(), pBodies.end(), order.begin());
+  }
+
+  size_t size() const { return numNodes; }
+
+  Point centerOfMass() const { return Point(nodeX[0], nodeY[0], nodeZ[0]); }
+
+  /**
+   * Sorts the bodies by Morton code within the bounding cube of box and
+   * builds the octree over them.
+   */
+  void build(const BoundingBox& box) {
+    Point origin = box.min;
+    double side  = 0.0;
+    for (int k = 0; k < 3; ++k)
+      side = std::max(side, box.max[k] - box.min[k]);
+    std::cerr << "DBG side " << side << " diam " << box.diameter() << "\n";
+    if (side <= 0.0)
+      side = 1.0;
+    for (unsigned d = 0; d <= MaxDepth; ++d) {
+      double cell = std::ldexp(side, -static_cast<int>(d));
+      dsqOf[d]    = cell * cell * config.itolsq;
+    }
+
+    galois::StatTimer T_sort("SortTime");
+    T_sort.start();
+    const double scale = std::ldexp(1.0, MaxDepth) / side;
+    const uint64_t maxCoord = (uint64_t{1} << MaxDepth) - 1;
+    galois::do_all(
+        galois::iterate(size_t{0}, numBodies),
+        [&](size_t i) {
+          uint64_t c[3];
+          for (int k = 0; k < 3; ++k) {
+            double q = (order[i]->pos[k] - origin[k]) * scale;
+            c[k] = std::min(static_cast<uint64_t>(std::max(q, 0.0)), maxCoord);
+          }
+          codes[i] = spreadBits(c[0]) | spreadBits(c[1]) << 1 |
+                     spreadBits(c[2]) << 2;
+        },
+        galois::loopname("MortonCodes"));
+    radixSort(codes, order, tmpCodes, tmpOrder, numBodies, 3 * MaxDepth);
+    galois::do_all(galois::iterate(size_t{0}, numBodies),
+                   [&](size_t i) {
+                     const Body* b = order[i];
+                     bodyX[i]      = b->pos[0];
+                     bodyY[i]      = b->pos[1];
+                     bodyZ[i]      = b->pos[2];
+                     bodyMass[i]   = b->mass;
+                   },
+                   galois::loopname("GatherBodies"));
+    T_sort.stop();
+
+    // Expand the top levels serially until there are enough subtrees to
+    // build in parallel; subtrees are sized first so that each one can be
+    // written into its own slice of the preorder arrays.
+    unsigned splitDepth = 1;
+    while ((1u << (3 * splitDepth)) < 16 * galois::getActiveThreads() &&
+           splitDepth < MaxDepth)
+      ++splitDepth;
+    std::vector<Subtree> subtrees;
+    collect(0, numBodies, 0, splitDepth, subtrees);
+
+    galois::do_all(galois::iterate(subtrees),
+                   [&](Subtree& t) {
+                     if (!t.top)
+                       t.size = countNodes(t.first, t.last, t.depth);
+                   },
+                   galois::loopname("CountNodes"), galois::steal());
+
+    numNodes = 0;
+    for (auto& t : subtrees) {
+      t.pos = numNodes;
+      numNodes += t.size;
+    }
+    reserve(nodeX, numNodes);
+    reserve(nodeY, numNodes);
+    reserve(nodeZ, numNodes);
+    reserve(nodeMass, numNodes);
+    reserve(skip, numNodes);
+    reserve(first, numNodes);
+    reserve(last, numNodes);
+    reserve(depth, numNodes);
+
+    // preorder places a top node's subtree up to the next subtree that is
+    // not deeper than it
+    std::vector<const Subtree*> open;
+    for (auto& t : subtrees) {
+      while (!open.empty() && open.back()->depth >= t.depth) {
+        skip[open.back()->pos] = t.pos;
+        open.pop_back();
+      }
+      if (t.top) {
+        setNode(t.pos, t.first, t.last, t.depth);
+        open.push_back(&t);
+      }
+    }
+    for (auto* t : open)
+      skip[t->pos] = numNodes;
+
+    galois::do_all(galois::iterate(subtrees),
+                   [&](const Subtree& t) {
+                     if (t.top)
+                       return;
+                     fill(t.first, t.last, t.depth, t.pos);
+                     for (size_t i = t.pos + t.size; i-- > t.pos;)
+                       summarize(i);
+                   },
+                   galois::loopname("FillTree"), galois::steal());
+    for (auto t = subtrees.rbegin(); t != subtrees.rend(); ++t)
+      if (t->top)
+        summarize(t->pos);
+  }
+
+  /**
+   * Computes accelerations of all bodies and updates their velocities the
+   * same way as ComputeForces::computeForce.
+   */
+  void computeForces() {
+    // groups are the largest subtrees with at most groupSize bodies
+    std::vector<uint32_t> groups;
+    for (size_t i = 0; i < numNodes;) {
+      if (last[i] - first[i] <= groupSize || skip[i] == i + 1) {
+        groups.push_back(i);
+        i = skip[i];
+      } else {
+        ++i;
+      }
+    }
+
+    galois::do_all(
+        galois::iterate(groups),
+        [&](uint32_t g) {
+          InteractionList& list = *lists.getLocal();
+          walk(g, list);
+          for (size_t j = first[g]; j < last[g]; ++j) {
+            Body* b = order[j];
+            Point p = b->acc;
+            b->acc  = evaluate(list, bodyX[j], bodyY[j], bodyZ[j]);
+            b->vel += (b->acc - p) * config.dthf;
+          }
+        },
+        galois::loopname("MortonCompute"), galois::steal());
+  }
+};
+
 void run(Bodies& bodies, BodyPtrs& pBodies, size_t nbodies) {
   typedef galois::worklists::PerSocketChunkLIFO<256> WL_;
   typedef galois::worklists::PerThreadChunkLIFO<32> WL;
@@ -480,6 +948,10 @@ void run(Bodies& bodies, BodyPtrs& pBodies, size_t nbodies) {
                        galois::runtime::pagePoolSize());
   galois::reportPageAlloc("MeminfoPre");
 
+  std::unique_ptr<MortonTree> mortonTree;
+  if (algo == Algo::morton)
+    mortonTree = std::make_unique<MortonTree>(pBodies);
+
   for (int step = 0; step < ntimesteps; step++) {
 
     auto MB = [](BoundingBox& lhs, const Point& rhs) { lhs.merge(rhs); };
@@ -494,37 +966,53 @@ void run(Bodies& bodies, BodyPtrs& pBodies, size_t nbodies) {
     BoundingBox box = boxes.reduce(
         [](BoundingBox& lhs, BoundingBox& rhs) { lhs.merge(rhs); });
 
-    Tree t;
-    BuildOctree treeBuilder{t};
-    Octree& top = t.emplace(box.center());
-
-    galois::StatTimer T_build("BuildTime");
-    T_build.start();
-    galois::do_all(
-        galois::iterate(pBodies),
-        [&](Body* body) { treeBuilder.insert(body, &top, box.radius()); },
-        galois::loopname("BuildTree"));
-    T_build.stop();
-
-    // update centers of mass in tree
-    galois::timeThis(
-        [&](void) {
-          unsigned size = computeCenterOfMass(&top);
-          // printTree(&top);
-          std::cout << "Tree Size: " << size << "\n";
-        },
-        "summarize-Serial");
-
-    ComputeForces cf(&top, box.diameter());
-
-    galois::StatTimer T_compute("ComputeTime");
-    T_compute.start();
-    galois::for_each(galois::iterate(pBodies),
-                     [&](Body* b, auto& cnx) { cf.computeForce(b, cnx); },
-                     galois::loopname("compute"), galois::wl<WLL>(),
-                     galois::no_conflicts(), galois::no_pushes(),
-                     galois::per_iter_alloc());
-    T_compute.stop();
+    Point com;
+    if (algo == Algo::morton) {
+      galois::StatTimer T_build("BuildTime");
+      T_build.start();
+      mortonTree->build(box);
+      T_build.stop();
+      std::cout << "Tree Size: " << mortonTree->size() << "\n";
+
+      galois::StatTimer T_compute("ComputeTime");
+      T_compute.start();
+      mortonTree->computeForces();
+      T_compute.stop();
+      com = mortonTree->centerOfMass();
+    } else {
+      Tree t;
+      BuildOctree treeBuilder{t};
+      Octree& top = t.emplace(box.center());
+
+      galois::StatTimer T_build("BuildTime");
+      T_build.start();
+      galois::do_all(
+          galois::iterate(pBodies),
+          [&](Body* body) { treeBuilder.insert(body, &top, box.radius()); },
+          galois::loopname("BuildTree"));
+      T_build.stop();
+
+      // update centers of mass in tree
+      galois::timeThis(
+          [&](void) {
+            unsigned size = computeCenterOfMass(&top);
+            // printTree(&top);
+            std::cout << "Tree Size: " << size << "\n";
+          },
+          "summarize-Serial");
+
+      ComputeForces cf(&top, box.diameter());
+
+      galois::StatTimer T_compute("ComputeTime");
+      T_compute.start();
+      galois::for_each(galois::iterate(pBodies),
+                       [&](Body* b, auto& cnx) { cf.computeForce(b, cnx); },
+                       galois::loopname("compute"), galois::wl<WLL>(),
+                       galois::no_conflicts(), galois::no_pushes(),
+                       galois::per_iter_alloc());
+      T_compute.stop();
+      com = top.pos;
+    }
 
     if (!skipVerify) {
       galois::timeThis(
@@ -551,7 +1039,7 @@ void run(Bodies& bodies, BodyPtrs& pBodies, size_t nbodies) {
     std::ios::fmtflags flags =
         std::cout.setf(std::ios::showpos | std::ios::right |
                        std::ios::scientific | std::ios::showpoint);
-    std::cout << top.pos;
+    std::cout << com;
     std::cout.flags(flags);
     std::cout << "\n";
   }
@@ -0,0 +1,160 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+#ifndef _APPROX_BC_H_
+#define _APPROX_BC_H_
+
+#include "galois/gIO.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/**
+ * Helpers for approximate betweenness centrality by adaptive source sampling.
+ *
+ * Sources are drawn uniformly at random and the Brandes dependencies of each
+ * sampled source are accumulated; scaling the sum by n / (number of samples)
+ * gives an unbiased estimate of BC. Sampling proceeds in geometrically growing
+ * rounds and stops either once the Hoeffding bound for (epsilon, delta) is
+ * reached or once the top-k ranking has not changed (up to a tolerance) for a
+ * number of consecutive rounds.
+ */
+namespace bc_approx {
+
+/**
+ * Number of sampled sources after which every normalized BC estimate
+ * (BC(v) / (n (n - 2))) is within epsilon of its true value with probability
+ * at least 1 - delta. Each per-source dependency divided by (n - 2) lies in
+ * [0, 1], so Hoeffding's inequality plus a union bound over all n nodes gives
+ * ln(2n / delta) / (2 epsilon^2) samples.
+ *
+ * @param numNodes number of nodes in the graph
+ * @param epsilon additive error on normalized BC
+ * @param delta failure probability
+ * @returns number of samples required by the bound
+ */
+inline uint64_t sampleBound(size_t numNodes, double epsilon, double delta) {
+  if (epsilon <= 0.0 || delta <= 0.0 || delta >= 1.0) {
+    GALOIS_DIE("approximate BC needs epsilon > 0 and 0 < delta < 1");
+  }
+  double n = std::max<double>(numNodes, 2);
+  return (uint64_t)std::ceil(std::log(2.0 * n / delta) /
+                             (2.0 * epsilon * epsilon));
+}
+
+/**
+ * Draws sample sources uniformly among the candidate nodes (usually nodes
+ * with outgoing edges). The i-th sample only depends on the seed and i so
+ * results are reproducible regardless of thread count.
+ */
+template <typename NodeTy>
+class SourceSampler {
+  const std::vector<NodeTy>& candidates;
+  uint64_t seed;
+  uint64_t drawn;
+
+public:
+  SourceSampler(const std::vector<NodeTy>& _candidates, uint64_t _seed)
+      : candidates(_candidates), seed(_seed), drawn(0) {}
+
+  //! Appends the next count samples to out
+  void nextBatch(uint64_t count, std::vector<NodeTy>& out) {
+    out.clear();
+    out.reserve(count);
+    std::uniform_int_distribution<size_t> dist(0, candidates.size() - 1);
+    for (uint64_t i = 0; i < count; ++i, ++drawn) {
+      std::mt19937_64 gen(seed ^ (drawn * 0x9E3779B97F4A7C15ull));
+      out.push_back(candidates[dist(gen)]);
+    }
+  }
+
+  uint64_t numDrawn() const { return drawn; }
+};
+
+/**
+ * Tracks the top-k ranking between sampling rounds and decides when it has
+ * converged.
+ */
+class TopKTracker {
+  unsigned k;
+  double tolerance;
+  unsigned roundsNeeded;
+  unsigned stableRounds;
+  std::vector<uint32_t> prevTop;
+  double lastOverlap;
+
+public:
+  /**
+   * @param _k number of top ranked nodes to track
+   * @param _tolerance fraction of the top-k set allowed to change between
+   * rounds while still counting the round as stable
+   * @param _roundsNeeded consecutive stable rounds required to stop
+   */
+  TopKTracker(unsigned _k, double _tolerance, unsigned _roundsNeeded)
+      : k(_k), tolerance(_tolerance), roundsNeeded(_roundsNeeded),
+        stableRounds(0), lastOverlap(0.0) {}
+
+  /**
+   * Compute the current top-k set from the given BC estimates and compare it
+   * to the set of the previous round.
+   *
+   * @returns true if the ranking has been stable for enough rounds
+   */
+  bool update(const std::vector<double>& bc) {
+    unsigned curK = std::min<size_t>(k, bc.size());
+    if (curK == 0) {
+      return true;
+    }
+
+    std::vector<uint32_t> ids(bc.size());
+    std::iota(ids.begin(), ids.end(), 0);
+    // ties broken by id so the ranking is deterministic
+    auto cmp = [&](uint32_t a, uint32_t b) {
+      return bc[a] > bc[b] || (bc[a] == bc[b] && a < b);
+    };
+    std::partial_sort(ids.begin(), ids.begin() + curK, ids.end(), cmp);
+    ids.resize(curK);
+    std::sort(ids.begin(), ids.end());
+
+    if (prevTop.size() == ids.size()) {
+      std::vector<uint32_t> common;
+      std::set_intersection(ids.begin(), ids.end(), prevTop.begin(),
+                            prevTop.end(), std::back_inserter(common));
+      lastOverlap = (double)common.size() / curK;
+      if (lastOverlap >= 1.0 - tolerance) {
+        stableRounds++;
+      } else {
+        stableRounds = 0;
+      }
+    }
+
+    prevTop = std::move(ids);
+    return stableRounds >= roundsNeeded;
+  }
+
+  double overlap() const { return lastOverlap; }
+};
+
+} // namespace bc_approx
+
+#endif
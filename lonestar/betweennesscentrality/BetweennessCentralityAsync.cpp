@@ -26,6 +26,7 @@
 
 #include "BCNode.h"
 #include "BCEdge.h"
+#include "ApproxBC.h"
 
 #include <iomanip>
 
@@ -69,6 +70,48 @@ static cll::opt<bool> generateCert("generateCertificate",
                                    cll::desc("Prints certificate at end of "
                                              "execution"),
                                    cll::init(false));
+static cll::opt<bool> approx("approx",
+                             cll::desc("Approximate BC by adaptive sampling "
+                                       "of sources instead of running all "
+                                       "sources"),
+                             cll::init(false));
+
+static cll::opt<double>
+    approxEpsilon("epsilon",
+                  cll::desc("Approximate mode: additive error bound on "
+                            "normalized BC (default 0.01)"),
+                  cll::init(0.01));
+
+static cll::opt<double>
+    approxDelta("delta",
+                cll::desc("Approximate mode: probability that the error "
+                          "bound does not hold (default 0.1)"),
+                cll::init(0.1));
+
+static cll::opt<unsigned int>
+    topK("topK",
+         cll::desc("Approximate mode: stop early once the top-k ranking is "
+                   "stable; 0 disables early stopping (default 100)"),
+         cll::init(100));
+
+static cll::opt<double>
+    topKTolerance("topKTolerance",
+                  cll::desc("Approximate mode: fraction of the top-k set "
+                            "allowed to change between stable rounds "
+                            "(default 0.01)"),
+                  cll::init(0.01));
+
+static cll::opt<unsigned int>
+    stableRounds("stableRounds",
+                 cll::desc("Approximate mode: consecutive stable rounds "
+                           "required before stopping early (default 2)"),
+                 cll::init(2));
+
+static cll::opt<unsigned int>
+    sampleSeed("sampleSeed", cll::desc("Approximate mode: seed for source "
+                                       "sampling"),
+               cll::init(0));
+
 // TODO bring this back
 // static cll::opt<bool> useNodeBased("useNodeBased",
 //                                   cll::desc("Use node based execution"),
@@ -495,19 +538,14 @@ int main(int argc, char** argv) {
 
   galois::gInfo("Beginning execution");
 
-  galois::StatTimer executionTimer;
-  executionTimer.start();
-  for (uint32_t i = startNode; i < numOfSources; ++i) {
-    uint32_t sourceToUse = i;
-    if (sourceVector.size() != 0) {
-      sourceToUse = sourceVector[i];
-    }
-
+  // runs BC for a single source; returns false if the source was skipped
+  // because it has no outgoing edges
+  auto processSource = [&](uint32_t sourceToUse) {
     // ignore nodes with no neighbors
     if (!std::distance(bcGraph.edge_begin(sourceToUse),
                        bcGraph.edge_end(sourceToUse))) {
       galois::gDebug(sourceToUse, " has no outgoing edges");
-      continue;
+      return false;
     }
 
     forwardPhaseWL.push_back(ForwardPhaseWorkItem(sourceToUse, 0));
@@ -531,12 +569,89 @@ int main(int argc, char** argv) {
     active.bc = backupSrcBC; // current source BC should not get updated
 
     backwardPhaseWL.clear();
+    return true;
+  };
+
+  galois::StatTimer executionTimer;
+  executionTimer.start();
+  if (approx) {
+    // candidate sources are the nodes with outgoing edges (restricted to the
+    // source file if one was given)
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = startNode; i < numOfSources; ++i) {
+      uint32_t n = sourceVector.size() ? sourceVector[i] : i;
+      if (bcGraph.edge_begin(n) != bcGraph.edge_end(n)) {
+        candidates.push_back(n);
+      }
+    }
+
+    uint64_t maxSamples =
+        candidates.empty()
+            ? 0
+            : bc_approx::sampleBound(nnodes, approxEpsilon, approxDelta);
+    galois::gInfo("Approximate mode: epsilon ", approxEpsilon, " delta ",
+                  approxDelta, " sample bound ", maxSamples);
+
+    bc_approx::SourceSampler<uint32_t> sampler(candidates, sampleSeed);
+    bc_approx::TopKTracker tracker(topK, topKTolerance, stableRounds);
+    std::vector<uint32_t> batch;
+    std::vector<double> estimate(nnodes);
+    uint64_t batchSize = 16;
+    unsigned rounds    = 0;
+    bool converged     = false;
+
+    // sources are processed one at a time (each source is parallel) so the
+    // rounds only decide how often the ranking is checked
+    while (sampler.numDrawn() < maxSamples) {
+      batchSize = std::min(batchSize, maxSamples - sampler.numDrawn());
+      sampler.nextBatch(batchSize, batch);
+      for (uint32_t src : batch) {
+        processSource(src);
+        goodSource++;
+      }
+      rounds++;
+
+      if (topK) {
+        galois::do_all(galois::iterate(0u, nnodes),
+                       [&](auto i) { estimate[i] = bcGraph.getData(i).bc; });
+        if (tracker.update(estimate)) {
+          converged = true;
+          break;
+        }
+      }
+      batchSize *= 2;
+    }
+
+    if (sampler.numDrawn()) {
+      double factor = (double)candidates.size() / sampler.numDrawn();
+      galois::do_all(galois::iterate(0u, nnodes),
+                     [&](auto i) { bcGraph.getData(i).bc *= factor; });
+    }
 
-    // break out once number of sources user specified to do (if any) has been
-    // reached
-    goodSource++;
-    if (numOfOutSources != 0 && goodSource >= numOfOutSources)
-      break;
+    galois::gInfo("Approximate mode: ", sampler.numDrawn(), " samples in ",
+                  rounds, " rounds", converged ? " (top-k stable)" : "");
+    galois::runtime::reportStat_Single("BC-Approx", "Samples",
+                                       sampler.numDrawn());
+    galois::runtime::reportStat_Single("BC-Approx", "Rounds", rounds);
+    galois::runtime::reportStat_Single("BC-Approx", "TopKStable",
+                                       converged ? 1 : 0);
+  } else {
+    for (uint32_t i = startNode; i < numOfSources; ++i) {
+      uint32_t sourceToUse = i;
+      if (sourceVector.size() != 0) {
+        sourceToUse = sourceVector[i];
+      }
+
+      if (!processSource(sourceToUse)) {
+        continue;
+      }
+
+      // break out once number of sources user specified to do (if any) has
+      // been reached
+      goodSource++;
+      if (numOfOutSources != 0 && goodSource >= numOfOutSources)
+        break;
+    }
   }
   executionTimer.stop();
 
@@ -23,6 +23,8 @@
 #include "llvm/Support/CommandLine.h"
 #include "Lonestar/BoilerPlate.h"
 
+#include "ApproxBC.h"
+
 #include <boost/iterator/filter_iterator.hpp>
 
 #include <iomanip>
@@ -51,6 +53,39 @@ static llvm::cl::opt<bool> forceVerify("forceVerify",
 static llvm::cl::opt<bool> printAll("printAll",
                                     llvm::cl::desc("Print betweenness values "
                                                    "for all nodes"));
+static llvm::cl::opt<bool>
+    approx("approx", llvm::cl::desc("Approximate BC by adaptive sampling of "
+                                    "sources instead of running all sources"),
+           llvm::cl::init(false));
+static llvm::cl::opt<double>
+    approxEpsilon("epsilon",
+            llvm::cl::desc("Approximate mode: additive error bound on "
+                           "normalized BC (default 0.01)"),
+            llvm::cl::init(0.01));
+static llvm::cl::opt<double>
+    approxDelta("delta",
+          llvm::cl::desc("Approximate mode: probability that the error bound "
+                         "does not hold (default 0.1)"),
+          llvm::cl::init(0.1));
+static llvm::cl::opt<unsigned int>
+    topK("topK",
+         llvm::cl::desc("Approximate mode: stop early once the top-k ranking "
+                        "is stable; 0 disables early stopping (default 100)"),
+         llvm::cl::init(100));
+static llvm::cl::opt<double> topKTolerance(
+    "topKTolerance",
+    llvm::cl::desc("Approximate mode: fraction of the top-k set allowed to "
+                   "change between stable rounds (default 0.01)"),
+    llvm::cl::init(0.01));
+static llvm::cl::opt<unsigned int> stableRounds(
+    "stableRounds",
+    llvm::cl::desc("Approximate mode: consecutive stable rounds required "
+                   "before stopping early (default 2)"),
+    llvm::cl::init(2));
+static llvm::cl::opt<unsigned int>
+    sampleSeed("sampleSeed",
+               llvm::cl::desc("Approximate mode: seed for source sampling"),
+               llvm::cl::init(0));
 
 using Graph = galois::graphs::LC_CSR_Graph<void, void>::with_no_lockable<
     true>::type ::with_numa_alloc<true>::type;
@@ -91,71 +126,56 @@ public:
     // Each thread works on an individual source node
     galois::do_all(
         galois::iterate(v),
-        [&](const GNode& curSource) {
-          galois::gdeque<GNode> SQ;
-
-          double* sigma               = *perThreadSigma.getLocal();
-          int* d                      = *perThreadD.getLocal();
-          double* delta               = *perThreadDelta.getLocal();
-          galois::gdeque<GNode>* succ = *perThreadSucc.getLocal();
-
-          sigma[curSource] = 1;
-          d[curSource]     = 1;
-
-          SQ.push_back(curSource);
-
-          // Do bfs while computing number of shortest paths (saved into sigma)
-          // and successors of nodes;
-          // Note this bfs makes it so source has distance of 1 instead of 0
-          for (auto qq = SQ.begin(), eq = SQ.end(); qq != eq; ++qq) {
-            int src = *qq;
-
-            for (auto edge : G->edges(src, galois::MethodFlag::UNPROTECTED)) {
-              int dest = G->getEdgeDst(edge);
-
-              if (!d[dest]) {
-                SQ.push_back(dest);
-                d[dest] = d[src] + 1;
-              }
-
-              if (d[dest] == d[src] + 1) {
-                sigma[dest] = sigma[dest] + sigma[src];
-                succ[src].push_back(dest);
-              }
-            }
-          }
-
-          // Back-propogate the dependency values (delta) along the BFS DAG
-          // ignore the source (hence SQ.size > 1 and not SQ.empty)
-          while (SQ.size() > 1) {
-            int leaf = SQ.back();
-            SQ.pop_back();
-
-            double sigma_leaf = sigma[leaf]; // has finalized short path value
-            double delta_leaf = delta[leaf];
-            auto& succ_list   = succ[leaf];
-
-            for (auto succ = succ_list.begin(), succ_end = succ_list.end();
-                 succ != succ_end; ++succ) {
-              delta_leaf += (sigma_leaf / sigma[*succ]) * (1.0 + delta[*succ]);
-            }
-            delta[leaf] = delta_leaf;
-          }
-
-          // save result of this source's BC, reset all local values for next
-          // source
-          double* Vec = *CB.getLocal();
-          for (int i = 0; i < NumNodes; ++i) {
-            Vec[i] += delta[i];
-            delta[i] = 0;
-            sigma[i] = 0;
-            d[i]     = 0;
-            succ[i].clear();
-          }
-        },
+        [&](const GNode& curSource) { processSource(curSource); },
         galois::steal(), galois::loopname("Main"));
   }
 
+  /**
+   * Runs betweeness-centrality on a batch of sampled sources. Sources may
+   * repeat; every occurrence contributes its dependencies again.
+   *
+   * @param v sampled sources to process
+   */
+  void runSampled(const std::vector<GNode>& v) {
+    galois::for_each(
+        galois::iterate(v),
+        [&](const GNode& curSource, auto&) { processSource(curSource); },
+        galois::no_pushes(), galois::no_conflicts(),
+        galois::loopname("Sampled"));
+  }
+
+  /**
+   * Sum the per-thread BC contributions of every node.
+   *
+   * @param out vector to store the summed contributions in; resized to the
+   * number of nodes
+   */
+  void gatherBC(std::vector<double>& out) {
+    out.resize(NumNodes);
+    galois::do_all(galois::iterate(0, NumNodes),
+                   [&](int i) {
+                     double bc = 0.0;
+                     for (unsigned j = 0; j < galois::getActiveThreads(); ++j)
+                       bc += (*CB.getRemote(j))[i];
+                     out[i] = bc;
+                   },
+                   galois::loopname("GatherBC"));
+  }
+
+  /**
+   * Scale all accumulated BC contributions by some factor; used to turn the
+   * sums over sampled sources into estimates of BC over all sources.
+   *
+   * @param factor value to multiply contributions by
+   */
+  void scale(double factor) {
+    galois::on_each([&](unsigned, unsigned) {
+      double* Vec = *CB.getLocal();
+      for (int i = 0; i < NumNodes; ++i)
+        Vec[i] *= factor;
+    });
+  }
+
   /**
    * Verification for reference torus graph inputs.
    * All nodes should have the same betweenness value up to
@@ -224,6 +244,75 @@ public:
   }
 
 private:
+  /**
+   * Computes the BC contributions of a single source with the thread's local
+   * arrays and adds them to the thread's BC measure.
+   *
+   * @param curSource source to compute BC contributions of
+   */
+  void processSource(const GNode& curSource) {
+    galois::gdeque<GNode> SQ;
+
+    double* sigma               = *perThreadSigma.getLocal();
+    int* d                      = *perThreadD.getLocal();
+    double* delta               = *perThreadDelta.getLocal();
+    galois::gdeque<GNode>* succ = *perThreadSucc.getLocal();
+
+    sigma[curSource] = 1;
+    d[curSource]     = 1;
+
+    SQ.push_back(curSource);
+
+    // Do bfs while computing number of shortest paths (saved into sigma)
+    // and successors of nodes;
+    // Note this bfs makes it so source has distance of 1 instead of 0
+    for (auto qq = SQ.begin(), eq = SQ.end(); qq != eq; ++qq) {
+      int src = *qq;
+
+      for (auto edge : G->edges(src, galois::MethodFlag::UNPROTECTED)) {
+        int dest = G->getEdgeDst(edge);
+
+        if (!d[dest]) {
+          SQ.push_back(dest);
+          d[dest] = d[src] + 1;
+        }
+
+        if (d[dest] == d[src] + 1) {
+          sigma[dest] = sigma[dest] + sigma[src];
+          succ[src].push_back(dest);
+        }
+      }
+    }
+
+    // Back-propogate the dependency values (delta) along the BFS DAG
+    // ignore the source (hence SQ.size > 1 and not SQ.empty)
+    while (SQ.size() > 1) {
+      int leaf = SQ.back();
+      SQ.pop_back();
+
+      double sigma_leaf = sigma[leaf]; // has finalized short path value
+      double delta_leaf = delta[leaf];
+      auto& succ_list   = succ[leaf];
+
+      for (auto succ = succ_list.begin(), succ_end = succ_list.end();
+           succ != succ_end; ++succ) {
+        delta_leaf += (sigma_leaf / sigma[*succ]) * (1.0 + delta[*succ]);
+      }
+      delta[leaf] = delta_leaf;
+    }
+
+    // save result of this source's BC, reset all local values for next
+    // source
+    double* Vec = *CB.getLocal();
+    for (int i = 0; i < NumNodes; ++i) {
+      Vec[i] += delta[i];
+      delta[i] = 0;
+      sigma[i] = 0;
+      d[i]     = 0;
+      succ[i].clear();
+    }
+  }
+
   /**
    * Initialize an array at some provided address.
    *
@@ -283,6 +372,64 @@ struct HasOut : public std::unary_function<GNode, bool> {
   }
 };
 
+/**
+ * Approximate BC by sampling sources from the candidate set in rounds of
+ * geometrically increasing size. Stops once the sample bound implied by
+ * epsilon/delta is reached or once the top-k ranking is stable.
+ *
+ * @param bcOuter BC executor to accumulate contributions into
+ * @param candidates nodes that may be sampled as sources
+ * @param numNodes number of nodes in the graph
+ */
+void runApprox(BCOuter& bcOuter, const std::vector<GNode>& candidates,
+               size_t numNodes) {
+  if (candidates.empty()) {
+    return;
+  }
+
+  uint64_t maxSamples =
+      bc_approx::sampleBound(numNodes, approxEpsilon, approxDelta);
+  galois::gPrint("Approximate mode: epsilon ", approxEpsilon, " delta ",
+                 approxDelta, " sample bound ", maxSamples, "\n");
+
+  bc_approx::SourceSampler<GNode> sampler(candidates, sampleSeed);
+  bc_approx::TopKTracker tracker(topK, topKTolerance, stableRounds);
+
+  std::vector<GNode> batch;
+  std::vector<double> estimate;
+  uint64_t batchSize =
+      std::max<uint64_t>(64, 4 * galois::getActiveThreads());
+  unsigned rounds = 0;
+  bool converged  = false;
+
+  while (sampler.numDrawn() < maxSamples) {
+    batchSize = std::min(batchSize, maxSamples - sampler.numDrawn());
+    sampler.nextBatch(batchSize, batch);
+    bcOuter.runSampled(batch);
+    rounds++;
+
+    if (topK) {
+      // the ranking is invariant to the n / samples scaling factor
+      bcOuter.gatherBC(estimate);
+      if (tracker.update(estimate)) {
+        converged = true;
+        break;
+      }
+    }
+    batchSize *= 2;
+  }
+
+  bcOuter.scale((double)candidates.size() / sampler.numDrawn());
+
+  galois::gPrint("Approximate mode: ", sampler.numDrawn(), " samples in ",
+                 rounds, " rounds", converged ? " (top-k stable)" : "", "\n");
+  galois::runtime::reportStat_Single("BC-Approx", "Samples",
+                                     sampler.numDrawn());
+  galois::runtime::reportStat_Single("BC-Approx", "Rounds", rounds);
+  galois::runtime::reportStat_Single("BC-Approx", "TopKStable",
+                                     converged ? 1 : 0);
+}
+
 int main(int argc, char** argv) {
   galois::SharedMemSys Gal;
   LonestarStart(argc, argv, name, desc, url);
@@ -323,14 +470,19 @@ int main(int argc, char** argv) {
   // execute algorithm
   galois::StatTimer T;
   T.start();
-  bcOuter.run(v);
+  if (approx) {
+    runApprox(bcOuter, v, NumNodes);
+  } else {
+    bcOuter.run(v);
+  }
   T.stop();
 
   bcOuter.printBCValues(0, std::min(10ul, NumNodes), std::cout, 6);
 
   if (printAll)
     bcOuter.printBCcertificate();
-  if (forceVerify || !skipVerify)
+  // sampled estimates are not exact, so torus verification does not apply
+  if (forceVerify || (!skipVerify && !approx))
     bcOuter.verify();
 
   galois::reportPageAlloc("MeminfoPost");
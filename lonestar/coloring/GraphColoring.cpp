@@ -0,0 +1,467 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+#include "galois/Galois.h"
+#include "galois/AtomicWrapper.h"
+#include "galois/Bag.h"
+#include "galois/Reduction.h"
+#include "galois/Timer.h"
+#include "galois/graphs/LCGraph.h"
+#include "galois/substrate/PerThreadStorage.h"
+#include "llvm/Support/CommandLine.h"
+
+#include "Lonestar/BoilerPlate.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+const char* name = "Graph Coloring";
+const char* desc = "Colors the nodes of a graph so that no two neighbors have "
+                   "the same color";
+const char* url = "graph_coloring";
+
+enum Algo { jp, speculative };
+enum Heuristic { RAND, LDF, SL };
+
+namespace cll = llvm::cl;
+static cll::opt<std::string> filename(cll::Positional,
+                                      cll::desc("<input graph (symmetric)>"),
+                                      cll::Required);
+static cll::opt<Algo> algo(
+    "algo", cll::desc("Choose an algorithm:"),
+    cll::values(clEnumVal(jp, "Jones-Plassmann (default)"),
+                clEnumVal(speculative, "Speculative coloring with conflict "
+                                       "resolution rounds (Gebremedhin-Manne)"),
+                clEnumValEnd),
+    cll::init(jp));
+static cll::opt<Heuristic> heuristic(
+    "heuristic", cll::desc("Choose a node priority:"),
+    cll::values(clEnumValN(RAND, "random", "Random priorities"),
+                clEnumValN(LDF, "ldf", "Largest degree first (default)"),
+                clEnumValN(SL, "sl", "Smallest last (parallel degeneracy "
+                                     "ordering)"),
+                clEnumValEnd),
+    cll::init(LDF));
+static cll::opt<std::string> outputFile("output",
+                                        cll::desc("Write the color of each "
+                                                  "node to this file"),
+                                        cll::init(""));
+
+constexpr static const uint32_t UNCOLORED =
+    std::numeric_limits<uint32_t>::max();
+
+struct Node {
+  uint32_t color;
+  //! higher priority nodes are colored first (JP) or keep their color on a
+  //! conflict (speculative); node ids break ties
+  uint64_t priority;
+  //! JP: number of higher priority neighbors that are not colored yet
+  galois::CopyableAtomic<uint32_t> pending;
+};
+
+using Graph = galois::graphs::LC_CSR_Graph<Node, void>::with_no_lockable<
+    true>::type ::with_numa_alloc<true>::type;
+using GNode = Graph::GraphNode;
+
+/**
+ * Thread-local bitmap of the colors used by a node's neighbors.
+ */
+class ForbiddenColors {
+  std::vector<uint64_t> words;
+  size_t used = 0;
+
+public:
+  void mark(uint32_t color) {
+    size_t w = color / 64;
+    if (w >= words.size()) {
+      words.resize(w + 1, 0);
+    }
+    words[w] |= 1ull << (color % 64);
+    used = std::max(used, w + 1);
+  }
+
+  //! smallest color not marked
+  uint32_t firstFree() const {
+    for (size_t w = 0; w < used; ++w) {
+      if (~words[w]) {
+        return w * 64 + __builtin_ctzll(~words[w]);
+      }
+    }
+    return used * 64;
+  }
+
+  void clear() {
+    std::fill(words.begin(), words.begin() + used, 0);
+    used = 0;
+  }
+};
+
+using PerThreadForbidden =
+    galois::substrate::PerThreadStorage<ForbiddenColors>;
+
+uint32_t hashNode(GNode n) {
+  uint64_t h = (uint64_t)n * 0x9E3779B97F4A7C15ull;
+  return (uint32_t)(h ^ (h >> 32));
+}
+
+bool higherPriority(Graph& graph, GNode a, GNode b) {
+  auto& ad = graph.getData(a, galois::MethodFlag::UNPROTECTED);
+  auto& bd = graph.getData(b, galois::MethodFlag::UNPROTECTED);
+  return ad.priority > bd.priority || (ad.priority == bd.priority && a > b);
+}
+
+size_t degree(Graph& graph, GNode n) {
+  return std::distance(graph.edge_begin(n, galois::MethodFlag::UNPROTECTED),
+                       graph.edge_end(n, galois::MethodFlag::UNPROTECTED));
+}
+
+/**
+ * Smallest-last priorities by parallel peeling: every round removes all
+ * remaining nodes whose remaining degree is at most the current level k, and
+ * nodes removed later get higher priority. A node is only revisited when its
+ * degree drops to k, so each round touches the removed nodes and their
+ * neighbors.
+ *
+ * @returns number of peeling rounds
+ */
+unsigned smallestLastPriorities(Graph& graph) {
+  constexpr uint64_t ALIVE = std::numeric_limits<uint64_t>::max();
+  galois::LargeArray<galois::CopyableAtomic<uint32_t>> remaining;
+  remaining.allocateBlocked(graph.size());
+
+  galois::do_all(galois::iterate(graph), [&](GNode n) {
+    remaining.constructAt(n);
+    remaining[n] = degree(graph, n);
+    graph.getData(n, galois::MethodFlag::UNPROTECTED).priority = ALIVE;
+  });
+
+  galois::InsertBag<GNode> frontier[2];
+  unsigned cur    = 0;
+  uint32_t k      = 0;
+  uint64_t round  = 0;
+  size_t numAlive = graph.size();
+
+  while (numAlive) {
+    if (frontier[cur].empty()) {
+      // raise the level to the smallest remaining degree
+      galois::GReduceMin<uint32_t> minDegree;
+      galois::do_all(galois::iterate(graph), [&](GNode n) {
+        if (graph.getData(n, galois::MethodFlag::UNPROTECTED).priority ==
+            ALIVE) {
+          minDegree.update(remaining[n]);
+        }
+      });
+      k = std::max(k, minDegree.reduce());
+      galois::do_all(galois::iterate(graph), [&](GNode n) {
+        if (graph.getData(n, galois::MethodFlag::UNPROTECTED).priority ==
+                ALIVE &&
+            remaining[n] <= k) {
+          frontier[cur].push_back(n);
+        }
+      });
+    }
+
+    // remove the frontier first so removed neighbors are not re-pushed
+    galois::GAccumulator<size_t> removed;
+    galois::do_all(galois::iterate(frontier[cur]), [&](GNode n) {
+      graph.getData(n, galois::MethodFlag::UNPROTECTED).priority = round;
+      removed += 1;
+    });
+
+    galois::do_all(galois::iterate(frontier[cur]),
+                   [&](GNode n) {
+                     for (auto e : graph.edges(
+                              n, galois::MethodFlag::UNPROTECTED)) {
+                       GNode dst = graph.getEdgeDst(e);
+                       if (graph.getData(dst, galois::MethodFlag::UNPROTECTED)
+                               .priority != ALIVE) {
+                         continue;
+                       }
+                       // push exactly once, when the degree drops to k
+                       if (remaining[dst].fetch_sub(1) == k + 1) {
+                         frontier[cur ^ 1].push_back(dst);
+                       }
+                     }
+                   },
+                   galois::steal(), galois::loopname("SmallestLast"));
+
+    numAlive -= removed.reduce();
+    frontier[cur].clear();
+    cur ^= 1;
+    round++;
+  }
+
+  remaining.destroy();
+  remaining.deallocate();
+
+  // later rounds first; hash within a round
+  galois::do_all(galois::iterate(graph), [&](GNode n) {
+    auto& nd    = graph.getData(n, galois::MethodFlag::UNPROTECTED);
+    nd.priority = (nd.priority << 32) | hashNode(n);
+  });
+  return round;
+}
+
+void assignPriorities(Graph& graph) {
+  switch (heuristic) {
+  case RAND:
+    galois::do_all(galois::iterate(graph), [&](GNode n) {
+      graph.getData(n, galois::MethodFlag::UNPROTECTED).priority = hashNode(n);
+    });
+    break;
+  case LDF:
+    galois::do_all(galois::iterate(graph), [&](GNode n) {
+      graph.getData(n, galois::MethodFlag::UNPROTECTED).priority =
+          ((uint64_t)degree(graph, n) << 32) | hashNode(n);
+    });
+    break;
+  case SL: {
+    unsigned rounds = smallestLastPriorities(graph);
+    galois::runtime::reportStat_Single("Coloring", "SmallestLastRounds",
+                                       rounds);
+    break;
+  }
+  default:
+    std::cerr << "Unknown heuristic " << heuristic << "\n";
+    abort();
+  }
+}
+
+//! Smallest color not used by a colored neighbor of n
+uint32_t firstFit(Graph& graph, GNode n, ForbiddenColors& colors) {
+  for (auto e : graph.edges(n, galois::MethodFlag::UNPROTECTED)) {
+    GNode dst = graph.getEdgeDst(e);
+    uint32_t c = graph.getData(dst, galois::MethodFlag::UNPROTECTED).color;
+    if (dst != n && c != UNCOLORED) {
+      colors.mark(c);
+    }
+  }
+  uint32_t c = colors.firstFree();
+  colors.clear();
+  return c;
+}
+
+/**
+ * Jones-Plassmann: a node is colored once all its higher priority neighbors
+ * are, and then releases its lower priority neighbors. The coloring only
+ * depends on the priorities.
+ */
+struct JonesPlassmann {
+  void operator()(Graph& graph) {
+    PerThreadForbidden forbidden;
+    galois::InsertBag<GNode> roots;
+
+    galois::do_all(galois::iterate(graph),
+                   [&](GNode n) {
+                     uint32_t higher = 0;
+                     for (auto e : graph.edges(
+                              n, galois::MethodFlag::UNPROTECTED)) {
+                       GNode dst = graph.getEdgeDst(e);
+                       if (dst != n && higherPriority(graph, dst, n)) {
+                         higher++;
+                       }
+                     }
+                     graph.getData(n, galois::MethodFlag::UNPROTECTED)
+                         .pending = higher;
+                     if (!higher) {
+                       roots.push_back(n);
+                     }
+                   },
+                   galois::loopname("CountPredecessors"));
+
+    galois::for_each(
+        galois::iterate(roots),
+        [&](GNode n, auto& ctx) {
+          graph.getData(n, galois::MethodFlag::UNPROTECTED).color =
+              firstFit(graph, n, *forbidden.getLocal());
+          for (auto e : graph.edges(n, galois::MethodFlag::UNPROTECTED)) {
+            GNode dst = graph.getEdgeDst(e);
+            if (dst != n && higherPriority(graph, n, dst)) {
+              auto& dd = graph.getData(dst, galois::MethodFlag::UNPROTECTED);
+              if (--dd.pending == 0) {
+                ctx.push(dst);
+              }
+            }
+          }
+        },
+        galois::no_conflicts(),
+        galois::wl<galois::worklists::PerSocketChunkFIFO<64>>(),
+        galois::loopname("JonesPlassmann"));
+  }
+};
+
+/**
+ * Speculative coloring: every uncolored node picks a color from its
+ * neighbors' current colors in parallel; then, for each pair of neighbors
+ * that picked the same color, the lower priority one is recolored in the
+ * next round.
+ */
+struct Speculative {
+  void operator()(Graph& graph) {
+    PerThreadForbidden forbidden;
+    galois::InsertBag<GNode> worklists[2];
+    galois::do_all(galois::iterate(graph),
+                   [&](GNode n) { worklists[0].push_back(n); });
+
+    galois::GAccumulator<size_t> conflicts;
+    unsigned cur    = 0;
+    unsigned rounds = 0;
+    while (!worklists[cur].empty()) {
+      galois::do_all(galois::iterate(worklists[cur]),
+                     [&](GNode n) {
+                       graph.getData(n, galois::MethodFlag::UNPROTECTED)
+                           .color =
+                           firstFit(graph, n, *forbidden.getLocal());
+                     },
+                     galois::steal(), galois::loopname("Tentative"));
+
+      galois::do_all(galois::iterate(worklists[cur]),
+                     [&](GNode n) {
+                       uint32_t c =
+                           graph.getData(n, galois::MethodFlag::UNPROTECTED)
+                               .color;
+                       for (auto e : graph.edges(
+                                n, galois::MethodFlag::UNPROTECTED)) {
+                         GNode dst = graph.getEdgeDst(e);
+                         if (dst != n &&
+                             graph.getData(dst,
+                                           galois::MethodFlag::UNPROTECTED)
+                                     .color == c &&
+                             higherPriority(graph, dst, n)) {
+                           worklists[cur ^ 1].push_back(n);
+                           conflicts += 1;
+                           return;
+                         }
+                       }
+                     },
+                     galois::steal(), galois::loopname("DetectConflicts"));
+
+      // conflicting nodes must not block each other's colors next round
+      galois::do_all(galois::iterate(worklists[cur ^ 1]), [&](GNode n) {
+        graph.getData(n, galois::MethodFlag::UNPROTECTED).color = UNCOLORED;
+      });
+
+      worklists[cur].clear();
+      cur ^= 1;
+      rounds++;
+    }
+
+    std::cout << "Rounds: " << rounds << ", conflicts: " << conflicts.reduce()
+              << "\n";
+    galois::runtime::reportStat_Single("Coloring", "Rounds", rounds);
+    galois::runtime::reportStat_Single("Coloring", "Conflicts",
+                                       conflicts.reduce());
+  }
+};
+
+bool verify(Graph& graph) {
+  galois::GReduceLogicalOR bad;
+  galois::do_all(galois::iterate(graph),
+                 [&](GNode n) {
+                   uint32_t c =
+                       graph.getData(n, galois::MethodFlag::UNPROTECTED).color;
+                   if (c == UNCOLORED) {
+                     bad.update(true);
+                     return;
+                   }
+                   for (auto e :
+                        graph.edges(n, galois::MethodFlag::UNPROTECTED)) {
+                     GNode dst = graph.getEdgeDst(e);
+                     if (dst != n &&
+                         graph.getData(dst, galois::MethodFlag::UNPROTECTED)
+                                 .color == c) {
+                       bad.update(true);
+                       return;
+                     }
+                   }
+                 },
+                 galois::loopname("Verify"));
+  return !bad.reduce();
+}
+
+template <typename Algo>
+void run(Graph& graph) {
+  Algo algo;
+
+  galois::StatTimer T;
+  T.start();
+  assignPriorities(graph);
+  algo(graph);
+  T.stop();
+}
+
+int main(int argc, char** argv) {
+  galois::SharedMemSys G;
+  LonestarStart(argc, argv, name, desc, url);
+
+  Graph graph;
+  galois::graphs::readGraph(graph, filename);
+  std::cout << "Read " << graph.size() << " nodes, " << graph.sizeEdges()
+            << " edges\n";
+
+  galois::preAlloc(numThreads +
+                   4 * graph.size() * sizeof(GNode) /
+                       galois::runtime::pagePoolSize());
+  galois::reportPageAlloc("MeminfoPre");
+
+  galois::do_all(galois::iterate(graph), [&](GNode n) {
+    graph.getData(n, galois::MethodFlag::UNPROTECTED).color = UNCOLORED;
+  });
+
+  switch (algo) {
+  case jp:
+    run<JonesPlassmann>(graph);
+    break;
+  case speculative:
+    run<Speculative>(graph);
+    break;
+  default:
+    std::cerr << "Unknown algorithm " << algo << "\n";
+    abort();
+  }
+
+  galois::reportPageAlloc("MeminfoPost");
+
+  galois::GReduceMax<uint32_t> maxColor;
+  galois::do_all(galois::iterate(graph), [&](GNode n) {
+    maxColor.update(graph.getData(n, galois::MethodFlag::UNPROTECTED).color);
+  });
+  uint32_t numColors = graph.size() ? maxColor.reduce() + 1 : 0;
+  std::cout << "Colors: " << numColors << "\n";
+  galois::runtime::reportStat_Single("Coloring", "Colors", numColors);
+
+  if (!skipVerify) {
+    if (!verify(graph)) {
+      GALOIS_DIE("verification failed");
+    }
+    std::cout << "Verification successful.\n";
+  }
+
+  if (outputFile != "") {
+    std::ofstream out(outputFile);
+    for (auto n : graph) {
+      out << n << " " << graph.getData(n).color << "\n";
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,449 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+#include "galois/Galois.h"
+#include "galois/Bag.h"
+#include "galois/LargeArray.h"
+#include "galois/Reduction.h"
+#include "galois/Timer.h"
+#include "galois/graphs/FileGraph.h"
+#include "galois/graphs/LCGraph.h"
+#include "galois/substrate/PerThreadStorage.h"
+#include "galois/substrate/SimpleLock.h"
+#include "llvm/Support/CommandLine.h"
+
+#include "Lonestar/BoilerPlate.h"
+#include "ContractionHierarchies.h"
+
+#include <iostream>
+#include <random>
+
+namespace cll = llvm::cl;
+
+static const char* name = "Contraction Hierarchies Preprocessing";
+static const char* desc =
+    "Orders and contracts the nodes of a weighted directed graph in parallel "
+    "and writes the resulting contraction hierarchy for fast point-to-point "
+    "shortest path queries";
+static const char* url = "contraction_hierarchies";
+
+static cll::opt<std::string>
+    filename(cll::Positional, cll::desc("<input graph>"), cll::Required);
+static cll::opt<std::string>
+    chFile("chFile",
+           cll::desc("Output contraction hierarchy (default: <input>.ch.gr)"),
+           cll::init(""));
+static cll::opt<unsigned int> witnessLimit(
+    "witnessLimit",
+    cll::desc("Nodes settled per witness search before a shortcut is added "
+              "anyway (default value 500)"),
+    cll::init(500));
+static cll::opt<unsigned int>
+    verifyQueries("verifyQueries",
+                  cll::desc("Random queries checked against Dijkstra "
+                            "(default value 100)"),
+                  cll::init(100));
+
+//! Arc of the remaining (not yet contracted) graph
+struct Arc {
+  uint32_t node;
+  uint32_t weight;
+};
+
+struct Shortcut {
+  uint32_t src;
+  uint32_t dst;
+  uint32_t weight;
+};
+
+struct CHNode {
+  //! Arcs to remaining nodes; frozen as the upward arcs once contracted
+  std::vector<Arc> out;
+  std::vector<Arc> in;
+  galois::substrate::SimpleLock lock;
+  int priority;
+  uint32_t deletedNeighbors;
+  bool contracted;
+  bool dirty;
+
+  CHNode()
+      : priority(0), deletedNeighbors(0), contracted(false), dirty(true) {}
+};
+
+using Nodes = galois::LargeArray<CHNode>;
+
+//! Adds an arc or lowers the weight of an existing one
+static void addArc(std::vector<Arc>& arcs, uint32_t node, uint32_t weight) {
+  for (Arc& a : arcs) {
+    if (a.node == node) {
+      a.weight = std::min(a.weight, weight);
+      return;
+    }
+  }
+  arcs.push_back(Arc{node, weight});
+}
+
+static void removeArc(std::vector<Arc>& arcs, uint32_t node) {
+  for (Arc& a : arcs) {
+    if (a.node == node) {
+      a = arcs.back();
+      arcs.pop_back();
+      return;
+    }
+  }
+}
+
+/**
+ * Calls fn(u, w, weight) for every shortcut needed to contract v: a pair of
+ * remaining neighbors u -> v -> w with no witness path around v that is
+ * strictly shorter. Witness searches settle at most witnessLimit nodes.
+ *
+ * Requiring strictly shorter witnesses keeps contraction of a whole
+ * independent set at once exact: a witness may run through another node
+ * contracted in the same round, but following such dependencies always
+ * strictly shortens the path, so they cannot drop a distance in a cycle.
+ */
+template <typename Fn>
+void findShortcuts(Nodes& nodes, SearchSpace& st, uint32_t v, Fn fn) {
+  CHNode& nv      = nodes[v];
+  uint64_t maxOut = 0;
+  for (const Arc& b : nv.out)
+    maxOut = std::max<uint64_t>(maxOut, b.weight);
+
+  for (const Arc& a : nv.in) {
+    uint64_t limit   = a.weight + maxOut;
+    unsigned settled = 0;
+    size_t targets   = nv.out.size();
+    st.begin(nodes.size());
+    st.relax(a.node, 0);
+    // Stop once every out-neighbor of v is settled or out of reach
+    while (!st.empty() && st.top() < limit && settled < witnessLimit &&
+           targets) {
+      SearchSpace::Entry e = st.pop();
+      if (e.dist > st.get(e.n))
+        continue;
+      ++settled;
+      for (const Arc& b : nv.out)
+        targets -= b.node == e.n;
+      for (const Arc& c : nodes[e.n].out)
+        if (c.node != v)
+          st.relax(c.node, e.dist + c.weight);
+    }
+
+    for (const Arc& b : nv.out) {
+      if (b.node == a.node)
+        continue;
+      uint64_t via = uint64_t{a.weight} + b.weight;
+      if (st.get(b.node) < via)
+        continue;
+      if (via > std::numeric_limits<uint32_t>::max())
+        GALOIS_DIE("shortcut weight does not fit in 32 bits");
+      fn(a.node, b.node, via);
+    }
+  }
+}
+
+//! Edge difference of contracting v plus its contracted neighbors
+int computePriority(Nodes& nodes, SearchSpace& st, uint32_t v) {
+  int shortcuts = 0;
+  findShortcuts(nodes, st, v,
+                [&](uint32_t, uint32_t, uint64_t) { ++shortcuts; });
+  CHNode& nv = nodes[v];
+  return shortcuts - (int)nv.out.size() - (int)nv.in.size() +
+         (int)nv.deletedNeighbors;
+}
+
+static unsigned int hash(unsigned int val) {
+  val = ((val >> 16) ^ val) * 0x45d9f3b;
+  val = ((val >> 16) ^ val) * 0x45d9f3b;
+  return (val >> 16) ^ val;
+}
+
+//! Strict total order on remaining nodes; ties are broken by a hash
+static bool before(Nodes& nodes, uint32_t a, uint32_t b) {
+  int pa = nodes[a].priority;
+  int pb = nodes[b].priority;
+  if (pa != pb)
+    return pa < pb;
+  unsigned ha = hash(a);
+  unsigned hb = hash(b);
+  return ha != hb ? ha < hb : a < b;
+}
+
+void loadNodes(InputGraph& graph, Nodes& nodes) {
+  nodes.create(graph.size());
+  galois::do_all(
+      galois::iterate(graph),
+      [&](uint32_t src) {
+        for (auto ii : graph.edges(src, galois::MethodFlag::UNPROTECTED)) {
+          uint32_t dst = graph.getEdgeDst(ii);
+          if (dst == src)
+            continue;
+          uint32_t weight = graph.getEdgeData(ii);
+          addArc(nodes[src].out, dst, weight);
+          nodes[dst].lock.lock();
+          addArc(nodes[dst].in, src, weight);
+          nodes[dst].lock.unlock();
+        }
+      },
+      galois::steal(), galois::loopname("LoadNodes"));
+}
+
+/**
+ * Contracts all nodes in rounds. Each round selects the remaining nodes whose
+ * priority is lower than that of all their remaining neighbors (an independent
+ * set, as in the priority-based independent set algorithm), computes their
+ * shortcuts in parallel on the unchanged remaining graph, then removes them
+ * and inserts the shortcuts. Only nodes whose neighborhood changed get their
+ * priority recomputed.
+ */
+void contract(Nodes& nodes) {
+  galois::substrate::PerThreadStorage<SearchSpace> states;
+  galois::GAccumulator<size_t> numShortcuts;
+  galois::InsertBag<uint32_t> remaining;
+  galois::InsertBag<uint32_t> selected;
+  galois::InsertBag<Shortcut> shortcuts;
+  size_t rounds = 0;
+
+  galois::do_all(galois::iterate(size_t{0}, nodes.size()),
+                 [&](size_t v) { remaining.push(v); });
+
+  while (!remaining.empty()) {
+    ++rounds;
+    galois::do_all(
+        galois::iterate(remaining),
+        [&](uint32_t v) {
+          CHNode& nv = nodes[v];
+          if (nv.dirty) {
+            nv.priority = computePriority(nodes, *states.getLocal(), v);
+            nv.dirty    = false;
+          }
+        },
+        galois::steal(), galois::loopname("UpdatePriorities"));
+
+    galois::do_all(
+        galois::iterate(remaining),
+        [&](uint32_t v) {
+          for (const Arc& a : nodes[v].out)
+            if (!before(nodes, v, a.node))
+              return;
+          for (const Arc& a : nodes[v].in)
+            if (!before(nodes, v, a.node))
+              return;
+          selected.push(v);
+        },
+        galois::steal(), galois::loopname("SelectIndependentSet"));
+
+    galois::do_all(
+        galois::iterate(selected),
+        [&](uint32_t v) {
+          findShortcuts(nodes, *states.getLocal(), v,
+                        [&](uint32_t u, uint32_t w, uint64_t weight) {
+                          shortcuts.push(Shortcut{u, w, (uint32_t)weight});
+                          numShortcuts += 1;
+                        });
+        },
+        galois::steal(), galois::loopname("FindShortcuts"));
+
+    galois::do_all(
+        galois::iterate(selected),
+        [&](uint32_t v) {
+          CHNode& nv    = nodes[v];
+          nv.contracted = true;
+          auto detach   = [&](uint32_t u, bool outgoing) {
+            CHNode& nu = nodes[u];
+            nu.lock.lock();
+            removeArc(outgoing ? nu.in : nu.out, v);
+            nu.deletedNeighbors++;
+            nu.dirty = true;
+            nu.lock.unlock();
+          };
+          for (const Arc& a : nv.out)
+            detach(a.node, true);
+          for (const Arc& a : nv.in)
+            detach(a.node, false);
+        },
+        galois::steal(), galois::loopname("RemoveContracted"));
+
+    galois::do_all(
+        galois::iterate(shortcuts),
+        [&](const Shortcut& s) {
+          CHNode& src = nodes[s.src];
+          src.lock.lock();
+          addArc(src.out, s.dst, s.weight);
+          src.dirty = true;
+          src.lock.unlock();
+          CHNode& dst = nodes[s.dst];
+          dst.lock.lock();
+          addArc(dst.in, s.src, s.weight);
+          dst.dirty = true;
+          dst.lock.unlock();
+        },
+        galois::steal(), galois::loopname("AddShortcuts"));
+
+    galois::InsertBag<uint32_t> next;
+    galois::do_all(galois::iterate(remaining),
+                   [&](uint32_t v) {
+                     if (!nodes[v].contracted)
+                       next.push(v);
+                   },
+                   galois::loopname("CompactRemaining"));
+    remaining.swap(next);
+    selected.clear();
+    shortcuts.clear();
+  }
+
+  std::cout << "Contracted in " << rounds << " rounds with "
+            << numShortcuts.reduce() << " shortcuts\n";
+  galois::runtime::reportStat_Single("ContractionHierarchies", "Rounds",
+                                     rounds);
+  galois::runtime::reportStat_Single("ContractionHierarchies", "Shortcuts",
+                                     numShortcuts.reduce());
+}
+
+/**
+ * Writes the hierarchy as a .gr graph over the input node ids with CHEdge
+ * edge data. Upward arcs in both directions to the same node with the same
+ * weight share one edge.
+ */
+void writeHierarchy(Nodes& nodes, const std::string& file) {
+  size_t numNodes = nodes.size();
+  galois::LargeArray<uint32_t> degree;
+  degree.create(numNodes);
+
+  auto forEachEdge = [&](uint32_t v, auto fn) {
+    CHNode& nv = nodes[v];
+    for (const Arc& a : nv.out) {
+      uint32_t dir = CHEdge::FORWARD;
+      for (const Arc& b : nv.in)
+        if (b.node == a.node && b.weight == a.weight)
+          dir |= CHEdge::BACKWARD;
+      fn(a.node, CHEdge{a.weight, dir});
+    }
+    for (const Arc& b : nv.in) {
+      bool shared = false;
+      for (const Arc& a : nv.out)
+        shared |= a.node == b.node && a.weight == b.weight;
+      if (!shared)
+        fn(b.node, CHEdge{b.weight, CHEdge::BACKWARD});
+    }
+  };
+
+  galois::GAccumulator<size_t> numEdges;
+  galois::do_all(galois::iterate(size_t{0}, numNodes),
+                 [&](size_t v) {
+                   forEachEdge(v, [&](uint32_t, const CHEdge&) {
+                     degree[v]++;
+                   });
+                   numEdges += degree[v];
+                 },
+                 galois::loopname("CountEdges"));
+
+  galois::graphs::FileGraphWriter p;
+  p.setNumNodes(numNodes);
+  p.setNumEdges(numEdges.reduce());
+  p.setSizeofEdgeData(sizeof(CHEdge));
+  p.phase1();
+  for (size_t v = 0; v < numNodes; ++v)
+    p.incrementDegree(v, degree[v]);
+  p.phase2();
+  std::vector<std::pair<uint32_t, CHEdge>> edges;
+  std::vector<CHEdge> edgeData(numEdges.reduce());
+  for (size_t v = 0; v < numNodes; ++v) {
+    edges.clear();
+    forEachEdge(v, [&](uint32_t dst, const CHEdge& e) {
+      edges.emplace_back(dst, e);
+    });
+    std::sort(edges.begin(), edges.end(),
+              [](const std::pair<uint32_t, CHEdge>& a,
+                 const std::pair<uint32_t, CHEdge>& b) {
+                return a.first < b.first;
+              });
+    for (auto& e : edges)
+      edgeData[p.addNeighbor(v, e.first)] = e.second;
+  }
+  CHEdge* data = p.finish<CHEdge>();
+  std::copy(edgeData.begin(), edgeData.end(), data);
+  p.toFile(file);
+  std::cout << "Wrote " << numEdges.reduce() << " edges to " << file << "\n";
+  galois::runtime::reportStat_Single("ContractionHierarchies", "Edges",
+                                     numEdges.reduce());
+}
+
+//! Checks random queries on the written hierarchy against Dijkstra
+void verify(InputGraph& graph, const std::string& file) {
+  CHGraph ch;
+  galois::graphs::readGraph(ch, file);
+  if (ch.size() != graph.size())
+    GALOIS_DIE("hierarchy has ", ch.size(), " nodes, expected ", graph.size());
+
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<uint32_t> pick(0, graph.size() - 1);
+  std::vector<std::pair<uint32_t, uint32_t>> queries(verifyQueries);
+  for (auto& q : queries)
+    q = std::make_pair(pick(gen), pick(gen));
+
+  galois::substrate::PerThreadStorage<CHQueryState> states;
+  galois::GAccumulator<size_t> mismatches;
+  galois::do_all(
+      galois::iterate(queries),
+      [&](const std::pair<uint32_t, uint32_t>& q) {
+        CHQueryState& st = *states.getLocal();
+        uint64_t expected = dijkstra(graph, st.side[0], q.first, q.second);
+        if (chQuery(ch, st, q.first, q.second) != expected)
+          mismatches += 1;
+      },
+      galois::steal(), galois::loopname("VerifyQueries"));
+  if (mismatches.reduce())
+    GALOIS_DIE(mismatches.reduce(), " queries differ from Dijkstra");
+  std::cout << "Verification successful.\n";
+}
+
+int main(int argc, char** argv) {
+  galois::SharedMemSys G;
+  LonestarStart(argc, argv, name, desc, url);
+
+  InputGraph graph;
+  galois::graphs::readGraph(graph, filename);
+  std::cout << "Read " << graph.size() << " nodes, " << graph.sizeEdges()
+            << " edges\n";
+  if (chFile.empty())
+    chFile = filename + ".ch.gr";
+
+  galois::preAlloc(numThreads +
+                   graph.size() * sizeof(CHNode) /
+                       galois::runtime::pagePoolSize());
+  galois::reportPageAlloc("MeminfoPre");
+
+  Nodes nodes;
+  galois::StatTimer Tmain;
+  Tmain.start();
+  loadNodes(graph, nodes);
+  contract(nodes);
+  Tmain.stop();
+
+  galois::reportPageAlloc("MeminfoPost");
+
+  writeHierarchy(nodes, chFile);
+
+  if (!skipVerify && graph.size())
+    verify(graph, chFile);
+
+  return 0;
+}
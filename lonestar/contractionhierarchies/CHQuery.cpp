@@ -0,0 +1,212 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+#include "galois/Galois.h"
+#include "galois/Reduction.h"
+#include "galois/Timer.h"
+#include "galois/graphs/LCGraph.h"
+#include "galois/substrate/PerThreadStorage.h"
+#include "llvm/Support/CommandLine.h"
+
+#include "Lonestar/BoilerPlate.h"
+#include "ContractionHierarchies.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace cll = llvm::cl;
+
+static const char* name = "Contraction Hierarchies Query";
+static const char* desc =
+    "Answers point-to-point shortest path queries on a contraction hierarchy "
+    "built by ch-build";
+static const char* url = "contraction_hierarchies";
+
+static cll::opt<std::string> filename(cll::Positional,
+                                      cll::desc("<contraction hierarchy>"),
+                                      cll::Required);
+static cll::opt<std::string>
+    inputGraph("graph",
+               cll::desc("Original graph, used to verify answers with "
+                         "Dijkstra's algorithm"),
+               cll::init(""));
+static cll::opt<unsigned int>
+    startNode("startNode",
+              cll::desc("Node to start search from (default value 0)"),
+              cll::init(0));
+static cll::opt<unsigned int>
+    reportNode("reportNode",
+               cll::desc("Node to report distance to(default value 1)"),
+               cll::init(1));
+static cll::opt<std::string> queryFile(
+    "queryFile",
+    cll::desc("Answer the source-target pairs in this file, one per line "
+              "(- for stdin), instead of a single query"),
+    cll::init(""));
+static cll::opt<std::string>
+    queryOutput("queryOutput",
+                cll::desc("File to write query batch distances to"),
+                cll::init(""));
+
+using Query = std::pair<uint32_t, uint32_t>;
+
+std::vector<Query> readQueries(CHGraph& graph) {
+  std::ifstream file;
+  if (queryFile != "-") {
+    file.open(queryFile);
+    if (!file.is_open())
+      GALOIS_DIE("could not open query file ", queryFile);
+  }
+  std::istream& in = queryFile == "-" ? std::cin : file;
+
+  std::vector<Query> queries;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream ss(line);
+    uint64_t src, dst;
+    if (line.empty() || line[0] == '#' || !(ss >> src >> dst))
+      continue;
+    if (src >= graph.size() || dst >= graph.size())
+      GALOIS_DIE("query node out of range: ", line);
+    queries.emplace_back(src, dst);
+  }
+  return queries;
+}
+
+/**
+ * The hierarchy stays resident and independent queries are answered
+ * concurrently, one per thread at a time.
+ */
+void runQueries(CHGraph& graph, const std::vector<Query>& queries,
+                std::vector<uint64_t>& results) {
+  using Clock = std::chrono::steady_clock;
+
+  size_t numQueries = queries.size();
+  galois::substrate::PerThreadStorage<CHQueryState> states;
+  std::vector<uint64_t> latencies(numQueries);
+  std::atomic<size_t> next(0);
+  results.resize(numQueries);
+
+  galois::StatTimer Tmain;
+  Tmain.start();
+  galois::on_each(
+      [&](unsigned, unsigned) {
+        CHQueryState& st = *states.getLocal();
+        for (size_t q; (q = next++) < numQueries;) {
+          auto start = Clock::now();
+          results[q] = chQuery(graph, st, queries[q].first, queries[q].second);
+          latencies[q] = std::chrono::duration_cast<std::chrono::microseconds>(
+                             Clock::now() - start)
+                             .count();
+        }
+      },
+      galois::loopname("CHQueries"));
+  Tmain.stop();
+
+  if (numQueries) {
+    std::vector<uint64_t> sorted(latencies);
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](unsigned p) {
+      return sorted[std::min(numQueries - 1, numQueries * p / 100)];
+    };
+    std::cout << "Query latency (us): p50 " << percentile(50) << " p90 "
+              << percentile(90) << " p99 " << percentile(99) << " max "
+              << sorted.back() << "\n";
+    const char* region = "CHQueries";
+    galois::runtime::reportStat_Single(region, "Queries", numQueries);
+    galois::runtime::reportStat_Single(region, "LatencyP50", percentile(50));
+    galois::runtime::reportStat_Single(region, "LatencyP90", percentile(90));
+    galois::runtime::reportStat_Single(region, "LatencyP99", percentile(99));
+    galois::runtime::reportStat_Single(region, "LatencyMax", sorted.back());
+  }
+}
+
+void verify(CHGraph& graph, const std::vector<Query>& queries,
+            const std::vector<uint64_t>& results) {
+  InputGraph original;
+  galois::graphs::readGraph(original, inputGraph);
+  if (original.size() != graph.size())
+    GALOIS_DIE("graph has ", original.size(), " nodes, hierarchy has ",
+               graph.size());
+
+  galois::substrate::PerThreadStorage<SearchSpace> states;
+  galois::GAccumulator<size_t> mismatches;
+  galois::do_all(
+      galois::iterate(size_t{0}, queries.size()),
+      [&](size_t q) {
+        if (dijkstra(original, *states.getLocal(), queries[q].first,
+                     queries[q].second) != results[q])
+          mismatches += 1;
+      },
+      galois::steal(), galois::loopname("VerifyQueries"));
+  if (mismatches.reduce())
+    GALOIS_DIE(mismatches.reduce(), " queries differ from Dijkstra");
+  std::cout << "Verification successful.\n";
+}
+
+int main(int argc, char** argv) {
+  galois::SharedMemSys G;
+  LonestarStart(argc, argv, name, desc, url);
+
+  CHGraph graph;
+  galois::graphs::readGraph(graph, filename);
+  std::cout << "Read " << graph.size() << " nodes, " << graph.sizeEdges()
+            << " edges\n";
+
+  std::vector<Query> queries;
+  if (!queryFile.empty()) {
+    queries = readQueries(graph);
+  } else {
+    if (startNode >= graph.size() || reportNode >= graph.size())
+      GALOIS_DIE("failed to set report: ", reportNode,
+                 " or failed to set source: ", startNode);
+    queries.emplace_back(startNode, reportNode);
+  }
+  std::cout << "Answering " << queries.size() << " queries\n";
+
+  std::vector<uint64_t> results;
+  runQueries(graph, queries, results);
+
+  if (queryFile.empty()) {
+    std::cout << "Node " << reportNode << " has distance ";
+    if (results[0] == SearchSpace::INF)
+      std::cout << "infinity\n";
+    else
+      std::cout << results[0] << "\n";
+  }
+
+  if (!queryOutput.empty()) {
+    std::ofstream out(queryOutput);
+    for (size_t q = 0; q < queries.size(); ++q) {
+      out << queries[q].first << " " << queries[q].second << " ";
+      if (results[q] == SearchSpace::INF)
+        out << "unreachable\n";
+      else
+        out << results[q] << "\n";
+    }
+  }
+
+  if (!skipVerify && !inputGraph.empty())
+    verify(graph, queries, results);
+
+  return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+#ifndef LONESTAR_CONTRACTION_HIERARCHIES_H
+#define LONESTAR_CONTRACTION_HIERARCHIES_H
+
+#include "galois/graphs/LCGraph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+//! Input road network: non-negative 32-bit edge weights
+using InputGraph = galois::graphs::LC_CSR_Graph<void, uint32_t>::
+    with_no_lockable<true>::type::with_numa_alloc<true>::type;
+
+/**
+ * Edge of the contracted graph. Every edge stored at a node leads to a node
+ * contracted later (higher rank). FORWARD edges are arcs src -> dst of the
+ * augmented graph and are used by the forward search; BACKWARD edges stand
+ * for arcs dst -> src and are used by the backward search. An edge whose two
+ * arcs have the same weight carries both bits.
+ */
+struct CHEdge {
+  enum : uint32_t { FORWARD = 1, BACKWARD = 2 };
+  uint32_t weight;
+  uint32_t dir;
+};
+
+using CHGraph = galois::graphs::LC_CSR_Graph<void, CHEdge>::with_no_lockable<
+    true>::type::with_numa_alloc<true>::type;
+
+/**
+ * Dijkstra labels and heap reused across many small searches. Labels carry
+ * the stamp of the search that wrote them, so starting a search only bumps
+ * the stamp instead of resetting a distance for every node.
+ */
+class SearchSpace {
+public:
+  static constexpr uint64_t INF = std::numeric_limits<uint64_t>::max();
+
+  struct Entry {
+    uint64_t dist;
+    uint32_t n;
+    bool operator>(const Entry& rhs) const { return dist > rhs.dist; }
+  };
+
+  void begin(size_t numNodes) {
+    if (labels.size() != numNodes) {
+      labels.assign(numNodes, Label{INF, 0});
+      stamp = 0;
+    }
+    if (++stamp == 0) {
+      std::fill(labels.begin(), labels.end(), Label{INF, 0});
+      stamp = 1;
+    }
+    heap.clear();
+  }
+
+  uint64_t get(uint32_t n) const {
+    const Label& l = labels[n];
+    return l.stamp == stamp ? l.dist : INF;
+  }
+
+  //! Lowers the label of n and queues it; false if d is no improvement
+  bool relax(uint32_t n, uint64_t d) {
+    if (d >= get(n))
+      return false;
+    labels[n] = Label{d, stamp};
+    heap.push_back(Entry{d, n});
+    std::push_heap(heap.begin(), heap.end(), std::greater<Entry>());
+    return true;
+  }
+
+  bool empty() const { return heap.empty(); }
+  uint64_t top() const { return heap.front().dist; }
+
+  Entry pop() {
+    std::pop_heap(heap.begin(), heap.end(), std::greater<Entry>());
+    Entry e = heap.back();
+    heap.pop_back();
+    return e;
+  }
+
+private:
+  struct Label {
+    uint64_t dist;
+    uint32_t stamp;
+  };
+
+  std::vector<Label> labels;
+  std::vector<Entry> heap;
+  uint32_t stamp = 0;
+};
+
+//! Per-thread state of point-to-point queries
+struct CHQueryState {
+  SearchSpace side[2];
+};
+
+/**
+ * Contraction-hierarchy query: a forward search from the source over FORWARD
+ * edges and a backward search from the target over BACKWARD edges, both only
+ * going upwards in rank. A node is not expanded when an edge from a higher
+ * node already proves its label too long (stall-on-demand).
+ */
+inline uint64_t chQuery(CHGraph& graph, CHQueryState& st, uint32_t source,
+                        uint32_t target) {
+  const uint32_t dirs[2] = {CHEdge::FORWARD, CHEdge::BACKWARD};
+  uint64_t best          = source == target ? 0 : SearchSpace::INF;
+
+  for (auto& s : st.side)
+    s.begin(graph.size());
+  st.side[0].relax(source, 0);
+  st.side[1].relax(target, 0);
+
+  while (true) {
+    bool live[2];
+    for (int i = 0; i < 2; ++i)
+      live[i] = !st.side[i].empty() && st.side[i].top() < best;
+    if (!live[0] && !live[1])
+      break;
+    int s = live[0] && (!live[1] || st.side[0].top() <= st.side[1].top())
+                ? 0
+                : 1;
+    SearchSpace& me    = st.side[s];
+    SearchSpace::Entry e = me.pop();
+    if (e.dist > me.get(e.n))
+      continue;
+
+    bool stalled = false;
+    for (auto ii : graph.edges(e.n, galois::MethodFlag::UNPROTECTED)) {
+      const CHEdge& edge = graph.getEdgeData(ii);
+      if (!(edge.dir & dirs[1 - s]))
+        continue;
+      uint64_t d = me.get(graph.getEdgeDst(ii));
+      if (d != SearchSpace::INF && d + edge.weight < e.dist) {
+        stalled = true;
+        break;
+      }
+    }
+    if (stalled)
+      continue;
+
+    uint64_t other = st.side[1 - s].get(e.n);
+    if (other != SearchSpace::INF)
+      best = std::min(best, e.dist + other);
+
+    for (auto ii : graph.edges(e.n, galois::MethodFlag::UNPROTECTED)) {
+      const CHEdge& edge = graph.getEdgeData(ii);
+      if (edge.dir & dirs[s])
+        me.relax(graph.getEdgeDst(ii), e.dist + edge.weight);
+    }
+  }
+  return best;
+}
+
+//! Plain point-to-point Dijkstra on the input graph, used for verification
+inline uint64_t dijkstra(InputGraph& graph, SearchSpace& st, uint32_t source,
+                         uint32_t target) {
+  st.begin(graph.size());
+  st.relax(source, 0);
+  while (!st.empty()) {
+    SearchSpace::Entry e = st.pop();
+    if (e.dist > st.get(e.n))
+      continue;
+    if (e.n == target)
+      break;
+    for (auto ii : graph.edges(e.n, galois::MethodFlag::UNPROTECTED))
+      st.relax(graph.getEdgeDst(ii), e.dist + graph.getEdgeData(ii));
+  }
+  return st.get(target);
+}
+
+#endif
@@ -53,6 +53,11 @@ static cll::opt<DetAlgo> detAlgo(
                 clEnumVal(detDisjoint, "Disjoint execution"), clEnumValEnd),
     cll::init(nondet));
 
+static cll::opt<bool> detAdaptive(
+    "detAdaptive",
+    cll::desc("Size deterministic rounds from the previous commit ratio"),
+    cll::init(false));
+
 template <typename WL, int Version = detBase>
 void refine(galois::InsertBag<GNode>& initialBad, Graph& graph) {
 
@@ -171,6 +176,7 @@ int main(int argc, char** argv) {
   using namespace galois::worklists;
 
   typedef Deterministic<> DWL;
+  typedef DeterministicAdaptive<> ADWL;
   typedef PerThreadChunkLIFO<32> Chunk;
 
   switch (detAlgo) {
@@ -178,13 +184,22 @@ int main(int argc, char** argv) {
     refine<Chunk>(initialBad, graph);
     break;
   case detBase:
-    refine<DWL>(initialBad, graph);
+    if (detAdaptive)
+      refine<ADWL>(initialBad, graph);
+    else
+      refine<DWL>(initialBad, graph);
     break;
   case detPrefix:
-    refine<DWL, detPrefix>(initialBad, graph);
+    if (detAdaptive)
+      refine<ADWL, detPrefix>(initialBad, graph);
+    else
+      refine<DWL, detPrefix>(initialBad, graph);
     break;
   case detDisjoint:
-    refine<DWL, detDisjoint>(initialBad, graph);
+    if (detAdaptive)
+      refine<ADWL, detDisjoint>(initialBad, graph);
+    else
+      refine<DWL, detDisjoint>(initialBad, graph);
     break;
   default:
     std::cerr << "Unknown algorithm" << detAlgo << "\n";
@@ -74,6 +74,11 @@ static cll::opt<DetAlgo> detAlgo(
                 clEnumVal(detDisjoint, "Disjoint execution"), clEnumValEnd),
     cll::init(nondet));
 
+static cll::opt<bool> detAdaptive(
+    "detAdaptive",
+    cll::desc("Size deterministic rounds from the previous commit ratio"),
+    cll::init(false));
+
 struct GetPointer : public std::unary_function<Point&, Point*> {
   Point* operator()(Point& p) const { return &p; }
 };
@@ -657,9 +662,9 @@ struct Process {
 };
 */
 
+template <typename DWL>
 static void run(Rounds& rounds, Graph& graph) {
   typedef galois::worklists::PerThreadChunkLIFO<32> Chunk;
-  typedef galois::worklists::Deterministic<> DWL;
 
   for (int i = maxRounds - 1; i >= 0; --i) {
 
@@ -755,7 +760,10 @@ int main(int argc, char** argv) {
 
   galois::StatTimer T;
   T.start();
-  run(rounds, graph);
+  if (detAdaptive)
+    run<galois::worklists::DeterministicAdaptive<>>(rounds, graph);
+  else
+    run<galois::worklists::Deterministic<>>(rounds, graph);
   T.stop();
   std::cout << "mesh size: " << graph.size() << "\n";
 
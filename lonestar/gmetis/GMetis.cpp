@@ -46,12 +46,16 @@ static const char* url = "gMetis";
 static cll::opt<InitialPartMode> partMode(
     cll::desc("Choose a inital part mode:"),
     cll::values(clEnumVal(GGP, "GGP"), clEnumVal(GGGP, "GGGP (default)"),
-                clEnumVal(MGGGP, "MGGGP"), clEnumValEnd),
+                clEnumVal(MGGGP, "MGGGP"),
+                clEnumVal(PRB, "PRB (parallel recursive bisection)"),
+                clEnumValEnd),
     cll::init(GGGP));
 static cll::opt<refinementMode> refineMode(
-    cll::desc("Choose a refinement mode:"),
+    "refine", cll::desc("Choose a refinement mode:"),
     cll::values(clEnumVal(BKL, "BKL"), clEnumVal(BKL2, "BKL2 (default)"),
                 clEnumVal(ROBO, "ROBO"), clEnumVal(GRACLUS, "GRACLUS"),
+                clEnumValN(PARALLEL, "parallel",
+                           "parallel label propagation with balancing"),
                 clEnumValEnd),
     cll::init(BKL2));
 
@@ -131,6 +135,9 @@ void Partition(MetisGraph* metisGraph, unsigned nparts) {
     case GRACLUS:
       std::cout << "Sorting refinnement with GRACLUS\n";
       break;
+    case PARALLEL:
+      std::cout << "Sorting refinnement with parallel label propagation\n";
+      break;
     default:
       abort();
     }
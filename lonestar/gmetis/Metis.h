@@ -28,8 +28,8 @@ using GNode    = GGraph::GraphNode;
 using GNodeBag = galois::InsertBag<GNode>;
 
 // algorithms
-enum InitialPartMode { GGP, GGGP, MGGGP };
-enum refinementMode { BKL, BKL2, ROBO, GRACLUS };
+enum InitialPartMode { GGP, GGGP, MGGGP, PRB };
+enum refinementMode { BKL, BKL2, ROBO, GRACLUS, PARALLEL };
 // Nodes in the metis graph
 class MetisNode {
 
@@ -42,6 +42,9 @@ class MetisNode {
     unsigned partition;
     unsigned oldPartition;
     bool maybeBoundary;
+    // proposed move used by the parallel refinement
+    unsigned dest;
+    int gain;
   };
   struct partitionData {
     bool locked;
@@ -78,7 +81,7 @@ public:
 
   // call to switch data to refining
   void initRefine(unsigned part = 0, bool bound = false) {
-    refineData rd = {part, part, bound};
+    refineData rd = {part, part, bound, part, 0};
     data.rd       = rd;
   }
 
@@ -102,6 +105,18 @@ public:
 
   unsigned getPart() const { return data.rd.partition; }
   void setPart(unsigned val) { data.rd.partition = val; }
+  //! atomically move the node from oldPart to newPart; fails if it has
+  //! already been taken out of oldPart
+  bool casPart(unsigned oldPart, unsigned newPart) {
+    return __sync_bool_compare_and_swap(&data.rd.partition, oldPart, newPart);
+  }
+
+  unsigned getDest() const { return data.rd.dest; }
+  int getGain() const { return data.rd.gain; }
+  void setMove(unsigned dest, int gain) {
+    data.rd.dest = dest;
+    data.rd.gain = gain;
+  }
 
   int getOldPart() const { return data.rd.oldPartition; }
   void OldPartCpyNew() { data.rd.oldPartition = data.rd.partition; }
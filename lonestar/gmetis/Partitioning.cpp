@@ -401,6 +401,151 @@ void parallelBisect(MetisGraph* mg, unsigned totalWeight, unsigned nparts,
                    galois::wl<galois::worklists::ChunkLIFO<1>>());
 }
 
+/**
+ * Pick one seed in every part that is still growing. Seeds are the nodes of
+ * the source part with the smallest hash, so every round picks a different,
+ * well spread node without a serial scan of the graph.
+ */
+void pickSeeds(GGraph& g, const std::vector<unsigned>& srcOf,
+               const std::vector<unsigned>& targetWeight,
+               const std::vector<unsigned>& newWeight, unsigned salt,
+               std::vector<GNode>& seeds) {
+  using Candidates = std::vector<std::pair<size_t, GNode>>;
+  unsigned nparts  = srcOf.size();
+  galois::substrate::PerThreadStorage<Candidates> candidates;
+  // growing[p] is the new part the source part p is being split into
+  std::vector<unsigned> growing(nparts, ~0U);
+  for (unsigned q = 0; q < nparts; ++q)
+    if (srcOf[q] != ~0U && newWeight[q] < targetWeight[q])
+      growing[srcOf[q]] = q;
+
+  galois::do_all(
+      galois::iterate(g),
+      [&](GNode n) {
+        unsigned q = growing[g.getData(n, galois::MethodFlag::UNPROTECTED)
+                                 .getPart()];
+        if (q == ~0U)
+          return;
+        size_t key = (reinterpret_cast<size_t>(n) ^ salt) *
+                     0x9E3779B97F4A7C15ull;
+        auto& local = *candidates.getLocal();
+        if (local.empty())
+          local.resize(nparts, std::make_pair(~size_t(0), GNode(NULL)));
+        if (key < local[q].first)
+          local[q] = std::make_pair(key, n);
+      },
+      galois::loopname("PRB-Seed"));
+
+  seeds.assign(nparts, NULL);
+  std::vector<size_t> best(nparts, ~size_t(0));
+  for (unsigned i = 0; i < candidates.size(); ++i) {
+    auto& local = *candidates.getRemote(i);
+    for (unsigned q = 0; q < local.size(); ++q)
+      if (local[q].second && local[q].first < best[q]) {
+        best[q]  = local[q].first;
+        seeds[q] = local[q].second;
+      }
+  }
+}
+
+/**
+ * Grow all new parts of one bisection level at the same time. Every new part
+ * is grown breadth first from a seed inside its source part, one frontier
+ * per round, until it reaches its target weight. Nodes are claimed with a CAS
+ * on their part so each node joins at most one new part. Disconnected source
+ * parts are handled by reseeding.
+ */
+void growParts(GGraph& g, const std::vector<unsigned>& srcOf,
+               const std::vector<unsigned>& targetWeight,
+               std::vector<unsigned>& newWeight) {
+  constexpr auto flag = galois::MethodFlag::UNPROTECTED;
+  GNodeBag bags[2];
+  GNodeBag* cur  = &bags[0];
+  GNodeBag* next = &bags[1];
+  std::vector<GNode> seeds;
+
+  for (unsigned round = 0;; ++round) {
+    pickSeeds(g, srcOf, targetWeight, newWeight, round, seeds);
+    bool seeded = false;
+    for (unsigned q = 0; q < seeds.size(); ++q) {
+      if (!seeds[q])
+        continue;
+      auto& nd = g.getData(seeds[q], flag);
+      nd.setPart(q);
+      newWeight[q] += nd.getWeight();
+      cur->push(seeds[q]);
+      seeded = true;
+    }
+    if (!seeded)
+      break;
+
+    while (!cur->empty()) {
+      galois::do_all(
+          galois::iterate(*cur),
+          [&](GNode n) {
+            unsigned q = g.getData(n, flag).getPart();
+            unsigned p = srcOf[q];
+            for (auto ii : g.edges(n, flag)) {
+              GNode dst = g.getEdgeDst(ii);
+              auto& dd  = g.getData(dst, flag);
+              if (newWeight[q] >= targetWeight[q])
+                return;
+              if (dd.getPart() == p && dd.casPart(p, q)) {
+                __sync_fetch_and_add(&newWeight[q], dd.getWeight());
+                next->push(dst);
+              }
+            }
+          },
+          galois::steal(), galois::loopname("PRB-Grow"));
+      cur->clear();
+      std::swap(cur, next);
+    }
+  }
+}
+
+/**
+ * Parallel recursive bisection: all parts of one level of the bisection tree
+ * are split at the same time by growing the new halves in parallel, so the
+ * parallelism does not depend on the number of parts. The result is refined
+ * afterwards by the regular refinement.
+ */
+void parallelRecursiveBisect(MetisGraph* mcg, unsigned nparts,
+                             std::vector<partInfo>& parts) {
+  GGraph& g = *mcg->getGraph();
+  std::vector<unsigned> active(1, 0);
+  while (true) {
+    std::vector<unsigned> srcOf(nparts, ~0U);
+    std::vector<unsigned> targetWeight(nparts, 0);
+    std::vector<unsigned> newWeight(nparts, 0);
+    std::vector<unsigned> nextActive;
+    for (unsigned p : active) {
+      partInfo& item = parts[p];
+      if (item.splitID() >= nparts) // when to stop
+        continue;
+      std::pair<unsigned, unsigned> ratio = item.splitRatio(nparts);
+      partInfo newPart                    = item.split();
+      newPart.partWeight                  = 0;
+      parts[newPart.partNum]              = newPart;
+      srcOf[newPart.partNum]              = p;
+      targetWeight[newPart.partNum] =
+          item.partWeight * ratio.second / (ratio.first + ratio.second);
+      nextActive.push_back(p);
+      nextActive.push_back(newPart.partNum);
+    }
+    if (nextActive.empty())
+      break;
+
+    growParts(g, srcOf, targetWeight, newWeight);
+
+    for (unsigned q = 0; q < nparts; ++q)
+      if (srcOf[q] != ~0U) {
+        parts[q].partWeight = newWeight[q];
+        parts[srcOf[q]].partWeight -= newWeight[q];
+      }
+    active.swap(nextActive);
+  }
+}
+
 } // namespace
 
 std::vector<partInfo> partition(MetisGraph* mcg, unsigned fineMetisGraphWeight,
@@ -433,6 +578,9 @@ std::vector<partInfo> partition(MetisGraph* mcg, unsigned fineMetisGraphWeight,
     default:
       abort();
     }
+  } else if (partMode == PRB) {
+    std::cout << "\nSorting initial partitioning using PRB:\n";
+    parallelRecursiveBisect(mcg, numPartitions, parts);
   } else {
     switch (partMode) {
     case GGP:
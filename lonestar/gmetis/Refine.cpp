@@ -21,6 +21,8 @@
 #include "galois/Reduction.h"
 #include "galois/Timer.h"
 #include "Metis.h"
+#include <algorithm>
+#include <limits>
 #include <set>
 #include <iostream>
 
@@ -381,13 +383,284 @@ void GraclusRefining(GGraph* graph, int nbParti, int nbIter) {
   std::cout<<std::endl;*/
 }
 
+//! Per-thread scratch space holding the connectivity of one node to each part
+struct PartConnectivity {
+  std::vector<int> conn;
+  std::vector<unsigned> touched;
+
+  void reset(unsigned nparts) {
+    for (unsigned p : touched)
+      conn[p] = 0;
+    touched.clear();
+    if (conn.size() < nparts)
+      conn.resize(nparts, 0);
+  }
+
+  void add(unsigned part, int weight) {
+    if (!conn[part])
+      touched.push_back(part);
+    conn[part] += weight;
+  }
+};
+using ThreadConnectivity =
+    galois::substrate::PerThreadStorage<PartConnectivity>;
+
+PartConnectivity& connectivity(GGraph& g, GNode n, ThreadConnectivity& tc,
+                               unsigned nparts) {
+  constexpr auto flag = galois::MethodFlag::UNPROTECTED;
+  auto& pc            = *tc.getLocal();
+  pc.reset(nparts);
+  for (auto ii : g.edges(n, flag))
+    pc.add(g.getData(g.getEdgeDst(ii), flag).getPart(),
+           g.getEdgeData(ii, flag));
+  return pc;
+}
+
+/**
+ * One round of label propagation. Every node proposes a move to the adjacent
+ * part with the highest positive gain, then the proposals are filtered as in
+ * Jet: the gain of a move is recomputed assuming that all neighbors with a
+ * higher priority (higher gain, ties broken by node) have already moved, and
+ * only the moves that still improve the cut are applied. This keeps
+ * neighboring nodes from swapping back and forth without any locking.
+ *
+ * @returns number of nodes moved
+ */
+size_t labelPropagationRound(GGraph& g, std::vector<partInfo>& parts,
+                             unsigned minSize, unsigned maxSize,
+                             ThreadConnectivity& tc) {
+  constexpr auto flag = galois::MethodFlag::UNPROTECTED;
+  unsigned nparts     = parts.size();
+
+  galois::do_all(
+      galois::iterate(g),
+      [&](GNode n) {
+        auto& nd      = g.getData(n, flag);
+        unsigned cur  = nd.getPart();
+        unsigned dest = cur;
+        int bestGain  = 0;
+        if (parts[cur].partWeight >= minSize) {
+          auto& pc = connectivity(g, n, tc, nparts);
+          for (unsigned p : pc.touched) {
+            if (p == cur || parts[p].partWeight + nd.getWeight() > maxSize)
+              continue;
+            int gain = pc.conn[p] - pc.conn[cur];
+            if (gain > bestGain ||
+                (gain == bestGain && dest != cur && p < dest)) {
+              bestGain = gain;
+              dest     = p;
+            }
+          }
+        }
+        nd.setMove(dest, bestGain);
+      },
+      galois::steal(), galois::loopname("RefineLP-Propose"));
+
+  GNodeBag movers;
+  galois::do_all(
+      galois::iterate(g),
+      [&](GNode n) {
+        auto& nd      = g.getData(n, flag);
+        unsigned cur  = nd.getPart();
+        unsigned dest = nd.getDest();
+        if (dest == cur)
+          return;
+        int gain = 0;
+        for (auto ii : g.edges(n, flag)) {
+          GNode neigh   = g.getEdgeDst(ii);
+          auto& md      = g.getData(neigh, flag);
+          unsigned part = md.getPart();
+          if (md.getDest() != part &&
+              (md.getGain() > nd.getGain() ||
+               (md.getGain() == nd.getGain() && neigh < n)))
+            part = md.getDest();
+          if (part == dest)
+            gain += g.getEdgeData(ii, flag);
+          else if (part == cur)
+            gain -= g.getEdgeData(ii, flag);
+        }
+        if (gain > 0)
+          movers.push(n);
+      },
+      galois::steal(), galois::loopname("RefineLP-Filter"));
+
+  galois::GAccumulator<size_t> moved;
+  galois::do_all(
+      galois::iterate(movers),
+      [&](GNode n) {
+        auto& nd = g.getData(n, flag);
+        __sync_fetch_and_sub(&parts[nd.getPart()].partWeight, nd.getWeight());
+        __sync_fetch_and_add(&parts[nd.getDest()].partWeight, nd.getWeight());
+        nd.setPart(nd.getDest());
+        moved += 1;
+      },
+      galois::loopname("RefineLP-Apply"));
+  return moved.reduce();
+}
+
+//! Gain buckets used by the balancer; bucket 0 holds moves that do not
+//! increase the cut and bucket b > 0 moves losing [2^(b-1), 2^b) per unit
+//! of node weight
+constexpr unsigned NUM_GAIN_BUCKETS = 16;
+
+unsigned lossBucket(int loss, unsigned weight) {
+  if (loss <= 0)
+    return 0;
+  unsigned perWeight = std::max(1U, (unsigned)loss / std::max(1U, weight));
+  unsigned bucket    = 1;
+  while (perWeight >>= 1)
+    ++bucket;
+  return std::min(bucket, NUM_GAIN_BUCKETS - 1);
+}
+
+/**
+ * One round of parallel balancing. Every node of an overweight part picks the
+ * least damaging part it can move to, and the candidates are sorted into gain
+ * buckets per source part. Each overweight part then sheds just enough weight
+ * taken from its cheapest buckets; destinations are reserved with an atomic
+ * add so no part is pushed over maxSize.
+ *
+ * @returns number of nodes moved
+ */
+size_t balanceRound(GGraph& g, std::vector<partInfo>& parts, unsigned maxSize,
+                    ThreadConnectivity& tc) {
+  constexpr auto flag = galois::MethodFlag::UNPROTECTED;
+  unsigned nparts     = parts.size();
+  unsigned lightest   = 0;
+  for (unsigned p = 1; p < nparts; ++p)
+    if (parts[p].partWeight < parts[lightest].partWeight)
+      lightest = p;
+
+  std::vector<unsigned> bucketWeight(nparts * NUM_GAIN_BUCKETS, 0);
+  galois::do_all(
+      galois::iterate(g),
+      [&](GNode n) {
+        auto& nd     = g.getData(n, flag);
+        unsigned cur = nd.getPart();
+        nd.setMove(cur, 0);
+        if (parts[cur].partWeight <= maxSize)
+          return;
+        auto& pc      = connectivity(g, n, tc, nparts);
+        unsigned dest = cur;
+        int bestLoss  = std::numeric_limits<int>::max();
+        // the lightest part is always a candidate so nodes inside an
+        // overweight part can still leave it
+        if (lightest != cur &&
+            parts[lightest].partWeight + nd.getWeight() <= maxSize) {
+          dest     = lightest;
+          bestLoss = pc.conn[cur] - pc.conn[lightest];
+        }
+        for (unsigned p : pc.touched) {
+          if (p == cur || parts[p].partWeight + nd.getWeight() > maxSize)
+            continue;
+          int loss = pc.conn[cur] - pc.conn[p];
+          if (loss < bestLoss) {
+            bestLoss = loss;
+            dest     = p;
+          }
+        }
+        if (dest == cur)
+          return;
+        unsigned bucket = lossBucket(bestLoss, nd.getWeight());
+        nd.setMove(dest, bucket);
+        __sync_fetch_and_add(&bucketWeight[cur * NUM_GAIN_BUCKETS + bucket],
+                             nd.getWeight());
+      },
+      galois::steal(), galois::loopname("RefineBalance-Bucket"));
+
+  // per part: buckets below cutoff move entirely, the cutoff bucket moves
+  // until budget is used up
+  std::vector<unsigned> cutoff(nparts, 0);
+  std::vector<unsigned> budget(nparts, 0);
+  std::vector<unsigned> used(nparts, 0);
+  for (unsigned p = 0; p < nparts; ++p) {
+    if (parts[p].partWeight <= maxSize)
+      continue;
+    unsigned excess = parts[p].partWeight - maxSize;
+    unsigned sum    = 0;
+    cutoff[p]       = NUM_GAIN_BUCKETS;
+    for (unsigned b = 0; b < NUM_GAIN_BUCKETS; ++b) {
+      unsigned w = bucketWeight[p * NUM_GAIN_BUCKETS + b];
+      if (sum + w >= excess) {
+        cutoff[p] = b;
+        budget[p] = excess - sum;
+        break;
+      }
+      sum += w;
+    }
+  }
+
+  galois::GAccumulator<size_t> moved;
+  galois::do_all(
+      galois::iterate(g),
+      [&](GNode n) {
+        auto& nd        = g.getData(n, flag);
+        unsigned cur    = nd.getPart();
+        unsigned dest   = nd.getDest();
+        unsigned bucket = nd.getGain();
+        if (dest == cur || bucket > cutoff[cur])
+          return;
+        if (bucket == cutoff[cur] &&
+            __sync_fetch_and_add(&used[cur], nd.getWeight()) >= budget[cur])
+          return;
+        if (__sync_add_and_fetch(&parts[dest].partWeight, nd.getWeight()) >
+            maxSize) {
+          __sync_fetch_and_sub(&parts[dest].partWeight, nd.getWeight());
+          return;
+        }
+        __sync_fetch_and_sub(&parts[cur].partWeight, nd.getWeight());
+        nd.setPart(dest);
+        moved += 1;
+      },
+      galois::steal(), galois::loopname("RefineBalance-Move"));
+  return moved.reduce();
+}
+
+unsigned heaviestPart(const std::vector<partInfo>& parts) {
+  unsigned w = 0;
+  for (auto& p : parts)
+    w = std::max(w, p.partWeight);
+  return w;
+}
+
+/**
+ * Fully parallel refinement of one level: alternate label propagation rounds
+ * with balancing rounds whenever a part is heavier than maxSize, until a
+ * round moves nothing.
+ *
+ * @returns number of nodes moved
+ */
+size_t refine_parallel(unsigned minSize, unsigned maxSize, GGraph& g,
+                       std::vector<partInfo>& parts) {
+  const unsigned maxRounds = 16;
+  ThreadConnectivity tc;
+  size_t total = 0;
+  size_t moved = 0;
+  for (unsigned round = 0; round < maxRounds; ++round) {
+    moved = 0;
+    if (heaviestPart(parts) > maxSize)
+      moved = balanceRound(g, parts, maxSize, tc);
+    if (!moved)
+      moved = labelPropagationRound(g, parts, minSize, maxSize, tc);
+    if (!moved)
+      break;
+    total += moved;
+  }
+  // the last rounds may have left a part overweight
+  while (heaviestPart(parts) > maxSize &&
+         (moved = balanceRound(g, parts, maxSize, tc)))
+    total += moved;
+  return total;
+}
+
 } // namespace
 
 void refine(MetisGraph* coarseGraph, std::vector<partInfo>& parts,
             unsigned minSize, unsigned maxSize, refinementMode refM,
             bool verbose) {
-  MetisGraph* tGraph = coarseGraph;
-  int nbIter         = 1;
+  MetisGraph* tGraph   = coarseGraph;
+  int nbIter           = 1;
+  size_t parallelMoves = 0;
   if (refM == GRACLUS) {
     while ((tGraph = tGraph->getFinerGraph()))
       nbIter *= 2;
@@ -419,6 +692,10 @@ void refine(MetisGraph* coarseGraph, std::vector<partInfo>& parts,
       GraclusRefining(coarseGraph->getGraph(), parts.size(), nbIter);
       nbIter = (nbIter + 1) / 2;
       break;
+    case PARALLEL:
+      parallelMoves += refine_parallel(minSize, maxSize,
+                                       *coarseGraph->getGraph(), parts);
+      break;
     default:
       abort();
     }
@@ -427,6 +704,9 @@ void refine(MetisGraph* coarseGraph, std::vector<partInfo>& parts,
       projectPart(coarseGraph, parts);
     }
   } while ((coarseGraph = coarseGraph->getFinerGraph()));
+
+  if (refM == PARALLEL)
+    galois::runtime::reportStat_Single("Refine", "Moves", parallelMoves);
 }
 
 /*
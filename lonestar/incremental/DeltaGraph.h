@@ -0,0 +1,173 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+#ifndef LONESTAR_DELTA_GRAPH_H
+#define LONESTAR_DELTA_GRAPH_H
+
+#include "galois/Galois.h"
+#include "galois/LargeArray.h"
+#include "galois/ParallelSTL.h"
+#include "galois/graphs/LCGraph.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * Delta-CSR overlay: a read-only CSR base graph plus, per node, a list of
+ * inserted out-edges and a deleted flag per base edge. Small batches of edge
+ * updates are applied in place; once the overlay grows past a fraction of the
+ * base, compact() folds it into a fresh CSR.
+ *
+ * Updates of different source nodes may be applied concurrently; updates of
+ * the same source must not be.
+ */
+class DeltaGraph {
+public:
+  using Base = galois::graphs::LC_CSR_Graph<void, void>::with_no_lockable<
+      true>::type::with_numa_alloc<true>::type;
+  using GNode = uint32_t;
+
+  struct Update {
+    GNode src;
+    GNode dst;
+    bool insert;
+  };
+
+  void readGraph(const std::string& filename) {
+    galois::graphs::readGraph(base, filename);
+    resetOverlay();
+  }
+
+  size_t size() const { return base.size(); }
+  size_t sizeEdges() const { return base.sizeEdges() + numAdded - numDeleted; }
+  uint32_t degree(GNode n) const { return degrees[n]; }
+
+  //! Overlay edges relative to the base
+  size_t sizeDelta() const { return numAdded + numDeleted; }
+  bool shouldCompact() const { return sizeDelta() > base.sizeEdges() / 8; }
+
+  template <typename Fn>
+  void forEachOut(GNode n, Fn fn) {
+    for (auto ii : base.edges(n, galois::MethodFlag::UNPROTECTED))
+      if (!deleted[*ii])
+        fn(base.getEdgeDst(ii));
+    for (GNode dst : added[n])
+      fn(dst);
+  }
+
+  void insertEdge(GNode src, GNode dst) {
+    added[src].push_back(dst);
+    degrees[src]++;
+    __sync_fetch_and_add(&numAdded, 1);
+  }
+
+  //! Removes one src -> dst edge; returns false if there is none
+  bool removeEdge(GNode src, GNode dst) {
+    auto& extra = added[src];
+    for (auto ii = extra.begin(), ei = extra.end(); ii != ei; ++ii) {
+      if (*ii == dst) {
+        *ii = extra.back();
+        extra.pop_back();
+        degrees[src]--;
+        __sync_fetch_and_sub(&numAdded, 1);
+        return true;
+      }
+    }
+    for (auto ii : base.edges(src, galois::MethodFlag::UNPROTECTED)) {
+      if (!deleted[*ii] && base.getEdgeDst(ii) == dst) {
+        deleted[*ii] = true;
+        degrees[src]--;
+        __sync_fetch_and_add(&numDeleted, 1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Sorts a batch by source and returns the start of each run of updates to
+   * the same source, followed by the batch size.
+   */
+  static std::vector<size_t> groupBySource(std::vector<Update>& batch) {
+    galois::ParallelSTL::sort(batch.begin(), batch.end(),
+                              [](const Update& a, const Update& b) {
+                                return a.src < b.src;
+                              });
+    std::vector<size_t> runs;
+    for (size_t i = 0; i < batch.size(); ++i)
+      if (i == 0 || batch[i].src != batch[i - 1].src)
+        runs.push_back(i);
+    runs.push_back(batch.size());
+    return runs;
+  }
+
+  //! Folds the overlay into a new CSR base
+  void compact() {
+    size_t numNodes = base.size();
+    galois::LargeArray<uint64_t> offsets;
+    offsets.create(numNodes + 1);
+    for (size_t n = 0; n < numNodes; ++n)
+      offsets[n + 1] = offsets[n] + degrees[n];
+
+    Base next;
+    next.allocateFrom(numNodes, offsets[numNodes]);
+    next.constructNodes();
+    galois::do_all(galois::iterate(size_t{0}, numNodes),
+                   [&](size_t n) {
+                     next.fixEndEdge(n, offsets[n + 1]);
+                     uint64_t e = offsets[n];
+                     forEachOut(n, [&](GNode dst) {
+                       next.constructEdge(e++, dst);
+                     });
+                   },
+                   galois::steal(), galois::loopname("CompactDeltaGraph"));
+    swap(base, next);
+    resetOverlay();
+  }
+
+private:
+  Base base;
+  galois::LargeArray<bool> deleted;
+  galois::LargeArray<std::vector<GNode>> added;
+  galois::LargeArray<uint32_t> degrees;
+  size_t numAdded;
+  size_t numDeleted;
+
+  void resetOverlay() {
+    deleted.destroy();
+    deleted.deallocate();
+    deleted.create(base.sizeEdges(), false);
+    added.destroy();
+    added.deallocate();
+    added.create(base.size());
+    degrees.destroy();
+    degrees.deallocate();
+    degrees.create(base.size());
+    galois::do_all(galois::iterate(base),
+                   [&](GNode n) {
+                     degrees[n] = std::distance(base.edge_begin(n),
+                                                base.edge_end(n));
+                   },
+                   galois::no_stats());
+    numAdded   = 0;
+    numDeleted = 0;
+  }
+};
+
+#endif
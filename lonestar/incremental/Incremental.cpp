@@ -0,0 +1,407 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+#include "galois/Galois.h"
+#include "galois/Bag.h"
+#include "galois/LargeArray.h"
+#include "galois/Reduction.h"
+#include "galois/Timer.h"
+#include "galois/UnionFind.h"
+#include "llvm/Support/CommandLine.h"
+
+#include "Lonestar/BoilerPlate.h"
+#include "DeltaGraph.h"
+
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace cll = llvm::cl;
+
+static const char* name = "Incremental PageRank and Connected Components";
+static const char* desc =
+    "Computes page ranks and connected components once, then applies batches "
+    "of edge insertions and deletions and repairs both results locally";
+static const char* url = 0;
+
+static cll::opt<std::string>
+    filename(cll::Positional, cll::desc("<input graph>"), cll::Required);
+static cll::list<std::string>
+    batchFiles(cll::Positional, cll::desc("<update batches>..."),
+               cll::ZeroOrMore);
+static cll::opt<float> tolerance("tolerance", cll::desc("tolerance"),
+                                 cll::init(1.0e-3));
+
+enum Algo { PageRank, CC, Both };
+
+static cll::opt<Algo>
+    algo("algo", cll::desc("Choose what to maintain:"),
+         cll::values(clEnumVal(PageRank, "PageRank"), clEnumVal(CC, "CC"),
+                     clEnumVal(Both, "Both"), clEnumValEnd),
+         cll::init(Both));
+
+// Same constants as the pagerank apps
+constexpr static const float ALPHA         = 0.85;
+constexpr static const float INIT_RESIDUAL = 1 - ALPHA;
+constexpr static const unsigned CHUNK_SIZE = 16;
+
+using Graph  = DeltaGraph;
+using GNode  = Graph::GNode;
+using Update = Graph::Update;
+typedef float PRTy;
+
+PRTy atomicAdd(std::atomic<PRTy>& v, PRTy delta) {
+  PRTy old;
+  do {
+    old = v;
+  } while (!v.compare_exchange_strong(old, old + delta));
+  return old;
+}
+
+struct CCNode : public galois::UnionFindNode<CCNode> {
+  CCNode() : galois::UnionFindNode<CCNode>(this) {}
+  void reset() { m_component.store(this, std::memory_order_relaxed); }
+};
+
+/**
+ * Residual-push PageRank state. value and residual always satisfy
+ * residual = (1 - ALPHA) + ALPHA * P^T value - value for the current graph,
+ * so an edge update only needs to correct the residuals of the neighbors of
+ * the updated source and push from nodes whose residual magnitude exceeds the
+ * tolerance.
+ */
+struct PageRankState {
+  galois::LargeArray<std::atomic<PRTy>> value;
+  galois::LargeArray<std::atomic<PRTy>> residual;
+
+  void init(Graph& graph) {
+    value.create(graph.size());
+    residual.create(graph.size());
+    galois::do_all(galois::iterate(size_t{0}, graph.size()),
+                   [&](size_t n) {
+                     value[n]    = 0;
+                     residual[n] = INIT_RESIDUAL;
+                   },
+                   galois::no_stats(), galois::loopname("InitializePR"));
+  }
+
+  //! Adds ALPHA * value(src) / degree(src) times sign to every out-neighbor
+  template <typename Bag>
+  void spread(Graph& graph, GNode src, PRTy sign, Bag& touched) {
+    uint32_t degree = graph.degree(src);
+    if (!degree)
+      return;
+    PRTy delta = sign * value[src] * ALPHA / degree;
+    graph.forEachOut(src, [&](GNode dst) {
+      atomicAdd(residual[dst], delta);
+      touched.push(dst);
+    });
+  }
+
+  //! Async push from the seeds until every residual is within tolerance
+  size_t push(Graph& graph, galois::InsertBag<GNode>& seeds) {
+    typedef galois::worklists::PerSocketChunkFIFO<CHUNK_SIZE> WL;
+    galois::GAccumulator<size_t> pushes;
+    galois::for_each(
+        galois::iterate(seeds),
+        [&](GNode src, auto& ctx) {
+          if (std::fabs(residual[src]) <= tolerance)
+            return;
+          PRTy oldResidual = residual[src].exchange(0.0);
+          atomicAdd(value[src], oldResidual);
+          pushes += 1;
+          uint32_t degree = graph.degree(src);
+          if (!degree)
+            return;
+          PRTy delta = oldResidual * ALPHA / degree;
+          graph.forEachOut(src, [&](GNode dst) {
+            PRTy old = atomicAdd(residual[dst], delta);
+            if (std::fabs(old) <= tolerance &&
+                std::fabs(old + delta) > tolerance)
+              ctx.push(dst);
+          });
+        },
+        galois::loopname("PushResidual"), galois::no_conflicts(),
+        galois::wl<WL>());
+    return pushes.reduce();
+  }
+};
+
+void computePageRank(Graph& graph, PageRankState& pr) {
+  pr.init(graph);
+  galois::InsertBag<GNode> seeds;
+  galois::do_all(galois::iterate(size_t{0}, graph.size()),
+                 [&](size_t n) { seeds.push(n); }, galois::no_stats());
+  pr.push(graph, seeds);
+}
+
+void computeComponents(Graph& graph, galois::LargeArray<CCNode>& cc) {
+  cc.create(graph.size());
+  galois::do_all(galois::iterate(size_t{0}, graph.size()),
+                 [&](size_t n) {
+                   graph.forEachOut(
+                       n, [&](GNode dst) { cc[n].merge(&cc[dst]); });
+                 },
+                 galois::steal(), galois::loopname("Merge"));
+}
+
+size_t countComponents(Graph& graph, galois::LargeArray<CCNode>& cc) {
+  galois::GAccumulator<size_t> reps;
+  galois::do_all(galois::iterate(size_t{0}, graph.size()),
+                 [&](size_t n) {
+                   if (cc[n].isRep())
+                     reps += 1;
+                 },
+                 galois::no_stats());
+  return reps.reduce();
+}
+
+std::vector<Update> readBatch(const std::string& file, size_t numNodes) {
+  std::ifstream in(file);
+  if (!in.is_open())
+    GALOIS_DIE("could not open update batch ", file);
+
+  std::vector<Update> batch;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream ss(line);
+    char op;
+    uint64_t src, dst;
+    if (line.empty() || line[0] == '#' || !(ss >> op >> src >> dst))
+      continue;
+    if ((op != '+' && op != '-') || src >= numNodes || dst >= numNodes)
+      GALOIS_DIE("bad edge update: ", line);
+    batch.push_back(Update{(GNode)src, (GNode)dst, op == '+'});
+  }
+  return batch;
+}
+
+/**
+ * Applies one batch to the graph. Updates are grouped by source; for each
+ * updated source the PageRank contribution over its old out-edges is
+ * withdrawn and the contribution over its new out-edges is added, which keeps
+ * the residual invariant. Returns the number of deletions of missing edges.
+ */
+size_t applyBatch(Graph& graph, std::vector<Update>& batch, PageRankState* pr,
+                  galois::InsertBag<GNode>& touched) {
+  std::vector<size_t> runs = Graph::groupBySource(batch);
+  galois::GAccumulator<size_t> missing;
+
+  galois::do_all(
+      galois::iterate(size_t{0}, runs.size() - 1),
+      [&](size_t r) {
+        GNode src = batch[runs[r]].src;
+        if (pr)
+          pr->spread(graph, src, -1, touched);
+        for (size_t i = runs[r]; i < runs[r + 1]; ++i) {
+          if (batch[i].insert)
+            graph.insertEdge(src, batch[i].dst);
+          else if (!graph.removeEdge(src, batch[i].dst))
+            missing += 1;
+        }
+        if (pr)
+          pr->spread(graph, src, 1, touched);
+      },
+      galois::steal(), galois::loopname("ApplyBatch"));
+  return missing.reduce();
+}
+
+/**
+ * Insertions only merge components. A deletion may split the component it
+ * was in, so every component containing a deleted edge is reset and rebuilt
+ * from the out-edges of its nodes; other components are left untouched.
+ * Returns the number of nodes reset.
+ */
+size_t repairComponents(Graph& graph, galois::LargeArray<CCNode>& cc,
+                        const std::vector<Update>& batch) {
+  galois::LargeArray<bool> affectedRep;
+  affectedRep.create(graph.size(), false);
+  bool anyDeleted = false;
+  for (const Update& u : batch) {
+    if (!u.insert) {
+      affectedRep[cc[u.src].findAndCompress() - &cc[0]] = true;
+      anyDeleted                                        = true;
+    }
+  }
+
+  galois::InsertBag<GNode> affected;
+  if (anyDeleted) {
+    galois::do_all(galois::iterate(size_t{0}, graph.size()),
+                   [&](size_t n) {
+                     if (affectedRep[cc[n].find() - &cc[0]])
+                       affected.push(n);
+                   },
+                   galois::loopname("FindAffected"));
+    galois::do_all(galois::iterate(affected),
+                   [&](GNode n) { cc[n].reset(); }, galois::no_stats());
+    galois::do_all(galois::iterate(affected),
+                   [&](GNode n) {
+                     graph.forEachOut(
+                         n, [&](GNode dst) { cc[n].merge(&cc[dst]); });
+                   },
+                   galois::steal(), galois::loopname("RebuildAffected"));
+  }
+
+  galois::do_all(galois::iterate(batch),
+                 [&](const Update& u) {
+                   if (u.insert)
+                     cc[u.src].merge(&cc[u.dst]);
+                 },
+                 galois::loopname("MergeInserted"));
+  return std::distance(affected.begin(), affected.end());
+}
+
+//! Compares the maintained results against a recomputation from scratch
+void verify(Graph& graph, PageRankState* pr, galois::LargeArray<CCNode>* cc) {
+  if (pr) {
+    PageRankState fresh;
+    computePageRank(graph, fresh);
+    galois::GAccumulator<double> diff, residuals, mass;
+    galois::do_all(galois::iterate(size_t{0}, graph.size()),
+                   [&](size_t n) {
+                     diff += std::fabs(pr->value[n] - fresh.value[n]);
+                     residuals += std::fabs(pr->residual[n]) +
+                                  std::fabs(fresh.residual[n]);
+                     mass += fresh.value[n];
+                   },
+                   galois::no_stats());
+    // Both solutions are within |residual|_1 / (1 - ALPHA) of the exact
+    // ranks in the 1-norm; allow some float rounding on top
+    double bound = residuals.reduce() / (1 - ALPHA) + 1e-4 * mass.reduce();
+    if (diff.reduce() > bound)
+      GALOIS_DIE("PageRank differs from recomputation by ", diff.reduce(),
+                 " (bound ", bound, ")");
+  }
+
+  if (cc) {
+    galois::LargeArray<CCNode> fresh;
+    computeComponents(graph, fresh);
+    galois::GReduceLogicalOR split;
+    galois::do_all(galois::iterate(size_t{0}, graph.size()),
+                   [&](size_t n) {
+                     graph.forEachOut(n, [&](GNode dst) {
+                       if ((*cc)[n].find() != (*cc)[dst].find())
+                         split.update(true);
+                     });
+                   },
+                   galois::no_stats());
+    // No edge crosses two components and the counts match: same partition
+    if (split.reduce() ||
+        countComponents(graph, *cc) != countComponents(graph, fresh))
+      GALOIS_DIE("components differ from recomputation");
+  }
+  std::cout << "Verification successful.\n";
+}
+
+int main(int argc, char** argv) {
+  galois::SharedMemSys G;
+  LonestarStart(argc, argv, name, desc, url);
+
+  Graph graph;
+  graph.readGraph(filename);
+  std::cout << "Read " << graph.size() << " nodes, " << graph.sizeEdges()
+            << " edges\n";
+
+  galois::preAlloc(5 * numThreads +
+                   (5 * graph.size() * sizeof(PRTy)) /
+                       galois::runtime::pagePoolSize());
+  galois::reportPageAlloc("MeminfoPre");
+
+  PageRankState prState;
+  galois::LargeArray<CCNode> ccState;
+  PageRankState* pr              = algo != CC ? &prState : nullptr;
+  galois::LargeArray<CCNode>* cc = algo != PageRank ? &ccState : nullptr;
+
+  galois::StatTimer Tinit("InitialTime");
+  Tinit.start();
+  if (pr)
+    computePageRank(graph, *pr);
+  if (cc)
+    computeComponents(graph, *cc);
+  Tinit.stop();
+  std::cout << "Initial computation: " << Tinit.get() << " ms";
+  if (cc)
+    std::cout << ", " << countComponents(graph, *cc) << " components";
+  std::cout << "\n";
+
+  galois::StatTimer Tmain;
+  galois::StatTimer Tpr("PageRankRepairTime");
+  galois::StatTimer Tcc("CCRepairTime");
+  const char* region = "Incremental";
+
+  for (size_t b = 0; b < batchFiles.size(); ++b) {
+    std::vector<Update> batch = readBatch(batchFiles[b], graph.size());
+    galois::InsertBag<GNode> touched;
+    galois::Timer batchTimer, prTimer, ccTimer;
+
+    Tmain.start();
+    batchTimer.start();
+    size_t missing = applyBatch(graph, batch, pr, touched);
+    batchTimer.stop();
+
+    size_t pushes = 0;
+    if (pr) {
+      Tpr.start();
+      prTimer.start();
+      pushes = pr->push(graph, touched);
+      prTimer.stop();
+      Tpr.stop();
+    }
+
+    size_t reset = 0;
+    if (cc) {
+      Tcc.start();
+      ccTimer.start();
+      reset = repairComponents(graph, *cc, batch);
+      ccTimer.stop();
+      Tcc.stop();
+    }
+
+    bool compacted = graph.shouldCompact();
+    if (compacted)
+      graph.compact();
+    Tmain.stop();
+
+    std::cout << "Batch " << b << ": " << batch.size() << " updates ("
+              << missing << " missing edges), apply " << batchTimer.get()
+              << " ms";
+    if (pr)
+      std::cout << ", PageRank " << prTimer.get() << " ms (" << pushes
+                << " pushes)";
+    if (cc)
+      std::cout << ", CC " << ccTimer.get() << " ms (" << reset
+                << " nodes reset, " << countComponents(graph, *cc)
+                << " components)";
+    std::cout << (compacted ? ", compacted" : "") << "\n";
+
+    galois::runtime::reportStat_Single(region, "Updates", batch.size());
+    galois::runtime::reportStat_Single(region, "MissingEdges", missing);
+    galois::runtime::reportStat_Single(region, "Pushes", pushes);
+    galois::runtime::reportStat_Single(region, "NodesReset", reset);
+
+    if (!skipVerify)
+      verify(graph, pr, cc);
+  }
+
+  galois::reportPageAlloc("MeminfoPost");
+
+  return 0;
+}
@@ -63,6 +63,10 @@ static cll::opt<Algo> algo(
             "edge-tiled prio algo based on Martin's GPU ECL-MIS algorithm"),
         clEnumValEnd),
     cll::init(prio));
+static cll::opt<bool> detAdaptive(
+    "detAdaptive",
+    cll::desc("Size deterministic rounds from the previous commit ratio"),
+    cll::init(false));
 
 enum MatchFlag : char { UNMATCHED, OTHER_MATCHED, MATCHED };
 
@@ -179,7 +183,8 @@ struct DefaultAlgo {
   }
 
   void operator()(Graph& graph) {
-    using DWL = galois::worklists::Deterministic<>;
+    using DWL  = galois::worklists::Deterministic<>;
+    using ADWL = galois::worklists::DeterministicAdaptive<>;
 
     using BSWL = galois::worklists::BulkSynchronous<
         typename galois::worklists::PerSocketChunkFIFO<64>>;
@@ -190,7 +195,10 @@ struct DefaultAlgo {
       run<BSWL>(graph);
       break;
     case detBase:
-      run<DWL>(graph);
+      if (detAdaptive)
+        run<ADWL>(graph);
+      else
+        run<DWL>(graph);
       break;
     default:
       std::cerr << "Unknown algorithm" << algo << "\n";
@@ -0,0 +1,630 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+#include "galois/Galois.h"
+#include "galois/AtomicWrapper.h"
+#include "galois/Bag.h"
+#include "galois/FlatMap.h"
+#include "galois/LargeArray.h"
+#include "galois/Reduction.h"
+#include "galois/Timer.h"
+#include "galois/graphs/FileGraph.h"
+#include "galois/graphs/LCGraph.h"
+#include "galois/substrate/PerThreadStorage.h"
+#include "llvm/Support/CommandLine.h"
+
+#include "Lonestar/BoilerPlate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+const char* name = "Louvain";
+const char* desc = "Detects communities by maximizing modularity with the "
+                   "multilevel Louvain method";
+const char* url = "louvain";
+
+enum Algo { nondet, colored };
+
+namespace cll = llvm::cl;
+static cll::opt<std::string> filename(cll::Positional,
+                                      cll::desc("<input graph (symmetric)>"),
+                                      cll::Required);
+static cll::opt<Algo> algo(
+    "algo", cll::desc("Choose an algorithm:"),
+    cll::values(clEnumVal(nondet, "Asynchronous local moves (default)"),
+                clEnumVal(colored, "Deterministic local moves one color "
+                                   "class at a time"),
+                clEnumValEnd),
+    cll::init(nondet));
+static cll::opt<bool> useEdgeWeights("useEdgeWeights",
+                                     cll::desc("Use 32-bit integer edge data "
+                                               "of the input as weights "
+                                               "(default all weights 1)"),
+                                     cll::init(false));
+static cll::opt<bool>
+    vertexFollowing("vertexFollowing",
+                    cll::desc("Merge degree-one nodes into their neighbor's "
+                              "community before the first level (default "
+                              "true)"),
+                    cll::init(true));
+static cll::opt<unsigned> maxLevels("maxLevels",
+                                    cll::desc("Maximum number of coarsening "
+                                              "levels (default 32)"),
+                                    cll::init(32));
+static cll::opt<unsigned> maxIterations("maxIterations",
+                                        cll::desc("Maximum local move sweeps "
+                                                  "per level (default 100)"),
+                                        cll::init(100));
+static cll::opt<double> threshold("threshold",
+                                  cll::desc("Minimum modularity gain of a "
+                                            "sweep or level to continue "
+                                            "(default 1e-6)"),
+                                  cll::init(1e-6));
+static cll::opt<std::string> outputFile("output",
+                                        cll::desc("Write the community of "
+                                                  "each node to this file"),
+                                        cll::init(""));
+
+// integer weights keep all community totals exact, so the colored algorithm
+// produces the same result regardless of the order of atomic updates
+using EdgeWeight = uint64_t;
+using Graph = galois::graphs::LC_CSR_Graph<void, EdgeWeight>::with_no_lockable<
+    true>::type ::with_numa_alloc<true>::type;
+using GNode = Graph::GraphNode;
+
+using CommunityMap = galois::flat_map<uint32_t, EdgeWeight>;
+using AtomicWeight = galois::CopyableAtomic<EdgeWeight>;
+
+//! Level graphs are built by hand, so loops go over node ids rather than the
+//! graph's (unset) thread-local ranges
+uint32_t numNodes(const Graph& graph) { return graph.size(); }
+
+/**
+ * Per-level community state. Node i of the level graph starts in community i.
+ */
+struct LevelState {
+  galois::LargeArray<uint32_t> comm;   //!< community of each node
+  galois::LargeArray<EdgeWeight> degree; //!< weighted degree of each node
+  std::vector<AtomicWeight> total;     //!< sum of degrees of each community
+  std::vector<galois::CopyableAtomic<uint32_t>> size; //!< nodes per community
+
+  explicit LevelState(Graph& graph) : total(graph.size()), size(graph.size()) {
+    comm.allocateBlocked(graph.size());
+    degree.allocateBlocked(graph.size());
+
+    galois::do_all(galois::iterate(0u, numNodes(graph)),
+                   [&](GNode n) {
+                     EdgeWeight k = 0;
+                     for (auto e :
+                          graph.edges(n, galois::MethodFlag::UNPROTECTED)) {
+                       k += graph.getEdgeData(e);
+                     }
+                     comm[n]   = n;
+                     degree[n] = k;
+                     total[n]  = k;
+                     size[n]   = 1;
+                   },
+                   galois::loopname("InitLevel"));
+  }
+
+  //! Recompute community totals and sizes from the community array
+  void recomputeTotals(Graph& graph) {
+    galois::do_all(galois::iterate(0u, numNodes(graph)), [&](GNode n) {
+      total[n] = 0;
+      size[n]  = 0;
+    });
+    galois::do_all(galois::iterate(0u, numNodes(graph)), [&](GNode n) {
+      total[comm[n]] += degree[n];
+      size[comm[n]] += 1;
+    });
+  }
+};
+
+/**
+ * Reads the input graph into a CSR graph with integer weights.
+ */
+void readInput(Graph& graph) {
+  galois::graphs::FileGraph fileGraph;
+  fileGraph.fromFile(filename);
+
+  if (useEdgeWeights && fileGraph.edgeSize() != sizeof(uint32_t)) {
+    GALOIS_DIE("useEdgeWeights needs 32-bit edge data in the input graph");
+  }
+
+  graph.allocateFrom(fileGraph.size(), fileGraph.sizeEdges());
+  graph.constructNodes();
+
+  galois::do_all(
+      galois::iterate(0u, (uint32_t)fileGraph.size()),
+      [&](uint32_t n) {
+        graph.fixEndEdge(n, *fileGraph.edge_end(n));
+        for (auto e : fileGraph.edges(n)) {
+          EdgeWeight w =
+              useEdgeWeights ? fileGraph.getEdgeData<uint32_t>(e) : 1;
+          graph.constructEdge(*e, fileGraph.getEdgeDst(e), w);
+        }
+      },
+      galois::loopname("ReadInput"));
+}
+
+/**
+ * Modularity of the current community assignment:
+ * sum over communities c of in(c) / 2m - (tot(c) / 2m)^2.
+ *
+ * Internal weights are accumulated as integers and communities are summed in
+ * order so the value is reproducible.
+ */
+double modularity(Graph& graph, const galois::LargeArray<uint32_t>& comm,
+                  const galois::LargeArray<EdgeWeight>& degree,
+                  EdgeWeight m2) {
+  std::vector<AtomicWeight> internal(graph.size());
+  std::vector<AtomicWeight> total(graph.size());
+
+  galois::do_all(galois::iterate(0u, numNodes(graph)),
+                 [&](GNode n) {
+                   EdgeWeight in = 0;
+                   for (auto e :
+                        graph.edges(n, galois::MethodFlag::UNPROTECTED)) {
+                     if (comm[graph.getEdgeDst(e)] == comm[n]) {
+                       in += graph.getEdgeData(e);
+                     }
+                   }
+                   internal[comm[n]] += in;
+                   total[comm[n]] += degree[n];
+                 },
+                 galois::loopname("Modularity"));
+
+  double q = 0.0;
+  for (size_t c = 0; c < graph.size(); ++c) {
+    double tot = (double)total[c] / m2;
+    q += (double)internal[c] / m2 - tot * tot;
+  }
+  return q;
+}
+
+/**
+ * Puts every node whose only neighbor is some other node into that neighbor's
+ * community (vertex following). Such a node always ends up with its neighbor,
+ * so this saves local move sweeps.
+ */
+void followVertices(Graph& graph, LevelState& state) {
+  galois::GAccumulator<size_t> followed;
+
+  galois::do_all(
+      galois::iterate(0u, numNodes(graph)),
+      [&](GNode n) {
+        auto ii = graph.edge_begin(n, galois::MethodFlag::UNPROTECTED);
+        auto ei = graph.edge_end(n, galois::MethodFlag::UNPROTECTED);
+        if (std::distance(ii, ei) != 1) {
+          return;
+        }
+        GNode dst = graph.getEdgeDst(ii);
+        if (dst == n) {
+          return;
+        }
+        // two nodes only connected to each other join the smaller id
+        if (std::distance(graph.edge_begin(dst), graph.edge_end(dst)) == 1 &&
+            dst > n) {
+          return;
+        }
+        state.comm[n] = dst;
+        followed += 1;
+      },
+      galois::loopname("VertexFollowing"));
+
+  state.recomputeTotals(graph);
+  galois::runtime::reportStat_Single("Louvain", "FollowedVertices",
+                                     followed.reduce());
+}
+
+/**
+ * Colors the graph with Jones-Plassmann using hashed node ids as priorities.
+ * Each round first selects the uncolored nodes whose priority beats all
+ * uncolored neighbors and then colors them, so the coloring is deterministic.
+ *
+ * @returns number of colors used
+ */
+unsigned colorGraph(Graph& graph, galois::LargeArray<uint32_t>& color) {
+  constexpr uint32_t UNCOLORED = std::numeric_limits<uint32_t>::max();
+
+  auto priority = [](GNode n) {
+    uint64_t h = (uint64_t)n * 0x9E3779B97F4A7C15ull;
+    return std::make_pair(h ^ (h >> 29), n);
+  };
+
+  galois::do_all(galois::iterate(0u, numNodes(graph)),
+                 [&](GNode n) { color[n] = UNCOLORED; });
+
+  galois::InsertBag<GNode> uncolored[2];
+  galois::InsertBag<GNode> selected;
+  galois::do_all(galois::iterate(0u, numNodes(graph)),
+                 [&](GNode n) { uncolored[0].push_back(n); });
+
+  galois::GReduceMax<uint32_t> maxColor;
+  unsigned cur = 0;
+  while (!uncolored[cur].empty()) {
+    galois::do_all(galois::iterate(uncolored[cur]),
+                   [&](GNode n) {
+                     auto p = priority(n);
+                     for (auto e : graph.edges(
+                              n, galois::MethodFlag::UNPROTECTED)) {
+                       GNode dst = graph.getEdgeDst(e);
+                       if (dst != n && color[dst] == UNCOLORED &&
+                           priority(dst) > p) {
+                         uncolored[cur ^ 1].push_back(n);
+                         return;
+                       }
+                     }
+                     selected.push_back(n);
+                   },
+                   galois::steal(), galois::loopname("ColorSelect"));
+
+    galois::do_all(galois::iterate(selected),
+                   [&](GNode n) {
+                     std::vector<bool> used;
+                     for (auto e : graph.edges(
+                              n, galois::MethodFlag::UNPROTECTED)) {
+                       uint32_t c = color[graph.getEdgeDst(e)];
+                       if (c != UNCOLORED) {
+                         if (c >= used.size()) {
+                           used.resize(c + 1, false);
+                         }
+                         used[c] = true;
+                       }
+                     }
+                     uint32_t c = std::find(used.begin(), used.end(), false) -
+                                  used.begin();
+                     color[n] = c;
+                     maxColor.update(c);
+                   },
+                   galois::steal(), galois::loopname("ColorAssign"));
+
+    selected.clear();
+    uncolored[cur].clear();
+    cur ^= 1;
+  }
+
+  return graph.size() ? maxColor.reduce() + 1 : 0;
+}
+
+/**
+ * Finds the community that maximizes the modularity gain of moving n. Only
+ * returns a different community if the move strictly improves modularity;
+ * ties between other communities go to the smallest id.
+ */
+uint32_t bestCommunity(Graph& graph, LevelState& state, GNode n, double m2,
+                       CommunityMap& neighbors) {
+  uint32_t own = state.comm[n];
+
+  neighbors.clear();
+  for (auto e : graph.edges(n, galois::MethodFlag::UNPROTECTED)) {
+    GNode dst = graph.getEdgeDst(e);
+    if (dst != n) {
+      neighbors[state.comm[dst]] += graph.getEdgeData(e);
+    }
+  }
+
+  double kOverM = state.degree[n] / m2;
+  auto ownIt    = neighbors.find(own);
+  double best   = (ownIt == neighbors.end() ? 0.0 : (double)ownIt->second) -
+                (double)(state.total[own] - state.degree[n]) * kOverM;
+  uint32_t bestComm = own;
+
+  for (auto& kv : neighbors) {
+    if (kv.first == own) {
+      continue;
+    }
+    // two singletons swapping into each other's community would undo each
+    // other; only let a singleton join another singleton with a smaller id
+    if (state.size[own] == 1 && state.size[kv.first] == 1 && kv.first > own) {
+      continue;
+    }
+    double gain = (double)kv.second - (double)state.total[kv.first] * kOverM;
+    if (gain > best) {
+      best     = gain;
+      bestComm = kv.first;
+    }
+  }
+
+  return bestComm;
+}
+
+//! Moves n from its community to another one and updates the totals
+void moveNode(LevelState& state, GNode n, uint32_t to) {
+  uint32_t from = state.comm[n];
+  state.total[from] -= state.degree[n];
+  state.size[from] -= 1;
+  state.total[to] += state.degree[n];
+  state.size[to] += 1;
+  state.comm[n] = to;
+}
+
+/**
+ * Runs local move sweeps over the level graph until a sweep improves
+ * modularity by less than the threshold.
+ *
+ * @returns modularity after the last sweep
+ */
+double localMoves(Graph& graph, LevelState& state, EdgeWeight m2,
+                  unsigned& sweeps) {
+  galois::substrate::PerThreadStorage<CommunityMap> neighborMaps;
+  galois::GAccumulator<size_t> moved;
+
+  // color classes and targets are only needed for the deterministic version
+  std::vector<galois::InsertBag<GNode>> classes;
+  galois::LargeArray<uint32_t> target;
+  if (algo == colored) {
+    galois::LargeArray<uint32_t> color;
+    color.allocateBlocked(graph.size());
+    target.allocateBlocked(graph.size());
+    unsigned numColors = colorGraph(graph, color);
+    classes.resize(numColors);
+    galois::do_all(galois::iterate(0u, numNodes(graph)),
+                   [&](GNode n) { classes[color[n]].push_back(n); });
+    galois::gPrint("  ", numColors, " colors\n");
+  }
+
+  double q = modularity(graph, state.comm, state.degree, m2);
+  for (sweeps = 0; sweeps < maxIterations; ++sweeps) {
+    moved.reset();
+
+    if (algo == colored) {
+      for (auto& cls : classes) {
+        // nodes of a class are not adjacent: decide against a snapshot of
+        // the totals, then apply all moves
+        galois::do_all(galois::iterate(cls),
+                       [&](GNode n) {
+                         target[n] = bestCommunity(graph, state, n, m2,
+                                                   *neighborMaps.getLocal());
+                       },
+                       galois::steal(), galois::loopname("ColoredDecide"));
+        galois::do_all(galois::iterate(cls),
+                       [&](GNode n) {
+                         if (target[n] != state.comm[n]) {
+                           moveNode(state, n, target[n]);
+                           moved += 1;
+                         }
+                       },
+                       galois::loopname("ColoredMove"));
+      }
+    } else {
+      galois::do_all(galois::iterate(0u, numNodes(graph)),
+                     [&](GNode n) {
+                       uint32_t to = bestCommunity(graph, state, n, m2,
+                                                   *neighborMaps.getLocal());
+                       if (to != state.comm[n]) {
+                         moveNode(state, n, to);
+                         moved += 1;
+                       }
+                     },
+                     galois::steal(), galois::loopname("LocalMove"));
+    }
+
+    double newQ = modularity(graph, state.comm, state.degree, m2);
+    bool done   = moved.reduce() == 0 || newQ - q < threshold;
+    q           = newQ;
+    if (done) {
+      sweeps++;
+      break;
+    }
+  }
+
+  return q;
+}
+
+/**
+ * Renumbers the communities of the level to [0, numCommunities).
+ *
+ * @returns number of non-empty communities
+ */
+uint32_t renumber(Graph& graph, LevelState& state) {
+  std::vector<uint32_t> newId(graph.size() + 1, 0);
+  galois::do_all(galois::iterate(0u, numNodes(graph)),
+                 [&](GNode n) { newId[state.comm[n] + 1] = 1; });
+  std::partial_sum(newId.begin(), newId.end(), newId.begin());
+  galois::do_all(galois::iterate(0u, numNodes(graph)),
+                 [&](GNode n) { state.comm[n] = newId[state.comm[n]]; });
+  return newId.back();
+}
+
+/**
+ * Builds the next level graph in which each community of the current level
+ * is a node. Edges between communities are summed and the internal weight of
+ * a community becomes a self loop.
+ */
+void aggregate(Graph& graph, const LevelState& state, uint32_t numComms,
+               Graph& coarse) {
+  // group the members of every community (counting sort)
+  std::vector<uint64_t> memberStart(numComms + 1, 0);
+  for (size_t n = 0; n < graph.size(); ++n) {
+    memberStart[state.comm[n] + 1]++;
+  }
+  std::partial_sum(memberStart.begin(), memberStart.end(),
+                   memberStart.begin());
+  std::vector<GNode> members(graph.size());
+  {
+    std::vector<uint64_t> cursor(memberStart.begin(), memberStart.end() - 1);
+    for (size_t n = 0; n < graph.size(); ++n) {
+      members[cursor[state.comm[n]]++] = n;
+    }
+  }
+
+  galois::substrate::PerThreadStorage<CommunityMap> neighborMaps;
+  std::vector<std::vector<std::pair<uint32_t, EdgeWeight>>> coarseEdges(
+      numComms);
+
+  galois::do_all(
+      galois::iterate(0u, numComms),
+      [&](uint32_t c) {
+        CommunityMap& neighbors = *neighborMaps.getLocal();
+        neighbors.clear();
+        for (uint64_t i = memberStart[c]; i < memberStart[c + 1]; ++i) {
+          GNode n = members[i];
+          for (auto e : graph.edges(n, galois::MethodFlag::UNPROTECTED)) {
+            neighbors[state.comm[graph.getEdgeDst(e)]] +=
+                graph.getEdgeData(e);
+          }
+        }
+        coarseEdges[c].assign(neighbors.begin(), neighbors.end());
+      },
+      galois::steal(), galois::loopname("Aggregate"));
+
+  std::vector<uint64_t> edgeEnd(numComms, 0);
+  uint64_t numEdges = 0;
+  for (uint32_t c = 0; c < numComms; ++c) {
+    numEdges += coarseEdges[c].size();
+    edgeEnd[c] = numEdges;
+  }
+
+  coarse.allocateFrom(numComms, numEdges);
+  coarse.constructNodes();
+  galois::do_all(galois::iterate(0u, numComms),
+                 [&](uint32_t c) {
+                   coarse.fixEndEdge(c, edgeEnd[c]);
+                   uint64_t e = edgeEnd[c] - coarseEdges[c].size();
+                   for (auto& kv : coarseEdges[c]) {
+                     coarse.constructEdge(e++, kv.first, kv.second);
+                   }
+                 },
+                 galois::loopname("BuildCoarseGraph"));
+}
+
+/**
+ * Recomputes the modularity of the final assignment on the input graph and
+ * checks that it matches the one computed on the last level.
+ */
+bool verify(Graph& graph, const galois::LargeArray<uint32_t>& community,
+            uint32_t numComms, EdgeWeight m2, double expected) {
+  galois::GReduceLogicalOR bad;
+  galois::do_all(galois::iterate(0u, numNodes(graph)),
+                 [&](GNode n) { bad.update(community[n] >= numComms); });
+  if (bad.reduce()) {
+    std::cerr << "community id out of range\n";
+    return false;
+  }
+
+  LevelState state(graph);
+  double q = modularity(graph, community, state.degree, m2);
+  if (std::fabs(q - expected) > 1e-6) {
+    std::cerr << "modularity on input graph " << q << " does not match "
+              << expected << "\n";
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  galois::SharedMemSys G;
+  LonestarStart(argc, argv, name, desc, url);
+
+  Graph graph;
+  galois::StatTimer readTimer("ReadGraph");
+  readTimer.start();
+  readInput(graph);
+  readTimer.stop();
+  std::cout << "Read " << graph.size() << " nodes, " << graph.sizeEdges()
+            << " edges\n";
+
+  galois::preAlloc(numThreads + 4 * (graph.size() + graph.sizeEdges()) *
+                                    sizeof(uint64_t) /
+                                    galois::runtime::pagePoolSize());
+  galois::reportPageAlloc("MeminfoPre");
+
+  galois::GAccumulator<EdgeWeight> totalWeight;
+  galois::do_all(galois::iterate(0u, numNodes(graph)), [&](GNode n) {
+    for (auto e : graph.edges(n, galois::MethodFlag::UNPROTECTED)) {
+      totalWeight += graph.getEdgeData(e);
+    }
+  });
+  EdgeWeight m2 = totalWeight.reduce();
+
+  // community of every input node in the current level
+  galois::LargeArray<uint32_t> community;
+  community.allocateBlocked(graph.size());
+  galois::do_all(galois::iterate(0u, numNodes(graph)),
+                 [&](GNode n) { community[n] = n; });
+
+  galois::StatTimer T;
+  T.start();
+
+  std::unique_ptr<Graph> coarse;
+  Graph* level      = &graph;
+  double q          = 0.0;
+  uint32_t numComms = graph.size();
+  unsigned levels   = 0;
+
+  while (m2 > 0 && levels < maxLevels) {
+    LevelState state(*level);
+    if (levels == 0 && vertexFollowing) {
+      followVertices(*level, state);
+    }
+
+    double startQ   = modularity(*level, state.comm, state.degree, m2);
+    unsigned sweeps = 0;
+    q               = localMoves(*level, state, m2, sweeps);
+    numComms        = renumber(*level, state);
+
+    galois::do_all(galois::iterate(0u, numNodes(graph)),
+                   [&](GNode n) { community[n] = state.comm[community[n]]; });
+
+    galois::gPrint("Level ", levels, ": ", level->size(), " nodes, ",
+                   numComms, " communities, ", sweeps,
+                   " sweeps, modularity ", q, "\n");
+    levels++;
+
+    if (numComms == level->size() || q - startQ < threshold) {
+      break;
+    }
+
+    std::unique_ptr<Graph> next(new Graph);
+    aggregate(*level, state, numComms, *next);
+    coarse = std::move(next);
+    level  = coarse.get();
+  }
+
+  T.stop();
+  galois::reportPageAlloc("MeminfoPost");
+
+  std::cout << "Communities: " << numComms << "\n";
+  std::cout << "Modularity: " << q << "\n";
+  galois::runtime::reportStat_Single("Louvain", "Levels", levels);
+  galois::runtime::reportStat_Single("Louvain", "Communities", numComms);
+  galois::runtime::reportStat_Single("Louvain", "Modularity", q);
+
+  if (!skipVerify && m2 > 0) {
+    if (!verify(graph, community, numComms, m2, q)) {
+      GALOIS_DIE("verification failed");
+    }
+    std::cout << "Verification successful.\n";
+  }
+
+  if (outputFile != "") {
+    std::ofstream out(outputFile);
+    for (size_t n = 0; n < graph.size(); ++n) {
+      out << n << " " << community[n] << "\n";
+    }
+  }
+
+  return 0;
+}
@@ -21,6 +21,9 @@
 // efficiently
 
 #include "galois/Galois.h"
+#include "galois/Bag.h"
+#include "galois/LargeArray.h"
+#include "galois/Reduction.h"
 #include "galois/Timer.h"
 #include "galois/Timer.h"
 #include "galois/graphs/Graph.h"
@@ -45,7 +48,7 @@ static const char* desc =
     "edges.";
 static const char* url = "bipartite_mcm";
 
-enum MatchingAlgo { pfpAlgo, ffAlgo, abmpAlgo };
+enum MatchingAlgo { pfpAlgo, ffAlgo, abmpAlgo, msbfsAlgo };
 
 enum ExecutionType { serial, parallel };
 
@@ -55,7 +58,10 @@ static cll::opt<MatchingAlgo> algo(
     cll::desc("Choose an algorithm:"),
     cll::values(clEnumVal(pfpAlgo, "Preflow-push"),
                 clEnumVal(ffAlgo, "Ford-Fulkerson augmenting paths"),
-                clEnumVal(abmpAlgo, "Alt-Blum-Mehlhorn-Paul"), clEnumValEnd),
+                clEnumVal(abmpAlgo, "Alt-Blum-Mehlhorn-Paul"),
+                clEnumVal(msbfsAlgo,
+                          "Multi-source BFS with tree grafting (MS-BFS-Graft)"),
+                clEnumValEnd),
     cll::init(abmpAlgo));
 static cll::opt<ExecutionType>
     executionType(cll::desc("Choose execution type:"),
@@ -586,6 +592,415 @@ struct MatchingABMP {
   }
 };
 
+//******************** MS-BFS-Graft Algorithm *********************
+
+struct GraftNode : public BaseNode {
+  uint32_t index;
+  GraftNode(size_t i = -1) : BaseNode(i), index(0) {}
+  void reset() { BaseNode::reset(); }
+};
+
+/**
+ * Multi-source BFS augmenting path algorithm with tree grafting (MS-BFS-Graft)
+ * of Azad, Buluc and Pothen, seeded by a parallel Karp-Sipser initialization.
+ *
+ * The graph is copied into a CSR over a single index space (A vertices first,
+ * then B vertices) holding both edge directions. Each phase grows vertex
+ * disjoint alternating BFS trees from all free A vertices at once, one
+ * frontier level per do_all, and augments every tree that reached a free B
+ * vertex. Instead of discarding the search forest between phases, vertices of
+ * augmented trees are released and grafted onto the trees that are still
+ * active; the forest is only rebuilt from scratch when few active vertices
+ * remain. The matching is written back into the graph at the end.
+ */
+template <typename G, bool Concurrent>
+struct MatchingMSBFS {
+  typedef typename G::GraphNode GraphNode;
+  typedef typename G::NodeList NodeList;
+  typedef typename G::node_data_type node_data_type;
+  typedef galois::InsertBag<uint32_t> Bag;
+
+  static const bool canRunIteratively = true;
+
+  //! Graft onto active trees while they hold more than 1/ALPHA as many
+  //! vertices as were released by augmentation; otherwise rebuild
+  static const int ALPHA = 5;
+
+  static constexpr uint32_t NONE = ~static_cast<uint32_t>(0);
+
+  size_t numA;
+  size_t numV;
+  galois::LargeArray<uint64_t> off;
+  galois::LargeArray<uint32_t> adj;
+  galois::LargeArray<uint32_t> mate;
+  galois::LargeArray<uint32_t> root;
+  galois::LargeArray<uint32_t> parent;
+  galois::LargeArray<uint32_t> leaf;
+  galois::LargeArray<uint32_t> visited;
+
+  std::string name() {
+    return std::string(Concurrent ? "Concurrent" : "Serial") +
+           " Multi-source BFS with tree grafting";
+  }
+
+  //! Claims both endpoints of (v, u); fails if either is already matched
+  bool tryMatch(uint32_t v, uint32_t u) {
+    if (!__sync_bool_compare_and_swap(&mate[v], NONE, u))
+      return false;
+    if (!__sync_bool_compare_and_swap(&mate[u], NONE, v)) {
+      mate[v] = NONE;
+      return false;
+    }
+    return true;
+  }
+
+  void buildCSR(G& g) {
+    NodeList& A = g.A;
+    NodeList& B = g.B;
+    numA        = A.size();
+    numV        = A.size() + B.size();
+
+    // A matched edge is stored reversed (B to A); turn those back into A to B
+    // edges and remember them as the initial matching
+    std::vector<std::pair<GraphNode, GraphNode>> matched;
+    for (auto b : B) {
+      for (auto ii : g.edges(b, galois::MethodFlag::UNPROTECTED))
+        matched.emplace_back(b, g.getEdgeDst(ii));
+    }
+    for (auto& m : matched) {
+      auto edge =
+          g.findEdge(m.first, m.second, galois::MethodFlag::UNPROTECTED);
+      g.removeEdge(m.first, edge, galois::MethodFlag::UNPROTECTED);
+      g.addEdge(m.second, m.first, galois::MethodFlag::UNPROTECTED);
+    }
+
+    galois::do_all(galois::iterate(size_t{0}, numA), [&](size_t i) {
+      g.getData(A[i], galois::MethodFlag::UNPROTECTED).index = i;
+    });
+    galois::do_all(galois::iterate(size_t{0}, B.size()), [&](size_t i) {
+      g.getData(B[i], galois::MethodFlag::UNPROTECTED).index = numA + i;
+    });
+
+    off.allocateInterleaved(numV + 1);
+    galois::LargeArray<uint64_t> degree;
+    degree.allocateInterleaved(numV);
+    galois::do_all(galois::iterate(size_t{0}, numV),
+                   [&](size_t v) { degree[v] = 0; });
+    galois::do_all(
+        galois::iterate(size_t{0}, numA),
+        [&](size_t a) {
+          for (auto ii : g.edges(A[a], galois::MethodFlag::UNPROTECTED)) {
+            uint32_t b = g.getData(g.getEdgeDst(ii),
+                                   galois::MethodFlag::UNPROTECTED)
+                             .index;
+            degree[a] += 1;
+            __sync_fetch_and_add(&degree[b], 1);
+          }
+        },
+        galois::steal());
+
+    off[0] = 0;
+    for (size_t v = 0; v < numV; ++v)
+      off[v + 1] = off[v] + degree[v];
+    adj.allocateInterleaved(off[numV]);
+
+    // Reuse degree as the insertion cursor of each vertex
+    galois::do_all(galois::iterate(size_t{0}, numV),
+                   [&](size_t v) { degree[v] = off[v]; });
+    galois::do_all(
+        galois::iterate(size_t{0}, numA),
+        [&](size_t a) {
+          for (auto ii : g.edges(A[a], galois::MethodFlag::UNPROTECTED)) {
+            uint32_t b = g.getData(g.getEdgeDst(ii),
+                                   galois::MethodFlag::UNPROTECTED)
+                             .index;
+            adj[degree[a]++]                       = b;
+            adj[__sync_fetch_and_add(&degree[b], 1)] = a;
+          }
+        },
+        galois::steal());
+
+    mate.allocateInterleaved(numV);
+    root.allocateInterleaved(numV);
+    parent.allocateInterleaved(numV);
+    leaf.allocateInterleaved(numV);
+    visited.allocateInterleaved(numV);
+    galois::do_all(galois::iterate(size_t{0}, numV), [&](size_t v) {
+      mate[v]    = NONE;
+      root[v]    = NONE;
+      parent[v]  = NONE;
+      leaf[v]    = NONE;
+      visited[v] = 0;
+    });
+
+    for (auto& m : matched) {
+      uint32_t a = g.getData(m.second, galois::MethodFlag::UNPROTECTED).index;
+      uint32_t b = g.getData(m.first, galois::MethodFlag::UNPROTECTED).index;
+      mate[a]    = b;
+      mate[b]    = a;
+    }
+  }
+
+  /**
+   * Parallel Karp-Sipser: repeatedly match vertices with a single unmatched
+   * neighbor (such edges belong to some maximum matching), then finish with a
+   * greedy maximal matching over the remaining A vertices.
+   */
+  void karpSipser() {
+    galois::LargeArray<uint32_t> degree;
+    degree.allocateInterleaved(numV);
+    Bag cur;
+    Bag next;
+
+    galois::do_all(galois::iterate(size_t{0}, numV), [&](size_t v) {
+      degree[v] = 0;
+      if (mate[v] != NONE)
+        return;
+      for (uint64_t e = off[v]; e < off[v + 1]; ++e) {
+        if (mate[adj[e]] == NONE)
+          degree[v] += 1;
+      }
+      if (degree[v] == 1)
+        cur.push(v);
+    });
+
+    auto retire = [&](uint32_t v, uint32_t skip) {
+      for (uint64_t e = off[v]; e < off[v + 1]; ++e) {
+        uint32_t w = adj[e];
+        if (w != skip && mate[w] == NONE &&
+            __sync_sub_and_fetch(&degree[w], 1) == 1)
+          next.push(w);
+      }
+    };
+
+    while (!cur.empty()) {
+      galois::do_all(
+          galois::iterate(cur),
+          [&](uint32_t v) {
+            if (mate[v] != NONE)
+              return;
+            for (uint64_t e = off[v]; e < off[v + 1]; ++e) {
+              uint32_t u = adj[e];
+              if (mate[u] == NONE && tryMatch(v, u)) {
+                retire(v, u);
+                retire(u, v);
+                return;
+              }
+            }
+          },
+          galois::steal(), galois::loopname("MatchingKarpSipser"));
+      cur.clear();
+      cur.swap(next);
+    }
+
+    galois::do_all(
+        galois::iterate(size_t{0}, numA),
+        [&](size_t a) {
+          if (mate[a] != NONE)
+            return;
+          for (uint64_t e = off[a]; e < off[a + 1]; ++e) {
+            if (mate[adj[e]] == NONE && tryMatch(a, adj[e]))
+              return;
+          }
+        },
+        galois::steal(), galois::loopname("MatchingGreedy"));
+  }
+
+  //! Makes every free A vertex with edges the root of a new tree
+  void plantForest(Bag& frontier) {
+    galois::do_all(galois::iterate(size_t{0}, numV), [&](size_t v) {
+      visited[v] = 0;
+      leaf[v]    = NONE;
+      if (v < numA && mate[v] == NONE && off[v] != off[v + 1]) {
+        root[v] = v;
+        frontier.push(v);
+      } else {
+        root[v] = NONE;
+      }
+    });
+  }
+
+  //! Grows all trees level by level until the frontier is exhausted
+  void growForest(Bag& frontier) {
+    Bag next;
+    while (!frontier.empty()) {
+      galois::do_all(
+          galois::iterate(frontier),
+          [&](uint32_t a) {
+            uint32_t r = root[a];
+            for (uint64_t e = off[a]; e < off[a + 1]; ++e) {
+              if (leaf[r] != NONE)
+                return;
+              uint32_t b = adj[e];
+              if (visited[b] ||
+                  !__sync_bool_compare_and_swap(&visited[b], 0, 1))
+                continue;
+              parent[b] = a;
+              root[b]   = r;
+              uint32_t m = mate[b];
+              if (m == NONE) {
+                __sync_bool_compare_and_swap(&leaf[r], NONE, b);
+              } else {
+                root[m] = r;
+                next.push(m);
+              }
+            }
+          },
+          galois::steal(), galois::loopname("MatchingMSBFS"));
+      frontier.clear();
+      frontier.swap(next);
+    }
+  }
+
+  //! Flips the augmenting path of every tree that reached a free B vertex
+  size_t augment() {
+    galois::GAccumulator<size_t> augmented;
+    galois::do_all(
+        galois::iterate(size_t{0}, numA),
+        [&](size_t r) {
+          if (root[r] != r || leaf[r] == NONE)
+            return;
+          uint32_t b = leaf[r];
+          while (true) {
+            uint32_t a    = parent[b];
+            uint32_t prev = mate[a];
+            mate[b]       = a;
+            mate[a]       = b;
+            if (a == r)
+              break;
+            b = prev;
+          }
+          augmented += 1;
+        },
+        galois::steal(), galois::loopname("MatchingAugment"));
+    return augmented.reduce();
+  }
+
+  /**
+   * Releases the vertices of augmented trees and either grafts the released B
+   * vertices onto adjacent active trees or, if too few vertices are active,
+   * replants the whole forest. Returns the frontier of the next phase.
+   */
+  void graft(Bag& frontier, size_t& numGrafts, size_t& numRebuilds) {
+    Bag released;
+    galois::GAccumulator<size_t> activeA;
+    galois::GAccumulator<size_t> renewableB;
+
+    galois::do_all(galois::iterate(size_t{0}, numV), [&](size_t v) {
+      uint32_t r = root[v];
+      if (r == NONE || r == v)
+        return;
+      if (leaf[r] == NONE) {
+        if (v < numA)
+          activeA += 1;
+        return;
+      }
+      root[v] = NONE;
+      if (v >= numA) {
+        visited[v] = 0;
+        released.push(v);
+        renewableB += 1;
+      }
+    });
+    galois::do_all(galois::iterate(size_t{0}, numA), [&](size_t r) {
+      if (root[r] != r)
+        return;
+      if (leaf[r] == NONE) {
+        activeA += 1;
+      } else {
+        root[r] = NONE;
+        leaf[r] = NONE;
+      }
+    });
+
+    if (activeA.reduce() <= renewableB.reduce() / ALPHA) {
+      numRebuilds += 1;
+      plantForest(frontier);
+      return;
+    }
+
+    numGrafts += 1;
+    galois::do_all(
+        galois::iterate(released),
+        [&](uint32_t b) {
+          for (uint64_t e = off[b]; e < off[b + 1]; ++e) {
+            uint32_t a = adj[e];
+            uint32_t r = root[a];
+            if (r == NONE)
+              continue;
+            visited[b] = 1;
+            parent[b]  = a;
+            root[b]    = r;
+            uint32_t m = mate[b];
+            if (m == NONE) {
+              __sync_bool_compare_and_swap(&leaf[r], NONE, b);
+            } else {
+              root[m] = r;
+              frontier.push(m);
+            }
+            return;
+          }
+        },
+        galois::steal(), galois::loopname("MatchingGraft"));
+  }
+
+  void writeBack(G& g) {
+    NodeList& A = g.A;
+    NodeList& B = g.B;
+    galois::do_all(
+        galois::iterate(size_t{0}, B.size()),
+        [&](size_t i) {
+          uint32_t a = mate[numA + i];
+          if (a == NONE)
+            return;
+          GraphNode src = A[a];
+          GraphNode dst = B[i];
+          auto edge = g.findEdge(src, dst, galois::MethodFlag::UNPROTECTED);
+          assert(edge != g.edge_end(src));
+          g.removeEdge(src, edge, galois::MethodFlag::UNPROTECTED);
+          g.addEdge(dst, src, galois::MethodFlag::UNPROTECTED);
+          g.getData(src, galois::MethodFlag::UNPROTECTED).free = false;
+          g.getData(dst, galois::MethodFlag::UNPROTECTED).free = false;
+        },
+        galois::steal());
+  }
+
+  void operator()(G& g) {
+    galois::setActiveThreads(Concurrent ? numThreads : 1);
+
+    galois::StatTimer initTime("InitializeTime");
+    initTime.start();
+    buildCSR(g);
+    karpSipser();
+    initTime.stop();
+
+    size_t numPhases   = 0;
+    size_t numGrafts   = 0;
+    size_t numRebuilds = 0;
+
+    Bag frontier;
+    plantForest(frontier);
+    while (true) {
+      growForest(frontier);
+      numPhases += 1;
+      if (augment() == 0)
+        break;
+      graft(frontier, numGrafts, numRebuilds);
+    }
+
+    galois::runtime::reportStat_Single("MatchingMSBFS", "Phases", numPhases);
+    galois::runtime::reportStat_Single("MatchingMSBFS", "Grafts", numGrafts);
+    galois::runtime::reportStat_Single("MatchingMSBFS", "Rebuilds",
+                                       numRebuilds);
+
+    writeBack(g);
+
+    for (auto* array : {&adj, &mate, &root, &parent, &leaf, &visited})
+      array->deallocate();
+    off.deallocate();
+  }
+};
+
 // *************************** MaxFlow Algorithm *******************************
 struct MFNode : public BaseNode {
   size_t excess;
@@ -1190,6 +1605,10 @@ void start() {
     start<MatchingFF, MFBipartiteGraph<FFNode, void>, Concurrent>(N, numEdges,
                                                                   numGroups);
     break;
+  case msbfsAlgo:
+    start<MatchingMSBFS, MFBipartiteGraph<GraftNode, void>, Concurrent>(
+        N, numEdges, numGroups);
+    break;
   default:
     GALOIS_DIE("unknown algo");
   }
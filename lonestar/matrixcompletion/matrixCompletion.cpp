@@ -88,6 +88,9 @@ static const unsigned ALS_CHUNK_SIZE = 4;
 
 size_t NUM_ITEM_NODES = 0;
 
+//! latent vectors of all items and users, indexed by node id
+LatentMatrix latentVectors;
+
 struct PurdueStepFunction : public StepFunction {
   virtual std::string name() const { return "Purdue"; }
   virtual LatentValue stepSize(int round) const {
@@ -131,9 +134,9 @@ double sumSquaredError(Graph& g) {
       galois::iterate(g.begin(), g.begin() + NUM_ITEM_NODES), [&](GNode n) {
         for (auto ii = g.edge_begin(n), ei = g.edge_end(n); ii != ei; ++ii) {
           GNode dst = g.getEdgeDst(ii);
-          LatentValue e =
-              predictionError(g.getData(n).latentVector,
-                              g.getData(dst).latentVector, g.getEdgeData(ii));
+          LatentValue e = predictionError(
+              latentVectors.row(n), latentVectors.row(dst),
+              latentVectors.rowStride(), g.getEdgeData(ii));
           error += (e * e);
         }
       });
@@ -291,7 +294,7 @@ void executeUntilConverged(const StepFunction& sf, Graph& g, Fn fn) {
     unsigned long millis = curElapsed - lastTime;
     lastTime             = curElapsed;
 
-    double gflops = countFlops(g.sizeEdges(), deltaRound, LATENT_VECTOR_SIZE) /
+    double gflops = countFlops(g.sizeEdges(), deltaRound, latentVectorSize) /
                     millis / 1e6;
 
     int curRound = round + deltaRound;
@@ -333,9 +336,8 @@ struct SGDBlockJumpAlgo {
 
   std::string name() const { return "sgdBlockJumpAlgo"; }
 
-  struct Node {
-    LatentValue latentVector[LATENT_VECTOR_SIZE];
-  };
+  // latent vectors are kept in latentVectors
+  struct Node {};
 
   typedef galois::graphs::LC_CSR_Graph<Node, double>
       //    ::with_numa_alloc<true>::type
@@ -368,6 +370,8 @@ struct SGDBlockJumpAlgo {
     }
   };
 
+  using Schedule = galois::runtime::SocketDiagonalSchedule;
+
   struct Process {
     Graph& g;
     SpinLock *xLocks, *yLocks;
@@ -376,6 +380,11 @@ struct SGDBlockJumpAlgo {
     LatentValue* steps;
     size_t maxUpdates;
     galois::GAccumulator<double>* errorAccum;
+    // item blocks are the rows and user blocks the columns of the schedule;
+    // null for dynamic scheduling
+    const Schedule* schedule;
+    galois::substrate::Barrier& barrier;
+    galois::GAccumulator<size_t>& crossSocketBlocks;
 
     struct GetDst : public std::unary_function<Graph::edge_iterator, GNode> {
       Graph* g;
@@ -414,7 +423,6 @@ struct SGDBlockJumpAlgo {
       // For each item in the range
       for (; mm != em; ++mm, ++itemId) {
         GNode item      = *mm;
-        Node& itemData  = g.getData(item);
         size_t lastUser = si.userEnd + NUM_ITEM_NODES;
 
         edge_dst_iterator start(no_deref_iterator(g.edge_begin(
@@ -433,9 +441,10 @@ struct SGDBlockJumpAlgo {
           if (user >= lastUser)
             break;
 
-          LatentValue e = doGradientUpdate(itemData.latentVector,
-                                           g.getData(user).latentVector, lambda,
-                                           g.getEdgeData(*ii.base()), stepSize);
+          LatentValue e = doGradientUpdate(
+              latentVectors.row(item), latentVectors.row(user),
+              latentVectors.rowStride(), lambda, g.getEdgeData(*ii.base()),
+              stepSize);
           if (errorAccum)
             error += e * e;
           ++seen;
@@ -469,7 +478,6 @@ struct SGDBlockJumpAlgo {
           continue;
 
         GNode item      = *mm;
-        Node& itemData  = g.getData(item);
         size_t lastUser = si.userEnd + NUM_ITEM_NODES;
 
         // For each edge in the range
@@ -481,9 +489,9 @@ struct SGDBlockJumpAlgo {
           if (user >= lastUser)
             break;
 
-          LatentValue e = doGradientUpdate(itemData.latentVector,
-                                           g.getData(user).latentVector, lambda,
-                                           g.getEdgeData(ii), stepSize);
+          LatentValue e = doGradientUpdate(
+              latentVectors.row(item), latentVectors.row(user),
+              latentVectors.rowStride(), lambda, g.getEdgeData(ii), stepSize);
           if (errorAccum)
             error += e * e;
           ++seen;
@@ -527,6 +535,102 @@ struct SGDBlockJumpAlgo {
       return numBlocks;
     }
 
+    /**
+     * Claims a block with fewer than target updates.
+     *
+     * @returns true if claimed, x and y locks are held on the block
+     */
+    bool tryClaim(BlockInfo& b, size_t target) {
+      if (b.updates >= target || !xLocks[b.x].try_lock())
+        return false;
+      if (yLocks[b.y].try_lock()) {
+        if (b.updates < target)
+          return true;
+        yLocks[b.y].unlock();
+      }
+      xLocks[b.x].unlock();
+      return false;
+    }
+
+    /**
+     * Brings every block of the stratum (item blocks x user blocks) to target
+     * updates, scanning from offset. Returns once all blocks are claimed.
+     *
+     * @returns number of blocks run by this thread
+     */
+    size_t runStratum(Schedule::Range items, Schedule::Range users,
+                      size_t target, size_t offset,
+                      galois::GAccumulator<size_t>& edgesVisited) {
+      const size_t width = users.second - users.first;
+      const size_t n     = width * (items.second - items.first);
+      size_t executed    = 0;
+
+      for (bool pending = n > 0; pending;) {
+        pending = false;
+        for (size_t i = 0; i < n; ++i) {
+          size_t k     = (offset + i) % n;
+          BlockInfo& b = blocks[users.first + k % width +
+                                (items.first + k / width) * numXBlocks];
+          if (b.updates >= target)
+            continue;
+          pending = true;
+          if (!tryClaim(b, target))
+            continue;
+
+          edgesVisited += runBlock(b);
+          executed += 1;
+
+          xLocks[b.x].unlock();
+          yLocks[b.y].unlock();
+        }
+      }
+
+      return executed;
+    }
+
+    /**
+     * NUMA-aware schedule: each round a thread works on the stratum of its
+     * socket and then helps the other strata; blocks run by a thread of
+     * another socket are counted as cross-socket.
+     */
+    void runSocketDiagonals(unsigned tid, unsigned total,
+                            galois::GAccumulator<size_t>& edgesVisited,
+                            galois::GAccumulator<size_t>& blocksVisited) {
+      auto& tp               = galois::substrate::getThreadPool();
+      const unsigned socket  = tp.getSocket(tid);
+      const unsigned sockets = schedule->rounds();
+      unsigned rank          = 0;
+      unsigned peers         = 0;
+      for (unsigned i = 0; i < total; ++i) {
+        if (tp.getSocket(i) == socket) {
+          rank += i < tid;
+          peers += 1;
+        }
+      }
+
+      // blocks are at maxUpdates - updatesPerEdge on entry
+      size_t first =
+          std::max<size_t>(maxUpdates, updatesPerEdge) - updatesPerEdge + 1;
+      for (size_t target = first; target <= maxUpdates; ++target) {
+        for (unsigned round = 0; round < sockets; ++round) {
+          for (unsigned k = 0; k < sockets; ++k) {
+            unsigned s  = (socket + k) % sockets;
+            auto items  = schedule->xGroup(s);
+            auto users  = schedule->yGroup(schedule->column(s, round));
+            size_t n    = (items.second - items.first) *
+                       (users.second - users.first);
+            size_t done = runStratum(items, users, target, n * rank / peers,
+                                     edgesVisited);
+            blocksVisited += done;
+            if (k != 0)
+              crossSocketBlocks += done;
+          }
+
+          barrier.wait();
+        }
+      }
+    }
+
     void operator()(unsigned tid, unsigned total) {
       galois::StatTimer timer("PerThreadTime");
       // TODO: Report Accumulators at the end
@@ -541,6 +645,12 @@ struct SGDBlockJumpAlgo {
 
       timer.start();
 
+      if (schedule) {
+        runSocketDiagonals(tid, total, edgesVisited, blocksVisited);
+        timer.stop();
+        return;
+      }
+
       while (true) {
         sp = &blocks[getNextBlock(sp)];
         if (sp == &blocks[numBlocks])
@@ -621,20 +731,50 @@ struct SGDBlockJumpAlgo {
                        }
                      });
     }
+
+    // item blocks are the rows of the schedule so that the item latent
+    // vectors and the ratings of a stratum stay on one socket
+    Schedule schedule(numYBlocks, numXBlocks);
+    if (numaTiles) {
+      latentVectors.distribute([&](size_t n) {
+        return n < NUM_ITEM_NODES
+                   ? schedule.xOwner(n / itemsPerBlock)
+                   : schedule.yOwner((n - NUM_ITEM_NODES) / usersPerBlock);
+      });
+    }
     preProcessTimer.stop();
 
+    galois::GAccumulator<size_t> crossSocketBlocks;
+    auto& barrier = galois::runtime::getBarrier(galois::getActiveThreads());
+
     // galois::StatTimer executeTimer("Total Execution Time");
     galois::StatTimer executeTimer("Time");
     executeTimer.start();
-    executeUntilConverged(sf, g,
-                          [&](LatentValue* steps, size_t maxUpdates,
-                              galois::GAccumulator<double>* errorAccum) {
-                            Process fn{g,      xLocks,     yLocks,
-                                       blocks, numXBlocks, numYBlocks,
-                                       steps,  maxUpdates, errorAccum};
-                            galois::on_each(fn);
-                          });
+    executeUntilConverged(
+        sf, g,
+        [&](LatentValue* steps, size_t maxUpdates,
+            galois::GAccumulator<double>* errorAccum) {
+          Process fn{g,
+                     xLocks,
+                     yLocks,
+                     blocks,
+                     numXBlocks,
+                     numYBlocks,
+                     steps,
+                     maxUpdates,
+                     errorAccum,
+                     numaTiles ? &schedule : nullptr,
+                     barrier,
+                     crossSocketBlocks};
+          galois::on_each(fn);
+        });
     executeTimer.stop();
+
+    if (numaTiles) {
+      galois::runtime::reportStat_Single("sgdBlockJumpAlgo",
+                                         "CrossSocketBlocks",
+                                         crossSocketBlocks.reduce());
+    }
   }
 };
 
@@ -645,9 +785,8 @@ struct SGDBlockJumpAlgo {
 class SGDItemsAlgo {
   static const bool makeSerializable = false;
 
-  struct BasicNode {
-    LatentValue latentVector[LATENT_VECTOR_SIZE];
-  };
+  // latent vectors are kept in latentVectors
+  struct BasicNode {};
 
   using Node = BasicNode;
 
@@ -682,10 +821,11 @@ private:
           [&](GNode src, auto& ctx) {
             for (auto ii : g.edges(src)) {
 
-              GNode dst         = g.getEdgeDst(ii);
+              GNode dst = g.getEdgeDst(ii);
+              g.getData(dst);
               LatentValue error = doGradientUpdate(
-                  g.getData(src, galois::MethodFlag::UNPROTECTED).latentVector,
-                  g.getData(dst).latentVector, lambda, g.getEdgeData(ii),
+                  latentVectors.row(src), latentVectors.row(dst),
+                  latentVectors.rowStride(), lambda, g.getEdgeData(ii),
                   stepSize);
 
               edgesVisited += 1;
@@ -725,8 +865,6 @@ class SGDEdgeItem {
   static const bool makeSerializable = false;
 
   struct BasicNode {
-    // latent vector to be learned.
-    LatentValue latentVector[LATENT_VECTOR_SIZE];
     // if a item's update is interrupted, where to start when resuming.
     unsigned int edge_offset;
   };
@@ -773,10 +911,11 @@ private:
             std::advance(ii, srcData.edge_offset);
             // Take lock on the destination as multiple source may update the
             // same destination.
-            auto& dstData = g.getData(g.getEdgeDst(ii));
-            LatentValue error =
-                doGradientUpdate(srcData.latentVector, dstData.latentVector,
-                                 lambda, g.getEdgeData(ii), stepSize);
+            GNode dst = g.getEdgeDst(ii);
+            g.getData(dst);
+            LatentValue error = doGradientUpdate(
+                latentVectors.row(src), latentVectors.row(dst),
+                latentVectors.rowStride(), lambda, g.getEdgeData(ii), stepSize);
 
             ++srcData.edge_offset;
             ++ii;
@@ -829,9 +968,8 @@ public:
 class SGDBlockEdgeAlgo {
   static const bool makeSerializable = false;
 
-  struct BasicNode {
-    LatentValue latentVector[LATENT_VECTOR_SIZE];
-  };
+  // latent vectors are kept in latentVectors
+  struct BasicNode {};
 
   using Node = BasicNode;
 
@@ -853,27 +991,30 @@ private:
   using GNode         = typename Graph::GraphNode;
   using edge_iterator = typename Graph::edge_iterator;
 
+  using Executor = galois::runtime::Fixed2DGraphTiledExecutor<Graph>;
+
   struct Execute {
     Graph& g;
     galois::GAccumulator<unsigned>& edgesVisited;
 
     void operator()(LatentValue* steps, int maxUpdates,
                     galois::GAccumulator<double>* errorAccum) {
-      galois::runtime::Fixed2DGraphTiledExecutor<Graph> executor(g);
+      Executor executor(g);
       executor.execute(
           g.begin(), g.begin() + NUM_ITEM_NODES, g.begin() + NUM_ITEM_NODES,
           g.end(), itemsPerBlock, usersPerBlock,
           [&](GNode src, GNode dst, edge_iterator edge) {
             const LatentValue stepSize = steps[0];
             LatentValue error          = doGradientUpdate(
-                g.getData(src).latentVector, g.getData(dst).latentVector,
-                lambda, g.getEdgeData(edge), stepSize);
+                latentVectors.row(src), latentVectors.row(dst),
+                latentVectors.rowStride(), lambda, g.getEdgeData(edge),
+                stepSize);
             edgesVisited += 1;
             if (useExactError)
               *errorAccum += error;
           },
-          true // use locks
-      );
+          true, // use locks
+          1, numaTiles);
     }
   };
 
@@ -882,6 +1023,17 @@ public:
     verify(g, "sgdBlockEdgeAlgo");
     galois::GAccumulator<unsigned> edgesVisited;
 
+    if (numaTiles) {
+      // items are the X dimension and users the Y dimension of the grid
+      auto placement = Executor::socketPlacement(
+          g.begin(), g.begin() + NUM_ITEM_NODES, g.begin() + NUM_ITEM_NODES,
+          g.end(), itemsPerBlock, usersPerBlock);
+      latentVectors.distribute([&](size_t n) {
+        return n < NUM_ITEM_NODES ? placement.xSocket(n)
+                                  : placement.ySocket(n - NUM_ITEM_NODES);
+      });
+    }
+
     // galois::StatTimer executeTimer("Total Execution Time");
     galois::StatTimer executeTimer("Time");
     executeTimer.start();
@@ -905,17 +1057,16 @@ public:
 struct SimpleALSalgo {
   bool isSgd() const { return false; }
   std::string name() const { return "AlternatingLeastSquares"; }
-  struct Node {
-    LatentValue latentVector[LATENT_VECTOR_SIZE];
-  };
+  // latent vectors are kept in latentVectors
+  struct Node {};
 
   typedef typename galois::graphs::LC_CSR_Graph<Node, double>::with_no_lockable<
       true>::type Graph;
   typedef Graph::GraphNode GNode;
   // Column-major access
   typedef Eigen::SparseMatrix<LatentValue> Sp;
-  typedef Eigen::Matrix<LatentValue, LATENT_VECTOR_SIZE, Eigen::Dynamic> MT;
-  typedef Eigen::Matrix<LatentValue, LATENT_VECTOR_SIZE, 1> V;
+  typedef Eigen::Matrix<LatentValue, Eigen::Dynamic, Eigen::Dynamic> MT;
+  typedef Eigen::Matrix<LatentValue, Eigen::Dynamic, 1> V;
   typedef Eigen::Map<V> MapV;
 
   Sp A;
@@ -926,8 +1077,7 @@ struct SimpleALSalgo {
   void copyToGraph(Graph& g, MT& WT, MT& HT) {
     // Copy out
     for (GNode n : g) {
-      LatentValue* ptr = &g.getData(n).latentVector[0];
-      MapV mapV{ptr};
+      MapV mapV{latentVectors.row(n), latentVectors.size()};
       if (n < NUM_ITEM_NODES) {
         mapV = WT.col(n);
       } else {
@@ -938,8 +1088,7 @@ struct SimpleALSalgo {
 
   void copyFromGraph(Graph& g, MT& WT, MT& HT) {
     for (GNode n : g) {
-      LatentValue* ptr = &g.getData(n).latentVector[0];
-      MapV mapV{ptr};
+      MapV mapV{latentVectors.row(n), latentVectors.size()};
       if (n < NUM_ITEM_NODES) {
         WT.col(n) = mapV;
       } else {
@@ -971,11 +1120,10 @@ struct SimpleALSalgo {
     // squares problems:
     //   (W^T W + lambda I) H^T = W^T A (solving for H^T)
     //   (H^T H + lambda I) W^T = H^T A^T (solving for W^T)
-    MT WT{LATENT_VECTOR_SIZE, NUM_ITEM_NODES};
-    MT HT{LATENT_VECTOR_SIZE, g.size() - NUM_ITEM_NODES};
-    typedef Eigen::Matrix<LatentValue, LATENT_VECTOR_SIZE, LATENT_VECTOR_SIZE>
-        XTX;
-    typedef Eigen::Matrix<LatentValue, LATENT_VECTOR_SIZE, Eigen::Dynamic> XTSp;
+    MT WT{latentVectors.size(), NUM_ITEM_NODES};
+    MT HT{latentVectors.size(), g.size() - NUM_ITEM_NODES};
+    typedef Eigen::Matrix<LatentValue, Eigen::Dynamic, Eigen::Dynamic> XTX;
+    typedef Eigen::Matrix<LatentValue, Eigen::Dynamic, Eigen::Dynamic> XTSp;
     typedef galois::substrate::PerThreadStorage<XTX> PerThrdXTX;
 
     galois::gPrint("ALS::Start initializeA\n");
@@ -1010,11 +1158,11 @@ struct SimpleALSalgo {
           [&](int col, galois::UserContext<int>&) {
             // Compute WTW = W^T * W for sparse A
             XTX& WTW = *xtxs.getLocal();
-            WTW.setConstant(0);
+            WTW.setZero(latentVectors.size(), latentVectors.size());
             for (Sp::InnerIterator it(A, col); it; ++it)
               WTW.triangularView<Eigen::Upper>() +=
                   WT.col(it.row()) * WT.col(it.row()).transpose();
-            for (int i = 0; i < LATENT_VECTOR_SIZE; ++i)
+            for (unsigned i = 0; i < latentVectors.size(); ++i)
               WTW(i, i) += lambda;
             HT.col(col) =
                 WTW.selfadjointView<Eigen::Upper>().llt().solve(WTA.col(col));
@@ -1032,11 +1180,11 @@ struct SimpleALSalgo {
           [&](int col, galois::UserContext<int>&) {
             // Compute HTH = H^T * H for sparse A
             XTX& HTH = *xtxs.getLocal();
-            HTH.setConstant(0);
+            HTH.setZero(latentVectors.size(), latentVectors.size());
             for (Sp::InnerIterator it(AT, col); it; ++it)
               HTH.triangularView<Eigen::Upper>() +=
                   HT.col(it.row()) * HT.col(it.row()).transpose();
-            for (int i = 0; i < LATENT_VECTOR_SIZE; ++i)
+            for (unsigned i = 0; i < latentVectors.size(); ++i)
               HTH(i, i) += lambda;
             WT.col(col) =
                 HTH.selfadjointView<Eigen::Upper>().llt().solve(HTAT.col(col));
@@ -1073,9 +1221,8 @@ struct SyncALSalgo {
 
   std::string name() const { return "SynchronousAlternatingLeastSquares"; }
 
-  struct Node {
-    LatentValue latentVector[LATENT_VECTOR_SIZE];
-  };
+  // latent vectors are kept in latentVectors
+  struct Node {};
 
   static const bool NEEDS_LOCKS = false;
   typedef typename galois::graphs::LC_CSR_Graph<Node, double> BaseGraph;
@@ -1086,12 +1233,11 @@ struct SyncALSalgo {
   typedef typename Graph::GraphNode GNode;
   // Column-major access
   typedef Eigen::SparseMatrix<LatentValue> Sp;
-  typedef Eigen::Matrix<LatentValue, LATENT_VECTOR_SIZE, Eigen::Dynamic> MT;
-  typedef Eigen::Matrix<LatentValue, LATENT_VECTOR_SIZE, 1> V;
+  typedef Eigen::Matrix<LatentValue, Eigen::Dynamic, Eigen::Dynamic> MT;
+  typedef Eigen::Matrix<LatentValue, Eigen::Dynamic, 1> V;
   typedef Eigen::Map<V> MapV;
-  typedef Eigen::Matrix<LatentValue, LATENT_VECTOR_SIZE, LATENT_VECTOR_SIZE>
-      XTX;
-  typedef Eigen::Matrix<LatentValue, LATENT_VECTOR_SIZE, Eigen::Dynamic> XTSp;
+  typedef Eigen::Matrix<LatentValue, Eigen::Dynamic, Eigen::Dynamic> XTX;
+  typedef Eigen::Matrix<LatentValue, Eigen::Dynamic, Eigen::Dynamic> XTSp;
 
   typedef galois::substrate::PerThreadStorage<XTX> PerThrdXTX;
   typedef galois::substrate::PerThreadStorage<V> PerThrdV;
@@ -1104,8 +1250,7 @@ struct SyncALSalgo {
   void copyToGraph(Graph& g, MT& WT, MT& HT) {
     // Copy out
     for (GNode n : g) {
-      LatentValue* ptr = &g.getData(n).latentVector[0];
-      MapV mapV{ptr};
+      MapV mapV{latentVectors.row(n), latentVectors.size()};
       if (n < NUM_ITEM_NODES) {
         mapV = WT.col(n);
       } else {
@@ -1116,8 +1261,7 @@ struct SyncALSalgo {
 
   void copyFromGraph(Graph& g, MT& WT, MT& HT) {
     for (GNode n : g) {
-      LatentValue* ptr = &g.getData(n).latentVector[0];
-      MapV mapV{ptr};
+      MapV mapV{latentVectors.row(n), latentVectors.size()};
       if (n < NUM_ITEM_NODES) {
         WT.col(n) = mapV;
       } else {
@@ -1146,30 +1290,30 @@ struct SyncALSalgo {
     // Compute WTW = W^T * W for sparse A
     V& r = *rhs.getLocal();
     if (col < NUM_ITEM_NODES) {
-      r.setConstant(0);
+      r.setZero(latentVectors.size());
       // HTAT = HT * AT; r = HTAT.col(col)
       for (Sp::InnerIterator it(AT, col); it; ++it)
         r += it.value() * HT.col(it.row());
       XTX& HTH = *xtxs.getLocal();
-      HTH.setConstant(0);
+      HTH.setZero(latentVectors.size(), latentVectors.size());
       for (Sp::InnerIterator it(AT, col); it; ++it)
         HTH.triangularView<Eigen::Upper>() +=
             HT.col(it.row()) * HT.col(it.row()).transpose();
-      for (int i = 0; i < LATENT_VECTOR_SIZE; ++i)
+      for (unsigned i = 0; i < latentVectors.size(); ++i)
         HTH(i, i) += lambda;
       WT.col(col) = HTH.selfadjointView<Eigen::Upper>().llt().solve(r);
     } else {
       col = col - NUM_ITEM_NODES;
-      r.setConstant(0);
+      r.setZero(latentVectors.size());
       // WTA = WT * A; x = WTA.col(col)
       for (Sp::InnerIterator it(A, col); it; ++it)
         r += it.value() * WT.col(it.row());
       XTX& WTW = *xtxs.getLocal();
-      WTW.setConstant(0);
+      WTW.setZero(latentVectors.size(), latentVectors.size());
       for (Sp::InnerIterator it(A, col); it; ++it)
         WTW.triangularView<Eigen::Upper>() +=
             WT.col(it.row()) * WT.col(it.row()).transpose();
-      for (int i = 0; i < LATENT_VECTOR_SIZE; ++i)
+      for (unsigned i = 0; i < latentVectors.size(); ++i)
         WTW(i, i) += lambda;
       HT.col(col) = WTW.selfadjointView<Eigen::Upper>().llt().solve(r);
     }
@@ -1226,8 +1370,8 @@ struct SyncALSalgo {
     // squares problems:
     //   (W^T W + lambda I) H^T = W^T A (solving for H^T)
     //   (H^T H + lambda I) W^T = H^T A^T (solving for W^T)
-    MT WT{LATENT_VECTOR_SIZE, NUM_ITEM_NODES};
-    MT HT{LATENT_VECTOR_SIZE, g.size() - NUM_ITEM_NODES};
+    MT WT{latentVectors.size(), NUM_ITEM_NODES};
+    MT HT{latentVectors.size(), g.size() - NUM_ITEM_NODES};
 
     initializeA(g);
     copyFromGraph(g, WT, HT);
@@ -1301,7 +1445,9 @@ size_t initializeGraphData(Graph& g) {
   galois::gPrint("initializeGraphData\n");
   galois::StatTimer initTimer("InitializeGraph");
   initTimer.start();
-  double top = 1.0 / std::sqrt(LATENT_VECTOR_SIZE);
+  latentVectors.allocate(g.size(), latentVectorSize);
+  const unsigned dim = latentVectors.size();
+  double top         = 1.0 / std::sqrt(dim);
   galois::substrate::PerThreadStorage<std::mt19937> gen;
 
 #if __cplusplus >= 201103L || defined(HAVE_CXX11_UNIFORM_INT_DISTRIBUTION)
@@ -1312,26 +1458,26 @@ size_t initializeGraphData(Graph& g) {
 
   if (useDetInit) {
     galois::do_all(galois::iterate(g), [&](typename Graph::GraphNode n) {
-      auto& data = g.getData(n);
-      auto val   = genVal(n);
-      for (int i = 0; i < LATENT_VECTOR_SIZE; i++) {
-        data.latentVector[i] = val;
+      LatentValue* data = latentVectors.row(n);
+      auto val          = genVal(n);
+      for (unsigned i = 0; i < dim; i++) {
+        data[i] = val;
       }
     });
   } else {
     galois::do_all(galois::iterate(g), [&](typename Graph::GraphNode n) {
-      auto& data = g.getData(n);
+      LatentValue* data = latentVectors.row(n);
 
       // all threads initialize their assignment with same generator or
       // a thread local one
       if (useSameLatentVector) {
         std::mt19937 sameGen;
-        for (int i = 0; i < LATENT_VECTOR_SIZE; i++) {
-          data.latentVector[i] = dist(sameGen);
+        for (unsigned i = 0; i < dim; i++) {
+          data[i] = dist(sameGen);
         }
       } else {
-        for (int i = 0; i < LATENT_VECTOR_SIZE; i++) {
-          data.latentVector[i] = dist(*gen.getLocal());
+        for (unsigned i = 0; i < dim; i++) {
+          data[i] = dist(*gen.getLocal());
         }
       }
     });
@@ -1368,8 +1514,8 @@ template <typename Graph>
 void writeBinaryLatentVectors(Graph& g, const std::string& filename) {
   std::ofstream file(filename);
   for (auto ii = g.begin(), ei = g.end(); ii != ei; ++ii) {
-    auto& v = g.getData(*ii).latentVector;
-    for (int i = 0; i < LATENT_VECTOR_SIZE; ++i) {
+    LatentValue* v = latentVectors.row(*ii);
+    for (unsigned i = 0; i < latentVectors.size(); ++i) {
       file.write(reinterpret_cast<char*>(&v[i]), sizeof(v[i]));
     }
   }
@@ -1380,8 +1526,8 @@ template <typename Graph>
 void writeAsciiLatentVectors(Graph& g, const std::string& filename) {
   std::ofstream file(filename);
   for (auto ii = g.begin(), ei = g.end(); ii != ei; ++ii) {
-    auto& v = g.getData(*ii).latentVector;
-    for (int i = 0; i < LATENT_VECTOR_SIZE; ++i) {
+    LatentValue* v = latentVectors.row(*ii);
+    for (unsigned i = 0; i < latentVectors.size(); ++i) {
       file << v[i] << " ";
     }
     file << "\n";
@@ -1419,7 +1565,7 @@ void run() {
             << " num ratings: " << g.sizeEdges() << "\n";
 
   std::unique_ptr<StepFunction> sf{newStepFunction()};
-  std::cout << "latent vector size: " << LATENT_VECTOR_SIZE
+  std::cout << "latent vector size: " << latentVectors.size()
             << " algo: " << algo.name() << " lambda: " << lambda;
 
   if (algo.isSgd()) {
@@ -1465,6 +1611,10 @@ int main(int argc, char** argv) {
   galois::SharedMemSys G;
   LonestarStart(argc, argv, name, desc, url);
 
+  if (latentVectorSize == 0) {
+    GALOIS_DIE("latent vector size must be positive");
+  }
+
   switch (algo) {
 #ifdef HAS_EIGEN
   case Algo::syncALS:
@@ -22,14 +22,18 @@
 
 #include <cassert>
 #include <galois/gstl.h>
+#include <galois/Galois.h>
+#include <galois/LargeArray.h>
+#include <galois/substrate/PageAlloc.h>
 #include <string>
+#include <type_traits>
 #include "llvm/Support/CommandLine.h"
 
-typedef double LatentValue;
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
 
-// Purdue, CSGD: 100; Intel: 20
-// static const int LATENT_VECTOR_SIZE = 100;
-static const int LATENT_VECTOR_SIZE = 20; // Purdue, CSGD: 100; Intel: 20
+typedef double LatentValue;
 
 /**
  * Common commandline parameters to for matrix completion algorithms
@@ -40,6 +44,12 @@ namespace cll = llvm::cl;
 static cll::opt<std::string>
     inputFilename(cll::Positional, cll::desc("<input file>"), cll::Required);
 
+// Purdue, CSGD: 100; Intel: 20
+static cll::opt<unsigned>
+    latentVectorSize("latentVectorSize",
+                     cll::desc("size of the latent vectors (default 20)"),
+                     cll::init(20));
+
 /*
  * (Purdue, Neflix): 0.012, (Purdue, Yahoo Music): 0.00075, (Purdue, HugeWiki):
  * 0.001 Intel: 0.001 Bottou: 0.1
@@ -73,6 +83,13 @@ static cll::opt<unsigned> usersPerBlock("usersPerBlock",
 static cll::opt<unsigned> itemsPerBlock("itemsPerBlock",
                                         cll::desc("items per block"),
                                         cll::init(350));
+static cll::opt<bool>
+    numaTiles("numaTiles",
+              cll::desc("NUMA-aware block schedule for sgdBlockEdge and "
+                        "sgdBlockJump: latent vectors of each block are placed "
+                        "on the owning socket and blocks are processed in "
+                        "socket-affine rotating diagonals (default false)"),
+              cll::init(false));
 static cll::opt<float>
     tolerance("tolerance", cll::desc("convergence tolerance"), cll::init(0.01));
 
@@ -117,36 +134,229 @@ static cll::opt<bool>
                cll::init(false));
 
 /**
- * Inner product of 2 vectors.
- *
- * Like std::inner_product but rewritten here to check vectorization
+ * Latent vectors of all nodes, stored outside of the graph with one row per
+ * node id. Rows are padded with zeros to a multiple of 64 bytes and the array
+ * is page aligned, so every row starts on a cache line and the kernels below
+ * can use aligned vector loads without a remainder loop. The padding stays
+ * zero under gradient updates.
+ */
+class LatentMatrix {
+  galois::LargeArray<LatentValue> data;
+  size_t rows     = 0;
+  unsigned dim    = 0;
+  unsigned stride = 0;
+
+public:
+  //! number of values in 64 bytes
+  static const unsigned ROW_ALIGN = 64 / sizeof(LatentValue);
+
+  /**
+   * Allocate zeroed rows. Rows are blocked across threads so each thread
+   * first touches, and therefore owns, a contiguous range of rows.
+   */
+  void allocate(size_t numRows, unsigned latentSize) {
+    rows   = numRows;
+    dim    = latentSize;
+    stride = (latentSize + ROW_ALIGN - 1) / ROW_ALIGN * ROW_ALIGN;
+    data.allocateBlocked(rows * stride);
+    galois::do_all(galois::iterate(size_t{0}, rows),
+                   [&](size_t n) {
+                     std::fill(row(n), row(n) + stride, LatentValue(0));
+                   },
+                   galois::loopname("AllocateLatentVectors"));
+  }
+
+  /**
+   * Move every row to the socket given by rowSocket(row). The rows are copied
+   * into a new array whose pages are first touched by a thread of the owning
+   * socket; a page holding rows of several sockets goes to the owner of its
+   * first row.
+   */
+  template <typename RowSocketFn>
+  void distribute(RowSocketFn rowSocket) {
+    auto& tp = galois::substrate::getThreadPool();
+    const size_t pageValues =
+        std::max<size_t>(galois::substrate::allocSize() / sizeof(LatentValue),
+                         stride);
+    const size_t numPages = (data.size() + pageValues - 1) / pageValues;
+
+    galois::LargeArray<LatentValue> placed;
+    placed.allocateFloating(data.size());
+
+    galois::on_each([&](unsigned tid, unsigned total) {
+      const unsigned socket    = tp.getSocket(tid);
+      const unsigned maxSocket = tp.getCumulativeMaxSocket(total - 1);
+      unsigned rank            = 0;
+      unsigned peers           = 0;
+      for (unsigned i = 0; i < total; ++i) {
+        if (tp.getSocket(i) == socket) {
+          rank += i < tid;
+          peers += 1;
+        }
+      }
+
+      // pages of this socket are dealt round robin to its threads
+      size_t seen = 0;
+      for (size_t p = 0; p < numPages; ++p) {
+        size_t begin = p * pageValues;
+        if (std::min(rowSocket(begin / stride), maxSocket) != socket)
+          continue;
+        if (seen++ % peers != rank)
+          continue;
+        size_t end = std::min(begin + pageValues, data.size());
+        std::copy(data.data() + begin, data.data() + end,
+                  placed.data() + begin);
+      }
+    });
+
+    data = std::move(placed);
+  }
+
+  LatentValue* row(size_t n) { return &data[n * stride]; }
+  const LatentValue* row(size_t n) const { return &data[n * stride]; }
+  //! number of meaningful values in a row
+  unsigned size() const { return dim; }
+  //! number of values in a row including padding
+  unsigned rowStride() const { return stride; }
+};
+
+/**
+ * Dot product and gradient step on padded latent rows of N values. N is a
+ * multiple of LatentMatrix::ROW_ALIGN; rows are 64-byte aligned.
+ */
+template <unsigned N>
+struct LatentKernel {
+  static_assert(N % LatentMatrix::ROW_ALIGN == 0, "Rows must be padded");
+  static_assert(std::is_same<LatentValue, double>::value,
+                "Vector kernels assume double latent values");
+
+#if defined(__AVX512F__)
+  static LatentValue dot(const LatentValue* __restrict__ a,
+                         const LatentValue* __restrict__ b) {
+    __m512d sum = _mm512_setzero_pd();
+    for (unsigned i = 0; i < N; i += 8)
+      sum = _mm512_fmadd_pd(_mm512_load_pd(a + i), _mm512_load_pd(b + i), sum);
+    return _mm512_reduce_add_pd(sum);
+  }
+
+  //! item = scale * item + coef * user; user = scale * user + coef * item
+  static void update(LatentValue* __restrict__ item,
+                     LatentValue* __restrict__ user, LatentValue scale,
+                     LatentValue coef) {
+    __m512d s = _mm512_set1_pd(scale);
+    __m512d c = _mm512_set1_pd(coef);
+    for (unsigned i = 0; i < N; i += 8) {
+      __m512d it = _mm512_load_pd(item + i);
+      __m512d us = _mm512_load_pd(user + i);
+      _mm512_store_pd(item + i, _mm512_fmadd_pd(c, us, _mm512_mul_pd(s, it)));
+      _mm512_store_pd(user + i, _mm512_fmadd_pd(c, it, _mm512_mul_pd(s, us)));
+    }
+  }
+#elif defined(__AVX2__) && defined(__FMA__)
+  static LatentValue dot(const LatentValue* __restrict__ a,
+                         const LatentValue* __restrict__ b) {
+    // two accumulators to hide the latency of the fma chain
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    for (unsigned i = 0; i < N; i += 8) {
+      sum0 = _mm256_fmadd_pd(_mm256_load_pd(a + i), _mm256_load_pd(b + i),
+                             sum0);
+      sum1 = _mm256_fmadd_pd(_mm256_load_pd(a + i + 4),
+                             _mm256_load_pd(b + i + 4), sum1);
+    }
+    __m256d sum = _mm256_add_pd(sum0, sum1);
+    __m128d half =
+        _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+    return _mm_cvtsd_f64(_mm_add_pd(half, _mm_unpackhi_pd(half, half)));
+  }
+
+  //! item = scale * item + coef * user; user = scale * user + coef * item
+  static void update(LatentValue* __restrict__ item,
+                     LatentValue* __restrict__ user, LatentValue scale,
+                     LatentValue coef) {
+    __m256d s = _mm256_set1_pd(scale);
+    __m256d c = _mm256_set1_pd(coef);
+    for (unsigned i = 0; i < N; i += 4) {
+      __m256d it = _mm256_load_pd(item + i);
+      __m256d us = _mm256_load_pd(user + i);
+      _mm256_store_pd(item + i, _mm256_fmadd_pd(c, us, _mm256_mul_pd(s, it)));
+      _mm256_store_pd(user + i, _mm256_fmadd_pd(c, it, _mm256_mul_pd(s, us)));
+    }
+  }
+#else
+  static LatentValue dot(const LatentValue* __restrict__ a,
+                         const LatentValue* __restrict__ b) {
+    LatentValue sum = 0;
+    for (unsigned i = 0; i < N; ++i)
+      sum += a[i] * b[i];
+    return sum;
+  }
+
+  //! item = scale * item + coef * user; user = scale * user + coef * item
+  static void update(LatentValue* __restrict__ item,
+                     LatentValue* __restrict__ user, LatentValue scale,
+                     LatentValue coef) {
+    for (unsigned i = 0; i < N; ++i) {
+      LatentValue prevItem = item[i];
+      LatentValue prevUser = user[i];
+      item[i]              = scale * prevItem + coef * prevUser;
+      user[i]              = scale * prevUser + coef * prevItem;
+    }
+  }
+#endif
+};
+
+/**
+ * Calls fn with the kernel specialized for the given row stride. Common
+ * latent sizes (16, 20, 32, 64, 128) get fully unrolled kernels; any other
+ * stride is processed 64 bytes at a time.
+ */
+template <typename Fn>
+auto withLatentKernel(unsigned stride, Fn fn) {
+  const unsigned W = LatentMatrix::ROW_ALIGN;
+  switch (stride) {
+  case 2 * W:
+    return fn(LatentKernel<2 * W>(), 1);
+  case 3 * W:
+    return fn(LatentKernel<3 * W>(), 1);
+  case 4 * W:
+    return fn(LatentKernel<4 * W>(), 1);
+  case 8 * W:
+    return fn(LatentKernel<8 * W>(), 1);
+  case 16 * W:
+    return fn(LatentKernel<16 * W>(), 1);
+  default:
+    return fn(LatentKernel<W>(), stride / W);
+  }
+}
+
+/**
+ * Inner product of 2 latent rows.
  *
- * @param first1 Pointer to beginning of vector 1
- * @param last1 Pointer to end of vector 1. Should be exactly LATENT_VECTOR_SIZE
- * away from first1
- * @param first2 Pointer to beginning of vector 2. Should have at least
- * LATENT_VECTOR_SIZE elements from this point.
+ * @param first1 Pointer to beginning of row 1
+ * @param first2 Pointer to beginning of row 2
+ * @param stride Padded length of the rows (LatentMatrix::rowStride)
  * @param init Initial value to accumulate sum into
  *
  * @returns init + the inner product (i.e. the inner product if init is 0, error
  * if init is -"ground truth"
  */
-template <typename T>
-T innerProduct(T* __restrict__ first1, T* __restrict__ last1,
-               T* __restrict__ first2, T init) {
-  assert(first1 + LATENT_VECTOR_SIZE == last1);
-  for (int i = 0; i < LATENT_VECTOR_SIZE; ++i) {
-    init += first1[i] * first2[i];
-  }
-  return init;
+inline LatentValue innerProduct(const LatentValue* __restrict__ first1,
+                                const LatentValue* __restrict__ first2,
+                                unsigned stride, LatentValue init) {
+  return withLatentKernel(stride, [&](auto kernel, unsigned blocks) {
+    using K = decltype(kernel);
+    for (unsigned b = 0, off = 0; b < blocks; ++b, off += stride / blocks)
+      init += K::dot(first1 + off, first2 + off);
+    return init;
+  });
 }
 
-template <typename T>
-T predictionError(T* __restrict__ itemLatent, T* __restrict__ userLatent,
-                  double actual) {
-  T v = actual;
-  return innerProduct(itemLatent, itemLatent + LATENT_VECTOR_SIZE, userLatent,
-                      -v);
+inline LatentValue predictionError(const LatentValue* __restrict__ itemLatent,
+                                   const LatentValue* __restrict__ userLatent,
+                                   unsigned stride, double actual) {
+  LatentValue v = actual;
+  return innerProduct(itemLatent, userLatent, stride, -v);
 }
 
 /**
@@ -156,6 +366,7 @@ T predictionError(T* __restrict__ itemLatent, T* __restrict__ userLatent,
  *
  * @param itemLatent latent vector of the item
  * @param userLatent latent vector of the user
+ * @param stride Padded length of the rows (LatentMatrix::rowStride)
  * @param lambda learning parameter
  * @param edgeRating Data on the edge, i.e. the number that the inner product
  * of the 2 latent vectors should eventually get to
@@ -164,25 +375,25 @@ T predictionError(T* __restrict__ itemLatent, T* __restrict__ userLatent,
  *
  * @return Error before gradient update
  */
-template <typename T>
-T doGradientUpdate(T* __restrict__ itemLatent, T* __restrict__ userLatent,
-                   double lambda, double edgeRating, double stepSize) {
-  // Implicit cast to type T
-  T l      = lambda;
-  T step   = stepSize;
-  T rating = edgeRating;
-  T error  = innerProduct(itemLatent, itemLatent + LATENT_VECTOR_SIZE,
-                         userLatent, -rating);
-
-  // Take gradient step to reduce error
-  for (int i = 0; i < LATENT_VECTOR_SIZE; i++) {
-    T prevItem = itemLatent[i];
-    T prevUser = userLatent[i];
-    itemLatent[i] -= step * (error * prevUser + l * prevItem);
-    userLatent[i] -= step * (error * prevItem + l * prevUser);
-  }
+inline LatentValue doGradientUpdate(LatentValue* __restrict__ itemLatent,
+                                    LatentValue* __restrict__ userLatent,
+                                    unsigned stride, double lambda,
+                                    double edgeRating, double stepSize) {
+  return withLatentKernel(stride, [&](auto kernel, unsigned blocks) {
+    using K           = decltype(kernel);
+    unsigned n        = stride / blocks;
+    LatentValue error = -edgeRating;
+    for (unsigned b = 0; b < blocks; ++b)
+      error += K::dot(itemLatent + b * n, userLatent + b * n);
 
-  return error;
+    // Take gradient step to reduce error:
+    //   item -= step * (error * user + lambda * item), same for user
+    LatentValue scale = 1.0 - stepSize * lambda;
+    LatentValue coef  = -stepSize * error;
+    for (unsigned b = 0; b < blocks; ++b)
+      K::update(itemLatent + b * n, userLatent + b * n, scale, coef);
+    return error;
+  });
 }
 
 struct StepFunction {
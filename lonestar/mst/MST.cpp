@@ -0,0 +1,494 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+#include "galois/Galois.h"
+#include "galois/Bag.h"
+#include "galois/LargeArray.h"
+#include "galois/ParallelSTL.h"
+#include "galois/Reduction.h"
+#include "galois/Timer.h"
+#include "galois/UnionFind.h"
+#include "galois/graphs/FileGraph.h"
+#include "llvm/Support/CommandLine.h"
+
+#include "Lonestar/BoilerPlate.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+namespace cll = llvm::cl;
+
+static const char* name = "Minimum Spanning Forest";
+static const char* desc =
+    "Computes the minimum spanning forest of a graph using an edge array "
+    "instead of a mutable graph";
+static const char* url = "mst";
+
+enum Algo { filterKruskal, boruvka };
+
+static cll::opt<std::string>
+    inputFilename(cll::Positional, cll::desc("<input file>"), cll::Required);
+static cll::opt<bool>
+    symmetricGraph("symmetricGraph",
+                   cll::desc("Graph already symmetric (default value false)"),
+                   cll::init(false));
+static cll::opt<Algo> algo(
+    "algo", cll::desc("Choose an algorithm (default value filterKruskal):"),
+    cll::values(clEnumVal(filterKruskal, "Parallel filter-Kruskal"),
+                clEnumVal(boruvka, "Boruvka with edge array contraction"),
+                clEnumValEnd),
+    cll::init(filterKruskal));
+static cll::opt<unsigned> kruskalBaseSize(
+    "kruskalBaseSize",
+    cll::desc("Filter-Kruskal sorts edge ranges up to this size directly "
+              "(default value 0 means the number of nodes)"),
+    cll::init(0));
+
+typedef int EdgeData;
+
+//! Undirected edge; each edge of the input appears once
+struct Edge {
+  uint32_t src;
+  uint32_t dst;
+  EdgeData weight;
+};
+
+struct Component : public galois::UnionFindNode<Component> {
+  Component()
+      : galois::UnionFindNode<Component>(const_cast<Component*>(this)) {}
+};
+
+typedef galois::LargeArray<Edge> EdgeList;
+typedef galois::LargeArray<Component> Components;
+typedef galois::InsertBag<Edge> Forest;
+
+/**
+ * Reads the input into an edge array. A symmetric input contributes each
+ * edge once (src < dst); for a directed input every non self-loop edge is
+ * taken as undirected, so the graph never needs to be symmetrized.
+ */
+size_t readEdges(EdgeList& edges) {
+  galois::graphs::FileGraph graph;
+  graph.fromFileInterleaved<EdgeData>(inputFilename);
+
+  size_t numNodes = graph.size();
+  galois::LargeArray<uint64_t> offsets;
+  offsets.allocateInterleaved(numNodes + 1);
+
+  auto keep = [&](uint32_t src, uint32_t dst) {
+    return symmetricGraph ? src < dst : src != dst;
+  };
+
+  galois::do_all(
+      galois::iterate(size_t{0}, numNodes),
+      [&](size_t src) {
+        uint64_t count = 0;
+        for (auto ii : graph.edges(src)) {
+          if (keep(src, graph.getEdgeDst(ii)))
+            count += 1;
+        }
+        offsets[src + 1] = count;
+      },
+      galois::steal());
+
+  offsets[0] = 0;
+  for (size_t n = 0; n < numNodes; ++n)
+    offsets[n + 1] += offsets[n];
+
+  edges.allocateInterleaved(offsets[numNodes]);
+  galois::do_all(
+      galois::iterate(size_t{0}, numNodes),
+      [&](size_t src) {
+        uint64_t pos = offsets[src];
+        for (auto ii : graph.edges(src)) {
+          uint32_t dst = graph.getEdgeDst(ii);
+          if (keep(src, dst)) {
+            edges[pos++] = Edge{static_cast<uint32_t>(src), dst,
+                                graph.getEdgeData<EdgeData>(ii)};
+          }
+        }
+      },
+      galois::steal());
+
+  return numNodes;
+}
+
+/**
+ * Filter-Kruskal of Osipov, Sanders and Singler. Edges are partitioned around
+ * a pivot weight; the light half is solved recursively, after which heavy
+ * edges whose endpoints are already connected are filtered out before the
+ * heavy half is solved. Small ranges are sorted and scanned as in Kruskal.
+ */
+struct FilterKruskal {
+  Components& components;
+  Forest& forest;
+  size_t baseSize;
+  size_t numTrees;
+  size_t numFiltered;
+
+  FilterKruskal(Components& c, Forest& f, size_t n)
+      : components(c), forest(f), numTrees(n), numFiltered(0) {
+    baseSize = std::max<size_t>(kruskalBaseSize ? kruskalBaseSize : n, 1024);
+  }
+
+  static bool lighter(const Edge& a, const Edge& b) {
+    return a.weight < b.weight;
+  }
+
+  void kruskal(Edge* first, Edge* last) {
+    galois::ParallelSTL::sort(first, last, lighter);
+    for (; first != last && numTrees > 1; ++first) {
+      if (components[first->src].merge(&components[first->dst])) {
+        forest.push(*first);
+        numTrees -= 1;
+      }
+    }
+  }
+
+  void operator()(Edge* first, Edge* last) {
+    if (numTrees <= 1)
+      return;
+    if (static_cast<size_t>(last - first) <= baseSize) {
+      kruskal(first, last);
+      return;
+    }
+
+    EdgeData pivot = galois::ParallelSTL::choose_rand(first, last)->weight;
+    Edge* mid      = galois::ParallelSTL::partition(
+        first, last, [=](const Edge& e) { return e.weight <= pivot; });
+    if (mid == last) {
+      // Pivot was the heaviest weight; split off the edges equal to it
+      mid = galois::ParallelSTL::partition(
+          first, last, [=](const Edge& e) { return e.weight < pivot; });
+      if (mid == first) {
+        kruskal(first, last);
+        return;
+      }
+    }
+
+    (*this)(first, mid);
+    if (numTrees <= 1)
+      return;
+
+    Components& c = components;
+    Edge* heavy   = galois::ParallelSTL::partition(
+        mid, last, [&c](const Edge& e) {
+          return c[e.src].findAndCompress() != c[e.dst].findAndCompress();
+        });
+    numFiltered += last - heavy;
+    (*this)(mid, heavy);
+  }
+};
+
+/**
+ * Boruvka's algorithm over a CSR edge array. Each round every component picks
+ * its lightest incident edge, components are hooked along those edges and
+ * collapsed by pointer jumping, and the edge array is rebuilt over the new
+ * component ids without self loops. Components without remaining edges are
+ * dropped, so each round works only on the shrinking contracted graph.
+ */
+struct ArrayBoruvka {
+  struct Arc {
+    uint32_t dst;
+    EdgeData weight;
+    uint64_t id;
+  };
+
+  static constexpr uint64_t NONE = std::numeric_limits<uint64_t>::max();
+
+  const EdgeList& edges;
+  Forest& forest;
+  size_t numNodes;
+
+  //! Current contracted graph and the buffer the next one is built in
+  galois::LargeArray<uint64_t> offsets;
+  galois::LargeArray<Arc> arcs;
+  galois::LargeArray<uint64_t> nextOffsets;
+  galois::LargeArray<Arc> nextArcs;
+
+  ArrayBoruvka(const EdgeList& e, Forest& f, size_t n)
+      : edges(e), forest(f), numNodes(n) {}
+
+  //! Total order on arcs so that no hooking cycle is longer than two
+  static bool lighter(const Arc& a, const Arc& b) {
+    return a.weight < b.weight || (a.weight == b.weight && a.id < b.id);
+  }
+
+  void buildCSR() {
+    galois::LargeArray<uint64_t> cursor;
+    cursor.allocateInterleaved(numNodes);
+    offsets.allocateInterleaved(numNodes + 1);
+    arcs.allocateInterleaved(2 * edges.size());
+    nextOffsets.allocateInterleaved(numNodes + 1);
+    nextArcs.allocateInterleaved(2 * edges.size());
+
+    galois::do_all(galois::iterate(size_t{0}, numNodes),
+                   [&](size_t n) { cursor[n] = 0; });
+    galois::do_all(galois::iterate(size_t{0}, edges.size()), [&](size_t i) {
+      __sync_fetch_and_add(&cursor[edges[i].src], 1);
+      __sync_fetch_and_add(&cursor[edges[i].dst], 1);
+    });
+
+    offsets[0] = 0;
+    for (size_t n = 0; n < numNodes; ++n) {
+      offsets[n + 1] = offsets[n] + cursor[n];
+      cursor[n]      = offsets[n];
+    }
+
+    galois::do_all(galois::iterate(size_t{0}, edges.size()), [&](size_t i) {
+      const Edge& e = edges[i];
+      arcs[__sync_fetch_and_add(&cursor[e.src], 1)] = Arc{e.dst, e.weight, i};
+      arcs[__sync_fetch_and_add(&cursor[e.dst], 1)] = Arc{e.src, e.weight, i};
+    });
+  }
+
+  void operator()() {
+    buildCSR();
+
+    size_t numComponents = numNodes;
+    size_t rounds        = 0;
+
+    galois::LargeArray<uint32_t> parent;
+    galois::LargeArray<uint64_t> lightest;
+    galois::LargeArray<uint64_t> kept;
+    galois::LargeArray<uint64_t> degree;
+    parent.allocateInterleaved(numNodes);
+    lightest.allocateInterleaved(numNodes);
+    kept.allocateInterleaved(numNodes);
+    degree.allocateInterleaved(numNodes + 1);
+
+    while (numComponents > 0 && offsets[numComponents] > 0) {
+      rounds += 1;
+
+      // Find the lightest arc leaving each component
+      galois::do_all(
+          galois::iterate(size_t{0}, numComponents),
+          [&](size_t c) {
+            uint64_t best = NONE;
+            for (uint64_t a = offsets[c]; a < offsets[c + 1]; ++a) {
+              if (best == NONE || lighter(arcs[a], arcs[best]))
+                best = a;
+            }
+            lightest[c] = best;
+            parent[c]   = best == NONE ? c : arcs[best].dst;
+          },
+          galois::steal(), galois::loopname("FindLightest"));
+
+      // Hook along lightest arcs; of the two components that picked the same
+      // edge, the smaller one becomes the root
+      galois::do_all(
+          galois::iterate(size_t{0}, numComponents),
+          [&](size_t c) {
+            uint32_t p = parent[c];
+            if (p == c)
+              return;
+            if (parent[p] == c && c < p) {
+              parent[c] = c;
+              return;
+            }
+            forest.push(edges[arcs[lightest[c]].id]);
+          },
+          galois::loopname("Hook"));
+
+      // Collapse each hooked tree onto its root
+      galois::GReduceLogicalOR changed;
+      do {
+        changed.reset();
+        galois::do_all(
+            galois::iterate(size_t{0}, numComponents),
+            [&](size_t c) {
+              uint32_t p  = parent[c];
+              uint32_t gp = parent[p];
+              if (p != gp) {
+                parent[c] = gp;
+                changed.update(true);
+              }
+            },
+            galois::loopname("PointerJump"));
+      } while (changed.reduce());
+
+      // Count the arcs that survive contraction, by new component
+      galois::do_all(galois::iterate(size_t{0}, numComponents + 1),
+                     [&](size_t c) { degree[c] = 0; });
+      galois::do_all(
+          galois::iterate(size_t{0}, numComponents),
+          [&](size_t c) {
+            uint32_t root  = parent[c];
+            uint64_t count = 0;
+            for (uint64_t a = offsets[c]; a < offsets[c + 1]; ++a) {
+              if (parent[arcs[a].dst] != root)
+                count += 1;
+            }
+            kept[c] = count;
+            if (count)
+              __sync_fetch_and_add(&degree[root], count);
+          },
+          galois::steal(), galois::loopname("CountArcs"));
+
+      // Renumber roots that still have arcs; reuse lightest as the new id
+      size_t nextComponents = 0;
+      nextOffsets[0]        = 0;
+      for (size_t c = 0; c < numComponents; ++c) {
+        if (degree[c] == 0)
+          continue;
+        lightest[c] = nextComponents;
+        nextOffsets[nextComponents + 1] =
+            nextOffsets[nextComponents] + degree[c];
+        degree[c] = nextOffsets[nextComponents];
+        nextComponents += 1;
+      }
+
+      galois::do_all(
+          galois::iterate(size_t{0}, numComponents),
+          [&](size_t c) {
+            if (kept[c] == 0)
+              return;
+            // Reserve one block per component rather than one slot per arc
+            uint32_t root = parent[c];
+            uint64_t pos  = __sync_fetch_and_add(&degree[root], kept[c]);
+            for (uint64_t a = offsets[c]; a < offsets[c + 1]; ++a) {
+              uint32_t other = parent[arcs[a].dst];
+              if (other == root)
+                continue;
+              Arc arc          = arcs[a];
+              arc.dst          = lightest[other];
+              nextArcs[pos++] = arc;
+            }
+          },
+          galois::steal(), galois::loopname("Contract"));
+
+      numComponents = nextComponents;
+      std::swap(offsets, nextOffsets);
+      std::swap(arcs, nextArcs);
+    }
+
+    galois::runtime::reportStat_Single("ArrayBoruvka", "rounds", rounds);
+  }
+};
+
+/**
+ * Checks that the forest is acyclic, spans every component of the graph, and
+ * has the same weight as a serial Kruskal over a copy of the edges.
+ */
+bool verify(const EdgeList& edges, Forest& forest, size_t numNodes,
+            size_t weight) {
+  Components components;
+  components.create(numNodes);
+
+  size_t numEdges = 0;
+  for (auto& e : forest) {
+    if (!components[e.src].merge(&components[e.dst])) {
+      std::cerr << "Forest has a cycle through edge " << e.src << " "
+                << e.dst << "\n";
+      return false;
+    }
+    numEdges += 1;
+  }
+
+  auto isBad = [&](const Edge& e) {
+    return components[e.src].findAndCompress() !=
+           components[e.dst].findAndCompress();
+  };
+  auto bad = galois::ParallelSTL::find_if(edges.begin(), edges.end(), isBad);
+  if (bad != edges.end()) {
+    std::cerr << "Forest does not span edge " << bad->src << " " << bad->dst
+              << "\n";
+    return false;
+  }
+
+  std::cout << "Num trees: " << numNodes - numEdges << "\n";
+  std::cout << "Tree edges: " << numEdges << "\n";
+
+  EdgeList sorted;
+  sorted.allocateInterleaved(edges.size());
+  std::copy(edges.begin(), edges.end(), sorted.begin());
+  std::sort(sorted.begin(), sorted.end(), FilterKruskal::lighter);
+
+  Components reference;
+  reference.create(numNodes);
+  size_t expected = 0;
+  for (auto& e : sorted) {
+    if (reference[e.src].merge(&reference[e.dst]))
+      expected += e.weight;
+  }
+
+  if (expected != weight) {
+    std::cerr << "MST weight " << weight << " but serial Kruskal found "
+              << expected << "\n";
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  galois::SharedMemSys G;
+  LonestarStart(argc, argv, name, desc, url);
+
+  EdgeList edges;
+  Components components;
+  Forest forest;
+
+  galois::StatTimer Tinitial("InitializeTime");
+  Tinitial.start();
+  size_t numNodes = readEdges(edges);
+  Tinitial.stop();
+
+  std::cout << "Nodes: " << numNodes << " edges: " << edges.size() << "\n";
+
+  galois::preAlloc(8 * galois::getActiveThreads() +
+                   (sizeof(Edge) * numNodes) / galois::runtime::pagePoolSize());
+  galois::reportPageAlloc("MeminfoPre");
+
+  galois::StatTimer T;
+  T.start();
+  switch (algo) {
+  case filterKruskal: {
+    components.create(numNodes);
+    FilterKruskal mst(components, forest, numNodes);
+    mst(edges.begin(), edges.end());
+    galois::runtime::reportStat_Single("FilterKruskal", "filtered",
+                                       mst.numFiltered);
+    break;
+  }
+  case boruvka: {
+    ArrayBoruvka mst(edges, forest, numNodes);
+    mst();
+    break;
+  }
+  default:
+    GALOIS_DIE("unknown algo");
+  }
+  T.stop();
+
+  galois::reportPageAlloc("MeminfoPost");
+
+  auto getWeight = [](const Edge& e) { return e.weight; };
+  size_t weight  = galois::ParallelSTL::map_reduce(
+      forest.begin(), forest.end(), getWeight, std::plus<size_t>(), 0ul);
+
+  std::cout << "MST weight: " << weight << std::endl;
+
+  if (!skipVerify && !verify(edges, forest, numNodes, weight)) {
+    GALOIS_DIE("verification failed");
+  }
+
+  return 0;
+}
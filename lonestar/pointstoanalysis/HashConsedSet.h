@@ -0,0 +1,833 @@
+/*
+ * This file belongs to the Galois project, a C++ library for exploiting parallelism.
+ * The code is being released under the terms of the 3-Clause BSD License (a
+ * copy is located in LICENSE.txt at the top-level directory).
+ *
+ * Copyright (C) 2018, The University of Texas at Austin. All rights reserved.
+ * UNIVERSITY EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES CONCERNING THIS
+ * SOFTWARE AND DOCUMENTATION, INCLUDING ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR ANY PARTICULAR PURPOSE, NON-INFRINGEMENT AND WARRANTIES OF
+ * PERFORMANCE, AND ANY WARRANTY THAT MIGHT OTHERWISE ARISE FROM COURSE OF
+ * DEALING OR USAGE OF TRADE.  NO WARRANTY IS EITHER EXPRESS OR IMPLIED WITH
+ * RESPECT TO THE USE OF THE SOFTWARE OR DOCUMENTATION. Under no circumstances
+ * shall University be liable for incidental, special, indirect, direct or
+ * consequential damages or loss of profits, interruption of business, or
+ * related expenses which may arise from use of Software or Documentation,
+ * including but not limited to those resulting from defects in Software and/or
+ * Documentation, or loss or inaccuracy of data of any kind.
+ */
+
+#ifndef _GALOIS_HASHCONSEDSET_
+#define _GALOIS_HASHCONSEDSET_
+
+#include <galois/AtomicWrapper.h>
+#include <galois/Reduction.h>
+#include <galois/runtime/Statistics.h>
+#include <galois/substrate/PaddedLock.h>
+#include <galois/substrate/PerThreadStorage.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <boost/iterator/iterator_facade.hpp>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace galois {
+
+/**
+ * Immutable set of unsigned integers stored as containers in the style of
+ * Roaring bitmaps.
+ *
+ * The high 16 bits of an element select a container and the low 16 bits are
+ * stored in it. A container is either a sorted array of values (at most
+ * ARRAY_MAX of them), a bitmap of 2^16 bits, or a list of runs, whichever is
+ * smallest. The choice only depends on the contents, so two equal sets have
+ * identical representations and can be compared and hashed directly.
+ */
+class HybridBitSet {
+public:
+  //! maximum number of values in an array container
+  static const unsigned ARRAY_MAX = 4096;
+  //! number of words in a bitmap container
+  static const unsigned BITMAP_WORDS = (1 << 16) / 64;
+
+  struct Container {
+    enum Kind : uint8_t { ARRAY, BITMAP, RUN };
+
+    uint16_t key  = 0;
+    Kind kind     = ARRAY;
+    uint32_t card = 0;
+    //! ARRAY: sorted values; RUN: (start, length - 1) pairs
+    std::vector<uint16_t> values;
+    //! BITMAP: BITMAP_WORDS words
+    std::vector<uint64_t> words;
+
+    bool operator==(const Container& o) const {
+      return key == o.key && kind == o.kind && card == o.card &&
+             values == o.values && words == o.words;
+    }
+
+    bool contains(uint16_t low) const {
+      switch (kind) {
+      case ARRAY:
+        return std::binary_search(values.begin(), values.end(), low);
+      case BITMAP:
+        return (words[low >> 6] >> (low & 63)) & 1;
+      default: {
+        // find the last run starting at or before low
+        size_t lo = 0;
+        size_t hi = values.size() / 2;
+        while (lo < hi) {
+          size_t mid = (lo + hi) / 2;
+          if (values[2 * mid] <= low)
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+        return lo > 0 &&
+               unsigned(low - values[2 * (lo - 1)]) <= values[2 * lo - 1];
+      }
+      }
+    }
+
+    //! Sets the members of this container in a bitmap of BITMAP_WORDS words
+    void orInto(uint64_t* bits) const {
+      switch (kind) {
+      case ARRAY:
+        for (uint16_t v : values)
+          bits[v >> 6] |= uint64_t(1) << (v & 63);
+        break;
+      case BITMAP:
+        orWords(bits, bits, words.data());
+        break;
+      case RUN:
+        for (size_t i = 0; i < values.size(); i += 2)
+          setRange(bits, values[i], values[i] + values[i + 1]);
+        break;
+      }
+    }
+
+    //! Bytes of heap storage used by this container
+    size_t bytes() const {
+      return values.capacity() * sizeof(uint16_t) +
+             words.capacity() * sizeof(uint64_t);
+    }
+  };
+
+  /**
+   * Iterator over the members of a set in increasing order.
+   */
+  class Iterator
+      : public boost::iterator_facade<Iterator, const unsigned,
+                                      boost::forward_traversal_tag> {
+    const HybridBitSet* set = nullptr;
+    size_t container        = 0;
+    uint32_t pos            = 0; // array index, bit or offset in the run
+    uint32_t run            = 0; // run index
+    unsigned value          = 0;
+
+    //! Moves to the first member at or after the current position
+    void settle() {
+      for (; container < set->containers.size(); ++container, pos = 0) {
+        const Container& c = set->containers[container];
+        unsigned high      = unsigned(c.key) << 16;
+
+        if (c.kind == Container::ARRAY && pos < c.card) {
+          value = high | c.values[pos];
+          return;
+        } else if (c.kind == Container::BITMAP) {
+          for (unsigned w = pos >> 6; w < BITMAP_WORDS; ++w) {
+            uint64_t bits = c.words[w];
+            if (w == pos >> 6)
+              bits &= ~uint64_t(0) << (pos & 63);
+            if (bits) {
+              pos   = (w << 6) + __builtin_ctzll(bits);
+              value = high | pos;
+              return;
+            }
+          }
+        } else if (c.kind == Container::RUN) {
+          for (; 2 * run < c.values.size(); ++run, pos = 0) {
+            if (pos <= c.values[2 * run + 1]) {
+              value = high | (c.values[2 * run] + pos);
+              return;
+            }
+          }
+          run = 0;
+        }
+      }
+      set = nullptr;
+    }
+
+    friend class boost::iterator_core_access;
+
+    void increment() {
+      ++pos;
+      settle();
+    }
+
+    bool equal(const Iterator& o) const {
+      return set == o.set && (set == nullptr || (container == o.container &&
+                                                 pos == o.pos && run == o.run));
+    }
+
+    const unsigned& dereference() const { return value; }
+
+  public:
+    //! End iterator
+    Iterator() {}
+
+    Iterator(const HybridBitSet* s) : set(s) {
+      if (set)
+        settle();
+    }
+  };
+
+private:
+  std::vector<Container> containers; // sorted by key
+  size_t cardinality = 0;
+  size_t hashValue   = 0;
+
+  // bookkeeping of HybridSetTable
+  template <bool>
+  friend class HybridSetTable;
+  mutable std::atomic<unsigned> refs{0};
+  mutable bool retired = false;
+
+  //! dst = a | b over BITMAP_WORDS words
+  static void orWords(uint64_t* dst, const uint64_t* a, const uint64_t* b) {
+#if defined(__AVX2__)
+    for (unsigned i = 0; i < BITMAP_WORDS; i += 4) {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                          _mm256_or_si256(va, vb));
+    }
+#else
+    for (unsigned i = 0; i < BITMAP_WORDS; ++i)
+      dst[i] = a[i] | b[i];
+#endif
+  }
+
+  //! true if every bit set in a is set in b
+  static bool subsetWords(const uint64_t* a, const uint64_t* b) {
+#if defined(__AVX2__)
+    for (unsigned i = 0; i < BITMAP_WORDS; i += 4) {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      // testc(vb, va) is set iff (~vb & va) == 0
+      if (!_mm256_testc_si256(vb, va))
+        return false;
+    }
+    return true;
+#else
+    uint64_t extra = 0;
+    for (unsigned i = 0; i < BITMAP_WORDS; ++i)
+      extra |= a[i] & ~b[i];
+    return extra == 0;
+#endif
+  }
+
+  //! Sets bits first to last (inclusive)
+  static void setRange(uint64_t* bits, unsigned first, unsigned last) {
+    unsigned fw = first >> 6;
+    unsigned lw = last >> 6;
+    uint64_t fm = ~uint64_t(0) << (first & 63);
+    uint64_t lm = ~uint64_t(0) >> (63 - (last & 63));
+    if (fw == lw) {
+      bits[fw] |= fm & lm;
+      return;
+    }
+    bits[fw] |= fm;
+    for (unsigned w = fw + 1; w < lw; ++w)
+      bits[w] = ~uint64_t(0);
+    bits[lw] |= lm;
+  }
+
+  /**
+   * Picks the smallest representation for a container with card values
+   * forming numRuns runs.
+   */
+  static Container::Kind bestKind(size_t card, size_t numRuns) {
+    size_t arrayBytes  = card <= ARRAY_MAX ? 2 * card : SIZE_MAX;
+    size_t runBytes    = 4 * numRuns;
+    size_t bitmapBytes = 8 * BITMAP_WORDS;
+    if (arrayBytes <= runBytes && arrayBytes <= bitmapBytes)
+      return Container::ARRAY;
+    return runBytes < bitmapBytes ? Container::RUN : Container::BITMAP;
+  }
+
+  //! Fills out with the sorted values vals
+  static void fromArray(uint16_t key, std::vector<uint16_t>&& vals,
+                        Container& out) {
+    size_t numRuns = 0;
+    for (size_t i = 0; i < vals.size(); ++i)
+      numRuns += i == 0 || vals[i] != vals[i - 1] + 1;
+
+    out.key  = key;
+    out.card = vals.size();
+    out.kind = bestKind(out.card, numRuns);
+    out.words.clear();
+    if (out.kind == Container::ARRAY) {
+      out.values = std::move(vals);
+      return;
+    }
+
+    out.values.clear();
+    out.values.reserve(2 * numRuns);
+    for (size_t i = 0; i < vals.size(); ++i) {
+      if (i == 0 || vals[i] != vals[i - 1] + 1) {
+        out.values.push_back(vals[i]);
+        out.values.push_back(0);
+      } else {
+        out.values.back() += 1;
+      }
+    }
+  }
+
+  //! Fills out with the members of a bitmap of BITMAP_WORDS words
+  static void fromBitmap(uint16_t key, const uint64_t* bits, Container& out) {
+    size_t card    = 0;
+    size_t numRuns = 0;
+    uint64_t carry = 0;
+    for (unsigned i = 0; i < BITMAP_WORDS; ++i) {
+      uint64_t w = bits[i];
+      card += __builtin_popcountll(w);
+      // a run starts at every set bit whose predecessor is clear
+      numRuns += __builtin_popcountll(w & ~((w << 1) | carry));
+      carry = w >> 63;
+    }
+
+    out.key  = key;
+    out.card = card;
+    out.kind = bestKind(card, numRuns);
+    out.values.clear();
+    out.words.clear();
+
+    if (out.kind == Container::BITMAP) {
+      out.words.assign(bits, bits + BITMAP_WORDS);
+      return;
+    }
+
+    out.values.reserve(out.kind == Container::ARRAY ? card : 2 * numRuns);
+    bool inRun = false;
+    for (unsigned i = 0; i < BITMAP_WORDS; ++i) {
+      for (uint64_t w = bits[i]; w; w &= w - 1) {
+        unsigned v = (i << 6) + __builtin_ctzll(w);
+        if (out.kind == Container::ARRAY) {
+          out.values.push_back(v);
+        } else if (inRun && v == out.values[out.values.size() - 2] +
+                                     out.values.back() + 1u) {
+          out.values.back() += 1;
+        } else {
+          out.values.push_back(v);
+          out.values.push_back(0);
+          inRun = true;
+        }
+      }
+    }
+  }
+
+  //! out = a | b for containers with the same key
+  static void unionContainers(const Container& a, const Container& b,
+                              Container& out) {
+    if (a.kind == Container::ARRAY && b.kind == Container::ARRAY &&
+        a.card + b.card <= ARRAY_MAX) {
+      std::vector<uint16_t> merged;
+      merged.reserve(a.card + b.card);
+      std::set_union(a.values.begin(), a.values.end(), b.values.begin(),
+                     b.values.end(), std::back_inserter(merged));
+      fromArray(a.key, std::move(merged), out);
+      return;
+    }
+
+    alignas(32) uint64_t bits[BITMAP_WORDS];
+    if (a.kind == Container::BITMAP && b.kind == Container::BITMAP) {
+      orWords(bits, a.words.data(), b.words.data());
+    } else {
+      std::memset(bits, 0, sizeof(bits));
+      a.orInto(bits);
+      b.orInto(bits);
+    }
+    fromBitmap(a.key, bits, out);
+  }
+
+  //! true if a is a subset of b for containers with the same key
+  static bool subsetContainers(const Container& a, const Container& b) {
+    if (a.card > b.card)
+      return false;
+
+    if (a.kind == Container::ARRAY) {
+      if (b.kind == Container::ARRAY)
+        return std::includes(b.values.begin(), b.values.end(),
+                             a.values.begin(), a.values.end());
+      for (uint16_t v : a.values)
+        if (!b.contains(v))
+          return false;
+      return true;
+    }
+
+    alignas(32) uint64_t aBits[BITMAP_WORDS];
+    alignas(32) uint64_t bBits[BITMAP_WORDS];
+    const uint64_t* aw = a.words.data();
+    const uint64_t* bw = b.words.data();
+    if (a.kind != Container::BITMAP) {
+      std::memset(aBits, 0, sizeof(aBits));
+      a.orInto(aBits);
+      aw = aBits;
+    }
+    if (b.kind != Container::BITMAP) {
+      std::memset(bBits, 0, sizeof(bBits));
+      b.orInto(bBits);
+      bw = bBits;
+    }
+    return subsetWords(aw, bw);
+  }
+
+  //! Computes the cardinality and hash after the containers are built
+  void finish() {
+    cardinality = 0;
+    size_t h    = 0xcbf29ce484222325ull;
+    auto mix    = [&](uint64_t x) { h = (h ^ x) * 0x100000001b3ull; };
+    for (const Container& c : containers) {
+      cardinality += c.card;
+      mix(c.key);
+      mix(c.kind);
+      for (uint16_t v : c.values)
+        mix(v);
+      for (uint64_t w : c.words)
+        mix(w);
+    }
+    hashValue = h;
+  }
+
+public:
+  HybridBitSet() = default;
+
+  HybridBitSet(HybridBitSet&& o)
+      : containers(std::move(o.containers)), cardinality(o.cardinality),
+        hashValue(o.hashValue) {
+    o.clear();
+  }
+
+  void clear() {
+    containers.clear();
+    cardinality = 0;
+    hashValue   = 0;
+  }
+
+  bool empty() const { return cardinality == 0; }
+  size_t size() const { return cardinality; }
+  size_t hash() const { return hashValue; }
+
+  bool operator==(const HybridBitSet& o) const {
+    return cardinality == o.cardinality && hashValue == o.hashValue &&
+           containers == o.containers;
+  }
+
+  Iterator begin() const { return Iterator(this); }
+  Iterator end() const { return Iterator(); }
+
+  bool test(unsigned num) const {
+    uint16_t key = num >> 16;
+    auto ii      = std::lower_bound(
+        containers.begin(), containers.end(), key,
+        [](const Container& c, uint16_t k) { return c.key < k; });
+    return ii != containers.end() && ii->key == key && ii->contains(num);
+  }
+
+  //! true if every member of this set is in second
+  bool isSubsetEq(const HybridBitSet& second) const {
+    if (cardinality > second.cardinality)
+      return false;
+
+    auto jj = second.containers.begin();
+    auto ej = second.containers.end();
+    for (const Container& c : containers) {
+      while (jj != ej && jj->key < c.key)
+        ++jj;
+      if (jj == ej || jj->key != c.key || !subsetContainers(c, *jj))
+        return false;
+    }
+    return true;
+  }
+
+  //! Makes out the union of a and b
+  static void unionOf(const HybridBitSet& a, const HybridBitSet& b,
+                      HybridBitSet& out) {
+    out.clear();
+    out.containers.reserve(a.containers.size() + b.containers.size());
+
+    auto ii = a.containers.begin(), ei = a.containers.end();
+    auto jj = b.containers.begin(), ej = b.containers.end();
+    while (ii != ei || jj != ej) {
+      if (jj == ej || (ii != ei && ii->key < jj->key)) {
+        out.containers.push_back(*ii++);
+      } else if (ii == ei || jj->key < ii->key) {
+        out.containers.push_back(*jj++);
+      } else {
+        out.containers.emplace_back();
+        unionContainers(*ii++, *jj++, out.containers.back());
+      }
+    }
+    out.finish();
+  }
+
+  //! Makes this set the union of a (may be null for empty) and {num}
+  void assignWith(const HybridBitSet* a, unsigned num) {
+    HybridBitSet single;
+    single.containers.emplace_back();
+    single.containers.back().key  = num >> 16;
+    single.containers.back().card = 1;
+    single.containers.back().values.push_back(num & 0xFFFF);
+    single.finish();
+
+    if (a) {
+      unionOf(*a, single, *this);
+    } else {
+      *this = std::move(single);
+    }
+  }
+
+  HybridBitSet& operator=(HybridBitSet&& o) {
+    containers  = std::move(o.containers);
+    cardinality = o.cardinality;
+    hashValue   = o.hashValue;
+    o.clear();
+    return *this;
+  }
+
+  //! Bytes of memory used by this set
+  size_t bytes() const {
+    size_t total =
+        sizeof(HybridBitSet) + containers.capacity() * sizeof(Container);
+    for (const Container& c : containers)
+      total += c.bytes();
+    return total;
+  }
+};
+
+/**
+ * Hash-consing table of HybridBitSets: every distinct set is stored once and
+ * shared by all variables that hold it. Sets are reference counted; a set
+ * whose count drops to zero is retired and freed by reclaim(), which must be
+ * called when no thread is reading sets (e.g. between parallel loops).
+ *
+ * @tparam IsConcurrent if true, the table can be used by several threads
+ */
+template <bool IsConcurrent>
+class HybridSetTable {
+  using Lock = galois::substrate::PaddedLock<IsConcurrent>;
+
+  static const unsigned NUM_SHARDS = 64;
+
+  struct Shard {
+    Lock lock;
+    std::unordered_multimap<size_t, HybridBitSet*> sets;
+  };
+
+  Shard shards[NUM_SHARDS];
+  galois::substrate::PerThreadStorage<HybridBitSet> scratch;
+  galois::substrate::PerThreadStorage<std::vector<HybridBitSet*>> retired;
+  galois::GAccumulator<size_t> numInterned;
+  galois::GAccumulator<size_t> numShared;
+  galois::GAccumulator<size_t> numReclaimed;
+
+  Shard& shardOf(size_t hash) { return shards[hash % NUM_SHARDS]; }
+
+public:
+  HybridSetTable() = default;
+  HybridSetTable(const HybridSetTable&) = delete;
+  HybridSetTable& operator=(const HybridSetTable&) = delete;
+
+  ~HybridSetTable() {
+    for (Shard& shard : shards)
+      for (auto& entry : shard.sets)
+        delete entry.second;
+  }
+
+  //! Thread local set to build new sets in before interning them
+  HybridBitSet& scratchSet() { return *scratch.getLocal(); }
+
+  /**
+   * Returns the shared copy of s, adding s to the table if no equal set
+   * exists. The caller owns one reference to the result. The contents of s
+   * are consumed.
+   *
+   * @returns the shared set or nullptr if s is empty
+   */
+  const HybridBitSet* intern(HybridBitSet& s) {
+    if (s.empty())
+      return nullptr;
+
+    Shard& shard = shardOf(s.hash());
+    std::lock_guard<Lock> lg(shard.lock);
+
+    auto range = shard.sets.equal_range(s.hash());
+    for (auto ii = range.first; ii != range.second; ++ii) {
+      if (*ii->second == s) {
+        ii->second->refs.fetch_add(1, std::memory_order_relaxed);
+        numShared += 1;
+        return ii->second;
+      }
+    }
+
+    HybridBitSet* copy = new HybridBitSet(std::move(s));
+    copy->refs.store(1, std::memory_order_relaxed);
+    shard.sets.emplace(copy->hash(), copy);
+    numInterned += 1;
+    return copy;
+  }
+
+  //! Takes another reference to s
+  void acquire(const HybridBitSet* s) {
+    if (s)
+      s->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  //! Drops a reference to s; unreferenced sets are retired
+  void release(const HybridBitSet* s) {
+    if (!s || s->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+      return;
+
+    Shard& shard = shardOf(s->hash());
+    std::lock_guard<Lock> lg(shard.lock);
+    // intern may have handed out the set again in the meantime
+    if (s->refs.load(std::memory_order_relaxed) == 0 && !s->retired) {
+      s->retired = true;
+      retired.getLocal()->push_back(const_cast<HybridBitSet*>(s));
+    }
+  }
+
+  /**
+   * Frees retired sets that are still unreferenced. Not thread safe; call
+   * only when no other thread uses the table.
+   */
+  void reclaim() {
+    for (unsigned t = 0; t < retired.size(); ++t) {
+      std::vector<HybridBitSet*>& list = *retired.getRemote(t);
+      for (HybridBitSet* s : list) {
+        s->retired = false;
+        if (s->refs.load(std::memory_order_relaxed) != 0)
+          continue;
+
+        Shard& shard = shardOf(s->hash());
+        auto range   = shard.sets.equal_range(s->hash());
+        for (auto ii = range.first; ii != range.second; ++ii) {
+          if (ii->second == s) {
+            shard.sets.erase(ii);
+            break;
+          }
+        }
+        delete s;
+        numReclaimed += 1;
+      }
+      list.clear();
+    }
+  }
+
+  /**
+   * Reports the number of interned, shared (hash-consing hits) and reclaimed
+   * sets along with the number and size of the sets still alive.
+   *
+   * @param region statistics region to report under
+   */
+  void reportStats(const char* region) {
+    size_t live  = 0;
+    size_t bytes = 0;
+    for (Shard& shard : shards) {
+      live += shard.sets.size();
+      for (auto& entry : shard.sets)
+        bytes += entry.second->bytes();
+    }
+
+    galois::runtime::reportStat_Single(region, "SetsInterned",
+                                       numInterned.reduce());
+    galois::runtime::reportStat_Single(region, "SetsShared",
+                                       numShared.reduce());
+    galois::runtime::reportStat_Single(region, "SetsReclaimed",
+                                       numReclaimed.reduce());
+    galois::runtime::reportStat_Single(region, "LiveSets", live);
+    galois::runtime::reportStat_Single(region, "LiveSetBytes", bytes);
+  }
+};
+
+/**
+ * Points-to set of one variable: a reference to an immutable, hash-consed
+ * HybridBitSet. Variables with equal sets share a single copy. Updates build
+ * a new set and swap it in with a compare and swap, so reads never see a
+ * partially updated set. Has the same interface as SparseBitVector.
+ *
+ * @tparam IsConcurrent if true, the set may be updated by several threads
+ */
+template <bool IsConcurrent>
+class HashConsedSet {
+public:
+  //! shared storage of the sets
+  using Store    = HybridSetTable<IsConcurrent>;
+  using iterator = HybridBitSet::Iterator;
+
+private:
+  using SetPtr =
+      typename std::conditional<IsConcurrent,
+                                galois::CopyableAtomic<const HybridBitSet*>,
+                                const HybridBitSet*>::type;
+
+  SetPtr current; // nullptr for the empty set
+  Store* table;
+
+  const HybridBitSet* get() const { return current; }
+
+  template <bool A = IsConcurrent, typename std::enable_if<A>::type* = nullptr>
+  bool replace(const HybridBitSet* expected, const HybridBitSet* desired) {
+    return current.compare_exchange_strong(expected, desired);
+  }
+
+  template <bool A                             = IsConcurrent,
+            typename std::enable_if<!A>::type* = nullptr>
+  bool replace(const HybridBitSet*, const HybridBitSet* desired) {
+    current = desired;
+    return true;
+  }
+
+  /**
+   * Interns built and makes it the current set if the current set is still
+   * old.
+   *
+   * @returns true on success
+   */
+  bool install(const HybridBitSet* old, HybridBitSet& built) {
+    const HybridBitSet* replacement = table->intern(built);
+    if (replace(old, replacement)) {
+      table->release(old);
+      return true;
+    }
+    table->release(replacement);
+    return false;
+  }
+
+public:
+  HashConsedSet() : current(nullptr), table(nullptr) {}
+
+  /**
+   * Initialize to the empty set.
+   *
+   * @param _table table that stores the sets
+   */
+  void init(Store* _table) {
+    current = nullptr;
+    table   = _table;
+  }
+
+  iterator begin() const { return iterator(get()); }
+  iterator end() const { return iterator(); }
+
+  /**
+   * Adds num to the set.
+   *
+   * @returns true if num wasn't in the set before
+   */
+  bool set(unsigned num) {
+    while (true) {
+      const HybridBitSet* old = get();
+      if (old && old->test(num))
+        return false;
+
+      HybridBitSet& built = table->scratchSet();
+      built.assignWith(old, num);
+      if (install(old, built))
+        return true;
+    }
+  }
+
+  bool test(unsigned num) const {
+    const HybridBitSet* s = get();
+    return s && s->test(num);
+  }
+
+  /**
+   * @param second set to compare with
+   * @returns true if this set is a subset of second
+   */
+  bool isSubsetEq(const HashConsedSet& second) const {
+    const HybridBitSet* a = get();
+    const HybridBitSet* b = second.get();
+    if (a == b || !a)
+      return true;
+    if (!b)
+      return false;
+    return a->isSubsetEq(*b);
+  }
+
+  /**
+   * Adds the members of second to this set.
+   *
+   * @param second set to merge into this one
+   * @returns a non-zero value if this set changed
+   */
+  unsigned unify(const HashConsedSet& second) {
+    while (true) {
+      const HybridBitSet* a = get();
+      const HybridBitSet* b = second.get();
+      if (a == b || !b)
+        return 0;
+
+      if (!a) {
+        // adopt the set of second
+        table->acquire(b);
+        if (replace(a, b))
+          return 1;
+        table->release(b);
+        continue;
+      }
+
+      if (b->isSubsetEq(*a))
+        return 0;
+
+      HybridBitSet& built = table->scratchSet();
+      HybridBitSet::unionOf(*a, *b, built);
+      if (install(a, built))
+        return 1;
+    }
+  }
+
+  //! @returns number of members
+  unsigned count() const {
+    const HybridBitSet* s = get();
+    return s ? s->size() : 0;
+  }
+
+  //! @returns all members in increasing order
+  std::vector<unsigned> getAllSetBits() const {
+    return std::vector<unsigned>(begin(), end());
+  }
+
+  /**
+   * Output the members of this set.
+   *
+   * @param out Stream to output to
+   * @param prefix A string to prepend to every member
+   */
+  void print(std::ostream& out, std::string prefix = std::string("")) const {
+    std::vector<unsigned> setBits = getAllSetBits();
+    out << "Elements(" << setBits.size() << "): ";
+
+    for (auto setBitNum : setBits) {
+      out << prefix << setBitNum << ", ";
+    }
+
+    out << "\n";
+  }
+};
+
+} // namespace galois
+
+#endif
@@ -24,6 +24,7 @@
 #include <fstream>
 #include <deque>
 #include "SparseBitVector.h"
+#include "HashConsedSet.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // Command line parameters
@@ -59,6 +60,17 @@ static cll::opt<bool>
                                 "(default false)"),
                       cll::init(false));
 
+enum PointsToSetKind { sbv, hybrid };
+
+static cll::opt<PointsToSetKind> pointsToSet(
+    "ptsSet", cll::desc("Representation of points-to sets:"),
+    cll::values(clEnumValN(sbv, "sbv", "Linked list sparse bit vector "
+                                       "(default)"),
+                clEnumValN(hybrid, "hybrid",
+                           "Hash-consed array/bitmap/run container sets"),
+                clEnumValEnd),
+    cll::init(sbv));
+
 static cll::opt<unsigned>
     THRESHOLD_LS("lsThreshold",
                  cll::desc("Determines how many constraints to "
@@ -125,27 +137,51 @@ public:
   }
 };
 
+//! Sparse bit vectors are updated in place; there is nothing to reclaim
+template <typename Store>
+void reclaimPointsToSets(Store&) {}
+
+//! Frees hash-consed points-to sets that are no longer referenced
+template <bool IsConcurrent>
+void reclaimPointsToSets(galois::HybridSetTable<IsConcurrent>& table) {
+  table.reclaim();
+}
+
+template <typename Store>
+void reportPointsToSets(Store&) {}
+
+template <bool IsConcurrent>
+void reportPointsToSets(galois::HybridSetTable<IsConcurrent>& table) {
+  table.reportStats("PointsToSets");
+}
+
 /**
  * Points to analysis runner base class. Does not have a run method itself.
  *
  * @tparam IsConcurrent if set to true, the data structures used for points
  * to results and outgoing edges will be thread safe
+ * @tparam PointsToSet representation of points-to sets (SparseBitVector or
+ * HashConsedSet); outgoing edges always use SparseBitVector
  */
-template <bool IsConcurrent>
+template <bool IsConcurrent, typename PointsToSet>
 class PTABase {
   // sparse bit vector is concurrent or serial based on template parameter
   using SparseBitVector = galois::SparseBitVector<IsConcurrent>;
 
   using PointsToConstraints = std::vector<PtsToCons>;
-  using PointsToInfo        = std::vector<SparseBitVector>;
+  using PointsToInfo        = std::vector<PointsToSet>;
   using EdgeVector          = std::vector<SparseBitVector>;
 
+public:
   using NodeAllocator =
       galois::FixedSizeAllocator<typename SparseBitVector::Node>;
+  // storage shared by the points-to sets
+  using PointsToStore = typename PointsToSet::Store;
 
 protected:
   PointsToInfo pointsToResult; // pointsTo results for nodes
   EdgeVector outgoingEdges;    // holds outgoing edges of a node
+  PointsToStore* pointsToStore = nullptr;
 
   PointsToConstraints addressCopyConstraints;
   PointsToConstraints loadStoreConstraints;
@@ -158,8 +194,7 @@ protected:
    */
   struct OnlineCycleDetection {
   private:
-    PTABase<IsConcurrent>&
-        outerPTA; // reference to outer PTA instance to get runtime info
+    PTABase& outerPTA; // reference to outer PTA instance to get runtime info
 
     galois::gstl::Vector<unsigned> ancestors; // TODO find better representation
     galois::gstl::Vector<bool> visited;       // TODO use better representation
@@ -286,7 +321,7 @@ protected:
     }
 
   public:
-    OnlineCycleDetection(PTABase<IsConcurrent>& o) : outerPTA(o) {}
+    OnlineCycleDetection(PTABase& o) : outerPTA(o) {}
 
     /**
      * Init fields (outerPTA needs to have numNodes set).
@@ -493,6 +528,12 @@ protected:
     return newPtsTo;
   }
 
+  /**
+   * Frees points-to sets that are no longer used. Only call this between
+   * loops, when no thread is reading points-to sets.
+   */
+  void reclaimPointsTo() { reclaimPointsToSets(*pointsToStore); }
+
 public:
   PTABase() : ocd(*this) {}
 
@@ -503,9 +544,12 @@ public:
    * @param n Number of nodes in the constraint graph
    * @param nodeAllocator galois allocator object to allocate nodes in the
    * sparse bit vector
+   * @param store storage for the points-to sets
    */
-  void initialize(size_t n, NodeAllocator& nodeAllocator) {
-    numNodes = n;
+  void initialize(size_t n, NodeAllocator& nodeAllocator,
+                  PointsToStore& store) {
+    numNodes      = n;
+    pointsToStore = &store;
 
     // initialize different constructs based on which version is being run
     pointsToResult.resize(numNodes);
@@ -513,7 +557,7 @@ public:
 
     // initialize vectors
     for (unsigned i = 0; i < numNodes; i++) {
-      pointsToResult[i].init(&nodeAllocator);
+      pointsToResult[i].init(&store);
       outgoingEdges[i].init(&nodeAllocator);
     }
 
@@ -660,7 +704,16 @@ public:
 /**
  * Serial points to executor.
  */
-class PTASerial : public PTABase<false> {
+template <typename PointsToSet>
+class PTASerial : public PTABase<false, PointsToSet> {
+  using Base = PTABase<false, PointsToSet>;
+  using Base::addressCopyConstraints;
+  using Base::loadStoreConstraints;
+  using Base::numNodes;
+  using Base::ocd;
+  using Base::outgoingEdges;
+  using Base::propagate;
+
 public:
   /**
    * Run points-to-analysis on a single thread.
@@ -672,9 +725,11 @@ public:
     galois::gDebug("no of nodes = ", numNodes);
 
     std::deque<unsigned> updates;
-    updates = processAddressOfCopy<galois::StdForEach, std::deque<unsigned>>(
+    updates = this->template processAddressOfCopy<galois::StdForEach,
+                                                  std::deque<unsigned>>(
         addressCopyConstraints);
-    processLoadStore<galois::StdForEach>(loadStoreConstraints, updates);
+    this->template processLoadStore<galois::StdForEach>(loadStoreConstraints,
+                                                        updates);
 
     unsigned numUps = 0;
 
@@ -696,15 +751,18 @@ public:
 
       if (updates.empty() || numUps >= THRESHOLD_LS) {
         galois::gDebug("No of points-to facts computed = ",
-                       countPointsToFacts());
+                       this->countPointsToFacts());
         numUps = 0;
 
         // After propagating all constraints, see if load/store
         // constraints need to be added in since graph was potentially updated
-        processLoadStore<galois::StdForEach>(loadStoreConstraints, updates);
+        this->template processLoadStore<galois::StdForEach>(
+            loadStoreConstraints, updates);
 
         // do cycle squashing
         ocd.process(updates);
+
+        this->reclaimPointsTo();
       }
     }
   }
@@ -713,7 +771,13 @@ public:
 /**
  * Concurrent points to executor.
  */
-class PTAConcurrent : public PTABase<true> {
+template <typename PointsToSet>
+class PTAConcurrent : public PTABase<true, PointsToSet> {
+  using Base = PTABase<true, PointsToSet>;
+  using Base::addressCopyConstraints;
+  using Base::loadStoreConstraints;
+  using Base::numNodes;
+
 public:
   /**
    * Run points-to-analysis using galois::for_each as the main loop.
@@ -725,9 +789,11 @@ public:
     galois::gDebug("no of nodes = ", numNodes);
 
     galois::InsertBag<unsigned> updates;
-    updates = processAddressOfCopy<galois::DoAll, galois::InsertBag<unsigned>>(
+    updates = this->template processAddressOfCopy<galois::DoAll,
+                                                  galois::InsertBag<unsigned>>(
         addressCopyConstraints);
-    processLoadStore<galois::DoAll>(loadStoreConstraints, updates);
+    this->template processLoadStore<galois::DoAll>(loadStoreConstraints,
+                                                   updates);
 
     while (!updates.empty()) {
       galois::for_each(
@@ -746,13 +812,18 @@ public:
                                                                  // with this
       );
 
-      galois::gDebug("No of points-to facts computed = ", countPointsToFacts());
+      galois::gDebug("No of points-to facts computed = ",
+                     this->countPointsToFacts());
 
       updates.clear();
 
+      // no operator is running, so unused points-to sets can be freed
+      this->reclaimPointsTo();
+
       // After propagating all constraints, see if load/store constraints need
       // to be added in since graph was potentially updated
-      processLoadStore<galois::DoAll>(loadStoreConstraints, updates);
+      this->template processLoadStore<galois::DoAll>(loadStoreConstraints,
+                                                     updates);
 
       // do cycle squashing
       // ocd.process(updates); // TODO have parallel OCD, if possible
@@ -763,10 +834,15 @@ public:
 /**
  * Method from running PTA.
  */
-template <typename PTAClass, typename Alloc>
-void runPTA(PTAClass& pta, Alloc nodeAllocator) {
+template <typename PTAClass>
+void runPTA() {
+  // declared before pta so that they outlive it
+  typename PTAClass::NodeAllocator nodeAllocator;
+  typename PTAClass::PointsToStore pointsToStore;
+  PTAClass pta;
+
   size_t numNodes = pta.readConstraints(input.c_str());
-  pta.initialize(numNodes, nodeAllocator);
+  pta.initialize(numNodes, nodeAllocator, pointsToStore);
 
   galois::StatTimer T; // main timer
 
@@ -775,6 +851,7 @@ void runPTA(PTAClass& pta, Alloc nodeAllocator) {
   T.stop();
 
   galois::gInfo("No of points-to facts computed = ", pta.countPointsToFacts());
+  reportPointsToSets(pointsToStore);
 
   if (!skipVerify) {
     galois::gInfo("Doing verification step");
@@ -799,20 +876,22 @@ int main(int argc, char** argv) {
     galois::gInfo("Note correctness of this version is relative to the serial "
                   "version.");
 
-    PTAConcurrent p;
-    galois::FixedSizeAllocator<typename galois::SparseBitVector<true>::Node>
-        nodeAllocator;
-    runPTA(p, nodeAllocator);
+    if (pointsToSet == hybrid) {
+      runPTA<PTAConcurrent<galois::HashConsedSet<true>>>();
+    } else {
+      runPTA<PTAConcurrent<galois::SparseBitVector<true>>>();
+    }
   } else {
     galois::gInfo("-------- Sequential version.");
     galois::gInfo(
         "The load store threshold (-lsThreshold) may need tweaking for "
         "best performance; its current setting may not be the best for "
         "your input and may actually degrade performance.");
-    PTASerial p;
-    galois::FixedSizeAllocator<typename galois::SparseBitVector<false>::Node>
-        nodeAllocator;
-    runPTA(p, nodeAllocator);
+    if (pointsToSet == hybrid) {
+      runPTA<PTASerial<galois::HashConsedSet<false>>>();
+    } else {
+      runPTA<PTASerial<galois::SparseBitVector<false>>>();
+    }
   }
 
   return 0;
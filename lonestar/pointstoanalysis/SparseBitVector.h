@@ -357,6 +357,9 @@ struct SparseBitVector {
 
   //////////////////////////////////////////////////////////////////////////////
 
+  //! allocator passed to init
+  using Store = galois::FixedSizeAllocator<Node>;
+
   using NodeType =
       typename std::conditional<IsConcurrent, galois::CopyableAtomic<Node*>,
                                 Node*>::type;
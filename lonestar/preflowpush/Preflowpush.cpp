@@ -49,6 +49,16 @@ static cll::opt<uint32_t> sinkId(cll::Positional, cll::desc("sinkID"),
 static cll::opt<bool> useHLOrder("useHLOrder",
                                  cll::desc("Use HL ordering heuristic"),
                                  cll::init(false));
+static cll::opt<unsigned>
+    hlShift("hlShift",
+            cll::desc("HL ordering groups 2^hlShift heights per OBIM bucket "
+                      "(default 0)"),
+            cll::init(0));
+static cll::opt<bool>
+    useGapRelabel("useGap",
+                  cll::desc("Use gap relabeling heuristic; only used by "
+                            "the non-deterministic algorithm (default true)"),
+                  cll::init(true));
 static cll::opt<bool>
     useUnitCapacity("useUnitCapacity",
                     cll::desc("Assume all capacities are unit"),
@@ -68,6 +78,10 @@ static cll::opt<DetAlgo> detAlgo(
                 clEnumVal(detBase, "Base execution"),
                 clEnumVal(detDisjoint, "Disjoint execution"), clEnumValEnd),
     cll::init(nondet));
+static cll::opt<bool> detAdaptive(
+    "detAdaptive",
+    cll::desc("Size deterministic rounds from the previous commit ratio"),
+    cll::init(false));
 
 /**
  * Alpha parameter the original Goldberg algorithm to control when global
@@ -113,6 +127,11 @@ struct PreflowPush {
   GNode source;
   int global_relabel_interval;
   bool should_global_relabel = false;
+  bool should_gap_relabel    = false;
+  //! number of nodes at each height below graph.size(); only maintained when
+  //! the gap heuristic is used
+  galois::LargeArray<int> heightCount;
+  bool trackGaps = false;
   galois::LargeArray<Graph::edge_iterator>
       reverseDirectionEdgeIterator; // ideally should be on the graph as
                                     // graph.getReverseEdgeIterator()
@@ -206,6 +225,19 @@ struct PreflowPush {
     }
   }
 
+  /**
+   * Update the height counts when a node is relabeled. A height whose count
+   * drops to zero is a potential gap; it is checked once the discharge loop
+   * is stopped since counts may be transiently off while threads relabel.
+   */
+  void moveHeight(int oldHeight, int newHeight) {
+    if (newHeight < (int)graph.size())
+      __sync_fetch_and_add(&heightCount[newHeight], 1);
+    if (oldHeight < (int)graph.size() &&
+        __sync_sub_and_fetch(&heightCount[oldHeight], 1) == 0)
+      should_gap_relabel = true;
+  }
+
   void relabel(const GNode& src) {
     int minHeight = std::numeric_limits<int>::max();
     int minEdge   = 0;
@@ -227,13 +259,16 @@ struct PreflowPush {
     assert(minHeight != std::numeric_limits<int>::max());
     ++minHeight;
 
-    Node& node = graph.getData(src, galois::MethodFlag::UNPROTECTED);
+    Node& node    = graph.getData(src, galois::MethodFlag::UNPROTECTED);
+    int oldHeight = node.height;
     if (minHeight < (int)graph.size()) {
       node.height  = minHeight;
       node.current = minEdge;
     } else {
       node.height = graph.size();
     }
+    if (trackGaps)
+      moveHeight(oldHeight, node.height);
   }
 
   template <typename C>
@@ -303,10 +338,8 @@ struct PreflowPush {
     return relabeled;
   }
 
-  template <DetAlgo version>
+  template <DetAlgo version, typename DWL>
   void detDischarge(galois::InsertBag<GNode>& initial, Counter& counter) {
-    typedef galois::worklists::Deterministic<> DWL;
-
     auto detIDfn = [this](const GNode& item) -> uint32_t {
       return graph.getData(item, galois::MethodFlag::UNPROTECTED).id;
     };
@@ -358,10 +391,14 @@ struct PreflowPush {
     // per thread
     const int relabel_interval =
         global_relabel_interval / galois::getActiveThreads();
+    // stopping for a gap costs O(n) instead of O(m) for a global relabel, so
+    // it may happen more often but not after every relabel
+    const int gap_interval = relabel_interval / 8;
 
     galois::for_each(
         galois::iterate(initial),
-        [&counter, relabel_interval, this](GNode& src, auto& ctx) {
+        [&counter, relabel_interval, gap_interval, this](GNode& src,
+                                                         auto& ctx) {
           int increment = 1;
           this->acquire(src);
           if (this->discharge(src, ctx)) {
@@ -376,6 +413,11 @@ struct PreflowPush {
             ctx.breakLoop();
             return;
           }
+          if (this->should_gap_relabel &&
+              counter.peekLocal() >= gap_interval) {
+            ctx.breakLoop();
+            return;
+          }
         },
         galois::loopname("nonDetDischarge"), galois::parallel_break(), wl_opt);
   }
@@ -446,6 +488,116 @@ struct PreflowPush {
         galois::loopname("updateHeights"));
   }
 
+  /**
+   * Reverse BFS on residual graph, bulk-synchronous: every level is a
+   * do_all over the frontier of the previous level and a node joins the
+   * next frontier when it is the first to be reached, so its height is its
+   * exact BFS distance to the sink.
+   */
+  void updateHeightsBSP() {
+    const int unreached = graph.size();
+    galois::InsertBag<GNode> bags[2];
+    galois::InsertBag<GNode>* cur  = &bags[0];
+    galois::InsertBag<GNode>* next = &bags[1];
+    cur->push(sink);
+
+    for (int level = 1; !cur->empty(); ++level) {
+      galois::do_all(
+          galois::iterate(*cur),
+          [&, this](const GNode& src) {
+            for (auto ii :
+                 this->graph.edges(src, galois::MethodFlag::UNPROTECTED)) {
+              int64_t rdata =
+                  this->graph.getEdgeData(reverseDirectionEdgeIterator[*ii]);
+              if (rdata <= 0)
+                continue;
+              GNode dst = this->graph.getEdgeDst(ii);
+              Node& node =
+                  this->graph.getData(dst, galois::MethodFlag::UNPROTECTED);
+              if (node.height == unreached &&
+                  __sync_bool_compare_and_swap(&node.height, unreached,
+                                               level))
+                next->push(dst);
+            }
+          },
+          galois::steal(), galois::loopname("updateHeightsBSP"));
+      cur->clear();
+      std::swap(cur, next);
+    }
+  }
+
+  /**
+   * Collect the nodes with excess that can still reach the sink into
+   * incoming and, if gaps are tracked, recount the nodes at each height.
+   */
+  template <typename IncomingWL>
+  void findWork(IncomingWL& incoming) {
+    if (trackGaps) {
+      galois::do_all(galois::iterate(size_t{0}, graph.size()),
+                     [&](size_t h) { heightCount[h] = 0; },
+                     galois::loopname("ResetHeightCounts"));
+    }
+
+    galois::do_all(galois::iterate(graph),
+                   [&incoming, this](const GNode& src) {
+                     Node& node = this->graph.getData(
+                         src, galois::MethodFlag::UNPROTECTED);
+                     if (node.height >= (int)this->graph.size())
+                       return;
+                     if (this->trackGaps)
+                       __sync_fetch_and_add(&heightCount[node.height], 1);
+                     if (src == this->sink || src == this->source)
+                       return;
+                     if (node.excess > 0)
+                       incoming.push_back(src);
+                   },
+                   galois::loopname("FindWork"));
+    should_gap_relabel = false;
+  }
+
+  /**
+   * Gap heuristic: if no node has height g, nodes above g cannot reach the
+   * sink any more and are lifted to graph.size(). Called while no discharge
+   * is running so the height counts are exact.
+   *
+   * @returns number of lifted nodes
+   */
+  template <typename IncomingWL>
+  size_t gapRelabel(IncomingWL& incoming) {
+    const int n   = graph.size();
+    int sinkLevel = graph.getData(sink, galois::MethodFlag::UNPROTECTED).height;
+
+    findWork(incoming);
+    galois::GReduceMin<int> minGap;
+    galois::do_all(galois::iterate(sinkLevel + 1, n),
+                   [&](int h) {
+                     if (heightCount[h] == 0)
+                       minGap.update(h);
+                   },
+                   galois::loopname("FindGap"));
+    int gap = minGap.reduce();
+    if (gap >= n)
+      return 0;
+
+    galois::GAccumulator<size_t> lifted;
+    galois::do_all(galois::iterate(graph),
+                   [&, this](const GNode& src) {
+                     Node& node = this->graph.getData(
+                         src, galois::MethodFlag::UNPROTECTED);
+                     if (src != this->source && node.height > gap &&
+                         node.height < n) {
+                       node.height = n;
+                       lifted += 1;
+                     }
+                   },
+                   galois::loopname("GapRelabel"));
+    if (lifted.reduce()) {
+      incoming.clear();
+      findWork(incoming);
+    }
+    return lifted.reduce();
+  }
+
   template <typename IncomingWL>
   void globalRelabel(IncomingWL& incoming) {
 
@@ -460,34 +612,30 @@ struct PreflowPush {
                    },
                    galois::loopname("ResetHeights"));
 
-    using BSWL = galois::worklists::BulkSynchronous<>;
     using DWL  = galois::worklists::Deterministic<>;
+    using ADWL = galois::worklists::DeterministicAdaptive<>;
     switch (detAlgo) {
     case nondet:
-      updateHeights<nondet, BSWL>();
+      updateHeightsBSP();
       break;
     case detBase:
-      updateHeights<detBase, DWL>();
+      if (detAdaptive)
+        updateHeights<detBase, ADWL>();
+      else
+        updateHeights<detBase, DWL>();
       break;
     case detDisjoint:
-      updateHeights<detDisjoint, DWL>();
+      if (detAdaptive)
+        updateHeights<detDisjoint, ADWL>();
+      else
+        updateHeights<detDisjoint, DWL>();
       break;
     default:
       std::cerr << "Unknown algorithm" << detAlgo << "\n";
       abort();
     }
 
-    galois::do_all(galois::iterate(graph),
-                   [&incoming, this](const GNode& src) {
-                     Node& node = this->graph.getData(
-                         src, galois::MethodFlag::UNPROTECTED);
-                     if (src == this->sink || src == this->source ||
-                         node.height >= (int)this->graph.size())
-                       return;
-                     if (node.excess > 0)
-                       incoming.push_back(src);
-                   },
-                   galois::loopname("FindWork"));
+    findWork(incoming);
   }
 
   template <typename C>
@@ -505,20 +653,39 @@ struct PreflowPush {
 
   void run() {
     Graph *captured_graph = &graph;
+    unsigned shift        = hlShift;
+    // two levels: OBIM buckets of heights, chunked FIFO inside each bucket
     auto obimIndexer = [=](const GNode& n) {
-      return -captured_graph->getData(n, galois::MethodFlag::UNPROTECTED).height;
+      return -(captured_graph->getData(n, galois::MethodFlag::UNPROTECTED)
+                   .height >>
+               shift);
     };
 
     typedef galois::worklists::PerSocketChunkFIFO<16> Chunk;
     typedef galois::worklists::OrderedByIntegerMetric<decltype(obimIndexer),
                                                       Chunk>
         OBIM;
+    typedef galois::worklists::Deterministic<> DWL;
+    typedef galois::worklists::DeterministicAdaptive<> ADWL;
 
     galois::InsertBag<GNode> initial;
     initializePreflow(initial);
 
+    trackGaps = useGapRelabel && detAlgo == nondet;
+    if (trackGaps) {
+      heightCount.allocateInterleaved(graph.size());
+      initial.clear();
+      findWork(initial);
+    }
+
+    galois::StatTimer T_discharge("DischargeTime");
+    galois::StatTimer T_global_relabel("GlobalRelabelTime");
+    galois::StatTimer T_gap_relabel("GapRelabelTime");
+    size_t numGlobalRelabels = 0;
+    size_t numGapRelabels    = 0;
+    size_t numGapLifted      = 0;
+
     while (initial.begin() != initial.end()) {
-      galois::StatTimer T_discharge("DischargeTime");
       T_discharge.start();
       Counter counter;
       switch (detAlgo) {
@@ -530,10 +697,16 @@ struct PreflowPush {
         }
         break;
       case detBase:
-        detDischarge<detBase>(initial, counter);
+        if (detAdaptive)
+          detDischarge<detBase, ADWL>(initial, counter);
+        else
+          detDischarge<detBase, DWL>(initial, counter);
         break;
       case detDisjoint:
-        detDischarge<detDisjoint>(initial, counter);
+        if (detAdaptive)
+          detDischarge<detDisjoint, ADWL>(initial, counter);
+        else
+          detDischarge<detDisjoint, DWL>(initial, counter);
         break;
       default:
         std::cerr << "Unknown algorithm" << detAlgo << "\n";
@@ -542,18 +715,36 @@ struct PreflowPush {
       T_discharge.stop();
 
       if (should_global_relabel) {
-        galois::StatTimer T_global_relabel("GlobalRelabelTime");
         T_global_relabel.start();
         initial.clear();
         globalRelabel(initial);
         should_global_relabel = false;
+        ++numGlobalRelabels;
         std::cout << " Flow after global relabel: "
                   << graph.getData(sink).excess << "\n";
         T_global_relabel.stop();
+      } else if (should_gap_relabel) {
+        T_gap_relabel.start();
+        initial.clear();
+        numGapLifted += gapRelabel(initial);
+        ++numGapRelabels;
+        T_gap_relabel.stop();
       } else {
         break;
       }
     }
+
+    std::cout << "Discharge time: " << T_discharge.get()
+              << " ms, relabel time: "
+              << T_global_relabel.get() + T_gap_relabel.get() << " ms ("
+              << numGlobalRelabels << " global relabels, " << numGapRelabels
+              << " gap checks lifting " << numGapLifted << " nodes)\n";
+    galois::runtime::reportStat_Single("PreflowPush", "GlobalRelabels",
+                                       numGlobalRelabels);
+    galois::runtime::reportStat_Single("PreflowPush", "GapRelabels",
+                                       numGapRelabels);
+    galois::runtime::reportStat_Single("PreflowPush", "GapLiftedNodes",
+                                       numGapLifted);
   }
 
   template <typename EdgeTy>